@@ -1,7 +1,6 @@
 // BeehiveMonitor_29.ino - top-level sketch (clean: only setup() and loop())
 
 #include <Arduino.h>
-#include <math.h> // for NAN / isnan
 #include "config.h"
 #include "ui.h"
 #include "menu_manager.h"
@@ -10,6 +9,9 @@
 #include "weather_manager.h"
 #include "key_server.h"
 #include "thingspeak_client.h"
+#include "collector_client.h"
+#include "mqtt_client.h"
+#include "http_pool.h"
 #include "serial_commands.h"
 
 #include "network_manager.h"
@@ -19,6 +21,9 @@
 #include "sms_handler.h"
 #include "sensors.h"
 #include "sd_logger.h"
+#include "scheduler.h"
+#include "acquisition.h"
+#include "battery_monitor.h"
 
 #include <Preferences.h>
 #include <WiFi.h>
@@ -30,25 +35,7 @@
 // SD presence flag (set during setup)
 bool sd_present = false;
 
-// Sensor / telemetry globals (definitions) - initialize floats to NAN to indicate 'no reading'
-float test_weight = NAN;
-float test_temp_int = NAN;
-float test_hum_int = NAN;
-float test_temp_ext = NAN;
-float test_hum_ext = NAN;
-float test_pressure = NAN;
-float test_acc_x = NAN;
-float test_acc_y = NAN;
-float test_acc_z = NAN;
-float test_batt_voltage = NAN;
-
-// GPS coordinates
-double test_lat = 0.0;
-double test_lon = 0.0;
-
-// integer sentinels
-int   test_batt_percent = -999; // sentinel: unknown
-int   test_rssi = -999;         // sentinel: unknown
+// Sensor values are published as one TelemetrySnapshot (telemetry.h).
 
 // single WebServer instance used by provisioning and other HTTP endpoints
 WebServer server(80);
@@ -137,6 +124,10 @@ void setup() {
   sd_present = false;
 #endif
 
+  // Sensors + acquisition task (samples independently of loop())
+  sensors_init();
+  acq_start();
+
   // Initialize SD logging (if SD card present)
   sdlog_init();
 
@@ -195,6 +186,8 @@ void setup() {
   }
 
   // Note: lcd_register is intentionally registered before keyServer to ensure "/" serves the UI.
+
+  scheduler_setup();
 }
 
 // =========================================================
@@ -205,9 +198,10 @@ void trigger_alarm(String reason) {
   
   // 1. Send SMS
   // Check if phone number is configured (not default placeholder)
+  // Queued, never blocks; repeats within SMS_COALESCE_MS become one "(xN)" SMS.
   String phone = ALARM_PHONE_NUMBER;
   if (phone.length() > 5 && phone != "+306912345678") {
-    sms_send(phone, "ALARM: " + reason);
+    sms_queue(phone.c_str(), ("ALARM: " + reason).c_str(), SMS_PRIO_ALARM, "alarm");
   } else {
     Serial.println("[ALARM] SMS skipped - phone number not configured");
   }
@@ -217,102 +211,171 @@ void trigger_alarm(String reason) {
 }
 
 // =========================================================
-// Main Loop
+// Scheduled jobs
 // =========================================================
-static unsigned long last_gps_update = 0;
+// loop() no longer polls every subsystem back-to-back: each one is a job
+// with its own period and loop() sleeps until the earliest deadline.
+static int job_upload = SCHED_INVALID_JOB;
+static int job_acq_id = SCHED_INVALID_JOB;
+static int job_battery_id = SCHED_INVALID_JOB;
+static int job_climate_id = SCHED_INVALID_JOB;
+static int job_modem_id = SCHED_INVALID_JOB;
+static int job_sms_id = SCHED_INVALID_JOB;
+static int job_sink_id = SCHED_INVALID_JOB;
+static TaskHandle_t loopTaskHandle = NULL;
+static unsigned long current_interval_ms = GPS_UPDATE_INTERVAL; // default from config.h
+
+static void job_menu()    { menuUpdate(); }
+static void job_time()    { timeManager_update(); }
+static void job_network() { manageAutoNetwork(); }
+static void job_serial()  { keyServer_loop(); serial_commands_poll(); }
+static void job_sms()     { sms_loop(); }
+static void job_http()    { server.handleClient(); }
+
+// AT engine: queued commands and unsolicited lines (+CGNSSINFO, +CMTI...).
+// Comes back quickly while commands are in flight.
+// The time to the next upload lets the modem sleep (PSM) until just before it;
+// idle keep-alive sockets and an MQTT session on the modem are closed
+// first, they keep it awake.
+static void job_modem() {
+  httpPool_service();
+  mqttClient_servicePower();
+  if (modem_service(sched_msUntilDue(job_upload))) sched_setNextDeadline(job_modem_id, 10);
+}
 
-void loop() {
-  menuUpdate();
-  timeManager_update();
-  manageAutoNetwork();
+// Samples come from the acquisition task; draining publishes them and
+// runs the accelerometer alarm check.
+static void job_acq()     { acq_drain(); }
 
-  keyServer_loop();
-  serial_commands_poll();
-  sms_loop();
+// Battery: a short ADC burst, then publish; the monitor picks the next deadline
+static void job_battery() {
+  uint32_t next_ms;
+  if (battery_poll(next_ms)) sensors_update_battery();
+  sched_setNextDeadline(job_battery_id, next_ms);
+}
 
-  server.handleClient();
+// Internal temperature: starts a conversion, reads it on the next run.
+// Feeds the load-cell temperature compensation.
+static void job_climate() {
+  uint32_t next_ms;
+  sensors_poll_internal(next_ms);
+  sched_setNextDeadline(job_climate_id, next_ms);
+}
 
-  // -------------------------------------------------------
-  // Sensor & Alarm Updates
-  // -------------------------------------------------------
-  
-  // TEST: Trigger alarm once after boot for testing
-  // COMMENTED OUT - System is stable, no need for test SMS anymore
-  /*
-  static bool test_alarm_triggered = false;
-  static unsigned long boot_time = millis();
-  if (!test_alarm_triggered && (millis() - boot_time > 30000)) {
-    test_alarm_triggered = true;
-    Serial.println("[TEST] Triggering test alarm 30s after boot...");
-    trigger_alarm("TEST: Accelerometer simulation after reboot");
+// Upload interval from preferences (0 = not set, use default)
+static void job_interval() {
+  Preferences p;
+  p.begin("beehive", true);
+  int mins = p.getInt("ts_interval", 0);
+  p.end();
+  unsigned long ms = (mins > 0) ? (unsigned long)mins * 60000UL : GPS_UPDATE_INTERVAL;
+  if (ms != current_interval_ms) {
+    current_interval_ms = ms;
+    sched_setPeriod(job_upload, current_interval_ms);
   }
-  */
-  
-  // 1. Accelerometer: Check frequently (every loop or fast interval)
-  // The sensor module handles the threshold check and calls trigger_alarm if needed.
-  sensors_update_accel();
-
-  // 2. GPS & ThingSpeak: Check periodically based on configured interval
-  // We read the interval from preferences (or default 60 min).
-  // Ideally we cache this, but reading Prefs every loop is slow? 
-  // Actually, let's cache it static or read every few seconds.
-  static unsigned long last_interval_check = 0;
-  static unsigned long current_interval_ms = GPS_UPDATE_INTERVAL; // default from config.h
-
-  unsigned long now = millis();
-
-  if (now - last_interval_check > 5000) {
-    last_interval_check = now;
-    Preferences p;
-    p.begin("beehive", true);
-    int mins = p.getInt("ts_interval", 0); // 0 means not set, use default
-    p.end();
-    if (mins > 0) current_interval_ms = (unsigned long)mins * 60000UL;
-    else current_interval_ms = GPS_UPDATE_INTERVAL;
+}
+
+// GPS & ThingSpeak & SD log, at the configured interval
+static void job_periodic_upload() {
+  // Check if user is active - if so, defer update to avoid freezing UI
+  if (isUserActive()) {
+    Serial.println("[MAIN] Periodic update deferred (User Active)");
+    sched_setNextDeadline(job_upload, 1000);
+    return;
   }
 
-  if (now - last_gps_update > current_interval_ms || last_gps_update == 0) {
-    // Check if user is active - if so, defer update to avoid freezing UI
-    if (isUserActive()) {
-      // Only log once per second to avoid spam
-      static unsigned long last_defer_log = 0;
-      if (now - last_defer_log > 1000) {
-        Serial.println("[MAIN] Periodic update deferred (User Active)");
-        last_defer_log = now;
-      }
-      // Defer by resetting last_gps_update slightly so we retry soon
-      // But don't change last_gps_update, just skip this iteration
-      return; 
-    }
+  Serial.printf("[MAIN] Starting periodic Data Send (Interval: %lu ms)...\n", current_interval_ms);
 
-    last_gps_update = now;
-    Serial.printf("[MAIN] Starting periodic Data Send (Interval: %lu ms)...\n", current_interval_ms);
-    
-    menuUpdate(); // Keep UI alive
-    
-    // Update GPS
-    if (sensors_update_gps()) {
-      Serial.println("[MAIN] GPS update successful");
-    } else {
-      Serial.println("[MAIN] GPS update failed (no fix or modem error)");
-    }
+  menuUpdate(); // Keep UI alive
 
-    menuUpdate(); // Keep UI alive
+  // Publish the cached GPS fix (no modem I/O)
+  if (sensors_update_gps()) {
+    Serial.println("[MAIN] GPS update successful");
+  } else {
+    Serial.println("[MAIN] GPS update failed (no recent fix)");
+  }
 
-    // Upload to ThingSpeak (Sensor data + GPS)
-    if (thingspeak_upload_current()) {
-       Serial.println("[MAIN] ThingSpeak upload successful");
-    } else {
-       Serial.println("[MAIN] ThingSpeak upload failed");
-    }
+  menuUpdate(); // Keep UI alive
 
-    // Log to SD card (same interval as ThingSpeak)
-    if (sdlog_write()) {
-      Serial.println("[MAIN] SD log written successfully");
-    } else {
-      Serial.println("[MAIN] SD log write failed or disabled");
-    }
+  // Upload to ThingSpeak (Sensor data + GPS)
+  if (thingspeak_upload_current()) {
+     Serial.println("[MAIN] ThingSpeak upload successful");
+  } else {
+     Serial.println("[MAIN] ThingSpeak upload failed");
   }
 
-  delay(10);
+  // Log to SD card (same interval as ThingSpeak)
+  if (sdlog_write()) {
+    Serial.println("[MAIN] SD log written successfully");
+  } else {
+    Serial.println("[MAIN] SD log write failed or disabled");
+  }
+}
+
+// Upload sinks (telemetry_sink.h): each drains its own SD queue in batches
+// once WiFi or the LTE data session is up; the sinks say when to come back
+// (rate limit, per-sink backoff, bearer poll). The MQTT session is kept
+// alive from here too (at most SINK_IDLE_MS apart).
+static void job_sinks() {
+  mqttClient_service();
+  sched_setNextDeadline(job_sink_id, sink_service());
+}
+
+// Lets sched_trigger() from another task cut loop()'s sleep short
+static void loop_wake() {
+  if (loopTaskHandle) xTaskNotifyGive(loopTaskHandle);
+}
+
+// Motion interrupt latched by the acquisition task: drain immediately
+static void acq_wake() {
+  sched_trigger(job_acq_id);
+}
+
+static void sms_wake() {
+  sched_trigger(job_sms_id);
+}
+
+// A sample was queued: send it as soon as the loop gets there
+static void sink_wake() {
+  sched_trigger(job_sink_id);
+}
+
+static void scheduler_setup() {
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  sched_setWakeHook(loop_wake);
+
+  sched_addJob("http",     job_http,      20);
+  sched_addJob("menu",     job_menu,      40);
+  job_acq_id = sched_addJob("acq", job_acq, ACQ_DRAIN_PERIOD_MS);
+  acq_setWakeHook(acq_wake);
+  sched_addJob("serial",   job_serial,    50);
+  sched_addJob("time",     job_time,      500);
+  sched_addJob("network",  job_network,   1000);
+  job_modem_id = sched_addJob("modem", job_modem, MODEM_URC_POLL_MS);
+  job_sms_id = sched_addJob("sms", job_sms, 5000);
+  sms_setWakeHook(sms_wake);
+  job_battery_id = sched_addJob("battery", job_battery, BATT_MEASURE_PERIOD_MS);
+  job_climate_id = sched_addJob("climate", job_climate, INT_CLIMATE_PERIOD_MS);
+  sched_addJob("interval", job_interval,  5000);
+  job_upload = sched_addJob("upload", job_periodic_upload, current_interval_ms);
+  sink_register(&SINK_THINGSPEAK);
+  sink_register(&SINK_COLLECTOR);
+  sink_register(&SINK_MQTT);
+  job_sink_id = sched_addJob("sinks", job_sinks, SINK_IDLE_MS, SINK_BEARER_POLL_MS);
+  sink_setWakeHook(sink_wake);
+  job_interval();
+  sched_trigger(job_battery_id); // first reading right after boot
+  sched_trigger(job_climate_id);
+  sched_trigger(job_upload); // first send right after boot
+}
+
+// =========================================================
+// Main Loop
+// =========================================================
+void loop() {
+  sched_runDue();
+
+  // Sleep until the earliest deadline (or until another task triggers a job)
+  uint32_t idle = sched_msUntilNext(SCHED_MAX_IDLE_MS);
+  if (idle > 0) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle));
 }
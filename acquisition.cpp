@@ -0,0 +1,193 @@
+// acquisition.cpp
+// Sensor acquisition task + SPSC sample ring (see acquisition.h).
+//
+// The MPU6050 shares the I2C bus with the LCD, so every bus access from this
+// task is done under lcdMutex (the same lock ui.cpp holds while writing).
+
+#include "acquisition.h"
+#include "config.h"
+#include "sensors.h"
+#include "calibration.h"
+#include "spsc_ring.h"
+#include "ui.h"
+#include "safe_freertos.h"
+#include "freertos/task.h"
+
+#include <atomic>
+
+#define ACQ_NOTIFY_MOTION  (1u << 0)   // MPU INT pin edge
+#define ACQ_NOTIFY_HX711   (1u << 1)   // HX711 DOUT falling = conversion ready
+
+static SpscRing<SensorSample, ACQ_RING_SIZE> s_ring;
+static TaskHandle_t s_task = NULL;
+static uint32_t s_seq = 0;
+static void (*s_wake)(void) = nullptr;
+
+// motion interrupts latched here so they survive a full ring / busy loop()
+static std::atomic<uint32_t> s_motionEvents(0);
+static volatile uint32_t s_motionFirstMs = 0;
+static uint32_t s_fifoBursts = 0;
+static uint32_t s_loadcellReads = 0;
+
+static void acq_push(SensorSample &s) {
+  s.seq = s_seq++;
+  s_ring.push(s);
+}
+
+static void IRAM_ATTR mpuIntIsr() {
+  BaseType_t woken = pdFALSE;
+  if (s_task) xTaskNotifyFromISR(s_task, ACQ_NOTIFY_MOTION, eSetBits, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// DOUT also toggles while a conversion is clocked out; those extra wakeups
+// find DOUT high and read nothing.
+static void IRAM_ATTR hx711ReadyIsr() {
+  BaseType_t woken = pdFALSE;
+  if (s_task) xTaskNotifyFromISR(s_task, ACQ_NOTIFY_HX711, eSetBits, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// Bit-banged, no I2C: does not need lcdMutex. Reads every channel that is
+// due and ready, round-robin.
+static void acq_pollLoadcell() {
+  int ch;
+  long raw;
+  while (calib_readNext(ch, raw)) {
+    SensorSample s = {};
+    s.t_ms = millis();
+    s.type = SAMPLE_LOADCELL;
+    s.channel = (uint8_t)ch;
+    s.v[0] = (float)raw;
+    acq_push(s);
+    s_loadcellReads++;
+  }
+}
+
+// Single-sample path (no FIFO): one register read per sample.
+static void acq_pollAccel() {
+  float x, y, z;
+  bool ok = false;
+  if (safeSemaphoreTake(lcdMutex, pdMS_TO_TICKS(ACQ_ACCEL_PERIOD_MS), "acq:accel")) {
+    ok = sensors_read_accel(x, y, z);
+    safeSemaphoreGive(lcdMutex, "acq:accel");
+  }
+  if (!ok) return;
+  SensorSample s = {};
+  s.t_ms = millis();
+  s.type = SAMPLE_ACCEL;
+  s.v[0] = x; s.v[1] = y; s.v[2] = z;
+  acq_push(s);
+}
+
+// FIFO path: drain everything queued in the MPU in a few burst reads and
+// back-date the samples from the FIFO rate.
+static void acq_drainAccelFifo(bool irq) {
+  static float xyz[ACQ_FIFO_MAX_BURST][3];
+  bool motion = false;
+  int n = 0;
+  if (safeSemaphoreTake(lcdMutex, pdMS_TO_TICKS(ACQ_FIFO_DRAIN_MS), "acq:fifo")) {
+    n = sensors_read_accel_fifo(xyz, ACQ_FIFO_MAX_BURST, motion);
+    safeSemaphoreGive(lcdMutex, "acq:fifo");
+  }
+  uint32_t now = millis();
+  if (n > 0) s_fifoBursts++;
+  for (int i = 0; i < n; ++i) {
+    SensorSample s = {};
+    s.t_ms = now - (uint32_t)(n - 1 - i) * (1 + MPU_SAMPLE_DIV);   // 1 kHz / (1 + div)
+    s.type = SAMPLE_ACCEL;
+    s.v[0] = xyz[i][0]; s.v[1] = xyz[i][1]; s.v[2] = xyz[i][2];
+    acq_push(s);
+  }
+
+  if ((irq && sensors_accel_motionIrq()) || motion) {
+    if (s_motionEvents.fetch_add(1) == 0) s_motionFirstMs = now;
+    if (s_wake) s_wake();   // alarm path: do not wait for the next drain period
+  }
+}
+
+static void acquisitionTask(void *pv) {
+  (void)pv;
+  const bool fifo = sensors_accel_fifoEnabled();
+  TickType_t lastWake = xTaskGetTickCount();
+  uint32_t lastFifoMs = millis();
+  for (;;) {
+    if (fifo) {
+      // sleep until the next FIFO drain, a motion interrupt or HX711 data ready
+      uint32_t since = millis() - lastFifoMs;
+      uint32_t wait = since < ACQ_FIFO_DRAIN_MS ? ACQ_FIFO_DRAIN_MS - since : 0;
+      uint32_t bits = 0;
+      xTaskNotifyWait(0, 0xFFFFFFFFu, &bits, pdMS_TO_TICKS(wait));
+      acq_pollLoadcell();
+      bool irq = (bits & ACQ_NOTIFY_MOTION) != 0;
+      if (irq || millis() - lastFifoMs >= ACQ_FIFO_DRAIN_MS) {
+        acq_drainAccelFifo(irq);
+        lastFifoMs = millis();
+      }
+    } else {
+      acq_pollAccel();
+      acq_pollLoadcell();   // 20 ms polling keeps up with 10 SPS
+      vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(ACQ_ACCEL_PERIOD_MS));
+    }
+  }
+}
+
+bool acq_start() {
+  if (s_task) return true;
+  BaseType_t ok = xTaskCreatePinnedToCore(acquisitionTask, "acqTask", 4096, NULL,
+                                          ACQ_TASK_PRIORITY, &s_task, ACQ_TASK_CORE);
+  if (ok != pdPASS) {
+    s_task = NULL;
+    Serial.println("[ACQ] acquisition task creation FAILED");
+    return false;
+  }
+#if MPU_INT_PIN >= 0
+  if (sensors_accel_motionIrq()) {
+    pinMode(MPU_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), mpuIntIsr, RISING);
+  }
+#endif
+  if (sensors_accel_fifoEnabled()) {
+    for (int ch = 0; ch < calib_channelCount(); ch++) {
+      if (calib_present(ch))
+        attachInterrupt(digitalPinToInterrupt(calib_dataReadyPin(ch)), hx711ReadyIsr, FALLING);
+    }
+  }
+#if ENABLE_DEBUG
+  if (sensors_accel_fifoEnabled())
+    Serial.printf("[ACQ] acquisition task started on core %d (FIFO burst every %d ms)\n",
+                  ACQ_TASK_CORE, ACQ_FIFO_DRAIN_MS);
+  else
+    Serial.printf("[ACQ] acquisition task started on core %d (%d ms period)\n",
+                  ACQ_TASK_CORE, ACQ_ACCEL_PERIOD_MS);
+#endif
+  return true;
+}
+
+void acq_setWakeHook(void (*fn)(void)) { s_wake = fn; }
+
+bool acq_pop(SensorSample &out) {
+  return s_ring.pop(out);
+}
+
+int acq_drain() {
+  static uint32_t droppedSeen = 0;
+  uint32_t ev = s_motionEvents.exchange(0);
+  uint32_t dropped = s_ring.dropped();     // read after ev: covers the interrupt's burst
+  if (ev) sensors_on_motion_event(ev, s_motionFirstMs, dropped != droppedSeen);
+  droppedSeen = dropped;
+
+  SensorSample s;
+  int n = 0;
+  while (s_ring.pop(s)) {
+    sensors_apply_sample(s);
+    n++;
+  }
+  return n;
+}
+
+uint32_t acq_getPushed()  { return s_seq; }
+uint32_t acq_getDropped() { return s_ring.dropped(); }
+size_t   acq_getPending() { return s_ring.size(); }
+uint32_t acq_getFifoBursts() { return s_fifoBursts; }
+uint32_t acq_getLoadcellReads() { return s_loadcellReads; }
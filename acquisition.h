@@ -0,0 +1,54 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+
+// acquisition.h : dedicated sensor acquisition task.
+//
+// A FreeRTOS task pinned to ACQ_TASK_CORE samples the sensors at a fixed
+// rate and pushes timestamped, sequence-numbered records into a lock-free
+// SPSC ring. loop() drains the ring (acq_drain) without taking locks, so the
+// sampling rate no longer depends on how long menus or uploads block loop().
+
+enum SampleType : uint8_t {
+  SAMPLE_NONE  = 0,
+  SAMPLE_ACCEL = 1,   // v[0..2] = acceleration X/Y/Z (m/s^2)
+  SAMPLE_LOADCELL = 2,  // v[0] = HX711 raw counts (24 bit, exact in a float), channel = load cell
+};
+
+struct SensorSample {
+  uint32_t seq;       // increments per record pushed (gaps = dropped records)
+  uint32_t t_ms;      // millis() at acquisition
+  uint8_t  type;      // SampleType
+  uint8_t  channel;   // sensor instance (0 for single sensors)
+  uint16_t flags;
+  float    v[3];
+};
+
+// Start the acquisition task (call once from setup() after sensors_init()).
+// With the MPU6050 FIFO enabled the task sleeps until the FIFO drain period
+// or the motion-detect interrupt, then reads all queued samples in bursts.
+// The HX711 data-ready edge (DOUT low) also wakes it to read one conversion.
+bool acq_start();
+
+// Called from the acquisition task when a motion interrupt is latched so the
+// consumer can run acq_drain() right away (e.g. sched_trigger of its job).
+void acq_setWakeHook(void (*fn)(void));
+
+// Consumer side (loop task only): pop one record. Returns false when empty.
+bool acq_pop(SensorSample &out);
+
+// Consumer side: report latched motion interrupts (and whether records were
+// dropped since the last drain, in which case the detector cannot see the
+// disturbance), then pop every pending record and hand it to the sensors
+// module. Returns the records processed.
+int acq_drain();
+
+// Diagnostics
+uint32_t acq_getPushed();
+uint32_t acq_getDropped();
+size_t   acq_getPending();
+uint32_t acq_getFifoBursts();
+uint32_t acq_getLoadcellReads();
+
+#endif // ACQUISITION_H
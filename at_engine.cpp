@@ -0,0 +1,361 @@
+// at_engine.cpp
+// Queued AT commands, line framing and URC dispatch (see at_engine.h).
+
+#include "at_engine.h"
+#include "line_framer.h"
+#include <string.h>
+
+#define AT_PREFIX_MAX 16
+
+struct AtCmd {
+  char        text[AT_CMD_MAX];
+  uint32_t    timeout_ms;
+  AtLineFn    on_line;
+  AtDoneFn    on_done;
+  void       *arg;
+  const char *prompt;       // payload commands only (at_commandPayload)
+  const char *payload;
+  size_t      payload_len;
+  bool        urgent;       // at_submitUrgent(): starts even while held
+};
+
+struct AtSub {
+  const char *prefix;
+  size_t      len;
+  AtUrcFn     fn;
+  void       *arg;
+};
+
+static AtIo     s_io = {};
+static bool     s_haveIo = false;
+
+static AtCmd    s_queue[AT_QUEUE_LEN];
+static uint8_t  s_qHead = 0, s_qCount = 0;
+
+static AtCmd    s_cur;
+static bool     s_active = false;
+static uint32_t s_curStart = 0;
+static char     s_curPrefix[AT_PREFIX_MAX];   // "+CCLK:" for "+CCLK?"
+static size_t   s_curPrefixLen = 0;
+
+static AtSub    s_subs[AT_MAX_URC_SUBS];
+static int      s_subCount = 0;
+
+static char       s_rxBuf[AT_RX_BUF];
+static LineFramer s_rx = { s_rxBuf, sizeof(s_rxBuf), 0, 0, 0, false, 0 };
+static uint32_t   s_lastByteMs = 0;
+
+static size_t     s_rawLeft = 0;      // at_expectRaw()
+static AtRawFn    s_rawFn = nullptr;
+static void      *s_rawArg = nullptr;
+
+static bool     s_hold = false;                // at_hold()
+static void   (*s_onDemand)() = nullptr;
+
+static AtStats  s_stats = {};
+
+static uint32_t at_now() { return s_io.now_ms(s_io.ctx); }
+
+void at_init(const AtIo &io) {
+  // Queue and subscriptions survive: modules may register before the UART is up.
+  s_io = io;
+  s_haveIo = (io.read && io.write && io.now_ms);
+  lf_reset(s_rx);
+  s_rawLeft = 0;
+}
+
+static AtCmd *at_enqueue(const char *cmd, bool front) {
+  size_t n = strlen(cmd);
+  if (s_qCount >= AT_QUEUE_LEN || n >= AT_CMD_MAX) {
+    s_stats.queue_full++;
+    return nullptr;
+  }
+  if (front) s_qHead = (s_qHead + AT_QUEUE_LEN - 1) % AT_QUEUE_LEN;
+  AtCmd &c = s_queue[front ? s_qHead : (s_qHead + s_qCount) % AT_QUEUE_LEN];
+  memcpy(c.text, cmd, n + 1);
+  c.urgent = front;
+  s_qCount++;
+  return &c;
+}
+
+bool at_submit(const char *cmd, uint32_t timeout_ms, AtLineFn on_line, AtDoneFn on_done, void *arg) {
+  AtCmd *q = at_enqueue(cmd, false);
+  if (!q) return false;
+  AtCmd &c = *q;
+  c.timeout_ms = timeout_ms;
+  c.on_line = on_line;
+  c.on_done = on_done;
+  c.arg = arg;
+  c.prompt = nullptr;
+  c.payload = nullptr;
+  c.payload_len = 0;
+  return true;
+}
+
+bool at_submitUrgent(const char *cmd, uint32_t timeout_ms, AtLineFn on_line, AtDoneFn on_done, void *arg) {
+  AtCmd *q = at_enqueue(cmd, true);
+  if (!q) return false;
+  q->timeout_ms = timeout_ms;
+  q->on_line = on_line;
+  q->on_done = on_done;
+  q->arg = arg;
+  q->prompt = nullptr;
+  q->payload = nullptr;
+  q->payload_len = 0;
+  return true;
+}
+
+void at_hold(bool hold, void (*on_demand)()) {
+  s_hold = hold;
+  s_onDemand = hold ? on_demand : nullptr;
+}
+
+bool at_held() { return s_hold; }
+
+// A blocking caller found its command stuck behind the hold: ask the
+// owner of the hold (the power manager) to lift it.
+static void at_demand() {
+  if (s_hold && s_onDemand && s_qCount && !s_queue[s_qHead].urgent) {
+    void (*fn)() = s_onDemand;
+    s_onDemand = nullptr;          // once per hold
+    fn();
+  }
+}
+
+bool at_subscribe(const char *prefix, AtUrcFn fn, void *arg) {
+  if (s_subCount >= AT_MAX_URC_SUBS || !prefix || !*prefix || !fn) return false;
+  s_subs[s_subCount++] = { prefix, strlen(prefix), fn, arg };
+  return true;
+}
+
+// "+CMGL=\"REC UNREAD\"" -> "+CMGL:". Basic commands ("", "E0", "I") have none.
+static void at_derivePrefix(const char *cmd) {
+  s_curPrefixLen = 0;
+  if (cmd[0] != '+' && cmd[0] != '*' && cmd[0] != '$' && cmd[0] != '^') return;
+  size_t i = 0;
+  while (cmd[i] && cmd[i] != '=' && cmd[i] != '?' && i < AT_PREFIX_MAX - 2) {
+    s_curPrefix[i] = cmd[i];
+    i++;
+  }
+  s_curPrefix[i++] = ':';
+  s_curPrefix[i] = '\0';
+  s_curPrefixLen = i;
+}
+
+static void at_startNext() {
+  if (s_active || !s_qCount || !s_haveIo) return;
+  if (s_hold && !s_queue[s_qHead].urgent) return;
+  s_cur = s_queue[s_qHead];
+  s_qHead = (s_qHead + 1) % AT_QUEUE_LEN;
+  s_qCount--;
+  at_derivePrefix(s_cur.text);
+  s_active = true;
+  s_curStart = at_now();
+  s_io.write(s_io.ctx, "AT", 2);
+  s_io.write(s_io.ctx, s_cur.text, strlen(s_cur.text));
+  s_io.write(s_io.ctx, "\r\n", 2);
+}
+
+static void at_complete(AtResult res, const char *final) {
+  AtCmd c = s_cur;              // on_done may submit the next command
+  s_active = false;
+  uint32_t took = at_now() - s_curStart;
+  s_stats.commands++;
+  s_stats.last_ms = took;
+  if (took > s_stats.max_ms) s_stats.max_ms = took;
+  if (res == AT_OK) s_stats.ok++;
+  else if (res == AT_TIMEOUT) s_stats.timeouts++;
+  else if (res == AT_ERROR) s_stats.errors++;
+  if (c.on_done) c.on_done(res, final, c.arg);
+}
+
+static AtResult at_classifyFinal(const char *line) {
+  if (strcmp(line, "OK") == 0) return AT_OK;
+  if (strcmp(line, "ERROR") == 0 ||
+      strncmp(line, "+CME ERROR", 10) == 0 ||
+      strncmp(line, "+CMS ERROR", 10) == 0 ||
+      strcmp(line, "NO CARRIER") == 0 ||
+      strcmp(line, "NO DIALTONE") == 0 ||
+      strcmp(line, "NO ANSWER") == 0 ||
+      strcmp(line, "BUSY") == 0) return AT_ERROR;
+  return AT_PENDING;
+}
+
+static bool at_dispatchUrc(const char *line) {
+  for (int i = 0; i < s_subCount; i++) {
+    if (strncmp(line, s_subs[i].prefix, s_subs[i].len) == 0) {
+      s_stats.urcs++;
+      s_subs[i].fn(line, at_now(), s_subs[i].arg);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void at_handleLine(const char *line) {
+  if (s_active) {
+    // echo (ATE1): "AT" + the command text
+    if (line[0] == 'A' && line[1] == 'T' && strcmp(line + 2, s_cur.text) == 0) return;
+
+    AtResult res = at_classifyFinal(line);
+    if (res != AT_PENDING) { at_complete(res, line); return; }
+
+    // our own response prefix wins over a subscriber with the same prefix
+    if (s_curPrefixLen && strncmp(line, s_curPrefix, s_curPrefixLen) == 0) {
+      if (s_cur.on_line) s_cur.on_line(line, s_cur.arg);
+      return;
+    }
+    if (at_dispatchUrc(line)) return;
+    if (s_cur.on_line) s_cur.on_line(line, s_cur.arg);   // bare lines (IMEI, CGMR...)
+    return;
+  }
+  if (!at_dispatchUrc(line)) s_stats.urc_unhandled++;
+}
+
+void at_expectRaw(size_t len, AtRawFn fn, void *arg) {
+  s_rawLeft = len;
+  s_rawFn = fn;
+  s_rawArg = arg;
+}
+
+// Hand pending bytes to the raw consumer. Returns true if any were taken.
+static bool at_feedRaw() {
+  if (!s_rawLeft || !lf_pending(s_rx)) return false;
+  size_t got;
+  const char *p = lf_take(s_rx, s_rawLeft, got);
+  s_rawLeft -= got;
+  if (s_rawFn) s_rawFn(p, got, s_rawArg);
+  return true;
+}
+
+// The running command waits for a prompt that is not a full line ("> "):
+// look at the partial line and send the payload once it is there.
+static bool at_checkPrompt() {
+  if (!s_active || !s_cur.prompt) return false;
+  while (lf_pending(s_rx) && (s_rx.buf[s_rx.start] == '\r' || s_rx.buf[s_rx.start] == '\n')) {
+    size_t got;
+    lf_take(s_rx, 1, got);
+  }
+  size_t plen = strlen(s_cur.prompt);
+  if (lf_pending(s_rx) < plen || memcmp(s_rx.buf + s_rx.start, s_cur.prompt, plen) != 0) return false;
+  size_t got;
+  lf_take(s_rx, plen, got);
+  s_cur.prompt = nullptr;
+  if (s_cur.payload_len) s_io.write(s_io.ctx, s_cur.payload, s_cur.payload_len);
+  return true;
+}
+
+static int at_pumpRx() {
+  int lines = 0;
+  uint32_t now = at_now();
+  if (lf_pending(s_rx) && !s_rawLeft && now - s_lastByteMs > AT_LINE_STALE_MS) lf_reset(s_rx);
+  for (;;) {
+    size_t space;
+    char *dst = lf_writePtr(s_rx, space);
+    size_t n = space ? s_io.read(s_io.ctx, dst, space) : 0;
+    if (n) {
+      lf_commit(s_rx, n);
+      s_lastByteMs = now;
+    }
+    for (;;) {
+      if (at_feedRaw()) continue;
+      if (s_rawLeft) break;                 // need more bytes
+      if (at_checkPrompt()) continue;
+      char *line = lf_next(s_rx);
+      if (!line) break;
+      at_handleLine(line);
+      lines++;
+    }
+    if (!n) break;
+  }
+  s_stats.line_overflows = s_rx.overflows;
+  return lines;
+}
+
+static void at_checkTimeout() {
+  if (s_active && at_now() - s_curStart >= s_cur.timeout_ms) at_complete(AT_TIMEOUT, "");
+}
+
+int at_poll() {
+  if (!s_haveIo) return 0;
+  int lines = at_pumpRx();
+  at_checkTimeout();
+  at_startNext();
+  return lines;
+}
+
+// at_command() waits on its own completion record.
+struct AtWait {
+  AtLineFn on_line;
+  void    *arg;
+  bool     done;
+  AtResult res;
+};
+
+static void at_waitLine(const char *line, void *arg) {
+  AtWait *w = (AtWait *)arg;
+  if (w->on_line) w->on_line(line, w->arg);
+}
+
+static void at_waitDone(AtResult res, const char *, void *arg) {
+  AtWait *w = (AtWait *)arg;
+  w->done = true;
+  w->res = res;
+}
+
+AtResult at_command(const char *cmd, uint32_t timeout_ms, AtLineFn on_line, void *arg) {
+  if (!s_haveIo) return AT_ERROR;
+  AtWait w = { on_line, arg, false, AT_PENDING };
+  if (!at_submit(cmd, timeout_ms, at_waitLine, at_waitDone, &w)) return AT_ERROR;
+  while (!w.done) {
+    at_demand();
+    at_poll();
+    if (!w.done && s_io.idle) s_io.idle(s_io.ctx);
+  }
+  return w.res;
+}
+
+bool at_submitPayload(const char *cmd, const char *prompt, const char *data, size_t len,
+                      uint32_t timeout_ms, AtLineFn on_line, AtDoneFn on_done, void *arg) {
+  if (!at_submit(cmd, timeout_ms, on_line, on_done, arg)) return false;
+  AtCmd &c = s_queue[(s_qHead + s_qCount - 1) % AT_QUEUE_LEN];
+  c.prompt = prompt;
+  c.payload = data;
+  c.payload_len = len;
+  return true;
+}
+
+AtResult at_commandPayload(const char *cmd, const char *prompt, const char *data, size_t len,
+                           uint32_t timeout_ms, AtLineFn on_line, void *arg) {
+  if (!s_haveIo) return AT_ERROR;
+  AtWait w = { on_line, arg, false, AT_PENDING };
+  if (!at_submitPayload(cmd, prompt, data, len, timeout_ms, at_waitLine, at_waitDone, &w)) return AT_ERROR;
+  while (!w.done) {
+    at_demand();
+    at_poll();
+    if (!w.done && s_io.idle) s_io.idle(s_io.ctx);
+  }
+  return w.res;
+}
+
+void at_settle() {
+  while (s_active && s_haveIo) {
+    at_pumpRx();
+    at_checkTimeout();
+    if (s_active && s_io.idle) s_io.idle(s_io.ctx);
+  }
+}
+
+void at_cancelAll() {
+  for (uint8_t i = 0; i < s_qCount; i++) {
+    AtCmd &c = s_queue[(s_qHead + i) % AT_QUEUE_LEN];
+    if (c.on_done) c.on_done(AT_CANCELLED, "", c.arg);
+  }
+  s_qCount = 0;
+  if (s_active) at_complete(AT_CANCELLED, "");
+}
+
+bool at_busy()   { return s_active; }
+int  at_queued() { return s_qCount; }
+const AtStats &at_stats() { return s_stats; }
+void at_resetStats() { s_stats = {}; s_rx.overflows = 0; }
@@ -0,0 +1,130 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// at_engine.h : single owner of the modem AT channel.
+//
+// Commands are queued with their own timeout and callbacks and sent one at
+// a time. Incoming bytes are read in chunks into a fixed buffer and framed
+// in place (line_framer.h); each line is either
+//   - the final result of the running command (OK / ERROR / +CME ERROR...),
+//     which completes it immediately instead of waiting out the timeout,
+//   - an intermediate response line of the running command, or
+//   - an unsolicited result code, routed to the subscriber whose prefix
+//     matches (+CMTI:, +CREG:, +CGNSSINFO:, ...).
+//
+// The engine has no Arduino dependency: the UART is reached through AtIo,
+// so the same code runs on the ESP32 (SerialAT, see modem_manager.cpp) and
+// on a PC against a scripted fake modem behind a pty.
+//
+// TinyGSM still talks to the same UART. Call at_settle() before handing the
+// port to it (modem_get() does): it finishes the command in flight, and
+// nothing new is sent until the next at_poll().
+//
+// Callbacks get a pointer into the receive buffer, valid only during the
+// call. They may at_submit() but must not block in at_command().
+
+struct AtIo {
+  void    *ctx;
+  size_t   (*read)(void *ctx, char *buf, size_t cap);          // what is there, 0 if none
+  size_t   (*write)(void *ctx, const char *data, size_t len);
+  uint32_t (*now_ms)(void *ctx);
+  void     (*idle)(void *ctx);                                 // called while blocking (may be null)
+};
+
+enum AtResult : uint8_t {
+  AT_PENDING = 0,
+  AT_OK,
+  AT_ERROR,       // ERROR, +CME ERROR, +CMS ERROR, NO CARRIER...
+  AT_TIMEOUT,
+  AT_CANCELLED,
+};
+
+// Intermediate response line of a command (without CR/LF).
+typedef void (*AtLineFn)(const char *line, void *arg);
+// Command finished; final is the result line ("" on timeout).
+typedef void (*AtDoneFn)(AtResult res, const char *final, void *arg);
+// Unsolicited result code.
+typedef void (*AtUrcFn)(const char *line, uint32_t now_ms, void *arg);
+// Raw bytes requested with at_expectRaw() (may come in several pieces).
+typedef void (*AtRawFn)(const char *data, size_t len, void *arg);
+
+#define AT_QUEUE_LEN      8
+#define AT_CMD_MAX        256    // command text without "AT" and CR (URLs fit)
+#define AT_RX_BUF         1024   // longest line is AT_RX_BUF-1; URC bursts fit whole
+#define AT_MAX_URC_SUBS   12
+#define AT_LINE_STALE_MS  100    // partial line older than this was cut by TinyGSM
+
+struct AtStats {
+  uint32_t commands;       // completed
+  uint32_t ok;
+  uint32_t errors;
+  uint32_t timeouts;
+  uint32_t urcs;           // delivered to a subscriber
+  uint32_t urc_unhandled;  // no subscriber
+  uint32_t queue_full;     // rejected submissions
+  uint32_t line_overflows; // lines cut at AT_RX_BUF-1
+  uint32_t last_ms;        // duration of the last command
+  uint32_t max_ms;
+};
+
+void at_init(const AtIo &io);
+
+// Queue "AT<cmd>" (cmd without the "AT" prefix, e.g. "+CCLK?").
+// Returns false if the queue is full or cmd is too long.
+bool at_submit(const char *cmd, uint32_t timeout_ms,
+               AtLineFn on_line = nullptr, AtDoneFn on_done = nullptr, void *arg = nullptr);
+
+// Submit and pump until it completes (returns as soon as OK/ERROR arrives).
+AtResult at_command(const char *cmd, uint32_t timeout_ms,
+                    AtLineFn on_line = nullptr, void *arg = nullptr);
+
+// Like at_command(), for commands that answer with a prompt ("DOWNLOAD",
+// ">") and then take len bytes of payload: data is written as soon as the
+// prompt arrives. data must stay valid until the call returns.
+AtResult at_commandPayload(const char *cmd, const char *prompt, const char *data, size_t len,
+                           uint32_t timeout_ms, AtLineFn on_line = nullptr, void *arg = nullptr);
+
+// Queued form of at_commandPayload(): data must stay valid until on_done.
+bool at_submitPayload(const char *cmd, const char *prompt, const char *data, size_t len,
+                      uint32_t timeout_ms, AtLineFn on_line = nullptr,
+                      AtDoneFn on_done = nullptr, void *arg = nullptr);
+
+// From a line or URC callback: the next len bytes after this line are
+// binary (e.g. after "+HTTPREAD: 512"); hand them to fn instead of framing.
+void at_expectRaw(size_t len, AtRawFn fn, void *arg = nullptr);
+
+// Queue ahead of everything else; starts even while the engine is held.
+bool at_submitUrgent(const char *cmd, uint32_t timeout_ms,
+                     AtLineFn on_line = nullptr, AtDoneFn on_done = nullptr, void *arg = nullptr);
+
+// Hold: queued commands stay queued (the modem is asleep) until released;
+// urgent ones still start. A blocking at_command() that finds itself held
+// calls on_demand (may be null) once, which is expected to wake the modem
+// and release the hold.
+void at_hold(bool hold, void (*on_demand)() = nullptr);
+bool at_held();
+
+// Route unsolicited lines starting with prefix (e.g. "+CMTI:") to fn.
+// The prefix string must outlive the engine (use a literal).
+bool at_subscribe(const char *prefix, AtUrcFn fn, void *arg = nullptr);
+
+// Read and dispatch everything pending, expire timeouts, start the next
+// queued command. Returns the number of lines handled.
+int  at_poll();
+
+// Finish the command in flight (pumping until done or timed out) so that
+// another driver can use the UART. Queued commands stay queued.
+void at_settle();
+
+// Drop every queued command (the running one completes as AT_CANCELLED).
+void at_cancelAll();
+
+bool     at_busy();           // a command is in flight
+int      at_queued();         // waiting, not counting the running one
+const AtStats &at_stats();
+void     at_resetStats();
+
+#endif // AT_ENGINE_H
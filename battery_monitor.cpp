@@ -0,0 +1,166 @@
+// battery_monitor.cpp
+// Battery voltage / state of charge (see battery_monitor.h).
+
+#include "battery_monitor.h"
+#include "config.h"
+
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+  #define BATT_HAVE_CONTINUOUS 1
+#else
+  #define BATT_HAVE_CONTINUOUS 0
+#endif
+
+#define BATT_BURST_TIMEOUT_MS 100   // a 256-sample burst at 20 kHz takes ~13 ms
+
+// Resting cell voltage (mV) -> state of charge (%), descending.
+struct SocPoint { uint16_t mv; uint8_t pct; };
+
+#if BATT_CHEMISTRY == BATT_CHEM_LIFEPO4
+static const SocPoint kSoc[] = {
+  {3400, 100}, {3350, 99}, {3320, 90}, {3300, 70}, {3270, 40}, {3260, 30},
+  {3250, 20}, {3220, 17}, {3200, 14}, {3000, 9}, {2500, 0},
+};
+#elif BATT_CHEMISTRY == BATT_CHEM_LEADACID
+static const SocPoint kSoc[] = {
+  {2120, 100}, {2100, 90}, {2080, 80}, {2050, 70}, {2030, 60}, {2010, 50},
+  {1980, 40}, {1960, 30}, {1930, 20}, {1900, 10}, {1750, 0},
+};
+#else // BATT_CHEM_LIION
+static const SocPoint kSoc[] = {
+  {4200, 100}, {4150, 95}, {4110, 90}, {4080, 85}, {4020, 80}, {3980, 75},
+  {3950, 70}, {3910, 65}, {3870, 60}, {3850, 55}, {3840, 50}, {3820, 45},
+  {3800, 40}, {3790, 35}, {3770, 30}, {3750, 25}, {3730, 20}, {3710, 15},
+  {3690, 10}, {3610, 5}, {3270, 0},
+};
+#endif
+
+enum BattState : uint8_t { BATT_IDLE, BATT_SAMPLING };
+
+static bool      s_inited = false;
+static bool      s_continuous = false;
+static BattState s_state = BATT_IDLE;
+static uint32_t  s_burstStartMs = 0;
+static volatile bool s_burstDone = false;
+
+static bool     s_have = false;
+static float    s_volts = 0.0f;      // smoothed pack voltage
+static int      s_percent = 0;
+static uint32_t s_bursts = 0;
+static uint32_t s_lastMv = 0;
+
+#if BATT_HAVE_CONTINUOUS
+static void ARDUINO_ISR_ATTR battAdcDone() { s_burstDone = true; }
+#endif
+
+// Oneshot reads from now on. The pin belongs to one ADC driver at a time:
+// the continuous one is released first, and is not tried again.
+static void battery_useOneshot() {
+#if BATT_HAVE_CONTINUOUS
+  analogContinuousDeinit();
+#endif
+  s_continuous = false;
+  s_state = BATT_IDLE;
+  analogSetPinAttenuation(BATTERY_PIN, ADC_11db);   // up to ~3.1 V at the pin
+}
+
+bool battery_init() {
+  if (s_inited) return true;
+  s_inited = true;
+
+#if BATT_HAVE_CONTINUOUS
+  const uint8_t pins[] = { BATTERY_PIN };
+  analogContinuousSetAtten(ADC_11db);
+  s_continuous = analogContinuous(pins, 1, BATT_ADC_CONVERSIONS, BATT_ADC_FREQ_HZ, &battAdcDone);
+  if (!s_continuous) battery_useOneshot();
+#else
+  battery_useOneshot();
+#endif
+
+#if ENABLE_DEBUG
+  Serial.printf("[BATT] monitor on GPIO%d, %s, %d samples per burst\n", BATTERY_PIN,
+                s_continuous ? "ADC continuous mode" : "oversampled analogReadMilliVolts",
+                BATT_ADC_CONVERSIONS);
+#endif
+  return true;
+}
+
+static void battery_applyBurst(uint32_t pin_mv) {
+  s_lastMv = pin_mv;
+  s_bursts++;
+  float v = (pin_mv / 1000.0f) * (float)((R1 + R2) / R2);
+  s_volts = s_have ? s_volts + BATT_FILTER_ALPHA * (v - s_volts) : v;
+  s_percent = battery_percentFromVoltage(s_volts);
+  s_have = true;
+}
+
+// Fallback: blocking but short (~BATT_ADC_CONVERSIONS * 10 us).
+static uint32_t battery_oversample() {
+  uint32_t sum = 0;
+  for (int i = 0; i < BATT_ADC_CONVERSIONS; i++) sum += analogReadMilliVolts(BATTERY_PIN);
+  return sum / BATT_ADC_CONVERSIONS;
+}
+
+bool battery_poll(uint32_t &next_ms) {
+  if (!s_inited) battery_init();
+  next_ms = BATT_MEASURE_PERIOD_MS;
+
+#if BATT_HAVE_CONTINUOUS
+  if (s_continuous) {
+    if (s_state == BATT_IDLE) {
+      s_burstDone = false;
+      if (analogContinuousStart()) {
+        s_state = BATT_SAMPLING;
+        s_burstStartMs = millis();
+        next_ms = 20;
+        return false;
+      }
+      Serial.println("[BATT] ADC continuous start failed, oneshot reads from now on");
+      battery_useOneshot();
+    } else {
+      adc_continuous_data_t *res = nullptr;
+      bool ok = s_burstDone && analogContinuousRead(&res, 0) && res;
+      if (!ok && millis() - s_burstStartMs < BATT_BURST_TIMEOUT_MS) {
+        next_ms = 10;
+        return false;
+      }
+      analogContinuousStop();
+      s_state = BATT_IDLE;
+      if (ok) {
+        battery_applyBurst((uint32_t)res[0].avg_read_mvolts);
+        return true;
+      }
+      Serial.println("[BATT] ADC burst timed out, oneshot reads from now on");
+      battery_useOneshot();
+    }
+  }
+#endif
+
+  battery_applyBurst(battery_oversample());
+  return true;
+}
+
+bool battery_get(float &volts, int &percent) {
+  if (!s_have) return false;
+  volts = s_volts;
+  percent = s_percent;
+  return true;
+}
+
+int battery_percentFromVoltage(float volts) {
+  const int n = sizeof(kSoc) / sizeof(kSoc[0]);
+  float cell_mv = volts * 1000.0f / BATT_CELLS;
+  if (cell_mv >= kSoc[0].mv) return 100;
+  if (cell_mv <= kSoc[n - 1].mv) return 0;
+  for (int i = 1; i < n; i++) {
+    if (cell_mv >= kSoc[i].mv) {
+      const SocPoint &hi = kSoc[i - 1], &lo = kSoc[i];
+      float f = (cell_mv - lo.mv) / (float)(hi.mv - lo.mv);
+      return (int)(lo.pct + f * (hi.pct - lo.pct) + 0.5f);
+    }
+  }
+  return 0;
+}
+
+bool     battery_usesContinuousAdc() { return s_continuous; }
+uint32_t battery_bursts()            { return s_bursts; }
+uint32_t battery_lastBurstMv()       { return s_lastMv; }
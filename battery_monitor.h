@@ -0,0 +1,36 @@
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+
+// battery_monitor.h : battery voltage and state of charge.
+//
+// Every BATT_MEASURE_PERIOD_MS one burst of BATT_ADC_CONVERSIONS samples is
+// taken on BATTERY_PIN. On Arduino-ESP32 3.x the burst runs in ADC
+// continuous (DMA) mode and the driver returns the eFuse-calibrated average;
+// on older cores, or once continuous mode has failed (its driver is then
+// released for good), it falls back to oversampled analogReadMilliVolts(),
+// which is calibrated the same way. Between bursts the ADC is stopped, so the
+// CPU cost is one short job per period.
+//
+// Bursts are smoothed with an EWMA and the state of charge comes from a
+// per-cell lookup table for BATT_CHEMISTRY (config.h).
+
+bool battery_init();
+
+// Advance the measurement (loop task). Returns true when a new reading is
+// available; next_ms is when it wants to be called again.
+bool battery_poll(uint32_t &next_ms);
+
+// Latest smoothed reading. False until the first burst completed.
+bool battery_get(float &volts, int &percent);
+
+// Lookup-table state of charge for a pack voltage (0..100).
+int  battery_percentFromVoltage(float volts);
+
+// Diagnostics
+bool     battery_usesContinuousAdc();
+uint32_t battery_bursts();
+uint32_t battery_lastBurstMv();    // ADC pin millivolts of the last burst
+
+#endif // BATTERY_MONITOR_H
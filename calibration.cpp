@@ -1,96 +1,245 @@
 #include "calibration.h"
+#include "telemetry.h"
 #include <Preferences.h>
 
 #if HAVE_HX711
   #include <HX711.h>
-  #ifndef HX711_DOUT_PIN
-    #define HX711_DOUT_PIN  DOUT
-  #endif
-  #ifndef HX711_SCK_PIN
-    #define HX711_SCK_PIN   SCK
-  #endif
-  static HX711 hx;
 #endif
 
-static float g_saved_factor = 0.0f; // counts per gram
-static long  g_saved_offset = 0;
-static int   g_saved_known  = 0;
+#define HX711_CONVERSION_MS 100   // 10 SPS
+
+struct LoadcellChannelDef {
+  uint8_t  dout;
+  uint8_t  sck;
+  uint16_t period_ms;   // read period (>= HX711_CONVERSION_MS)
+};
+
+static const LoadcellChannelDef kChannels[] = LOADCELL_CHANNEL_TABLE;
+static_assert(sizeof(kChannels) / sizeof(kChannels[0]) == LOADCELL_CHANNELS,
+              "LOADCELL_CHANNEL_TABLE must have LOADCELL_CHANNELS entries");
+static_assert(LOADCELL_CHANNELS >= 1 && LOADCELL_CHANNELS <= TLM_MAX_WEIGHTS,
+              "LOADCELL_CHANNELS out of range (see TLM_MAX_WEIGHTS)");
+
+// Per-channel state. The calibration record and filter belong to the loop
+// task; last_read_ms is only touched by the acquisition task.
+struct LoadcellChannel {
+#if HAVE_HX711
+  HX711    hx;
+#endif
+  bool     present;         // HX711 answered at init
+  float    factor;          // counts per gram
+  long     offset;
+  int      known;
+  float    tc_gpc;          // temperature coefficient, grams per degree C
+  float    tc_ref;          // ... around this temperature
+  LoadcellFilter filter;
+  uint32_t raw_count;
+  uint32_t last_sample_ms;
+  uint32_t last_read_ms;
+};
+
+static LoadcellChannel g_ch[LOADCELL_CHANNELS];
 static bool  g_inited = false;
+static int   g_rr = 0;              // round-robin start (acquisition task)
+
+// shared internal temperature (loop task)
+static bool    s_haveTemp = false;
+static int16_t s_tempCc = 0;
+
+static void calib_applyTempComp(int ch);
+
+static bool validCh(int ch) { return ch >= 0 && ch < LOADCELL_CHANNELS; }
+
+// Channel 0 keeps the single-channel key names ("factor"); others get the
+// channel number appended ("factor1").
+static const char *prefKey(char *buf, size_t len, const char *base, int ch) {
+  if (ch == 0) return base;
+  snprintf(buf, len, "%s%d", base, ch);
+  return buf;
+}
 
 void calib_init() {
   if (g_inited) return;
   g_inited = true;
 
+  LoadcellFilterConfig fc;
+  fc.window = CALIB_FILTER_WINDOW;
+  fc.mad_k_q4 = CALIB_FILTER_MAD_K_Q4;
+  fc.iir_shift = CALIB_FILTER_IIR_SHIFT;
+  fc.noise_counts = CALIB_FILTER_NOISE;
+
 #if HAVE_HX711
-  hx.begin(HX711_DOUT_PIN, HX711_SCK_PIN);
+  for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+    g_ch[ch].hx.begin(kChannels[ch].dout, kChannels[ch].sck);
+  }
   delay(100);
-  #if ENABLE_DEBUG
-    if (!hx.is_ready()) Serial.println(F("[CALIB] HX711 not ready"));
-  #endif
 #endif
 
   Preferences p;
-  if (p.begin(CALIB_PREF_NS, true)) {
-    g_saved_factor = p.getFloat("factor", 0.0f);
-    g_saved_offset = p.getLong("offset", 0);
-    g_saved_known  = p.getInt("known", 0);
-    p.end();
+  bool prefs = p.begin(CALIB_PREF_NS, true);
+  for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+    LoadcellChannel &c = g_ch[ch];
+#if HAVE_HX711
+    // DOUT is pulled low by a conversion every 100 ms
+    c.present = c.hx.wait_ready_timeout(2 * HX711_CONVERSION_MS);
+#endif
+    char k[16];
+    c.factor = prefs ? p.getFloat(prefKey(k, sizeof(k), "factor", ch), 0.0f) : 0.0f;
+    c.offset = prefs ? p.getLong(prefKey(k, sizeof(k), "offset", ch), 0) : 0;
+    c.known  = prefs ? p.getInt(prefKey(k, sizeof(k), "known", ch), 0) : 0;
+    c.tc_gpc = prefs ? p.getFloat(prefKey(k, sizeof(k), "tc_gpc", ch), 0.0f) : 0.0f;
+    c.tc_ref = prefs ? p.getFloat(prefKey(k, sizeof(k), "tc_ref", ch), 20.0f) : 20.0f;
+    lcf_init(c.filter, fc);
+    calib_applyTempComp(ch);
+
+    #if ENABLE_DEBUG
+      Serial.printf("[CALIB] ch%d HX711 %s, factor=%.3f offset=%ld\n", ch,
+                    c.present ? "ready" : "not ready", c.factor, c.offset);
+    #endif
   }
+  if (prefs) p.end();
+}
 
-  #if ENABLE_DEBUG
-    Serial.print(F("[CALIB] loaded factor="));
-    Serial.print(g_saved_factor);
-    Serial.print(F(" offset="));
-    Serial.println(g_saved_offset);
-  #endif
+int  calib_channelCount() { return LOADCELL_CHANNELS; }
+bool calib_present(int ch) { return validCh(ch) && g_ch[ch].present; }
+
+int calib_dataReadyPin(int ch) {
+  if (!validCh(ch)) return -1;
+  return kChannels[ch].dout;
 }
 
-static long calib_safe_read_once() {
+// Next channel (round-robin) whose read period has passed and whose DOUT is
+// low; ~25 SCK pulses, no waiting. A channel counts as due half a
+// conversion early so a 100 ms period reads every conversion.
+bool calib_readNext(int &ch, long &raw) {
 #if HAVE_HX711
-  unsigned long start = millis();
-  while (!hx.is_ready()) {
-    if (millis() - start > 500) break;
-    delay(1);
+  uint32_t now = millis();
+  for (int i = 0; i < LOADCELL_CHANNELS; i++) {
+    int c = (g_rr + i) % LOADCELL_CHANNELS;
+    LoadcellChannel &lc = g_ch[c];
+    if (!lc.present) continue;
+    if (now - lc.last_read_ms < (uint32_t)kChannels[c].period_ms - HX711_CONVERSION_MS / 2) continue;
+    if (!lc.hx.is_ready()) continue;
+    raw = lc.hx.read();
+    lc.last_read_ms = now;
+    g_rr = (c + 1) % LOADCELL_CHANNELS;
+    ch = c;
+    return true;
   }
-  long v = hx.read();
-  return v;
 #else
-  #if ENABLE_DEBUG
-    Serial.println(F("[CALIB] HX711 not present: stub read->0"));
-  #endif
-  return 0;
+  (void)ch; (void)raw;
 #endif
+  return false;
+}
+
+// ---- pending request (loop task) ----
+enum CalibReqKind : uint8_t { REQ_RAW, REQ_TARE };
+static struct {
+  CalibRequestStatus status;
+  CalibReqKind kind;
+  int  ch;
+  int  skip_total;
+  int  skip;          // samples still to discard
+  int  samples;       // samples to average
+  int  got;
+  long long sum;
+  long result;
+  uint32_t last_ms;   // start or last sample, for the timeout
+} s_req = { CALIB_REQ_IDLE, REQ_RAW, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static void calib_finishRequest() {
+  s_req.result = (long)(s_req.sum / s_req.got);
+  s_req.status = CALIB_REQ_DONE;
+  if (s_req.kind == REQ_TARE) {
+    LoadcellChannel &c = g_ch[s_req.ch];
+    c.offset = s_req.result; // transient until saved by caller if desired
+    lcf_reset(c.filter);
+    #if ENABLE_DEBUG
+      Serial.printf("[CALIB] ch%d TARE offset=%ld\n", s_req.ch, s_req.result);
+    #endif
+  }
+}
+
+void calib_onRawSample(int ch, long raw, uint32_t t_ms) {
+  if (!validCh(ch)) return;
+  LoadcellChannel &c = g_ch[ch];
+  c.raw_count++;
+  c.last_sample_ms = t_ms;
+  bool accepted = lcf_push(c.filter, (int32_t)raw);
+
+  if (s_req.status != CALIB_REQ_BUSY || s_req.ch != ch) return;
+  s_req.last_ms = millis();
+  if (!accepted) return;          // glitches do not count towards an average
+  if (s_req.skip > 0) { s_req.skip--; return; }
+  s_req.sum += raw;
+  if (++s_req.got >= s_req.samples) calib_finishRequest();
+}
+
+uint32_t calib_rawSampleCount(int ch) { return validCh(ch) ? g_ch[ch].raw_count : 0; }
+
+void calib_setTemperature(bool valid, float temp_c) {
+  s_haveTemp = valid;
+  s_tempCc = valid ? (int16_t)(temp_c * 100.0f) : 0;
 }
 
-long calib_readRawAverage(int samples, int skip) {
+bool calib_getWeightKg(int ch, float &kg, uint8_t *confidence) {
+  if (!calib_hasSavedFactor(ch)) return false;
+  const LoadcellChannel &c = g_ch[ch];
+  uint32_t stale = kChannels[ch].period_ms + CALIB_REQ_TIMEOUT_MS;
+  if (c.raw_count == 0 || millis() - c.last_sample_ms > stale) return false;
+  int32_t counts;
+  uint8_t conf;
+  if (!lcf_output(c.filter, s_haveTemp, s_tempCc, counts, conf)) return false;
+  kg = (float)(counts - c.offset) / c.factor / 1000.0f;
+  if (confidence) *confidence = conf;
+  return true;
+}
+
+const LoadcellFilter &calib_filter(int ch) { return g_ch[validCh(ch) ? ch : 0].filter; }
+
+static bool calib_startRequest(CalibReqKind kind, int ch, int samples, int skip) {
   if (samples <= 0) samples = CALIB_SAMPLES;
   if (skip < 0) skip = CALIB_SKIP;
-  long sum = 0;
-  int count = 0;
+  s_req.kind = kind;
+  s_req.ch = validCh(ch) ? ch : 0;
+  s_req.samples = samples;
+  s_req.skip_total = skip;
+  s_req.skip = skip;
+  s_req.got = 0;
+  s_req.sum = 0;
+  s_req.last_ms = millis();
+  if (!calib_present(ch)) {
+    #if ENABLE_DEBUG
+      Serial.printf("[CALIB] ch%d HX711 not present: request failed\n", ch);
+    #endif
+    s_req.status = CALIB_REQ_FAILED;
+    return false;
+  }
+  s_req.status = CALIB_REQ_BUSY;
+  return true;
+}
 
-  for (int i = 0; i < skip; i++) {
-    (void)calib_safe_read_once();
-    delay(20);
+bool calib_requestRawAverage(int ch, int samples, int skip) { return calib_startRequest(REQ_RAW, ch, samples, skip); }
+bool calib_requestTare(int ch, int samples, int skip)       { return calib_startRequest(REQ_TARE, ch, samples, skip); }
+
+CalibRequestStatus calib_pollRequest(long &raw, int *progress_pct) {
+  if (s_req.status == CALIB_REQ_BUSY &&
+      millis() - s_req.last_ms > kChannels[s_req.ch].period_ms + CALIB_REQ_TIMEOUT_MS) {
+    #if ENABLE_DEBUG
+      Serial.printf("[CALIB] ch%d HX711 request timed out\n", s_req.ch);
+    #endif
+    s_req.status = CALIB_REQ_FAILED;
   }
-  for (int i = 0; i < samples; i++) {
-    long v = calib_safe_read_once();
-    sum += v;
-    count++;
-    delay(30);
+  if (progress_pct) {
+    int total = s_req.skip_total + s_req.samples;
+    int done = (s_req.skip_total - s_req.skip) + s_req.got;
+    *progress_pct = (s_req.status == CALIB_REQ_DONE) ? 100 : (total > 0 ? done * 100 / total : 0);
   }
-  if (count == 0) return 0;
-  return sum / count;
+  if (s_req.status == CALIB_REQ_DONE) raw = s_req.result;
+  return s_req.status;
 }
 
-long calib_doTare(int samples, int skip) {
-  long off = calib_readRawAverage(samples, skip);
-  g_saved_offset = off; // transient until saved by caller if desired
-  #if ENABLE_DEBUG
-    Serial.print(F("[CALIB] TARE offset="));
-    Serial.println(off);
-  #endif
-  return off;
-}
+void calib_cancelRequest() { s_req.status = CALIB_REQ_IDLE; }
 
 float calib_computeFactorFromKnownWeight(long raw_at_weight, long offset, float grams) {
   if (grams <= 0.0f) return 0.0f;
@@ -99,7 +248,8 @@ float calib_computeFactorFromKnownWeight(long raw_at_weight, long offset, float
   return factor;
 }
 
-bool calib_saveFactor(float factor, long offset, int known_grams) {
+bool calib_saveFactor(int ch, float factor, long offset, int known_grams) {
+  if (!validCh(ch)) return false;
   Preferences p;
   if (!p.begin(CALIB_PREF_NS, false)) {
     #if ENABLE_DEBUG
@@ -107,25 +257,48 @@ bool calib_saveFactor(float factor, long offset, int known_grams) {
     #endif
     return false;
   }
-  p.putFloat("factor", factor);
-  p.putLong("offset", offset);
-  p.putInt("known", known_grams);
+  char k[16];
+  p.putFloat(prefKey(k, sizeof(k), "factor", ch), factor);
+  p.putLong(prefKey(k, sizeof(k), "offset", ch), offset);
+  p.putInt(prefKey(k, sizeof(k), "known", ch), known_grams);
   p.end();
 
-  g_saved_factor = factor;
-  g_saved_offset = offset;
-  g_saved_known  = known_grams;
+  LoadcellChannel &c = g_ch[ch];
+  c.factor = factor;
+  c.offset = offset;
+  c.known  = known_grams;
+  calib_applyTempComp(ch);
 
   #if ENABLE_DEBUG
-    Serial.print(F("[CALIB] saved factor="));
-    Serial.print(factor);
-    Serial.print(F(" offset="));
-    Serial.println(offset);
+    Serial.printf("[CALIB] ch%d saved factor=%.3f offset=%ld\n", ch, factor, offset);
   #endif
   return true;
 }
 
-bool calib_hasSavedFactor() { return (g_saved_factor > 0.0f); }
-float calib_getSavedFactor() { return g_saved_factor; }
-long  calib_getSavedOffset() { return g_saved_offset; }
-int   calib_getSavedKnown()  { return g_saved_known; }
\ No newline at end of file
+bool  calib_hasSavedFactor(int ch) { return validCh(ch) && g_ch[ch].factor > 0.0f; }
+float calib_getSavedFactor(int ch) { return validCh(ch) ? g_ch[ch].factor : 0.0f; }
+long  calib_getSavedOffset(int ch) { return validCh(ch) ? g_ch[ch].offset : 0; }
+int   calib_getSavedKnown(int ch)  { return validCh(ch) ? g_ch[ch].known : 0; }
+
+// The filter works in counts, so the coefficient follows the saved factor.
+static void calib_applyTempComp(int ch) {
+  LoadcellChannel &c = g_ch[ch];
+  lcf_setTempComp(c.filter, c.tc_gpc * c.factor, c.tc_ref);
+}
+
+bool calib_saveTempComp(int ch, float grams_per_c, float ref_c) {
+  if (!validCh(ch)) return false;
+  Preferences p;
+  if (!p.begin(CALIB_PREF_NS, false)) return false;
+  char k[16];
+  p.putFloat(prefKey(k, sizeof(k), "tc_gpc", ch), grams_per_c);
+  p.putFloat(prefKey(k, sizeof(k), "tc_ref", ch), ref_c);
+  p.end();
+  g_ch[ch].tc_gpc = grams_per_c;
+  g_ch[ch].tc_ref = ref_c;
+  calib_applyTempComp(ch);
+  return true;
+}
+
+float calib_getTempCoeff(int ch) { return validCh(ch) ? g_ch[ch].tc_gpc : 0.0f; }
+float calib_getTempRef(int ch)   { return validCh(ch) ? g_ch[ch].tc_ref : 0.0f; }
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "loadcell_filter.h"
 
 // HX711 detection (use library if available)
 #ifdef __has_include
@@ -24,15 +25,65 @@
 #ifndef CALIB_SKIP
   #define CALIB_SKIP 5
 #endif
+// Filter pipeline for the published weight (loadcell_filter.h)
+#ifndef CALIB_FILTER_WINDOW
+  #define CALIB_FILTER_WINDOW 9       // median/MAD window (0.9 s at 10 SPS)
+#endif
+#ifndef CALIB_FILTER_MAD_K_Q4
+  #define CALIB_FILTER_MAD_K_Q4 48    // reject beyond 3 sigma (Q4)
+#endif
+#ifndef CALIB_FILTER_IIR_SHIFT
+  #define CALIB_FILTER_IIR_SHIFT 3    // IIR weight 1/8
+#endif
+#ifndef CALIB_FILTER_NOISE
+  #define CALIB_FILTER_NOISE 40       // counts, HX711 noise at gain 128
+#endif
+#ifndef CALIB_REQ_TIMEOUT_MS
+  #define CALIB_REQ_TIMEOUT_MS 1000   // no HX711 sample for this long -> request fails
+#endif
 
+// HX711 engine: one channel per entry of LOADCELL_CHANNEL_TABLE (config.h).
+// The acquisition task reads the channels round-robin whenever a DOUT is
+// low (data ready) and the channel's read period has passed, and queues
+// the counts; loop() feeds them back through calib_onRawSample(). Nothing
+// here waits for an HX711. Calibration records are stored per channel in
+// CALIB_PREF_NS (channel 0 keeps the original key names).
 void calib_init();
-long calib_readRawAverage(int samples = CALIB_SAMPLES, int skip = CALIB_SKIP);
-long calib_doTare(int samples = CALIB_SAMPLES, int skip = CALIB_SKIP);
+int  calib_channelCount();
+bool calib_present(int ch);
+int  calib_dataReadyPin(int ch);                          // DOUT, for the data-ready interrupt
+bool calib_readNext(int &ch, long &raw);                  // acquisition task only
+void calib_onRawSample(int ch, long raw, uint32_t t_ms);  // loop task only
+uint32_t calib_rawSampleCount(int ch);
+
+// Filtered weight: median/MAD outlier gate, IIR smoothing and temperature
+// compensation. confidence is 0..100 (see loadcell_filter.h).
+void calib_setTemperature(bool valid, float temp_c);      // shared by all channels
+bool calib_getWeightKg(int ch, float &kg, uint8_t *confidence = nullptr);
+const LoadcellFilter &calib_filter(int ch);
+bool  calib_saveTempComp(int ch, float grams_per_c, float ref_c);
+float calib_getTempCoeff(int ch);
+float calib_getTempRef(int ch);
+
+// Asynchronous averaged reads: start a request, then poll it from the
+// caller's loop (the samples arrive through calib_onRawSample). One request
+// at a time; a new one replaces the previous.
+enum CalibRequestStatus : uint8_t {
+  CALIB_REQ_IDLE = 0,
+  CALIB_REQ_BUSY,
+  CALIB_REQ_DONE,
+  CALIB_REQ_FAILED
+};
+bool calib_requestRawAverage(int ch, int samples = CALIB_SAMPLES, int skip = CALIB_SKIP);
+bool calib_requestTare(int ch, int samples = CALIB_SAMPLES, int skip = CALIB_SKIP);  // DONE sets the offset
+CalibRequestStatus calib_pollRequest(long &raw, int *progress_pct = nullptr);
+void calib_cancelRequest();
+
 float calib_computeFactorFromKnownWeight(long raw_at_weight, long offset, float grams);
-bool calib_saveFactor(float factor, long offset, int known_grams);
-bool calib_hasSavedFactor();
-float calib_getSavedFactor();
-long  calib_getSavedOffset();
-int   calib_getSavedKnown();
+bool  calib_saveFactor(int ch, float factor, long offset, int known_grams);
+bool  calib_hasSavedFactor(int ch);
+float calib_getSavedFactor(int ch);
+long  calib_getSavedOffset(int ch);
+int   calib_getSavedKnown(int ch);
 
 #endif // CALIBRATION_H
\ No newline at end of file
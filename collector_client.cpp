@@ -0,0 +1,45 @@
+#include "collector_client.h"
+#include "config.h"
+
+static bool col_enabled() { return strlen(COLLECTOR_URL) > 0; }
+
+static void col_begin(String &out) {
+  out += "{\"api_key\":";
+  sink_jsonString(out, COLLECTOR_API_KEY);
+  out += ",\"samples\":[";
+}
+
+// Undatable samples go without "ts" (the server stamps them on arrival)
+static void col_encode(String &out, const SampleRecord &r, int n) {
+  if (n) out += ',';
+  sink_jsonSample(out, r);
+}
+
+static void col_end(String &out) { out += "]}"; }
+
+static bool col_send(const HttpTransport &tp, const String &body, HttpResponse &resp) {
+  String url = String(COLLECTOR_URL) + "/api/telemetry/batch";
+  HttpRequest req = { "POST", url.c_str(), "application/json",
+                      body.c_str(), body.length(), 20000 };
+  return tp.perform(req, resp);
+}
+
+static bool col_ack(const HttpResponse &resp, int) {
+  return resp.status == 200 && strstr(resp.body, "\"ok\"");
+}
+
+const TelemetrySink SINK_COLLECTOR = {
+  "collector",
+  COLLECTOR_QUEUE_DIR,
+  COLLECTOR_BATCH_MAX,
+  COLLECTOR_BATCH_BYTES,
+  COLLECTOR_MIN_INTERVAL_MS,
+  col_enabled,
+  col_begin,
+  col_encode,
+  col_end,
+  col_send,
+  col_ack,
+  nullptr,
+  nullptr,
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include <Arduino.h>
+#include "telemetry_sink.h"
+
+// Own telemetry collector (server/server_main.py) as an upload sink.
+// Queued samples go in batches of up to COLLECTOR_BATCH_MAX to
+// COLLECTOR_URL/api/telemetry/batch:
+//   {"api_key":"..","samples":[{"ts":"2024-05-01T10:00:00Z","lat":..,
+//    "lon":..,"fields":{"field1":"23.5",..}},..]}
+// and are acked by {"status":"ok",..}. Off while COLLECTOR_URL is "".
+extern const TelemetrySink SINK_COLLECTOR;
@@ -19,6 +19,7 @@
 #define MEASUREMENT_INTERVAL  (3600ULL * 1000000ULL)
 
 #define THINGSPEAK_WRITE_APIKEY "10A4ZQ8S44BPJASO"
+#define THINGSPEAK_CHANNEL_ID   0UL     // channel number for bulk uploads (0 = queue drains one /update at a time)
 
 // =============================
 // Fixed hardware pinout
@@ -32,6 +33,21 @@
 #define DOUT           19
 #define SCK            18
 
+// Load-cell channels, one HX711 per hive: { DOUT, SCK, read period ms }.
+// Each HX711 needs its own SCK. The period may be longer than the 100 ms
+// conversion time to sample a channel less often. Free outputs for extra
+// SCKs: 25, 16, 17 (16/17 only on modules without PSRAM); 5 is the buzzer.
+#ifndef LOADCELL_CHANNELS
+#define LOADCELL_CHANNELS 1
+#endif
+#ifndef LOADCELL_CHANNEL_TABLE
+#define LOADCELL_CHANNEL_TABLE { \
+  { DOUT, SCK, 100 },            \
+  /* { 36, 25, 100 }, */         \
+  /* { 39, 16, 100 }, */         \
+}
+#endif
+
 // SD Card pins
 #define SD_MISO        2
 #define SD_MOSI        15
@@ -43,6 +59,27 @@
 #define R1             10000.0
 #define R2             10000.0
 
+// Battery monitor (battery_monitor.h)
+#define BATT_CHEM_LIION      0      // 3.0 .. 4.2 V per cell
+#define BATT_CHEM_LIFEPO4    1      // 2.5 .. 3.4 V per cell
+#define BATT_CHEM_LEADACID   2      // 1.75 .. 2.12 V per cell (resting)
+#ifndef BATT_CHEMISTRY
+#define BATT_CHEMISTRY       BATT_CHEM_LIION
+#endif
+#ifndef BATT_CELLS
+#define BATT_CELLS           1
+#endif
+#define BATT_MEASURE_PERIOD_MS 10000   // one oversampled burst every 10 s
+#define BATT_ADC_CONVERSIONS   256     // samples averaged per burst
+#define BATT_ADC_FREQ_HZ       20000   // continuous-mode sample rate (ESP32 minimum)
+#define BATT_FILTER_ALPHA      0.25f   // EWMA over bursts
+
+// Internal temperature / humidity (SI7021 on the I2C bus)
+#define INT_CLIMATE_PERIOD_MS  30000   // one reading every 30 s
+#ifndef TEMP_COMP_DIE_FALLBACK
+#define TEMP_COMP_DIE_FALLBACK 1       // no SI7021: compensate on the ESP32 die temperature
+#endif
+
 // LTE Modem
 #define MODEM_RX       27
 #define MODEM_TX       26
@@ -109,37 +146,12 @@ extern LiquidCrystal_I2C lcd;
 #endif
 
 // ============================================================
-// SENSOR VALUE GLOBALS (no hardcoded test values here)
+// SENSOR VALUES
 //
-// These globals are updated by the sensors module when real sensors are
-// connected. They are declared extern here and defined (with safe defaults)
-// in sensors.cpp. Do NOT hardcode temporary data here.
+// Current readings are published as one TelemetrySnapshot (telemetry.h);
+// read them with telemetry_read(). There are no per-value globals.
 // ============================================================
 
-// Weight (kg)
-extern float test_weight;
-
-// Internal Temperature & Humidity (SI7021)
-extern float test_temp_int;
-extern float test_hum_int;
-
-// External Temperature, Humidity, Pressure (BME280/BME680)
-extern float test_temp_ext;
-extern float test_hum_ext;
-extern float test_pressure;
-
-// Accelerometer (X,Y,Z)
-extern float test_acc_x;
-extern float test_acc_y;
-extern float test_acc_z;
-
-// Battery voltage & percentage (retain placeholders as requested)
-extern float test_batt_voltage;
-extern int   test_batt_percent;
-
-// Modem signal (optional)
-extern int   test_rssi;
-
 // ------------------------
 // Default location (compile-time fallback only)
 #define DEFAULT_LAT       37.983810       // fallback: Athens latitude
@@ -152,12 +164,143 @@ extern int   test_rssi;
 #define ACCEL_THRESHOLD    2.0             // m/s^2 delta to trigger alarm
 //#define GPS_UPDATE_INTERVAL (3600UL * 1000UL) // 1 hour in ms
 #define GPS_UPDATE_INTERVAL (60UL * 1000UL) // 1 minute in ms
+#define GNSS_REPORT_INTERVAL_S 10         // modem sends +CGNSSINFO this often
+#define GNSS_MAX_FIX_AGE_MS    (10UL * 60UL * 1000UL) // older fixes are not published
+#define GNSS_REARM_MS          (60UL * 1000UL)  // min time between re-arm attempts
+
+// Motion detector (motion_detector.h): deviation from the gravity baseline
+#define MOTION_THRESHOLD           ACCEL_THRESHOLD   // m/s^2 |a - g|
+#define MOTION_BASELINE_ALPHA      0.01f             // ~2 s time constant at 50 Hz
+#define MOTION_DEBOUNCE_SAMPLES    5                 // samples over threshold ...
+#define MOTION_WINDOW_SAMPLES      25                // ... within the last 0.5 s
+#define MOTION_COOLDOWN_MS         (5UL * 60UL * 1000UL) // quiet time before re-arming
+#define MOTION_SETTLE_MS           3000              // baseline learning after boot / re-arm
+#define MOTION_MAX_ALARMS_PER_HOUR 4
+
+// =============================
+// SMS commands and outbox (sms_handler.h)
+// =============================
+#define SMS_CMD_PIN        "4321"          // first word of every SMS command - CHANGE ME
+#define SMS_NUMBER_MATCH_DIGITS 9          // sender == alarm phone if the last digits match
+#define SMS_MAX_BATCH      8               // messages handled per scan
+#define SMS_RESCAN_MS      (30UL * 60UL * 1000UL) // safety scan in case a +CMTI was missed
+#define SMS_RETRY_MS       (60UL * 1000UL) // after a failed listing (SIM not ready)
+#define SMS_OUTBOX_LEN     6               // outgoing messages waiting / awaiting report
+#define SMS_COALESCE_MS    (5UL * 60UL * 1000UL) // repeats of one alarm within this become one SMS
+#define SMS_MAX_ATTEMPTS   5
+#define SMS_RETRY_BASE_MS  (15UL * 1000UL) // doubles per failed attempt ...
+#define SMS_RETRY_MAX_MS   (10UL * 60UL * 1000UL) // ... up to this
+#define SMS_SEND_TIMEOUT_MS 60000          // AT+CMGS can take long on a weak network
+#define SMS_DELIVERY_REPORTS 1             // request +CDS status reports
+#define SMS_REPORT_WAIT_MS (10UL * 60UL * 1000UL) // keep tracking a sent message this long
+
+// =============================
+// Modem: AT engine, power-up, status cache
+// =============================
+#define MODEM_URC_POLL_MS      200              // AT engine service period when idle (URCs)
+#define MODEM_UART_RX_BUFFER   4096             // UART driver RX ring (bytes), set before begin()
+#define MODEM_AT_PROBE_MS      300              // one AT probe during power-up
+#define MODEM_PWR_SEQ_WAIT_MS  4000             // wait for AT after a PWRKEY sequence
+#define MODEM_REG_PROBE_MS     1000             // registration poll until first attach (boot metric)
+#define MODEM_STATUS_TTL_MS    (30UL * 1000UL)  // background CSQ / registration refresh
+#define MODEM_OPERATOR_TTL_MS  (10UL * 60UL * 1000UL) // operator name refresh
+
+// =============================
+// Modem power saving: PSM / eDRX (modem_power.h)
+// =============================
+#define MODEM_PSM_ENABLE       1                // sleep the modem (PSM) between distant uploads
+#define MODEM_PSM_TAU_S        (4UL * 3600UL)   // requested periodic TAU (at least the sleep length)
+#define MODEM_PSM_ACTIVE_S     30               // requested active time before PSM
+#define MODEM_EDRX_MS          81920            // requested eDRX cycle, 0 = leave as is
+#define MODEM_PSM_MIN_SLEEP_MS (10UL * 60UL * 1000UL) // shorter gaps: stay awake
+#define MODEM_PSM_WAKE_LEAD_MS (60UL * 1000UL)  // awake this long before an upload
+#define MODEM_PSM_IDLE_MS      (30UL * 1000UL)  // no AT traffic this long before sleeping
+#define MODEM_PSM_WAKE_PULSE_MS 200             // PWRKEY pulse (power-off needs >2.5 s)
+#define MODEM_PSM_WAKE_TRIES   3
+
+// =============================
+// LTE data session (pdp_session.h)
+// =============================
+#define PDP_ATTACH_TIMEOUT_MS  (60UL * 1000UL)  // LTE data attach, registration wait included
+#define PDP_BACKOFF_MIN_MS     (5UL * 1000UL)   // first retry after a failed attach ...
+#define PDP_BACKOFF_MAX_MS     (10UL * 60UL * 1000UL) // ... doubling up to this
+#define PDP_BACKOFF_JITTER_PCT 20               // +/- spread of each backoff
+
+// =============================
+// HTTP over LTE (http_pool.h, modem-native HTTP(S))
+// =============================
+#define HTTP_POOL_SIZE         2                // keep-alive modem sockets for HTTP uploads
+#define HTTP_POOL_MUX_BASE     1                // first modem socket (mux 0 stays with ad-hoc clients)
+#define HTTP_POOL_IDLE_MS      (50UL * 1000UL)  // reconnect instead of reusing after this idle time
+#define MODEM_HTTP_READ_BLOCK  1024             // AT+HTTPREAD block size (modem-native HTTP(S))
+#define THINGSPEAK_LTE_NATIVE_HTTP 0            // 1: ThingSpeak over the modem's HTTPS client instead of the pool
+
+// =============================
+// Upload sinks (telemetry_sink.h)
+// =============================
+#define SINK_SEG_BYTES         (16UL * 1024UL)  // upload queue segment file size (each sink)
+#define SINK_RETRY_MIN_MS      (30UL * 1000UL)  // first retry after a batch a sink did not ack ...
+#define SINK_RETRY_MAX_MS      (30UL * 60UL * 1000UL) // ... doubling up to this
+#define SINK_BEARER_POLL_MS    (10UL * 1000UL)  // samples queued, no bearer: look again after
+#define SINK_IDLE_MS           (60UL * 1000UL)  // nothing queued: service the sinks anyway after
+
+// ThingSpeak (thingspeak_client.h)
+#define TS_QUEUE_DIR           "/sd/tsq"        // ThingSpeak backlog (VFS path, SD mounted at /sd)
+#define TS_BULK_MAX_ENTRIES    100              // queued samples per bulk_update.json request
+#define TS_BULK_MAX_BYTES      16000            // ... and at most this much JSON
+#define TS_BULK_MIN_INTERVAL_MS (16UL * 1000UL) // between requests (ThingSpeak allows one per 15 s)
+
+// Own collector (collector_client.h)
+#define COLLECTOR_URL          ""               // own collector (server/), e.g. "http://10.0.0.2:8000"; "" = off
+#define COLLECTOR_API_KEY      "changeme"       // TELEMETRY_API_KEY on the server
+#define COLLECTOR_QUEUE_DIR    "/sd/colq"       // collector backlog
+#define COLLECTOR_BATCH_MAX    50               // samples per /api/telemetry/batch request
+#define COLLECTOR_BATCH_BYTES  12000            // ... and at most this much JSON
+#define COLLECTOR_MIN_INTERVAL_MS 2000          // between requests
+
+// =============================
+// MQTT upload sink (mqtt_client.h)
+// =============================
+#define MQTT_HOST              ""               // broker for the MQTT upload sink, e.g. "10.0.0.2"; "" = off
+#define MQTT_PORT              1883
+#define MQTT_USER              ""               // "" = no login
+#define MQTT_PASS              ""
+#define MQTT_TOPIC_PREFIX      "beehive"        // samples go to <prefix>/<client id>/telemetry
+#define MQTT_KEEPALIVE_S       300              // PINGREQ after half of this without traffic
+#define MQTT_ACK_TIMEOUT_MS    (15UL * 1000UL)  // CONNACK / PUBACK / PINGRESP, then reconnect
+#define MQTT_QUEUE_DIR         "/sd/mqq"        // MQTT backlog
+#define MQTT_BATCH_MAX         16               // QoS 1 publishes in flight at once (<= MQTT_MAX_INFLIGHT)
+#define MQTT_BATCH_BYTES       4000
+#define MQTT_MUX               (HTTP_POOL_MUX_BASE + HTTP_POOL_SIZE) // modem socket of the session
+
+// =============================
+// Sensor acquisition task
+// =============================
+#ifndef ACQ_TASK_CORE
+#define ACQ_TASK_CORE        0      // loop() runs on core 1
+#endif
+#define ACQ_TASK_PRIORITY    3
+#define ACQ_ACCEL_PERIOD_MS  20     // 50 Hz accelerometer sampling
+#define ACQ_RING_SIZE        128    // samples (power of two)
+#define ACQ_DRAIN_PERIOD_MS  50     // loop() drains the ring this often
+#define ACQ_FIFO_DRAIN_MS    200    // MPU FIFO burst read period (10 samples at 50 Hz)
+#define ACQ_FIFO_MAX_BURST   64     // samples read per drain at most
+
+// MPU6050 FIFO + motion-detect interrupt
+#ifndef MPU_INT_PIN
+#define MPU_INT_PIN          34     // MPU6050 INT -> GPIO34 (input only); -1 = not wired
+#endif
+#define MPU_SAMPLE_DIV       19     // 1 kHz / (1 + 19) = 50 Hz into the FIFO
+#define MPU_MOTION_DURATION  20     // ms above threshold before MOT_INT fires
+#define MPU_MOTION_THRESHOLD ((uint8_t)(ACCEL_THRESHOLD / 9.80665 * 1000.0 / 2.0)) // 2 mg/LSB
 
 // =============================
-// GPS Globals
+// Scheduler
 // =============================
-extern double test_lat;
-extern double test_lon;
+// Longest loop() sleep between scheduler passes (ms)
+#ifndef SCHED_MAX_IDLE_MS
+#define SCHED_MAX_IDLE_MS  100
+#endif
 
 // Optional behavior toggles (local to project)
 #ifndef AUTOSTART_KEYSERVER
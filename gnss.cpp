@@ -0,0 +1,105 @@
+// gnss.cpp
+// +CGNSSINFO parser and fix cache (see gnss.h).
+
+#include "gnss.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GNSS_PREFIX      "+CGNSSINFO:"
+#define GNSS_MAX_LINE    160
+#define GNSS_MAX_FIELDS  24
+
+static GnssFix  s_fix = {};
+static bool     s_haveFix = false;
+static bool     s_haveReport = false;
+static uint32_t s_lastReportMs = 0;
+static uint32_t s_reports = 0;
+static uint32_t s_fixes = 0;
+static uint32_t s_errors = 0;
+
+// "3113.330650" (NMEA ddmm.mmmm / dddmm.mmmm) or "31.222177" (degrees).
+// Degrees never need more than 3 integer digits, NMEA always has 4+.
+static bool parseCoord(const char *s, double &deg) {
+  if (!*s) return false;
+  char *end = nullptr;
+  double v = strtod(s, &end);
+  if (end == s) return false;
+  const char *dot = strchr(s, '.');
+  size_t intDigits = dot ? (size_t)(dot - s) : strlen(s);
+  if (intDigits >= 4) {
+    int d = (int)(v / 100.0);
+    v = d + (v - d * 100.0) / 60.0;
+  }
+  deg = v;
+  return true;
+}
+
+bool gnss_feedLine(const char *line, uint32_t now_ms) {
+  if (strncmp(line, GNSS_PREFIX, sizeof(GNSS_PREFIX) - 1) != 0) return false;
+  const char *p = line + sizeof(GNSS_PREFIX) - 1;
+  while (*p == ' ') p++;
+
+  s_reports++;
+  s_haveReport = true;
+  s_lastReportMs = now_ms;
+
+  char buf[GNSS_MAX_LINE];
+  strncpy(buf, p, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+
+  char *f[GNSS_MAX_FIELDS];
+  int n = 0;
+  char *c = buf;
+  f[n++] = c;
+  while (*c && n < GNSS_MAX_FIELDS) {
+    if (*c == ',') { *c = '\0'; f[n++] = c + 1; }
+    c++;
+  }
+
+  // the hemisphere field anchors the layout: lat, N/S, lon, E/W, date, time, alt, speed, course, pdop, hdop
+  int ns = -1;
+  for (int i = 2; i < n; i++) {
+    if ((f[i][0] == 'N' || f[i][0] == 'S') && f[i][1] == '\0') { ns = i; break; }
+  }
+  if (ns < 0) return true;          // "+CGNSSINFO: ,,,,,,,," = no fix yet
+  if (ns + 5 >= n) { s_errors++; return true; }
+
+  GnssFix fix = {};
+  if (!parseCoord(f[ns - 1], fix.lat) || !parseCoord(f[ns + 1], fix.lon)) {
+    s_errors++;
+    return true;
+  }
+  if (f[ns][0] == 'S') fix.lat = -fix.lat;
+  if (f[ns + 2][0] == 'W') fix.lon = -fix.lon;
+  if (fix.lat < -90.0 || fix.lat > 90.0 || fix.lon < -180.0 || fix.lon > 180.0) {
+    s_errors++;
+    return true;
+  }
+
+  for (int i = 1; i < ns - 1; i++) fix.sats += (uint8_t)atoi(f[i]);
+  fix.utc_date = (uint32_t)strtoul(f[ns + 3], nullptr, 10);
+  fix.utc_time = (uint32_t)strtoul(f[ns + 4], nullptr, 10);
+  if (ns + 5 < n) fix.alt_m    = (float)atof(f[ns + 5]);
+  if (ns + 6 < n) fix.speed_kn = (float)atof(f[ns + 6]);
+  if (ns + 9 < n) fix.hdop     = (float)atof(f[ns + 9]);
+  fix.valid = true;
+  fix.t_ms = now_ms;
+
+  s_fix = fix;
+  s_haveFix = true;
+  s_fixes++;
+  return true;
+}
+
+bool gnss_getFix(GnssFix &out) {
+  if (!s_haveFix) return false;
+  out = s_fix;
+  return true;
+}
+
+uint32_t gnss_fixAgeMs(uint32_t now_ms)    { return s_haveFix ? now_ms - s_fix.t_ms : UINT32_MAX; }
+uint32_t gnss_reportAgeMs(uint32_t now_ms) { return s_haveReport ? now_ms - s_lastReportMs : UINT32_MAX; }
+
+uint32_t gnss_reports()     { return s_reports; }
+uint32_t gnss_fixes()       { return s_fixes; }
+uint32_t gnss_parseErrors() { return s_errors; }
@@ -0,0 +1,45 @@
+#ifndef GNSS_H
+#define GNSS_H
+
+#include <stdint.h>
+
+// gnss.h : cached GNSS fix fed by unsolicited +CGNSSINFO reports.
+//
+// After AT+CGNSSINFO=<n> the A7670 prints a position report every n
+// seconds on its own. The AT engine frames those lines and modem_manager
+// hands them to gnss_feedLine(), which parses in place (no String, no heap) and
+// keeps the latest fix with its receive time. Readers never talk to the
+// modem, so they return immediately.
+//
+// Accepts both report layouts in the field (3 or 4 constellation counts)
+// and both coordinate formats (dd.dddddd and NMEA ddmm.mmmm).
+
+struct GnssFix {
+  bool     valid;       // false: modem reported "no fix"
+  double   lat, lon;    // degrees, +N / +E
+  float    alt_m;
+  float    speed_kn;
+  float    hdop;
+  uint8_t  sats;        // satellites in use, all constellations
+  uint32_t utc_date;    // ddmmyy
+  uint32_t utc_time;    // hhmmss
+  uint32_t t_ms;        // millis() when the report arrived
+};
+
+// Parse one line (without CR/LF). Returns true if it was a +CGNSSINFO
+// report (with or without a fix).
+bool gnss_feedLine(const char *line, uint32_t now_ms);
+
+// Latest report with a fix. Returns false if none yet.
+bool gnss_getFix(GnssFix &out);
+
+// Age of the latest fix / latest report of any kind (UINT32_MAX if never).
+uint32_t gnss_fixAgeMs(uint32_t now_ms);
+uint32_t gnss_reportAgeMs(uint32_t now_ms);
+
+// Counters
+uint32_t gnss_reports();
+uint32_t gnss_fixes();
+uint32_t gnss_parseErrors();
+
+#endif // GNSS_H
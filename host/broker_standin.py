@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Stand-in servers for host/test_mqtt_session.cpp.
+
+    broker_standin.py PORT
+
+PORT:   MQTT 3.1.1 broker stand-in. Answers CONNECT with CONNACK (session
+        present when the client id connected before with clean session
+        off), QoS 1 PUBLISH with PUBACK (not for topics containing "noack",
+        to provoke ack timeouts), PINGREQ with PINGRESP; DISCONNECT closes.
+PORT+1: HTTP/1.1 keep-alive stand-in answering every request like
+        ThingSpeak's /update (entry id in the body), to count the bytes of
+        the HTTP upload path next to MQTT.
+
+Nothing is stored; it runs until killed.
+"""
+import socket
+import sys
+import threading
+
+sessions = set()
+
+# what api.thingspeak.com sends back for /update (headers trimmed to the
+# ones it always sets)
+HTTP_RESPONSE = (
+    b"HTTP/1.1 200 OK\r\n"
+    b"Date: Wed, 01 May 2024 10:00:00 GMT\r\n"
+    b"Content-Type: text/plain; charset=utf-8\r\n"
+    b"Content-Length: 5\r\n"
+    b"Connection: keep-alive\r\n"
+    b"Status: 200 OK\r\n"
+    b"Cache-Control: max-age=0, private, must-revalidate\r\n"
+    b"Access-Control-Allow-Origin: *\r\n"
+    b"Access-Control-Max-Age: 1800\r\n"
+    b"X-Request-Id: 6f2b4c1e-9a7d-4e2b-8c31-2d5f0a7b9e10\r\n"
+    b"Access-Control-Allow-Headers: origin, content-type, X-Requested-With\r\n"
+    b"Access-Control-Allow-Methods: GET, POST, PUT, OPTIONS, DELETE, PATCH\r\n"
+    b"ETag: W/\"5d41402abc4b2a76b9719d911017c592\"\r\n"
+    b"\r\n"
+    b"12345"
+)
+
+
+def read_exact(c, n):
+    b = b""
+    while len(b) < n:
+        x = c.recv(n - len(b))
+        if not x:
+            raise EOFError
+        b += x
+    return b
+
+
+def mqtt_client(c):
+    try:
+        while True:
+            h = read_exact(c, 1)[0]
+            ln, mult = 0, 1
+            while True:
+                b = read_exact(c, 1)[0]
+                ln += (b & 127) * mult
+                mult *= 128
+                if not b & 128:
+                    break
+            body = read_exact(c, ln)
+            t = h >> 4
+            if t == 1:                                  # CONNECT
+                cid_len = body[10] << 8 | body[11]
+                cid = body[12:12 + cid_len]
+                clean = body[7] & 2
+                present = 1 if (cid in sessions and not clean) else 0
+                sessions.add(cid)
+                c.sendall(bytes([0x20, 2, present, 0]))
+            elif t == 3:                                # PUBLISH
+                tl = body[0] << 8 | body[1]
+                topic = body[2:2 + tl]
+                pid = body[2 + tl:4 + tl]
+                if (h >> 1) & 3 and b"noack" not in topic:
+                    c.sendall(bytes([0x40, 2]) + pid)
+            elif t == 12:                               # PINGREQ
+                c.sendall(bytes([0xD0, 0]))
+            elif t == 14:                               # DISCONNECT
+                break
+    except (EOFError, OSError):
+        pass
+    c.close()
+
+
+def http_client(c):
+    buf = b""
+    try:
+        while True:
+            while b"\r\n\r\n" not in buf:
+                x = c.recv(65536)
+                if not x:
+                    raise EOFError
+                buf += x
+            hdr, _, buf = buf.partition(b"\r\n\r\n")
+            n = 0
+            for line in hdr.split(b"\r\n"):
+                if line.lower().startswith(b"content-length:"):
+                    n = int(line.split(b":")[1])
+            while len(buf) < n:
+                x = c.recv(65536)
+                if not x:
+                    raise EOFError
+                buf += x
+            buf = buf[n:]
+            c.sendall(HTTP_RESPONSE)
+    except (EOFError, OSError):
+        pass
+    c.close()
+
+
+def serve(port, handler):
+    s = socket.socket()
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(("127.0.0.1", port))
+    s.listen(5)
+    while True:
+        c, _ = s.accept()
+        threading.Thread(target=handler, args=(c,), daemon=True).start()
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 18830
+    threading.Thread(target=serve, args=(port + 1, http_client), daemon=True).start()
+    serve(port, mqtt_client)
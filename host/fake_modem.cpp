@@ -0,0 +1,122 @@
+// fake_modem.cpp
+// Scripted modem (see fake_modem.h).
+
+#include "fake_modem.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct FmOut { uint32_t due; std::string bytes; };
+
+static uint32_t    (*s_now)() = nullptr;
+static const FmRule *s_rules = nullptr;
+static int           s_ruleCount = 0;
+static FmHook        s_hook = nullptr;
+static std::string   s_in;                 // partial command
+static std::vector<FmOut> s_out;           // in due order
+static bool          s_echo = false;
+static bool          s_asleep = false;
+static int           s_commands = 0;
+static std::string   s_last;
+
+static void fm_queue(const std::string &bytes, uint32_t delay_ms) {
+  FmOut o = { s_now() + delay_ms, bytes };
+  size_t i = s_out.size();
+  while (i > 0 && (int32_t)(s_out[i - 1].due - o.due) > 0) i--;
+  s_out.insert(s_out.begin() + i, o);
+}
+
+static std::string fm_lines(const char *lines) {
+  std::string out;
+  const char *p = lines;
+  for (;;) {
+    const char *e = strchr(p, '\n');
+    size_t n = e ? (size_t)(e - p) : strlen(p);
+    out += "\r\n";
+    out.append(p, n);
+    out += "\r\n";
+    if (!e) break;
+    p = e + 1;
+  }
+  return out;
+}
+
+static const FmRule *fm_match(const char *cmd) {
+  for (int i = 0; i < s_ruleCount; i++) {
+    const char *r = s_rules[i].cmd;
+    size_t n = strlen(r);
+    if (n && r[n - 1] == '*') {
+      if (strncmp(cmd, r, n - 1) == 0) return &s_rules[i];
+    } else if (strcmp(cmd, r) == 0) {
+      return &s_rules[i];
+    }
+  }
+  return nullptr;
+}
+
+static void fm_command(const std::string &line) {
+  s_commands++;
+  s_last = line;
+  if (s_asleep) return;
+  if (s_echo) fm_queue(line + "\r", 0);
+  if (line.compare(0, 2, "AT") != 0) {
+    fm_queue(fm_lines("ERROR"), 0);
+    return;
+  }
+  const char *cmd = line.c_str() + 2;
+  if (s_hook) s_hook(cmd);
+  if (s_asleep) return;                    // the hook put it to sleep
+  const FmRule *r = fm_match(cmd);
+  if (!r) {
+    fm_queue(fm_lines("ERROR"), 0);
+    return;
+  }
+  if (r->reply) fm_queue(fm_lines(r->reply), r->delay_ms);
+}
+
+void fm_init(uint32_t (*now_ms)(), const FmRule *rules, int count, FmHook hook) {
+  s_now = now_ms;
+  s_rules = rules;
+  s_ruleCount = count;
+  s_hook = hook;
+  s_in.clear();
+  s_out.clear();
+  s_echo = false;
+  s_asleep = false;
+  s_commands = 0;
+  s_last.clear();
+}
+
+void fm_rx(const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    if (c == '\r' || c == '\n') {
+      if (!s_in.empty()) fm_command(s_in);
+      s_in.clear();
+    } else {
+      s_in += c;
+    }
+  }
+}
+
+size_t fm_tx(char *buf, size_t cap) {
+  size_t n = 0;
+  uint32_t now = s_now();
+  while (!s_out.empty() && (int32_t)(now - s_out[0].due) >= 0 && n < cap) {
+    std::string &b = s_out[0].bytes;
+    size_t take = b.size() < cap - n ? b.size() : cap - n;
+    memcpy(buf + n, b.data(), take);
+    n += take;
+    b.erase(0, take);
+    if (b.empty()) s_out.erase(s_out.begin());
+  }
+  return n;
+}
+
+void fm_send(const char *lines, uint32_t delay_ms) { fm_queue(fm_lines(lines), delay_ms); }
+void fm_setEcho(bool echo) { s_echo = echo; }
+void fm_setAsleep(bool asleep) { s_asleep = asleep; }
+bool fm_asleep() { return s_asleep; }
+int  fm_commands() { return s_commands; }
+const char *fm_lastCommand() { return s_last.c_str(); }
+void fm_clear() { s_out.clear(); s_in.clear(); }
@@ -0,0 +1,36 @@
+#ifndef FAKE_MODEM_H
+#define FAKE_MODEM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// fake_modem.h : scripted modem for the host checks of the AT modules.
+//
+// Bytes the module sends go in through fm_rx(); every "AT<cmd>\r" found
+// there is answered from a rule table after the rule's delay. What is due
+// by now comes out of fm_tx(). Unsolicited lines are queued with
+// fm_send(). The clock is the caller's: a fake one for simulations over
+// hours, a real one behind a pty (test_at_engine.cpp).
+
+struct FmRule {
+  const char *cmd;        // text after "AT"; a trailing '*' matches any rest
+  const char *reply;      // lines separated by '\n', nullptr = no answer at all
+  uint32_t    delay_ms;   // from the command to the reply
+};
+
+// Called for every command before it is answered (may be null), e.g. to
+// model state the rules cannot (PSM entry after CPSMS=1).
+typedef void (*FmHook)(const char *cmd);
+
+void   fm_init(uint32_t (*now_ms)(), const FmRule *rules, int count, FmHook hook = nullptr);
+void   fm_rx(const char *data, size_t len);
+size_t fm_tx(char *buf, size_t cap);
+void   fm_send(const char *lines, uint32_t delay_ms = 0);   // unsolicited
+void   fm_setEcho(bool echo);                               // ATE1: commands echoed
+void   fm_setAsleep(bool asleep);                           // asleep: commands are lost
+bool   fm_asleep();
+int    fm_commands();                                       // answered or not
+const char *fm_lastCommand();
+void   fm_clear();                                          // drop pending output
+
+#endif // FAKE_MODEM_H
@@ -0,0 +1,231 @@
+// test_at_engine.cpp
+// Host check of at_engine.cpp against the scripted fake modem behind a pty.
+//
+// The engine reads and writes the pty's slave side like SerialAT; a thread
+// plays the modem on the master side (fake_modem.cpp), with real time in
+// between. Checks: completion on OK / ERROR / +CME ERROR without waiting
+// out the timeout, intermediate lines, URC routing while idle and in the
+// middle of a response, unhandled URCs, echo, the queue order, and the
+// timeout of a command that is never answered.
+
+#include "at_engine.h"
+#include "fake_modem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int s_fail = 0;
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); s_fail++; } } while (0)
+
+static const auto kStart = std::chrono::steady_clock::now();
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - kStart).count();
+}
+
+static const FmRule kRules[] = {
+  { "",          "OK",                              0 },
+  { "E1",        "OK",                              0 },
+  { "+CPIN?",    "+CPIN: READY\nOK",                20 },
+  { "+CGSN",     "861234567890123\nOK",             0 },
+  { "+COPS=9",   "+CME ERROR: 3",                   10 },
+  { "+FAIL",     "ERROR",                           0 },
+  { "+CSQ",      "+CREG: 1,5\n+CSQ: 20,99\nOK",     30 },   // URC in the middle
+  { "+SLOW",     nullptr,                           0 },    // never answered
+  { "+Q*",       "OK",                              5 },
+};
+
+// --- the modem side: fake_modem on the pty master ---------------------
+
+static int s_master = -1, s_slave = -1;
+static std::mutex s_fmLock;               // fake_modem is not thread-safe
+static std::atomic<bool> s_stop(false);
+
+static void modemThread() {
+  char buf[256];
+  while (!s_stop) {
+    ssize_t n = read(s_master, buf, sizeof(buf));
+    size_t out;
+    {
+      std::lock_guard<std::mutex> g(s_fmLock);
+      if (n > 0) fm_rx(buf, (size_t)n);
+      out = fm_tx(buf, sizeof(buf));
+    }
+    if (out && write(s_master, buf, out) != (ssize_t)out) break;
+    if (n <= 0 && !out) usleep(500);
+  }
+}
+
+static bool openPty() {
+  s_master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (s_master < 0 || grantpt(s_master) != 0 || unlockpt(s_master) != 0) return false;
+  s_slave = open(ptsname(s_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (s_slave < 0) return false;
+  struct termios t;
+  tcgetattr(s_slave, &t);
+  cfmakeraw(&t);                          // no CR/LF translation, no echo
+  tcsetattr(s_slave, TCSANOW, &t);
+  fcntl(s_master, F_SETFL, fcntl(s_master, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+// --- the engine side: AtIo on the pty slave ---------------------------
+
+static size_t ioRead(void *, char *buf, size_t cap) {
+  ssize_t n = read(s_slave, buf, cap);
+  return n > 0 ? (size_t)n : 0;
+}
+static size_t ioWrite(void *, const char *data, size_t len) {
+  ssize_t n = write(s_slave, data, len);
+  return n > 0 ? (size_t)n : 0;
+}
+static uint32_t ioNow(void *) { return nowMs(); }
+static void ioIdle(void *) { usleep(200); }
+
+static void fmSend(const char *lines) {
+  std::lock_guard<std::mutex> g(s_fmLock);
+  fm_send(lines);
+}
+
+// --- callbacks ---------------------------------------------------------
+
+static std::vector<std::string> s_lines;    // intermediate lines of the running command
+static void onLine(const char *line, void *) { s_lines.push_back(line); }
+
+static std::vector<std::string> s_cmti, s_creg;
+static void onCmti(const char *line, uint32_t, void *) { s_cmti.push_back(line); }
+static void onCreg(const char *line, uint32_t, void *) { s_creg.push_back(line); }
+
+static std::vector<int> s_doneOrder;
+static void onDone(AtResult res, const char *, void *arg) {
+  if (res == AT_OK) s_doneOrder.push_back((int)(intptr_t)arg);
+}
+
+static bool pollUntil(bool (*cond)(), uint32_t ms) {
+  uint32_t t0 = nowMs();
+  while (!cond() && nowMs() - t0 < ms) {
+    at_poll();
+    usleep(200);
+  }
+  return cond();
+}
+
+// --- checks ------------------------------------------------------------
+
+static void checkFinalResults() {
+  uint32_t t0 = nowMs();
+  CHECK(at_command("", 2000) == AT_OK);
+  CHECK(nowMs() - t0 < 500);                 // on OK, not after the timeout
+
+  s_lines.clear();
+  CHECK(at_command("+CPIN?", 2000, onLine) == AT_OK);
+  CHECK(s_lines.size() == 1 && s_lines[0] == "+CPIN: READY");
+
+  s_lines.clear();
+  CHECK(at_command("+CGSN", 2000, onLine) == AT_OK);   // bare line, no prefix
+  CHECK(s_lines.size() == 1 && s_lines[0] == "861234567890123");
+
+  t0 = nowMs();
+  CHECK(at_command("+COPS=9", 2000) == AT_ERROR);
+  CHECK(at_command("+FAIL", 2000) == AT_ERROR);
+  CHECK(at_command("+UNKNOWN", 2000) == AT_ERROR);      // fake modem: no rule -> ERROR
+  CHECK(nowMs() - t0 < 1000);
+  CHECK(at_stats().errors == 3);
+}
+
+static bool gotCmti() { return !s_cmti.empty(); }
+
+static void checkUrcs() {
+  // idle: straight to the subscriber
+  s_cmti.clear();
+  fmSend("+CMTI: \"SM\",3");
+  CHECK(pollUntil(gotCmti, 1000));
+  CHECK(s_cmti.size() == 1 && s_cmti[0] == "+CMTI: \"SM\",3");
+
+  // in the middle of a response: the URC goes to its subscriber, the
+  // response line to the command
+  s_lines.clear();
+  s_creg.clear();
+  CHECK(at_command("+CSQ", 2000, onLine) == AT_OK);
+  CHECK(s_creg.size() == 1 && s_creg[0] == "+CREG: 1,5");
+  CHECK(s_lines.size() == 1 && s_lines[0] == "+CSQ: 20,99");
+
+  // nobody subscribed
+  uint32_t before = at_stats().urc_unhandled;
+  fmSend("RING\n+CMTI: \"SM\",4");
+  s_cmti.clear();
+  CHECK(pollUntil(gotCmti, 1000));
+  CHECK(at_stats().urc_unhandled == before + 1);
+}
+
+static void checkEcho() {
+  {
+    std::lock_guard<std::mutex> g(s_fmLock);
+    fm_setEcho(true);
+  }
+  s_lines.clear();
+  CHECK(at_command("+CPIN?", 2000, onLine) == AT_OK);
+  CHECK(s_lines.size() == 1 && s_lines[0] == "+CPIN: READY");   // echo not passed on
+  std::lock_guard<std::mutex> g(s_fmLock);
+  fm_setEcho(false);
+}
+
+static bool queueDone() { return s_doneOrder.size() == 3 && !at_busy() && at_queued() == 0; }
+
+static void checkQueue() {
+  s_doneOrder.clear();
+  CHECK(at_submit("+Q1", 1000, nullptr, onDone, (void *)1));
+  CHECK(at_submit("+Q2", 1000, nullptr, onDone, (void *)2));
+  CHECK(at_submit("+Q3", 1000, nullptr, onDone, (void *)3));
+  CHECK(at_queued() == 3);
+  CHECK(pollUntil(queueDone, 2000));
+  CHECK(s_doneOrder == std::vector<int>({ 1, 2, 3 }));
+}
+
+static void checkTimeout() {
+  uint32_t timeouts = at_stats().timeouts;
+  uint32_t t0 = nowMs();
+  CHECK(at_command("+SLOW", 300) == AT_TIMEOUT);
+  uint32_t took = nowMs() - t0;
+  CHECK(took >= 300 && took < 600);
+  CHECK(at_stats().timeouts == timeouts + 1);
+  CHECK(at_command("", 2000) == AT_OK);      // the channel is usable again
+}
+
+int main() {
+  if (!openPty()) {
+    perror("pty");
+    return 1;
+  }
+  fm_init(nowMs, kRules, sizeof(kRules) / sizeof(kRules[0]));
+  std::thread modem(modemThread);
+
+  AtIo io = { nullptr, ioRead, ioWrite, ioNow, ioIdle };
+  at_init(io);
+  at_subscribe("+CMTI:", onCmti);
+  at_subscribe("+CREG:", onCreg);
+
+  checkFinalResults();
+  checkUrcs();
+  checkEcho();
+  checkQueue();
+  checkTimeout();
+
+  s_stop = true;
+  modem.join();
+  const AtStats &st = at_stats();
+  printf("at_engine: %lu commands (%lu ok, %lu errors, %lu timeouts), %lu URCs, max %lu ms\n",
+         (unsigned long)st.commands, (unsigned long)st.ok, (unsigned long)st.errors,
+         (unsigned long)st.timeouts, (unsigned long)st.urcs, (unsigned long)st.max_ms);
+  printf(s_fail ? "at_engine: %d check(s) FAILED\n" : "at_engine: all checks passed\n", s_fail);
+  return s_fail ? 1 : 0;
+}
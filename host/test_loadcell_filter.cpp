@@ -0,0 +1,126 @@
+// test_loadcell_filter.cpp
+// Host check and benchmark of loadcell_filter.cpp, the host counterpart of
+// 'weight bench'.
+//
+// Checks: glitches are rejected and do not move the output, the IIR
+// settles on a step, temperature compensation is applied only with a
+// temperature. Benchmark: the 'weight bench' trace (noise, 5% glitches, a
+// slow drift), time and TSC cycles per sample (push + output) on this host.
+
+#include "loadcell_filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+// calibration.h defaults (CALIB_FILTER_*)
+static const LoadcellFilterConfig kConfig = {
+  9,       // CALIB_FILTER_WINDOW
+  48,      // CALIB_FILTER_MAD_K_Q4 (3 sigma)
+  3,       // CALIB_FILTER_IIR_SHIFT
+  40,      // CALIB_FILTER_NOISE
+};
+
+static int s_fail = 0;
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); s_fail++; } } while (0)
+
+static uint32_t s_seed = 12345;
+static int32_t noise(int amp) {
+  s_seed = s_seed * 1664525u + 1013904223u;
+  return (int32_t)((s_seed >> 24) % (2 * amp + 1)) - amp;
+}
+
+static void checkGlitches() {
+  LoadcellFilter f;
+  lcf_init(f, kConfig);
+  int32_t out;
+  uint8_t conf;
+  CHECK(!lcf_output(f, false, 0, out, conf));      // nothing accepted yet
+  for (int i = 0; i < 50; i++) lcf_push(f, 100000 + noise(30));
+  CHECK(lcf_output(f, false, 0, out, conf));
+  CHECK(abs(out - 100000) < 40);
+  CHECK(conf > 50);
+
+  uint32_t rejected = f.rejected;
+  CHECK(!lcf_push(f, 160000));                      // single spike
+  CHECK(f.rejected == rejected + 1);
+  int32_t after;
+  lcf_output(f, false, 0, after, conf);
+  CHECK(after == out);                              // did not reach the IIR
+}
+
+static void checkStep() {
+  LoadcellFilter f;
+  lcf_init(f, kConfig);
+  for (int i = 0; i < 30; i++) lcf_push(f, 100000 + noise(20));
+  // a hive frame added: the median moves after half a window, the IIR follows
+  for (int i = 0; i < 60; i++) lcf_push(f, 120000 + noise(20));
+  int32_t out;
+  uint8_t conf;
+  CHECK(lcf_output(f, false, 0, out, conf));
+  CHECK(abs(out - 120000) < 100);
+}
+
+static void checkTempComp() {
+  LoadcellFilter f;
+  lcf_init(f, kConfig);
+  lcf_setTempComp(f, 10.0f, 20.0f);                 // 10 counts per degree around 20 C
+  for (int i = 0; i < 40; i++) lcf_push(f, 50000);
+  int32_t none, at20, at30;
+  uint8_t conf;
+  lcf_output(f, false, 0, none, conf);
+  lcf_output(f, true, 2000, at20, conf);
+  lcf_output(f, true, 3000, at30, conf);
+  CHECK(none == 50000);                              // no temperature: uncorrected
+  CHECK(at20 == none);                               // at the reference: no change
+  CHECK(abs((none - at30) - 100) <= 1);              // +10 C: 100 counts taken off
+}
+
+static void benchmark() {
+  const int N = 200000;
+  LoadcellFilter f;
+  lcf_init(f, kConfig);
+  lcf_setTempComp(f, 10.0f, 20.0f);
+  s_seed = 12345;
+  volatile int32_t sink = 0;
+  uint64_t cycles = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    s_seed = s_seed * 1664525u + 1013904223u;
+    int32_t raw = 250000 + (i % 2000) * 2 + (int32_t)((s_seed >> 24) % 81) - 40;
+    if ((s_seed & 0xFF) < 13) raw += 60000;        // glitch
+#if HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    lcf_push(f, raw);
+    int32_t out;
+    uint8_t conf;
+    lcf_output(f, true, 2500, out, conf);
+#if HAVE_TSC
+    cycles += __rdtsc() - c0;
+#endif
+    sink = out;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  (void)sink;
+  printf("bench: %d samples, window=%u, %.1f ns/sample", N, (unsigned)f.cfg.window, ns / N);
+#if HAVE_TSC
+  printf(", %.0f TSC cycles/sample", (double)cycles / N);
+#endif
+  printf(" on this host, rejected=%lu (%.1f%%)\n", (unsigned long)f.rejected, 100.0 * f.rejected / N);
+  CHECK(f.rejected > N / 40 && f.rejected < N / 10);   // ~5% glitches
+}
+
+int main() {
+  checkGlitches();
+  checkStep();
+  checkTempComp();
+  benchmark();
+  printf(s_fail ? "loadcell_filter: %d check(s) FAILED\n" : "loadcell_filter: all checks passed\n", s_fail);
+  return s_fail ? 1 : 0;
+}
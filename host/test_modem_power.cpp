@@ -0,0 +1,330 @@
+// test_modem_power.cpp
+// Host check of modem_power.cpp + at_engine.cpp against a simulated modem
+// (fake_modem.cpp) on a fake clock.
+//
+// The simulated modem grants PSM (T3324 2 s, T3412 1 h), reports
+// +CPSMSTATUS: "ENTER PSM" when the active time runs out and then loses
+// every command until PWRKEY is pulsed. Checks: sleep entry after the idle
+// time, wake-ahead before a scheduled send, wake on queued work, on-demand
+// wake from a blocking at_command(), wake failure, an open socket holding
+// the modem awake, PSM refused by the network. Then one simulated day with a send every 15 min reports the
+// awake time.
+//
+// All of it runs with the status cache's background refresh of
+// modem_manager.cpp (+CSQ / +CEREG? every few seconds, shorter than
+// idle_ms) in the loop, so the modem only sleeps if that polling holds off
+// while the power manager counts down to PSM.
+
+#include "modem_power.h"
+#include "at_engine.h"
+#include "fake_modem.h"
+#include <stdio.h>
+#include <string.h>
+
+static int s_fail = 0;
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); s_fail++; } } while (0)
+
+static uint32_t s_now = 1000;             // fake millis()
+static uint32_t nowMs() { return s_now; }
+
+// --- the simulated modem -----------------------------------------------
+
+static const FmRule kGranted[] = {
+  { "",             "OK",                                                               20 },
+  { "+CEREG=4",     "OK",                                                               10 },
+  { "+CPSMSTATUS=1","OK",                                                               10 },
+  { "+CEDRXS=*",    "OK",                                                               10 },
+  { "+CEDRXRDP",    "+CEDRXRDP: 4,\"0010\",\"0010\",\"0011\"\nOK",                      10 },
+  { "+CPSMS=*",     "OK",                                                               10 },
+  { "+CEREG?",      "+CEREG: 4,1,\"1A2B\",\"01A2B3C4\",7,,,\"00000001\",\"00100001\"\nOK", 10 },
+  { "+CSQ",         "+CSQ: 20,99\nOK",                                                  50 },
+};
+static const FmRule kRefused[] = {
+  { "",             "OK",                                          20 },
+  { "+CEREG=4",     "OK",                                          10 },
+  { "+CPSMSTATUS=1","OK",                                          10 },
+  { "+CEDRXS=*",    "OK",                                          10 },
+  { "+CEDRXRDP",    "+CEDRXRDP: 4,\"0010\",\"0010\",\"0011\"\nOK", 10 },
+  { "+CPSMS=*",     "OK",                                          10 },
+  { "+CEREG?",      "+CEREG: 4,1,\"1A2B\",\"01A2B3C4\",7\nOK",     10 },   // no timers
+  { "+CSQ",         "+CSQ: 20,99\nOK",                             50 },
+};
+
+static const uint32_t kActiveMs = 2000;   // granted T3324
+static uint32_t s_psmAt = 0;              // modem drops into PSM then (0 = not planned)
+static bool     s_pwrkeyWakes = true;
+static int      s_pulses = 0;
+static int      s_cmdsAsleep = 0;         // commands lost while in PSM
+
+static void modemHook(const char *cmd) {
+  if (strncmp(cmd, "+CPSMS=1", 8) == 0) {
+    s_psmAt = s_now + kActiveMs;
+    fm_send("+CPSMSTATUS: \"ENTER PSM\"", kActiveMs);
+  } else if (strncmp(cmd, "+CPSMS=0", 8) == 0) {
+    s_psmAt = 0;
+  }
+}
+
+static void modemTick() {
+  if (fm_asleep()) return;
+  if (s_psmAt && (int32_t)(s_now - s_psmAt) >= 0) {   // the URC is out by now
+    s_psmAt = 0;
+    fm_setAsleep(true);
+  }
+}
+
+static int s_commandsSeen = 0;
+static void noteCommands() {
+  if (fm_asleep()) s_cmdsAsleep += fm_commands() - s_commandsSeen;
+  s_commandsSeen = fm_commands();
+}
+
+// --- io for the engine and the power manager -------------------------
+
+static size_t atRead(void *, char *buf, size_t cap) { return fm_tx(buf, cap); }
+static size_t atWrite(void *, const char *data, size_t len) {
+  fm_rx(data, len);
+  noteCommands();
+  return len;
+}
+static uint32_t atNow(void *) { return s_now; }
+static void atIdle(void *) { s_now += 1; modemTick(); }
+
+static void pwrkey(uint32_t hold_ms) {
+  s_pulses++;
+  s_now += hold_ms;
+  if (s_pwrkeyWakes && fm_asleep()) {
+    fm_setAsleep(false);
+    fm_clear();
+  }
+}
+static int  s_beforeSleep = 0, s_afterWake = 0;
+static void beforeSleep() { s_beforeSleep++; }
+static void afterWake() { s_afterWake++; }
+static void mpIdle() { s_now += 1; modemTick(); }
+
+static const ModemPowerConfig kConfig = {
+  true,             // enabled
+  3600,             // tau_s
+  2,                // active_s
+  20480,            // edrx_ms
+  60000,            // min_sleep_ms
+  20000,            // wake_lead_ms
+  5000,             // idle_ms
+  100,              // wake_pulse_ms
+  3,                // wake_tries
+};
+
+// --- the status cache's polling (modem_manager.cpp modem_refreshStatus) --
+
+static const uint32_t kStatusTtlMs = 4000;   // below idle_ms: would keep the modem up
+static uint32_t s_statusLast = 0;
+static uint32_t s_statusWakes = 0;
+static int      s_refreshes = 0;
+
+static void statusRefresh() {
+  if (!modemPower_isAwake()) return;
+  if (modemPower_wakeCount() != s_statusWakes) {
+    s_statusWakes = modemPower_wakeCount();
+    s_statusLast = 0;
+  }
+  if (s_statusLast && s_now - s_statusLast < kStatusTtlMs) return;
+  if (s_statusLast && modemPower_sleepPending()) return;
+  s_statusLast = s_now;
+  s_refreshes++;
+  at_submit("+CSQ", 1000);
+  at_submit("+CEREG?", 1000);
+}
+
+// --- the loop ------------------------------------------------------------
+
+static uint32_t s_sendAt = 0;             // next scheduled send, 0 = none
+
+static uint32_t untilSend() {
+  if (!s_sendAt) return 0xFFFFFFFFUL;
+  int32_t d = (int32_t)(s_sendAt - s_now);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+// loop() for ms of fake time, 10 ms per pass
+static void run(uint32_t ms) {
+  uint32_t end = s_now + ms;
+  while ((int32_t)(end - s_now) > 0) {
+    s_now += 10;
+    modemTick();
+    at_poll();
+    modemPower_service(untilSend());
+    statusRefresh();
+  }
+}
+
+static bool runUntil(bool (*cond)(), uint32_t max_ms) {
+  uint32_t end = s_now + max_ms;
+  while (!cond() && (int32_t)(end - s_now) > 0) run(10);
+  return cond();
+}
+
+static bool isAsleep() { return modemPower_state() == MPWR_ASLEEP; }
+static bool isAwake() { return modemPower_state() == MPWR_AWAKE; }
+static bool isEntering() { return modemPower_state() == MPWR_ENTERING; }
+
+static void setup(const FmRule *rules, int count) {
+  fm_init(nowMs, rules, count, modemHook);
+  s_commandsSeen = 0;
+  s_psmAt = 0;
+  s_statusLast = 0;
+  AtIo io = { nullptr, atRead, atWrite, atNow, atIdle };
+  at_init(io);
+  ModemPowerIo pio = { nowMs, pwrkey, beforeSleep, afterWake, mpIdle };
+  modemPower_init(pio, kConfig);
+}
+
+// --- checks ------------------------------------------------------------
+
+static void checkSleepAndWakeAhead() {
+  setup(kGranted, sizeof(kGranted) / sizeof(kGranted[0]));
+  s_sendAt = s_now + 10UL * 60UL * 1000UL;
+  uint32_t t0 = s_now;
+  CHECK(runUntil(isAsleep, 60000));
+  const ModemPowerStats &st = modemPower_stats();
+  CHECK(st.sleeps == 1);
+  CHECK(st.active_s == 2 && st.tau_s == 3600);
+  CHECK(st.edrx_ms == 20480);
+  CHECK(s_beforeSleep == 1);
+  CHECK(fm_asleep());
+  printf("sleep: asleep %lu ms after boot (idle %lu, PSM/eDRX setup, idle %lu, T3324 %lu)\n",
+         (unsigned long)(s_now - t0), (unsigned long)kConfig.idle_ms,
+         (unsigned long)kConfig.idle_ms, (unsigned long)kActiveMs);
+
+  // nothing is sent to the sleeping modem
+  int lost = s_cmdsAsleep;
+  int refreshes = s_refreshes;
+  CHECK(runUntil(isAwake, 10UL * 60UL * 1000UL));
+  CHECK(s_cmdsAsleep == lost);
+  CHECK(s_refreshes == refreshes + 1);     // the cache catches up at once
+  uint32_t lead = s_sendAt - s_now;
+  printf("wake-ahead: awake %lu ms before the send (wake_lead %lu ms), %d pulse(s)\n",
+         (unsigned long)lead, (unsigned long)kConfig.wake_lead_ms, s_pulses);
+  CHECK(lead > kConfig.wake_lead_ms - 1000 && lead <= kConfig.wake_lead_ms);
+  CHECK(st.wakes == 1 && s_afterWake == 1);
+  CHECK(strncmp(fm_lastCommand(), "AT+CPSMS=0", 10) == 0);   // PSM off first
+
+  // the send itself does not wait for a wake
+  run(lead);
+  uint32_t c0 = s_now;
+  CHECK(at_command("+CSQ", 2000) == AT_OK);
+  CHECK(s_now - c0 < 200);
+  s_sendAt = 0;
+}
+
+static void checkQueuedWake() {
+  s_sendAt = s_now + 3600UL * 1000UL;
+  CHECK(runUntil(isAsleep, 60000));
+  uint32_t wakes = modemPower_stats().wakes;
+  run(5UL * 60UL * 1000UL);
+  CHECK(isAsleep());
+  CHECK(at_submit("+CSQ", 2000));          // e.g. an SMS scan queued up
+  CHECK(runUntil(isAwake, 5000));
+  CHECK(modemPower_stats().wakes == wakes + 1);
+  run(500);
+  CHECK(at_queued() == 0 && !at_busy());
+}
+
+static void checkOnDemandWake() {
+  CHECK(runUntil(isAsleep, 60000));
+  uint32_t wakes = modemPower_stats().wakes;
+  uint32_t c0 = s_now;
+  CHECK(at_command("+CSQ", 5000) == AT_OK);   // blocking caller, modem asleep
+  printf("on-demand: blocking command answered after %lu ms (pulse + AT probe)\n",
+         (unsigned long)(s_now - c0));
+  CHECK(modemPower_stats().wakes == wakes + 1);
+  CHECK(isAwake());
+}
+
+static void checkWakeFailure() {
+  CHECK(runUntil(isAsleep, 60000));
+  s_pwrkeyWakes = false;                   // modem does not react to PWRKEY
+  int pulses = s_pulses;
+  uint32_t failures = modemPower_stats().wake_failures;
+  CHECK(!modemPower_wakeNow());
+  CHECK(s_pulses == pulses + kConfig.wake_tries);
+  CHECK(modemPower_stats().wake_failures == failures + 1);
+  CHECK(!at_held());                       // callers see their own errors
+  CHECK(at_command("+CSQ", 500) == AT_TIMEOUT);
+  s_pwrkeyWakes = true;
+  fm_setAsleep(false);
+  s_sendAt = 0;
+  run(1000);
+}
+
+// A socket open on the modem (pooled HTTP, MQTT) holds it out of PSM.
+static void checkHold() {
+  s_sendAt = s_now + 3600UL * 1000UL;
+  CHECK(runUntil(isAwake, 5000));
+  uint32_t sleeps = modemPower_stats().sleeps;
+  modemPower_hold(true);
+  run(2UL * 60UL * 1000UL);
+  CHECK(isAwake());
+  CHECK(modemPower_stats().sleeps == sleeps);
+  modemPower_hold(false);
+  CHECK(runUntil(isAsleep, 60000));
+  CHECK(modemPower_stats().sleeps == sleeps + 1);
+
+  // taken while entering PSM: back to awake
+  CHECK(modemPower_wakeNow());
+  CHECK(runUntil(isEntering, 60000));
+  modemPower_hold(true);
+  run(100);
+  CHECK(isAwake());
+  modemPower_hold(false);
+  s_sendAt = 0;
+}
+
+static void checkRefused() {
+  setup(kRefused, sizeof(kRefused) / sizeof(kRefused[0]));
+  uint32_t sleeps = modemPower_stats().sleeps;
+  s_sendAt = s_now + 10UL * 60UL * 1000UL;
+  run(5UL * 60UL * 1000UL);
+  CHECK(modemPower_stats().sleeps == sleeps);
+  CHECK(modemPower_stats().active_s == 0 && modemPower_stats().tau_s == 0);
+  CHECK(isAwake());
+  CHECK(!modemPower_sleepPending());
+  int refreshes = s_refreshes;
+  run(3 * kStatusTtlMs);                   // no sleep coming: the cache polls as usual
+  CHECK(s_refreshes >= refreshes + 2);
+  s_sendAt = 0;
+}
+
+// One day, a send every 15 min: time awake per day.
+static void benchDay() {
+  setup(kGranted, sizeof(kGranted) / sizeof(kGranted[0]));
+  const uint32_t period = 15UL * 60UL * 1000UL;
+  uint32_t sends = 0, slow = 0;
+  uint32_t day0 = modemPower_stats().day;
+  s_sendAt = s_now + period;
+  while (modemPower_stats().day < day0 + 2) {
+    run((uint32_t)(s_sendAt - s_now));
+    uint32_t c0 = s_now;
+    if (at_command("+CSQ", 5000) == AT_OK) sends++;
+    if (s_now - c0 > 500) slow++;          // had to wake on demand
+    s_sendAt += period;
+  }
+  const ModemPowerStats &st = modemPower_stats();
+  printf("day: %lu sends, %lu waited for a wake, awake %lu s of 86400 (%.1f%%), %d status refreshes\n",
+         (unsigned long)sends, (unsigned long)slow, (unsigned long)(st.awake_ms_yesterday / 1000),
+         st.awake_ms_yesterday / 864000.0, s_refreshes);
+  CHECK(slow == 0);
+  CHECK(st.awake_ms_yesterday < 86400000UL / 5);
+}
+
+int main() {
+  checkSleepAndWakeAhead();
+  checkQueuedWake();
+  checkOnDemandWake();
+  checkWakeFailure();
+  checkHold();
+  checkRefused();
+  benchDay();
+  printf(s_fail ? "modem_power: %d check(s) FAILED\n" : "modem_power: all checks passed\n", s_fail);
+  return s_fail ? 1 : 0;
+}
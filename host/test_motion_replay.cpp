@@ -0,0 +1,94 @@
+// test_motion_replay.cpp
+// Host replay of accelerometer CSV traces through motion_detector.cpp, the
+// host counterpart of 'motion replay <file>'.
+//
+//   test_motion_replay trace.csv...
+//
+// Lines are "t_ms,x,y,z" (m/s^2); other lines are skipped, except
+// "# expect alarms=N suppressed=M", which makes the trace a check.
+// Reports alarms per trace and the detector cost in ns per sample.
+
+#include "motion_detector.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+// config.h defaults (MOTION_*)
+static const MotionConfig kConfig = {
+  2.0f,              // MOTION_THRESHOLD (ACCEL_THRESHOLD)
+  0.01f,             // MOTION_BASELINE_ALPHA
+  5,                 // MOTION_DEBOUNCE_SAMPLES
+  25,                // MOTION_WINDOW_SAMPLES
+  5UL * 60UL * 1000UL,   // MOTION_COOLDOWN_MS
+  3000,              // MOTION_SETTLE_MS
+  4,                 // MOTION_MAX_ALARMS_PER_HOUR
+};
+
+struct Sample { uint32_t t; float x, y, z; };
+
+static bool loadTrace(const char *path, std::vector<Sample> &out, int &exp_alarms, int &exp_supp) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  exp_alarms = exp_supp = -1;
+  while (fgets(line, sizeof(line), f)) {
+    Sample s;
+    unsigned long t;
+    if (sscanf(line, "# expect alarms=%d suppressed=%d", &exp_alarms, &exp_supp) == 2) continue;
+    if (sscanf(line, "%lu,%f,%f,%f", &t, &s.x, &s.y, &s.z) != 4) continue;
+    s.t = (uint32_t)t;
+    out.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace.csv...\n", argv[0]);
+    return 2;
+  }
+  int failed = 0;
+  uint64_t total_samples = 0;
+  double total_ns = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::vector<Sample> tr;
+    int exp_alarms, exp_supp;
+    if (!loadTrace(argv[i], tr, exp_alarms, exp_supp) || tr.empty()) {
+      printf("%s: cannot read\n", argv[i]);
+      failed++;
+      continue;
+    }
+
+    MotionDetector d;
+    motion_init(d, kConfig, tr[0].t);
+    uint32_t quiet = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const Sample &s : tr) {
+      if (motion_update(d, s.x, s.y, s.z, s.t) == MOTION_EVT_QUIET) quiet++;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    total_samples += tr.size();
+    total_ns += ns;
+
+    const char *base = strrchr(argv[i], '/');
+    base = base ? base + 1 : argv[i];
+    bool ok = (exp_alarms < 0 || (int)d.alarms == exp_alarms) &&
+              (exp_supp < 0 || (int)d.suppressed == exp_supp);
+    printf("%-16s %6zu samples (%5.1f min): %lu alarms, %lu suppressed, %lu ended, %.1f ns/sample%s\n",
+           base, tr.size(), (tr.back().t - tr[0].t) / 60000.0, (unsigned long)d.alarms,
+           (unsigned long)d.suppressed, (unsigned long)quiet, ns / tr.size(),
+           ok ? "" : "  <-- FAIL");
+    if (!ok) {
+      printf("  expected %d alarms, %d suppressed\n", exp_alarms, exp_supp);
+      failed++;
+    }
+  }
+
+  printf("motion: %llu samples, %.1f ns/sample on this host%s\n",
+         (unsigned long long)total_samples, total_samples ? total_ns / total_samples : 0.0,
+         failed ? ", FAILED" : ", all traces as expected");
+  return failed ? 1 : 0;
+}
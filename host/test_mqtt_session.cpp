@@ -0,0 +1,253 @@
+// test_mqtt_session.cpp
+// Host check of mqtt_session.cpp against broker_standin.py over TCP, and
+// bytes on the wire per sample for MQTT and for the HTTP upload path.
+//
+//   broker_standin.py PORT &  test_mqtt_session PORT
+//
+// Checks: connect, one publish, a batch in flight, keep-alive ping, ack
+// timeout (the connection is dropped), reconnect with the broker's session
+// present, no broker at all.
+//
+// Bytes: the same sample (the MQTT sink's JSON, sink_jsonSample()) as QoS 1
+// PUBLISH + PUBACK, and as ThingSpeak /update over a kept-alive socket with
+// the request header of http_pool.cpp (the LTE sink path, HTTP_POOL) against
+// the stand-in's ThingSpeak-like response. TCP/IP headers are not counted;
+// the HTTP figure is with the connection already open, as the pool reuses it.
+
+#include "mqtt_session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <string>
+
+static int s_fail = 0;
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); s_fail++; } } while (0)
+
+static const auto kStart = std::chrono::steady_clock::now();
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - kStart).count();
+}
+
+static int tcpConnect(const char *host, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  inet_pton(AF_INET, host, &a.sin_addr);
+  if (connect(fd, (sockaddr *)&a, sizeof(a)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// --- MqttIo over a socket ------------------------------------------------
+
+static int s_fd = -1;
+
+static uint32_t ioNow() { return nowMs(); }
+static bool ioOpen(const char *host, uint16_t port) {
+  s_fd = tcpConnect(host, port);
+  return s_fd >= 0;
+}
+static bool ioIsOpen() { return s_fd >= 0; }
+static void ioClose() {
+  if (s_fd >= 0) close(s_fd);
+  s_fd = -1;
+}
+static size_t ioWrite(const uint8_t *buf, size_t len) {
+  if (s_fd < 0) return 0;
+  ssize_t n = send(s_fd, buf, len, MSG_NOSIGNAL);
+  return n > 0 ? (size_t)n : 0;
+}
+static int ioRead(uint8_t *buf, size_t cap) {
+  if (s_fd < 0) return 0;
+  ssize_t n = recv(s_fd, buf, cap, MSG_DONTWAIT);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    ioClose();                            // peer closed
+    return 0;
+  }
+  return n > 0 ? (int)n : 0;
+}
+static void ioIdle() { usleep(500); }
+
+static const MqttIo kIo = { ioNow, ioOpen, ioIsOpen, ioWrite, ioRead, ioClose, ioIdle };
+
+static uint16_t s_port = 18830;
+
+static MqttConfig config(const char *id, uint16_t keepalive_s, uint32_t ack_ms) {
+  MqttConfig c = { "127.0.0.1", s_port, id, "", "", keepalive_s, ack_ms };
+  return c;
+}
+
+// One sample as the MQTT sink sends it (sink_jsonSample())
+static const char kSample[] =
+  "{\"fields\":{\"field1\":\"23.5\",\"field2\":\"34.1\",\"field3\":\"61\",\"field4\":\"18.7\","
+  "\"field5\":\"72\",\"field6\":\"1013\",\"field7\":\"3.98\"},\"ts\":\"2024-05-01T10:00:00Z\","
+  "\"lat\":40.640063,\"lon\":22.944419}";
+static const char kTopic[] = "beehive/beehive-a1b2c3/telemetry";
+
+// --- checks ------------------------------------------------------------
+
+static bool waitBroker() {
+  for (int i = 0; i < 40; i++) {
+    int fd = tcpConnect("127.0.0.1", s_port);
+    if (fd >= 0) {
+      close(fd);
+      return true;
+    }
+    usleep(50000);
+  }
+  return false;
+}
+
+static void checkSession() {
+  mqtt_init(kIo, config("beehive-test", 2, 500));
+  mqtt_resetStats();
+  CHECK(mqtt_connect());
+  CHECK(mqtt_isConnected());
+  CHECK(!mqtt_stats().session_present);          // first time for this id
+
+  CHECK(mqtt_publish(kTopic, (const uint8_t *)kSample, strlen(kSample)) != 0);
+  CHECK(mqtt_waitAcked(1000));
+  CHECK(mqtt_stats().acked == 1);
+
+  for (int i = 0; i < 16; i++) CHECK(mqtt_publish(kTopic, (const uint8_t *)kSample, strlen(kSample)) != 0);
+  CHECK(mqtt_inFlight() == 16);
+  CHECK(mqtt_waitAcked(2000));
+  CHECK(mqtt_stats().acked == 17);
+
+  // keep-alive 2 s: a PINGREQ after 1 s without traffic
+  uint32_t t0 = nowMs();
+  while (nowMs() - t0 < 1500) {
+    mqtt_service();
+    usleep(5000);
+  }
+  CHECK(mqtt_stats().pings >= 1);
+  CHECK(mqtt_isConnected());                     // PINGRESP came back
+
+  // no PUBACK: the connection is dropped after ack_timeout_ms
+  CHECK(mqtt_publish("beehive/noack", (const uint8_t *)"x", 1) != 0);
+  t0 = nowMs();
+  CHECK(!mqtt_waitAcked(500));
+  CHECK(nowMs() - t0 >= 500);
+  CHECK(!mqtt_isConnected());
+  CHECK(mqtt_stats().ack_timeouts == 1 && mqtt_stats().drops == 1);
+
+  // reconnect: the broker kept the session
+  CHECK(mqtt_connect());
+  CHECK(mqtt_stats().session_present);
+  mqtt_disconnect();
+  CHECK(!mqtt_isConnected());
+}
+
+static void checkNoBroker() {
+  MqttConfig c = config("beehive-test", 2, 300);
+  c.port = (uint16_t)(s_port + 2);               // nothing listens there
+  mqtt_init(kIo, c);
+  uint32_t failures = mqtt_stats().connect_failures;
+  CHECK(!mqtt_connect());
+  CHECK(mqtt_stats().connect_failures == failures + 1);
+}
+
+// --- bytes on the wire -------------------------------------------------
+
+static void mqttBytes(int n, double &per_sample, uint32_t &session) {
+  mqtt_init(kIo, config("beehive-bytes", 300, 2000));
+  mqtt_resetStats();
+  CHECK(mqtt_connect());
+  session = (uint32_t)(mqtt_stats().tx_bytes + mqtt_stats().rx_bytes);   // CONNECT + CONNACK
+  for (int i = 0; i < n; i++) mqtt_publish(kTopic, (const uint8_t *)kSample, strlen(kSample));
+  CHECK(mqtt_waitAcked(2000));
+  per_sample = (double)(mqtt_stats().tx_bytes + mqtt_stats().rx_bytes - session) / n;
+  mqtt_disconnect();
+}
+
+// http_pool.cpp sendRequest(): the header the LTE sink path puts on the wire
+static std::string poolRequest(const char *path, const char *host, const char *type,
+                               const std::string &body) {
+  char hdr[320];
+  int n = snprintf(hdr, sizeof(hdr), "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n",
+                   "POST", path, host);
+  n += snprintf(hdr + n, sizeof(hdr) - n, "Content-Type: %s\r\nContent-Length: %u\r\n",
+                type, (unsigned)body.size());
+  snprintf(hdr + n, sizeof(hdr) - n, "\r\n");
+  return std::string(hdr) + body;
+}
+
+// Read one response (headers + Content-Length body); returns its size.
+static size_t readResponse(int fd) {
+  std::string in;
+  char buf[1024];
+  size_t need = 0;
+  for (;;) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return 0;
+    in.append(buf, (size_t)n);
+    size_t end = in.find("\r\n\r\n");
+    if (end == std::string::npos) continue;
+    if (!need) {
+      const char *cl = strcasestr(in.c_str(), "Content-Length:");
+      need = end + 4 + (cl ? (size_t)atol(cl + 15) : 0);
+    }
+    if (in.size() >= need) return in.size();
+  }
+}
+
+static void httpBytes(int n, double &per_sample, size_t &req_bytes, size_t &resp_bytes) {
+  // ThingSpeak sink, one sample per /update (THINGSPEAK_CHANNEL_ID 0)
+  std::string body = "api_key=10A4ZQ8S44BPJASO&created_at=2024-05-01T10:00:00Z"
+                     "&field1=23.5&field2=34.1&field3=61&field4=18.7&field5=72&field6=1013"
+                     "&field7=3.98&field8=40.640063+22.944419";
+  std::string req = poolRequest("/update", "api.thingspeak.com",
+                                "application/x-www-form-urlencoded", body);
+  int fd = tcpConnect("127.0.0.1", (uint16_t)(s_port + 1));
+  CHECK(fd >= 0);
+  if (fd < 0) return;
+  size_t total = 0;
+  for (int i = 0; i < n; i++) {                  // one kept-alive connection
+    CHECK(send(fd, req.data(), req.size(), MSG_NOSIGNAL) == (ssize_t)req.size());
+    resp_bytes = readResponse(fd);
+    CHECK(resp_bytes > 0);
+    total += req.size() + resp_bytes;
+  }
+  close(fd);
+  req_bytes = req.size();
+  per_sample = (double)total / n;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) s_port = (uint16_t)atoi(argv[1]);
+  if (!waitBroker()) {
+    printf("mqtt_session: no broker stand-in on port %u (run broker_standin.py %u)\n",
+           (unsigned)s_port, (unsigned)s_port);
+    return 1;
+  }
+  checkSession();
+  checkNoBroker();
+
+  const int N = 16;
+  double mqtt_per, http_per = 0;
+  uint32_t session;
+  size_t req = 0, resp = 0;
+  mqttBytes(N, mqtt_per, session);
+  httpBytes(N, http_per, req, resp);
+  printf("bytes: sample payload %zu bytes (JSON), %d samples\n", strlen(kSample), N);
+  printf("bytes: MQTT QoS 1   %.0f per sample (PUBLISH + PUBACK), %lu once per session (CONNECT + CONNACK)\n",
+         mqtt_per, (unsigned long)session);
+  printf("bytes: HTTP pooled  %.0f per sample (request %zu + response %zu), connection reused\n",
+         http_per, req, resp);
+  CHECK(mqtt_per < http_per);
+
+  printf(s_fail ? "mqtt_session: %d check(s) FAILED\n" : "mqtt_session: all checks passed\n", s_fail);
+  return s_fail ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+// test_scheduler.cpp
+// Host check and benchmark of scheduler.cpp against a fake clock.
+//
+// Checks: period and phase keeping, one-shot jobs, sched_trigger() (also
+// from another thread while the loop runs), jobs moving their own deadline,
+// fairness within one sched_runDue(), the millis() wrap, and
+// sched_msUntilNext().
+//
+// Benchmark: the firmware's job table (BeehiveMonitor_28.ino) over one
+// simulated hour. Reports loop wakeups against the old loop() (everything
+// polled, then delay(10)), trigger-to-run latency of the alarm job while
+// other jobs run, and host time per dispatch.
+
+#include "scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static uint32_t s_now = 0;          // fake millis()
+static uint32_t fakeMs() { return s_now; }
+static uint32_t fakeUs() { return s_now * 1000UL; }
+
+static int s_fail = 0;
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #x); s_fail++; } } while (0)
+
+// The scheduler keeps its jobs in a static table; each check registers new
+// ones, so they are written to only look at their own jobs.
+static int  s_runs[8];
+static void jobA() { s_runs[0]++; }
+static void jobB() { s_runs[1]++; }
+static void jobC() { s_runs[2]++; }
+static int  s_selfId = SCHED_INVALID_JOB;
+static void jobSelf() { s_runs[3]++; sched_setNextDeadline(s_selfId, 250); }
+static int  s_busyId = SCHED_INVALID_JOB;
+static void jobBusy() { s_runs[4]++; sched_trigger(s_busyId); }   // re-triggers itself
+
+// run the loop the way loop() does, until fake time `until`
+static uint32_t runUntil(uint32_t until) {
+  uint32_t wakeups = 0;
+  while ((int32_t)(until - s_now) > 0) {
+    sched_runDue();
+    wakeups++;
+    uint32_t idle = sched_msUntilNext(1000);
+    if (idle == 0) idle = 1;
+    if ((int32_t)(until - (s_now + idle)) < 0) idle = until - s_now;
+    s_now += idle;
+  }
+  return wakeups;
+}
+
+static void checkBasics() {
+  s_now = 1000;
+  int a = sched_addJob("a", jobA, 100);
+  int b = sched_addJob("b", jobB, 0, 500);          // one-shot after 500 ms
+  int c = sched_addJob("c", jobC, 1000, 1000);
+  CHECK(a >= 0 && b >= 0 && c >= 0);
+
+  runUntil(2000);
+  CHECK(s_runs[0] == 10);                  // t = 1000, 1100 .. 1900
+  CHECK(s_runs[1] == 1);                   // once at 1500, then disarmed
+  CHECK(s_runs[2] == 0);                   // first due at 2000: runUntil() stops before it
+  CHECK(sched_msUntilDue(c) == 0);
+
+  sched_setNextDeadline(b, 300);            // re-arm the one-shot
+  runUntil(2400);
+  CHECK(s_runs[1] == 2);
+
+  sched_trigger(b);
+  CHECK(sched_msUntilDue(b) == 0);
+  sched_runDue();
+  CHECK(s_runs[1] == 3);
+
+  sched_setEnabled(a, false);
+  int before = s_runs[0];
+  runUntil(3000);
+  CHECK(s_runs[0] == before);
+  sched_setEnabled(a, true);
+
+  // shorter period pulls a far deadline in
+  sched_setPeriod(c, 50);
+  CHECK(sched_msUntilDue(c) <= 50);
+  sched_setPeriod(c, 1000000);
+  sched_setEnabled(c, false);
+  sched_setEnabled(a, false);
+  sched_setEnabled(b, false);
+}
+
+static void checkSelfReschedule() {
+  s_selfId = sched_addJob("self", jobSelf, 100);
+  s_runs[3] = 0;
+  uint32_t t0 = s_now;
+  runUntil(t0 + 1000);
+  CHECK(s_runs[3] == 4);                    // t0, +250, +500, +750: its own deadline wins over the period
+  sched_setEnabled(s_selfId, false);
+}
+
+static void checkFairness() {
+  s_busyId = sched_addJob("busy", jobBusy, 1000);
+  int other = sched_addJob("other", jobA, 10);
+  s_runs[0] = s_runs[4] = 0;
+  uint32_t t0 = s_now;
+  runUntil(t0 + 100);
+  CHECK(s_runs[0] >= 9);                    // the re-triggering job did not starve it
+  CHECK(s_runs[4] >= 9);
+  sched_setEnabled(s_busyId, false);
+  sched_setEnabled(other, false);
+}
+
+// The acquisition task triggers the alarm job from the other core while
+// loop() dispatches: every trigger is followed by a run.
+static std::atomic<int> s_xRuns(0);
+static void jobCross() { s_xRuns++; }
+
+static void checkCrossTaskTrigger() {
+  int x = sched_addJob("cross", jobCross, 0, 1000000);   // only runs when triggered
+  std::atomic<bool> stop(false);
+  std::atomic<int> sent(0);
+  std::thread acq([&] {
+    for (int i = 0; i < 2000; i++) {
+      sched_trigger(x);
+      sent++;
+      if ((i & 63) == 0) std::this_thread::yield();
+    }
+    stop = true;
+  });
+  while (!stop) {
+    sched_runDue();
+    s_now++;
+  }
+  acq.join();
+  sched_runDue();                           // a trigger after the loop's last pass
+  CHECK(s_xRuns >= 1 && s_xRuns <= sent);
+  int before = s_xRuns;
+  sched_runDue();
+  CHECK(s_xRuns == before);                 // one-shot: disarmed again
+
+  sched_trigger(x);
+  CHECK(sched_msUntilNext(1000) == 0);
+  sched_runDue();
+  CHECK(s_xRuns == before + 1);
+  sched_setEnabled(x, false);
+}
+
+static void checkWrap() {
+  s_now = 0xFFFFFF00UL;
+  int w = sched_addJob("wrap", jobC, 100);
+  s_runs[2] = 0;
+  runUntil(0x00000200UL);                   // across the 49.7-day wrap
+  CHECK(s_runs[2] == 8);                    // ..F00, ..F64, ..FC8, 0x2C, 0x90, 0xF4, 0x158, 0x1BC
+  CHECK(sched_msUntilNext(1000) <= 100);
+  sched_setEnabled(w, false);
+}
+
+// ---------------------------------------------------------------------
+// Benchmark: the firmware's job table over one simulated hour
+// ---------------------------------------------------------------------
+struct SimJob { const char *name; uint32_t period_ms; uint32_t cost_ms; };
+
+// periods as registered in scheduler_setup() (config.h defaults);
+// cost = typical run time
+static const SimJob kJobs[] = {
+  { "http",     20,      0 },
+  { "menu",     40,      0 },
+  { "acq",      50,      0 },
+  { "serial",   50,      0 },
+  { "time",     500,     0 },
+  { "network",  1000,    2 },
+  { "modem",    200,     1 },
+  { "sms",      5000,    0 },
+  { "battery",  10000,   5 },
+  { "climate",  30000,   1 },
+  { "interval", 5000,    0 },
+  { "upload",   60000,   1500 },   // sensor snapshot + queue + first send
+  { "sinks",    60000,   300 },
+};
+static const int kNumJobs = sizeof(kJobs) / sizeof(kJobs[0]);
+
+static uint32_t s_cost[SCHED_MAX_JOBS];
+static int      s_simIds[SCHED_MAX_JOBS];
+#define SIM_JOB(n) static void sim##n() { s_now += s_cost[n]; }
+SIM_JOB(0) SIM_JOB(1) SIM_JOB(2) SIM_JOB(3) SIM_JOB(4) SIM_JOB(5)
+SIM_JOB(6) SIM_JOB(7) SIM_JOB(8) SIM_JOB(9) SIM_JOB(10) SIM_JOB(11) SIM_JOB(12)
+static SchedJobFn kSimFns[] = { sim0, sim1, sim2, sim3, sim4, sim5, sim6, sim7, sim8, sim9, sim10, sim11, sim12 };
+
+static int      s_alarmId = SCHED_INVALID_JOB;
+static uint32_t s_alarmAt = 0;
+static uint32_t s_alarmMax = 0;
+static uint64_t s_alarmSum = 0;
+static uint32_t s_alarmRuns = 0;
+static void simAlarm() {
+  uint32_t lat = s_now - s_alarmAt;
+  if (lat > s_alarmMax) s_alarmMax = lat;
+  s_alarmSum += lat;
+  s_alarmRuns++;
+}
+
+static void benchmark() {
+  // a fresh table would be cleaner, but the scheduler has no reset: the
+  // jobs of the checks above are disabled and do not count
+  int base = sched_jobCount();
+  if (base + kNumJobs + 1 > SCHED_MAX_JOBS) {
+    printf("bench: job table too small (%d used), skipped\n", base);
+    return;
+  }
+  s_now = 0;
+  for (int i = 0; i < kNumJobs; i++) {
+    s_cost[i] = kJobs[i].cost_ms;
+    s_simIds[i] = sched_addJob(kJobs[i].name, kSimFns[i], kJobs[i].period_ms);
+  }
+  s_alarmId = sched_addJob("alarm", simAlarm, 0, 0xFFFFFFF);   // one-shot, triggered
+  sched_setEnabled(s_alarmId, true);
+  sched_setNextDeadline(s_alarmId, 0);
+  sched_runDue();                                            // settle the first round
+  s_alarmRuns = 0;
+  sched_resetStats();
+
+  const uint32_t hour = 3600UL * 1000UL;
+  uint32_t start = s_now;
+  uint32_t wakeups = 0;
+  uint32_t nextAlarm = start + 777;
+  srand(1);
+  auto t0 = std::chrono::steady_clock::now();
+  while (s_now - start < hour) {
+    // motion interrupt from the acquisition task: trigger at a random moment
+    if ((int32_t)(s_now - nextAlarm) >= 0) {
+      s_alarmAt = nextAlarm;
+      sched_trigger(s_alarmId);
+      nextAlarm += 5000 + rand() % 60000;
+    }
+    sched_runDue();
+    wakeups++;
+    uint32_t idle = sched_msUntilNext(100);   // SCHED_MAX_IDLE_MS
+    uint32_t toAlarm = nextAlarm - s_now;
+    if ((int32_t)toAlarm > 0 && toAlarm < idle) idle = toAlarm;   // notify cuts the sleep short
+    s_now += idle;
+  }
+  double host_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+  uint32_t polled = hour / 10;   // old loop(): every subsystem, then delay(10)
+  printf("bench: 1 h simulated, %d jobs: %lu loop wakeups (old loop: %lu, %.1fx fewer)\n",
+         kNumJobs + 1, (unsigned long)wakeups, (unsigned long)polled, (double)polled / wakeups);
+  printf("bench: alarm trigger -> run: %lu triggers, mean %.1f ms, max %lu ms (behind the jobs already due)\n",
+         (unsigned long)s_alarmRuns, s_alarmRuns ? (double)s_alarmSum / s_alarmRuns : 0.0,
+         (unsigned long)s_alarmMax);
+  printf("bench: host time %.0f ns per wakeup (dispatch + next deadline, %d jobs)\n",
+         host_ns / wakeups, sched_jobCount());
+  for (int i = 0; i < kNumJobs; i++) {
+    SchedJobStats st;
+    if (!sched_getStats(s_simIds[i], st)) continue;
+    printf("  %-9s runs %6lu  late max %5lu ms\n", st.name, (unsigned long)st.runs,
+           (unsigned long)st.max_late_ms);
+  }
+  CHECK(s_alarmRuns > 0);
+  uint32_t pass = 0;
+  for (int i = 0; i < kNumJobs; i++) pass += kJobs[i].cost_ms;
+  CHECK(s_alarmMax <= pass);                 // at worst behind one pass over every job
+  CHECK(wakeups < polled);
+}
+
+int main() {
+  sched_setClock(fakeMs, fakeUs);
+  checkBasics();
+  checkSelfReschedule();
+  checkFairness();
+  checkCrossTaskTrigger();
+  checkWrap();
+  if (s_fail) {
+    printf("scheduler: %d check(s) failed\n", s_fail);
+    return 1;
+  }
+  benchmark();
+  printf(s_fail ? "scheduler: FAILED\n" : "scheduler: all checks passed\n");
+  return s_fail ? 1 : 0;
+}
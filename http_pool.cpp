@@ -0,0 +1,220 @@
+// http_pool.cpp
+// Keep-alive HTTP connections over modem sockets (see http_pool.h).
+
+#include "http_pool.h"
+#include "http_transport.h"
+#include "config.h"
+#include "modem_manager.h"
+#include "modem_power.h"
+#include "pdp_session.h"
+#include <TinyGsmClient.h>
+
+struct PoolSlot {
+  TinyGsmClient *client;      // created on first use, lives forever (owns a mux)
+  char     host[64];
+  uint16_t port;
+  bool     open;
+  uint32_t last_used_ms;
+  uint32_t requests;          // on the current connection
+};
+
+static PoolSlot      s_slots[HTTP_POOL_SIZE];
+static HttpPoolStats s_stats = {};
+
+// Every socket operation goes through modem_get(): it wakes the modem from
+// PSM and lets the AT engine finish its command in flight, so TinyGSM never
+// reads the engine's OK/ERROR (or the engine TinyGSM's).
+static TinyGsmClient &slotClient(int i) {
+  TinyGsm &modem = modem_get();
+  if (!s_slots[i].client) {
+    s_slots[i].client = new TinyGsmClient(modem, HTTP_POOL_MUX_BASE + i);
+  }
+  return *s_slots[i].client;
+}
+
+// An open slot holds the modem out of PSM (modemPower_hold).
+static void slotOpened(int i) {
+  if (!s_slots[i].open) modemPower_hold(true);
+  s_slots[i].open = true;
+}
+
+static void slotClose(int i) {
+  if (s_slots[i].open) {
+    slotClient(i).stop();
+    modemPower_hold(false);
+  }
+  s_slots[i].open = false;
+  s_slots[i].requests = 0;
+}
+
+// Pick a slot for host:port. reused = an open, live connection to it.
+static int acquireSlot(const char *host, uint16_t port, bool &reused) {
+  uint32_t now = millis();
+  reused = false;
+
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    PoolSlot &s = s_slots[i];
+    if (!s.open || s.port != port || strcmp(s.host, host) != 0) continue;
+    if (now - s.last_used_ms > HTTP_POOL_IDLE_MS || !slotClient(i).connected()) {
+      slotClose(i);     // the server has almost certainly dropped it
+      return i;
+    }
+    reused = true;
+    return i;
+  }
+
+  int lru = 0;
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    if (!s_slots[i].open) return i;
+    if (s_slots[i].last_used_ms < s_slots[lru].last_used_ms) lru = i;
+  }
+  slotClose(lru);
+  return lru;
+}
+
+static bool sendRequest(TinyGsmClient &c, const char *method, const char *host, const char *path,
+                        const char *content_type, const char *body, size_t body_len) {
+  char hdr[320];
+  int n = snprintf(hdr, sizeof(hdr), "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n",
+                   method, path, host);
+  if (body || content_type) {
+    n += snprintf(hdr + n, sizeof(hdr) - n, "Content-Type: %s\r\nContent-Length: %u\r\n",
+                  content_type ? content_type : "application/octet-stream", (unsigned)body_len);
+  }
+  n += snprintf(hdr + n, sizeof(hdr) - n, "\r\n");
+  if (n >= (int)sizeof(hdr)) return false;   // path/host too long for the header buffer
+
+  if (c.write((const uint8_t *)hdr, n) != (size_t)n) return false;
+  if (body_len && c.write((const uint8_t *)body, body_len) != body_len) return false;
+  return true;
+}
+
+bool httpPool_request(const char *method, const char *host, uint16_t port, const char *path,
+                      const char *content_type, const char *body, size_t body_len,
+                      HttpResponse &resp, uint32_t timeout_ms,
+                      void (*idle)(), HttpPoolTiming *timing) {
+  char  *buf = resp.body;
+  size_t cap = resp.body_cap;
+  HttpPoolTiming t = { false, 0, 0 };
+  bool ok = false;
+
+  s_stats.requests++;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused;
+    int i = acquireSlot(host, port, reused);
+    PoolSlot &s = s_slots[i];
+    TinyGsmClient &c = slotClient(i);
+
+    t.reused = reused;
+    t.connect_ms = 0;
+    if (!reused) {
+      uint32_t c0 = millis();
+      bool conn = c.connect(host, port);
+      t.connect_ms = millis() - c0;
+      s_stats.connects++;
+      s_stats.connect_ms_total += t.connect_ms;
+      if (t.connect_ms > s_stats.connect_ms_max) s_stats.connect_ms_max = t.connect_ms;
+      if (!conn) {
+        s_stats.connect_failures++;
+#if ENABLE_DEBUG
+        Serial.printf("[HTTP] connect %s:%u failed (%lu ms)\n", host, (unsigned)port, (unsigned long)t.connect_ms);
+#endif
+        break;
+      }
+      strncpy(s.host, host, sizeof(s.host) - 1);
+      s.host[sizeof(s.host) - 1] = '\0';
+      s.port = port;
+      slotOpened(i);
+    }
+
+    http_begin(resp, buf, cap);
+    uint32_t t0 = millis();
+    bool sent = sendRequest(c, method, host, path, content_type, body, body_len);
+    if (sent) http_readClient(c, resp, timeout_ms, idle);
+    t.transfer_ms = millis() - t0;
+    s.last_used_ms = millis();
+    s.requests++;
+
+    if (reused && (!sent || (resp.wire_bytes == 0 && !c.connected()))) {
+      // kept-alive socket was dead: the write failed, or the server closed
+      // it without a byte of answer. Once anything came back (or the wait
+      // merely timed out) the request may have been taken: sending it
+      // again could store it twice.
+      slotClose(i);
+      s_stats.retries++;
+      continue;
+    }
+
+    ok = sent && resp.complete && !resp.error;
+    if (!ok || !resp.keep_alive) slotClose(i);
+    break;
+  }
+
+  if (t.reused) s_stats.reused++;
+  if (!ok) s_stats.failures++;
+  s_stats.transfer_ms_total += t.transfer_ms;
+  if (t.transfer_ms > s_stats.transfer_ms_max) s_stats.transfer_ms_max = t.transfer_ms;
+  if (timing) *timing = t;
+#if ENABLE_DEBUG
+  Serial.printf("[HTTP] %s %s%s -> %d, %s, connect %lu ms, transfer %lu ms\n", method, host, path,
+                resp.status, t.reused ? "reused" : "new connection",
+                (unsigned long)t.connect_ms, (unsigned long)t.transfer_ms);
+#endif
+  return ok;
+}
+
+// --- HttpTransport over the pool ----------------------------------------
+
+// "http://host[:port]/path" -> host, port, path (points into url)
+static bool pool_splitUrl(const char *url, char *host, size_t host_cap, uint16_t &port,
+                          const char *&path) {
+  const char *h = url + 7;                       // after "http://"
+  const char *slash = strchr(h, '/');
+  const char *end = slash ? slash : h + strlen(h);
+  const char *colon = (const char *)memchr(h, ':', end - h);
+  const char *host_end = colon ? colon : end;
+  size_t n = host_end - h;
+  if (n == 0 || n >= host_cap) return false;
+  memcpy(host, h, n);
+  host[n] = '\0';
+  port = colon ? (uint16_t)atoi(colon + 1) : 80;
+  path = slash ? slash : "/";
+  return port != 0;
+}
+
+// Not while the modem sleeps: the sink comes back in the next wake window
+// instead of waking the modem itself.
+static bool pool_ready() { return pdp_isUp() && modemPower_isAwake(); }
+
+static bool pool_perform(const HttpRequest &req, HttpResponse &resp) {
+  // TLS is the modem's own HTTPS service: one session per request there
+  if (strncmp(req.url, "http://", 7) != 0) return HTTP_MODEM.perform(req, resp);
+  char host[sizeof(s_slots[0].host)];
+  uint16_t port;
+  const char *path;
+  if (!pool_splitUrl(req.url, host, sizeof(host), port, path)) return false;
+  return httpPool_request(req.method, host, port, path, req.content_type, req.body, req.body_len,
+                          resp, req.timeout_ms);
+}
+
+const HttpTransport HTTP_POOL = { "lte-pool", pool_ready, pool_perform };
+
+void httpPool_closeAll() {
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) slotClose(i);
+}
+
+void httpPool_service() {
+  uint32_t now = millis();
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    if (s_slots[i].open && now - s_slots[i].last_used_ms > HTTP_POOL_IDLE_MS) slotClose(i);
+  }
+}
+
+int httpPool_openCount() {
+  int n = 0;
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) if (s_slots[i].open) n++;
+  return n;
+}
+
+const HttpPoolStats &httpPool_stats() { return s_stats; }
+void httpPool_resetStats() { s_stats = {}; }
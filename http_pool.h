@@ -0,0 +1,64 @@
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <Arduino.h>
+#include "http_response.h"
+
+// http_pool.h : keep-alive HTTP/1.1 connections over the modem's sockets.
+//
+// Each pool slot is a TinyGsmClient on its own modem socket (mux
+// HTTP_POOL_MUX_BASE..). A request reuses the open connection to the same
+// host:port if there is one; otherwise it takes a free (or the least
+// recently used) slot and connects. Responses must be length-delimited or
+// chunked to keep the connection; "Connection: close" or a body ended by
+// close drops it. If a reused connection turns out to be dead (send fails
+// or it closes without a byte of response), the request is sent again
+// once on a fresh connection.
+//
+// Sockets are reached through modem_get() (PSM wake, AT engine settled)
+// and an open connection keeps the modem out of PSM until it has idled
+// HTTP_POOL_IDLE_MS and httpPool_service() closes it.
+//
+// Loop task only, like every other modem user.
+
+struct HttpPoolTiming {
+  bool     reused;        // no TCP connect was needed
+  uint32_t connect_ms;    // TCP connect (0 when reused)
+  uint32_t transfer_ms;   // request sent -> response complete
+};
+
+struct HttpPoolStats {
+  uint32_t requests;
+  uint32_t reused;
+  uint32_t connects;
+  uint32_t connect_failures;
+  uint32_t retries;        // stale keep-alive connection, sent again
+  uint32_t failures;       // no complete response
+  uint64_t connect_ms_total;
+  uint64_t transfer_ms_total;
+  uint32_t connect_ms_max;
+  uint32_t transfer_ms_max;
+};
+
+// Send one request and read the response into resp (see http_response.h).
+// content_type/body may be null for GET. Returns true when a complete
+// response arrived (any status).
+bool httpPool_request(const char *method, const char *host, uint16_t port, const char *path,
+                      const char *content_type, const char *body, size_t body_len,
+                      HttpResponse &resp, uint32_t timeout_ms,
+                      void (*idle)() = nullptr, HttpPoolTiming *timing = nullptr);
+
+// Close every pooled connection (e.g. before the data session goes down).
+void httpPool_closeAll();
+
+// Close connections idle for HTTP_POOL_IDLE_MS, so the modem can sleep
+// (loop task, often).
+void httpPool_service();
+
+// Open connections right now.
+int  httpPool_openCount();
+
+const HttpPoolStats &httpPool_stats();
+void httpPool_resetStats();
+
+#endif // HTTP_POOL_H
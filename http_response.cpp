@@ -0,0 +1,177 @@
+// http_response.cpp
+// Incremental HTTP/1.x response reader (see http_response.h).
+
+#include "http_response.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+enum HttpState : uint8_t {
+  HS_HEADERS = 0,
+  HS_BODY,          // identity body (Content-Length or until close)
+  HS_CHUNK_SIZE,
+  HS_CHUNK_DATA,
+  HS_CHUNK_END,     // CRLF after chunk data
+  HS_TRAILER,
+  HS_DONE,
+};
+
+void http_begin(HttpResponse &r, char *body, size_t body_cap) {
+  memset(&r, 0, sizeof(r));
+  r.content_length = -1;
+  r.body = body;
+  r.body_cap = body_cap;
+  if (body && body_cap) body[0] = '\0';
+  r.state = HS_HEADERS;
+}
+
+void http_appendBody(HttpResponse &r, const char *p, size_t n) {
+  r.received += n;
+  if (!r.body || !r.body_cap) return;
+  size_t room = r.body_cap - 1 - r.body_len;
+  if (n > room) { n = room; r.truncated = true; }
+  memcpy(r.body + r.body_len, p, n);
+  r.body_len += n;
+  r.body[r.body_len] = '\0';
+}
+
+static void http_done(HttpResponse &r) {
+  r.complete = true;
+  r.state = HS_DONE;
+}
+
+static void http_headerLine(HttpResponse &r, char *line) {
+  if (r.status == 0) {
+    // "HTTP/1.1 200 OK"
+    if (strncmp(line, "HTTP/", 5) != 0) { r.error = true; return; }
+    const char *sp = strchr(line, ' ');
+    r.status = sp ? atoi(sp + 1) : 0;
+    r.keep_alive = strncmp(line, "HTTP/1.0", 8) != 0;
+    if (r.status <= 0) r.error = true;
+    return;
+  }
+  if (!*line) {
+    r.headers_done = true;
+    if (r.chunked) r.state = HS_CHUNK_SIZE;
+    else if (r.content_length == 0) http_done(r);
+    else r.state = HS_BODY;
+    if (!r.chunked && r.content_length < 0) r.keep_alive = false;   // body ends at close
+    return;
+  }
+  char *colon = strchr(line, ':');
+  if (!colon) return;
+  *colon = '\0';
+  const char *v = colon + 1;
+  while (*v == ' ' || *v == '\t') v++;
+  if (strcasecmp(line, "Content-Length") == 0) r.content_length = atol(v);
+  else if (strcasecmp(line, "Transfer-Encoding") == 0 && strncasecmp(v, "chunked", 7) == 0) r.chunked = true;
+  else if (strcasecmp(line, "Connection") == 0) {
+    if (strncasecmp(v, "close", 5) == 0) r.keep_alive = false;
+    else if (strncasecmp(v, "keep-alive", 10) == 0) r.keep_alive = true;
+  }
+}
+
+// Collect one CRLF-terminated line into r.hdr. Returns bytes consumed;
+// *done is set when the line is complete (r.hdr NUL-terminated, no CR).
+static size_t http_collectLine(HttpResponse &r, const char *p, size_t n, bool *done) {
+  const char *lf = (const char *)memchr(p, '\n', n);
+  size_t take = lf ? (size_t)(lf - p) + 1 : n;
+  size_t copy = lf ? take - 1 : take;
+  size_t room = sizeof(r.hdr) - 1 - r.hdr_fill;
+  if (copy > room) copy = room;      // over-long header: keep the start
+  memcpy(r.hdr + r.hdr_fill, p, copy);
+  r.hdr_fill += copy;
+  *done = (lf != nullptr);
+  if (*done) {
+    if (r.hdr_fill && r.hdr[r.hdr_fill - 1] == '\r') r.hdr_fill--;
+    r.hdr[r.hdr_fill] = '\0';
+    r.hdr_fill = 0;
+  }
+  return take;
+}
+
+bool http_feed(HttpResponse &r, const char *p, size_t n) {
+  r.wire_bytes += n;
+  while (n && !r.error && r.state != HS_DONE) {
+    bool line = false;
+    size_t used = 0;
+
+    switch (r.state) {
+      case HS_HEADERS:
+        used = http_collectLine(r, p, n, &line);
+        if (line) http_headerLine(r, r.hdr);
+        break;
+
+      case HS_BODY: {
+        used = n;
+        if (r.content_length >= 0) {
+          long left = r.content_length - (long)r.received;
+          if ((long)used > left) used = (size_t)left;
+        }
+        http_appendBody(r, p, used);
+        if (r.content_length >= 0 && (long)r.received >= r.content_length) http_done(r);
+        break;
+      }
+
+      case HS_CHUNK_SIZE:
+        used = http_collectLine(r, p, n, &line);
+        if (line) {
+          char *end = nullptr;
+          r.chunk_left = strtol(r.hdr, &end, 16);
+          if (end == r.hdr || r.chunk_left < 0) r.error = true;
+          else r.state = r.chunk_left ? HS_CHUNK_DATA : HS_TRAILER;
+        }
+        break;
+
+      case HS_CHUNK_DATA:
+        used = n < (size_t)r.chunk_left ? n : (size_t)r.chunk_left;
+        http_appendBody(r, p, used);
+        r.chunk_left -= (long)used;
+        if (!r.chunk_left) r.state = HS_CHUNK_END;
+        break;
+
+      case HS_CHUNK_END:
+        used = http_collectLine(r, p, n, &line);
+        if (line) r.state = HS_CHUNK_SIZE;
+        break;
+
+      case HS_TRAILER:
+        used = http_collectLine(r, p, n, &line);
+        if (line && !r.hdr[0]) http_done(r);
+        break;
+    }
+    p += used;
+    n -= used;
+  }
+  return !r.error && r.state != HS_DONE;
+}
+
+void http_finish(HttpResponse &r) {
+  r.keep_alive = false;
+  if (r.state == HS_BODY && r.content_length < 0) http_done(r);
+}
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+
+bool http_readClient(Client &client, HttpResponse &r, uint32_t timeout_ms, void (*idle)()) {
+  char chunk[256];
+  uint32_t last = millis();
+  for (;;) {
+    int avail = client.available();
+    if (avail > 0) {
+      int n = client.read((uint8_t *)chunk, avail < (int)sizeof(chunk) ? avail : (int)sizeof(chunk));
+      if (n > 0) {
+        last = millis();
+        if (!http_feed(r, chunk, (size_t)n)) break;
+        continue;
+      }
+    }
+    if (!client.connected()) { http_finish(r); break; }
+    if (millis() - last >= timeout_ms) break;
+    if (idle) idle();
+    delay(5);
+  }
+  return r.complete && !r.error;
+}
+#endif
@@ -0,0 +1,57 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// http_response.h : incremental HTTP/1.x response reader for modem sockets.
+//
+// Bytes are read from the socket in chunks and fed in. Header lines are
+// collected in a small fixed buffer and only the status code,
+// Content-Length and Transfer-Encoding are kept. Body bytes go straight
+// into the caller's buffer, de-chunked, with no String and no per-byte
+// allocation. A body larger than the buffer is cut and flagged, never
+// overflowed.
+
+struct HttpResponse {
+  int      status;          // 0 until the status line arrived
+  long     content_length;  // -1 if not given
+  bool     chunked;
+  bool     headers_done;
+  bool     complete;        // whole body received (length/last chunk)
+  bool     error;           // malformed response
+  bool     truncated;       // body did not fit
+  bool     keep_alive;      // peer will keep the connection open (HTTP/1.1 default)
+  char    *body;            // caller's buffer, NUL-terminated
+  size_t   body_cap;
+  size_t   body_len;
+  size_t   received;        // body bytes seen, including dropped ones
+  size_t   wire_bytes;      // everything fed, status line and headers too
+
+  // internal
+  uint8_t  state;
+  long     chunk_left;
+  char     hdr[192];
+  size_t   hdr_fill;
+};
+
+void   http_begin(HttpResponse &r, char *body, size_t body_cap);
+
+// Feed n bytes. Returns false once the response is complete or broken.
+bool   http_feed(HttpResponse &r, const char *data, size_t n);
+
+// The peer closed the connection: with no length given, that ends the body.
+void   http_finish(HttpResponse &r);
+
+// Append already-decoded body bytes (transports that do their own HTTP).
+void   http_appendBody(HttpResponse &r, const char *data, size_t n);
+
+#if defined(ARDUINO)
+#include <Client.h>
+// Read a response from client until it is complete, the peer closes or
+// timeout_ms passes without data. idle (may be null) runs between reads.
+bool   http_readClient(Client &client, HttpResponse &r, uint32_t timeout_ms,
+                       void (*idle)() = nullptr);
+#endif
+
+#endif // HTTP_RESPONSE_H
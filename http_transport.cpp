@@ -0,0 +1,59 @@
+// http_transport.cpp
+// WiFi transport and bearer selection (see http_transport.h).
+// The modem transport lives in modem_http.cpp.
+
+#include "http_transport.h"
+#include "config.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+// HTTPClient::writeToStream() de-chunks into any Stream; this one appends
+// to the response body buffer.
+class BodySink : public Stream {
+public:
+  explicit BodySink(HttpResponse &r) : r_(r) {}
+  size_t write(uint8_t c) override { http_appendBody(r_, (const char *)&c, 1); return 1; }
+  size_t write(const uint8_t *buf, size_t n) override { http_appendBody(r_, (const char *)buf, n); return n; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override {}
+private:
+  HttpResponse &r_;
+};
+
+static bool wifi_ready() { return WiFi.status() == WL_CONNECTED; }
+
+static bool wifi_perform(const HttpRequest &req, HttpResponse &resp) {
+  HTTPClient http;
+  if (!http.begin(req.url)) return false;
+  http.setTimeout(req.timeout_ms);
+  if (req.content_type) http.addHeader("Content-Type", req.content_type);
+
+  int code = req.body
+    ? http.sendRequest(req.method, (uint8_t *)req.body, req.body_len)
+    : http.sendRequest(req.method);
+  if (code <= 0) {
+#if ENABLE_DEBUG
+    Serial.printf("[HTTP-WIFI] %s failed: %s\n", req.method, http.errorToString(code).c_str());
+#endif
+    http.end();
+    return false;
+  }
+
+  resp.status = code;
+  resp.headers_done = true;
+  BodySink sink(resp);
+  int n = http.writeToStream(&sink);
+  resp.complete = (n >= 0);
+  http.end();
+  return true;
+}
+
+const HttpTransport HTTP_WIFI = { "wifi", wifi_ready, wifi_perform };
+
+const HttpTransport *http_pickTransport() {
+  if (HTTP_WIFI.ready()) return &HTTP_WIFI;
+  if (HTTP_MODEM.ready()) return &HTTP_MODEM;
+  return nullptr;
+}
@@ -0,0 +1,43 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <Arduino.h>
+#include "http_response.h"
+
+// http_transport.h : one HTTP(S) request, whichever bearer is up.
+//
+// Callers fill an HttpRequest, hand an HttpResponse with their body buffer
+// (http_begin) and call perform() on a transport:
+//   - HTTP_WIFI  : HTTPClient over WiFi (TLS on the ESP32)
+//   - HTTP_MODEM : the A7670's own HTTP(S) service (AT+HTTPINIT/HTTPACTION/
+//                  HTTPREAD): the modem does TCP, TLS and de-chunking and
+//                  the body comes over the UART in MODEM_HTTP_READ_BLOCK
+//                  blocks, so no ESP32 CPU goes into TLS.
+//   - HTTP_POOL  : plain http:// over a kept-alive modem socket (http_pool.h),
+//                  no TCP setup per request; https:// URLs go to HTTP_MODEM.
+// Both fill resp.status / resp.body / resp.body_len / resp.truncated the
+// same way, so parsing code does not care which one ran.
+
+struct HttpRequest {
+  const char *method;         // "GET" / "POST"
+  const char *url;            // http:// or https://
+  const char *content_type;   // POST only (may be null)
+  const char *body;
+  size_t      body_len;
+  uint32_t    timeout_ms;
+};
+
+struct HttpTransport {
+  const char *name;
+  bool (*ready)();                                             // bearer is up
+  bool (*perform)(const HttpRequest &req, HttpResponse &resp); // true: got a response
+};
+
+extern const HttpTransport HTTP_WIFI;
+extern const HttpTransport HTTP_MODEM;
+extern const HttpTransport HTTP_POOL;     // in http_pool.cpp
+
+// WiFi if connected, else the modem if registered, else nullptr.
+const HttpTransport *http_pickTransport();
+
+#endif // HTTP_TRANSPORT_H
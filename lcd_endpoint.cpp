@@ -4,6 +4,8 @@
 #include <Preferences.h>
 #include "lcd_server_simple.h"
 #include "provisioning_server.h"
+#include "telemetry.h"
+#include "config.h"
 #include <WiFi.h>
 
 static String html_page = R"rawliteral(
@@ -267,6 +269,53 @@ void lcd_register(WebServer &server) {
     server.send(200, "application/json", js);
   });
 
+  // Telemetry JSON: one consistent snapshot; fields without a valid
+  // reading are sent as null
+  server.on("/telemetry.json", HTTP_GET, [&server]() {
+    TelemetrySnapshot t;
+    telemetry_read(t);
+    char buf[48];
+    auto num = [&](uint32_t field, const char *fmt, double v) -> String {
+      if (!telemetry_has(t, field)) return String("null");
+      snprintf(buf, sizeof(buf), fmt, v);
+      return String(buf);
+    };
+
+    String js;
+    js.reserve(384);
+    js += "{";
+    js += "\"seq\":" + String(t.seq);
+    js += ",\"t_ms\":" + String(t.t_ms);
+    js += ",\"epoch\":" + String((unsigned long)t.epoch);
+    js += ",\"valid\":" + String(t.valid);
+    js += ",\"weight\":[";
+    String conf;
+    for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+      char wb[16] = "null", cb[8] = "null";
+      if (telemetry_hasWeight(t, ch)) {
+        snprintf(wb, sizeof(wb), "%.2f", t.weight[ch]);
+        snprintf(cb, sizeof(cb), "%u", (unsigned)t.weight_conf[ch]);
+      }
+      if (ch) { js += ","; conf += ","; }
+      js += wb;
+      conf += cb;
+    }
+    js += "],\"weight_conf\":[" + conf + "]";
+    js += ",\"temp_int\":" + num(TLM_TEMP_INT, "%.1f", t.temp_int);
+    js += ",\"hum_int\":" + num(TLM_HUM_INT, "%.1f", t.hum_int);
+    js += ",\"temp_ext\":" + num(TLM_TEMP_EXT, "%.1f", t.temp_ext);
+    js += ",\"hum_ext\":" + num(TLM_HUM_EXT, "%.1f", t.hum_ext);
+    js += ",\"pressure\":" + num(TLM_PRESSURE, "%.1f", t.pressure);
+    js += ",\"acc\":[" + num(TLM_ACCEL, "%.3f", t.acc_x) + "," + num(TLM_ACCEL, "%.3f", t.acc_y) + "," + num(TLM_ACCEL, "%.3f", t.acc_z) + "]";
+    js += ",\"batt_v\":" + num(TLM_BATT_V, "%.2f", t.batt_voltage);
+    js += ",\"batt_pct\":" + num(TLM_BATT_PCT, "%.0f", t.batt_percent);
+    js += ",\"lat\":" + num(TLM_GPS, "%.6f", t.lat);
+    js += ",\"lon\":" + num(TLM_GPS, "%.6f", t.lon);
+    js += ",\"rssi\":" + num(TLM_RSSI, "%.0f", t.rssi);
+    js += "}";
+    server.send(200, "application/json", js);
+  });
+
   // WiFi JSON (read-only safe view)
   server.on("/wifi.json", HTTP_GET, [&server]() {
     Preferences pref;
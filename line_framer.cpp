@@ -0,0 +1,85 @@
+// line_framer.cpp
+// In-place line framing (see line_framer.h).
+
+#include "line_framer.h"
+#include <string.h>
+
+void lf_init(LineFramer &f, char *buf, size_t cap) {
+  f.buf = buf;
+  f.cap = cap;
+  f.overflows = 0;
+  lf_reset(f);
+}
+
+void lf_reset(LineFramer &f) {
+  f.start = f.scan = f.end = 0;
+  f.skipping = false;
+}
+
+// One byte is kept back so a line that fills the buffer can still be terminated.
+char *lf_writePtr(LineFramer &f, size_t &space) {
+  if (f.start == f.end) {
+    f.start = f.scan = f.end = 0;
+  } else if (f.end >= f.cap - 1 && f.start > 0) {
+    size_t n = f.end - f.start;
+    memmove(f.buf, f.buf + f.start, n);
+    f.scan -= f.start;
+    f.end = n;
+    f.start = 0;
+  }
+  space = (f.cap - 1) - f.end;
+  return f.buf + f.end;
+}
+
+void lf_commit(LineFramer &f, size_t n) {
+  f.end += n;
+  if (f.end > f.cap - 1) f.end = f.cap - 1;
+}
+
+char *lf_next(LineFramer &f, size_t *len) {
+  for (;;) {
+    char *lf = (char *)memchr(f.buf + f.scan, '\n', f.end - f.scan);
+
+    if (f.skipping) {
+      if (!lf) { f.start = f.scan = f.end; return nullptr; }
+      f.start = f.scan = (size_t)(lf - f.buf) + 1;
+      f.skipping = false;
+      continue;
+    }
+
+    if (!lf) {
+      f.scan = f.end;
+      if (f.start == 0 && f.end >= f.cap - 1) {
+        // no LF in a full buffer: cut the line here, drop the rest of it
+        f.overflows++;
+        f.skipping = true;
+        f.buf[f.end] = '\0';
+        size_t n = f.end;
+        f.start = f.scan = f.end;
+        if (len) *len = n;
+        return f.buf;
+      }
+      return nullptr;
+    }
+
+    char  *line = f.buf + f.start;
+    size_t n = (size_t)(lf - line);
+    f.start = f.scan = (size_t)(lf - f.buf) + 1;
+    while (n && line[n - 1] == '\r') n--;       // an echo ends in "\r\r\n"
+    line[n] = '\0';
+    if (!n) continue;
+    if (len) *len = n;
+    return line;
+  }
+}
+
+size_t lf_pending(const LineFramer &f) { return f.end - f.start; }
+
+const char *lf_take(LineFramer &f, size_t n, size_t &got) {
+  size_t avail = f.end - f.start;
+  got = n < avail ? n : avail;
+  const char *p = f.buf + f.start;
+  f.start += got;
+  if (f.scan < f.start) f.scan = f.start;
+  return p;
+}
@@ -0,0 +1,49 @@
+#ifndef LINE_FRAMER_H
+#define LINE_FRAMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// line_framer.h : in-place line framing over a caller-owned buffer.
+//
+// The reader asks for the free tail of the buffer (lf_writePtr), reads a
+// whole chunk from the driver straight into it (one bulk read, not one
+// call per byte) and commits it. lf_next() then hands out each complete
+// line as a pointer into the same buffer: the terminator is replaced by
+// '\0' in place and CR is dropped, nothing is copied. A partial line
+// stays where it is; only when the tail runs out of room is it moved to
+// the front (one memmove per buffer-full, not per line).
+//
+// A line longer than the buffer is cut: the first cap-1 bytes come out as
+// one line, the rest is discarded up to the next LF and counted.
+
+struct LineFramer {
+  char    *buf;
+  size_t   cap;
+  size_t   start;      // first byte of the current (unreturned) line
+  size_t   scan;       // bytes before this were already searched for LF
+  size_t   end;        // valid bytes
+  bool     skipping;   // dropping the tail of an over-long line
+  uint32_t overflows;
+};
+
+void   lf_init(LineFramer &f, char *buf, size_t cap);
+void   lf_reset(LineFramer &f);                  // drop any partial line
+
+// Free space to read into (compacts first if needed). space may be 0.
+char  *lf_writePtr(LineFramer &f, size_t &space);
+void   lf_commit(LineFramer &f, size_t n);
+
+// Next complete line (no CR/LF, NUL-terminated, valid until the next
+// lf_writePtr/lf_reset). Returns nullptr if none; len gets the length.
+// Empty lines are skipped.
+char  *lf_next(LineFramer &f, size_t *len = nullptr);
+
+// Bytes held that are not yet part of a returned line.
+size_t lf_pending(const LineFramer &f);
+
+// Take up to n raw bytes from the pending data (for binary payloads
+// that follow a header line). Returns a pointer into the buffer.
+const char *lf_take(LineFramer &f, size_t n, size_t &got);
+
+#endif // LINE_FRAMER_H
@@ -0,0 +1,101 @@
+// loadcell_filter.cpp
+// Fixed-point load-cell filter pipeline (see loadcell_filter.h).
+
+#include "loadcell_filter.h"
+#include <string.h>
+
+#define LCF_MAD_TO_SIGMA_Q8 380   // 1.4826 * 256
+
+static void sortSmall(int32_t *a, int n) {
+  for (int i = 1; i < n; i++) {
+    int32_t v = a[i];
+    int j = i - 1;
+    while (j >= 0 && a[j] > v) { a[j + 1] = a[j]; j--; }
+    a[j + 1] = v;
+  }
+}
+
+static int32_t absDiff(int32_t a, int32_t b) { return a > b ? a - b : b - a; }
+
+static int popcount16(uint16_t v) {
+  int n = 0;
+  while (v) { v &= (uint16_t)(v - 1); n++; }
+  return n;
+}
+
+void lcf_init(LoadcellFilter &f, const LoadcellFilterConfig &cfg) {
+  memset(&f, 0, sizeof(f));
+  f.cfg = cfg;
+  if (f.cfg.window == 0 || f.cfg.window > LCF_MAX_WINDOW) f.cfg.window = LCF_MAX_WINDOW;
+  if (f.cfg.noise_counts < 1) f.cfg.noise_counts = 1;
+  if (f.cfg.iir_shift > 8) f.cfg.iir_shift = 8;
+}
+
+void lcf_reset(LoadcellFilter &f) {
+  f.head = 0;
+  f.count = 0;
+  f.accepted_mask = 0;
+  f.have_iir = false;
+  f.iir_q8 = 0;
+}
+
+void lcf_setTempComp(LoadcellFilter &f, float counts_per_c, float ref_c) {
+  f.tc_q8 = (int32_t)(counts_per_c * 256.0f);
+  f.tc_ref_cc = (int16_t)(ref_c * 100.0f);
+}
+
+bool lcf_push(LoadcellFilter &f, int32_t raw) {
+  const uint8_t n = f.cfg.window;
+  f.buf[f.head] = raw;
+  if (f.count < n) f.count++;
+
+  // rolling median and MAD of the raw window
+  int32_t tmp[LCF_MAX_WINDOW];
+  memcpy(tmp, f.buf, f.count * sizeof(int32_t));
+  sortSmall(tmp, f.count);
+  f.median = tmp[f.count / 2];
+  for (int i = 0; i < f.count; i++) tmp[i] = absDiff(f.buf[i], f.median);
+  sortSmall(tmp, f.count);
+  f.sigma = (int32_t)(((int64_t)tmp[f.count / 2] * LCF_MAD_TO_SIGMA_Q8 + 128) >> 8);
+
+  int32_t sigma = f.sigma > f.cfg.noise_counts ? f.sigma : f.cfg.noise_counts;
+  bool ok = (int64_t)absDiff(raw, f.median) * 16 <= (int64_t)f.cfg.mad_k_q4 * sigma;
+
+  uint16_t bit = (uint16_t)(1u << f.head);
+  if (ok) f.accepted_mask |= bit;
+  else f.accepted_mask &= (uint16_t)~bit;
+  f.head = (uint8_t)((f.head + 1) % n);
+
+  if (!ok) {
+    f.rejected++;
+    return false;
+  }
+  f.accepted++;
+  int64_t x_q8 = (int64_t)raw << 8;
+  if (!f.have_iir) {
+    f.iir_q8 = x_q8;
+    f.have_iir = true;
+  } else {
+    f.iir_q8 += (x_q8 - f.iir_q8) >> f.cfg.iir_shift;
+  }
+  return true;
+}
+
+bool lcf_output(const LoadcellFilter &f, bool have_temp, int16_t temp_cc,
+                int32_t &counts, uint8_t &confidence) {
+  if (!f.have_iir) return false;
+
+  int64_t c_q8 = f.iir_q8;
+  if (have_temp && f.tc_q8 != 0) {
+    c_q8 -= (int64_t)f.tc_q8 * (temp_cc - f.tc_ref_cc) / 100;
+  }
+  counts = (int32_t)((c_q8 + 128) >> 8);
+
+  // share of accepted samples, scaled down while the window is filling
+  // and when the spread is well above the expected noise
+  uint32_t conf = (uint32_t)popcount16(f.accepted_mask) * 100u / f.cfg.window;
+  int32_t quiet = 2 * f.cfg.noise_counts;
+  if (f.sigma > quiet) conf = conf * (uint32_t)quiet / (uint32_t)f.sigma;
+  confidence = (uint8_t)(conf > 100 ? 100 : conf);
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef LOADCELL_FILTER_H
+#define LOADCELL_FILTER_H
+
+#include <stdint.h>
+
+// loadcell_filter.h : fixed-point signal pipeline for HX711 raw counts.
+//
+//   raw -> rolling median + MAD over the last `window` samples
+//       -> outlier gate: |raw - median| > k * max(1.4826 * MAD, noise)
+//       -> IIR smoother (y += (x - y) >> iir_shift) on accepted samples
+//       -> temperature correction (counts per degree C from a reference)
+//
+// Integer math only (the IIR state is Q8 counts), no allocation; all state
+// lives in the LoadcellFilter struct. Confidence (0..100) falls with the
+// share of rejected samples and with spread above the expected noise.
+
+#define LCF_MAX_WINDOW 15
+
+struct LoadcellFilterConfig {
+  uint8_t window;         // median/MAD window (odd, <= LCF_MAX_WINDOW)
+  uint8_t mad_k_q4;       // gate width in sigmas, Q4 (48 = 3.0)
+  uint8_t iir_shift;      // IIR weight 1 / 2^shift
+  int32_t noise_counts;   // expected sigma of a quiet scale (gate floor)
+};
+
+struct LoadcellFilter {
+  LoadcellFilterConfig cfg;
+  int32_t  buf[LCF_MAX_WINDOW];   // raw samples, arrival order
+  uint16_t accepted_mask;         // 1 bit per window slot, 1 = passed the gate
+  uint8_t  head;
+  uint8_t  count;
+  bool     have_iir;
+  int64_t  iir_q8;
+  int32_t  median;
+  int32_t  sigma;                 // 1.4826 * MAD, counts
+  int32_t  tc_q8;                 // temperature coefficient, Q8 counts per degree C
+  int16_t  tc_ref_cc;             // reference temperature, centi-degrees C
+  uint32_t accepted;
+  uint32_t rejected;
+};
+
+void lcf_init(LoadcellFilter &f, const LoadcellFilterConfig &cfg);
+void lcf_reset(LoadcellFilter &f);   // drop history (after tare / step change)
+
+// Temperature coefficient in counts per degree C around ref_c (0 = off).
+void lcf_setTempComp(LoadcellFilter &f, float counts_per_c, float ref_c);
+
+// Feed one raw sample. Returns true if it passed the outlier gate.
+bool lcf_push(LoadcellFilter &f, int32_t raw);
+
+// Filtered, temperature-corrected counts. temp_cc is the current
+// temperature in centi-degrees C (ignored when have_temp is false).
+// Returns false until the first sample was accepted.
+bool lcf_output(const LoadcellFilter &f, bool have_temp, int16_t temp_cc,
+                int32_t &counts, uint8_t &confidence);
+
+#endif // LOADCELL_FILTER_H
@@ -24,6 +24,7 @@
 #include "network_manager.h"
 #include "sensors.h"
 #include "sd_logger.h"
+#include "telemetry.h"
 
 extern LiquidCrystal_I2C lcd;
 // sd_present declared in top-level sketch
@@ -55,6 +56,25 @@ static MenuItem m_cal_raw;
 static MenuItem m_cal_save;
 static MenuItem m_cal_back;
 
+// One LCD line with the weight: "WEIGHT: 12.3 kg" for a single load cell,
+// "W 12.3 15.1 --" (one value per hive) for several.
+static void formatWeightLine(char *buf, size_t len, const TelemetrySnapshot &t) {
+  if (LOADCELL_CHANNELS == 1) {
+    if (telemetry_hasWeight(t, 0)) snprintf(buf, len, "WEIGHT: %5.1f kg", t.weight[0]);
+    else snprintf(buf, len, "WEIGHT:  --.- kg");
+    return;
+  }
+  int n = snprintf(buf, len, "W");
+  for (int ch = 0; ch < LOADCELL_CHANNELS && n > 0 && (size_t)n < len; ch++) {
+    if (telemetry_hasWeight(t, ch)) n += snprintf(buf + n, len - n, " %.1f", t.weight[ch]);
+    else n += snprintf(buf + n, len - n, " --");
+  }
+}
+
+// Load cell the calibration screens work on (chosen per action when the
+// controller has more than one).
+static int calChannel = 0;
+
 // incremental mirror state
 static MenuItem* currentListArr[32];
 static int currentMenuCount = 0;
@@ -405,9 +425,8 @@ void menuShowStatus() {
 
   unsigned long lastUpdate = 0;
   String oldDateTime = "";
-  float oldWeight = NAN;
-  float oldBattV = NAN;
-  int oldBattP = -999;
+  String oldWeightLine = "";
+  String oldBattLine = "";
 
   while (true) {
     server.handleClient();
@@ -420,17 +439,19 @@ void menuShowStatus() {
         writeColsOverwrite(0, 0, padRightBytes(ndt, 20));
         oldDateTime = ndt;
       }
-      float w = test_weight;
-      if (!(isnan(w) && isnan(oldWeight)) && fabs((isnan(w)?0:w) - (isnan(oldWeight)?0:oldWeight)) > 0.01f) {
-        char buf[64]; snprintf(buf, sizeof(buf), "WEIGHT: %5.1f kg", w);
+      TelemetrySnapshot t;
+      telemetry_read(t);
+      char buf[64];
+      formatWeightLine(buf, sizeof(buf), t);   // '--' for channels without a reading
+      if (oldWeightLine != buf) {
         writeColsOverwrite(0, 1, padRightBytes(String(buf), 20));
-        oldWeight = w;
+        oldWeightLine = buf;
       }
-      float bv = test_batt_voltage; int bp = test_batt_percent;
-      if (!(isnan(bv) && isnan(oldBattV)) && (fabs((isnan(bv)?0:bv) - (isnan(oldBattV)?0:oldBattV)) > 0.01f || bp != oldBattP)) {
-        char buf[64]; snprintf(buf, sizeof(buf), "BATTERY: %.2fV %3d%%", bv, bp);
+      if (telemetry_has(t, TLM_BATT_V | TLM_BATT_PCT)) snprintf(buf, sizeof(buf), "BATTERY: %.2fV %3d%%", t.batt_voltage, t.batt_percent);
+      else snprintf(buf, sizeof(buf), "BATTERY: -.--V  --%%");
+      if (oldBattLine != buf) {
         writeColsOverwrite(0, 2, padRightBytes(String(buf), 20));
-        oldBattV = bv; oldBattP = bp;
+        oldBattLine = buf;
       }
       writeColsOverwrite(0, 3, padRightBytes(String(getTextEN(TXT_BACK_SMALL)), 20));
       uiRefreshMirror();
@@ -550,20 +571,30 @@ void menuShowMeasurements() {
   while (true) {
     server.handleClient();
     if (page != lastPage) {
+      TelemetrySnapshot t;
+      telemetry_read(t);
       if (page == 0) {
-        snprintf(buf, sizeof(buf), "WEIGHT: %5.1f kg", test_weight);
+        formatWeightLine(buf, sizeof(buf), t);
         writeColsOverwrite(0,1,padRightBytes(String(buf),20));
-        snprintf(buf, sizeof(buf), "T_INT:  %4.1f%s", test_temp_int, DEGREE_SYMBOL_UTF);
+        if (telemetry_has(t, TLM_TEMP_INT)) snprintf(buf, sizeof(buf), "T_INT:  %4.1f%s", t.temp_int, DEGREE_SYMBOL_UTF);
+        else snprintf(buf, sizeof(buf), "T_INT:  --.-%s", DEGREE_SYMBOL_UTF);
         writeColsOverwrite(0,2,padRightBytes(String(buf),20));
       } else if (page == 1) {
-        snprintf(buf, sizeof(buf), "T_EXT:  %4.1f%s", test_temp_ext, DEGREE_SYMBOL_UTF);
+        if (telemetry_has(t, TLM_TEMP_EXT)) snprintf(buf, sizeof(buf), "T_EXT:  %4.1f%s", t.temp_ext, DEGREE_SYMBOL_UTF);
+        else snprintf(buf, sizeof(buf), "T_EXT:  --.-%s", DEGREE_SYMBOL_UTF);
         writeColsOverwrite(0,1,padRightBytes(String(buf),20));
-        snprintf(buf, sizeof(buf), "H_EXT:  %3.0f%%", test_hum_ext);
+        if (telemetry_has(t, TLM_HUM_EXT)) snprintf(buf, sizeof(buf), "H_EXT:  %3.0f%%", t.hum_ext);
+        else snprintf(buf, sizeof(buf), "H_EXT:  --%%");
         writeColsOverwrite(0,2,padRightBytes(String(buf),20));
       } else {
-        snprintf(buf, sizeof(buf), "ACC: X%.2f Y%.2f", test_acc_x, test_acc_y);
-        writeColsOverwrite(0,1,padRightBytes(String(buf),20));
-        snprintf(buf, sizeof(buf), "Z: %.2f", test_acc_z);
+        if (telemetry_has(t, TLM_ACCEL)) {
+          snprintf(buf, sizeof(buf), "ACC: X%.2f Y%.2f", t.acc_x, t.acc_y);
+          writeColsOverwrite(0,1,padRightBytes(String(buf),20));
+          snprintf(buf, sizeof(buf), "Z: %.2f", t.acc_z);
+        } else {
+          writeColsOverwrite(0,1,padRightBytes(String("ACC: --"),20));
+          snprintf(buf, sizeof(buf), " ");
+        }
         writeColsOverwrite(0,2,padRightBytes(String(buf),20));
       }
       lastPage = page;
@@ -577,10 +608,75 @@ void menuShowMeasurements() {
   }
 }
 
+// Wait for an asynchronous HX711 request (calib_request*) with a progress
+// line. The web server and the acquisition drain keep running, since the
+// samples reach the request through acq_drain(). BACK cancels.
+static bool menuWaitCalibRequest(const char *title, long &raw) {
+  char buf[32];
+  int lastPct = -1;
+  menuClear();
+  for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
+  writeColsOverwrite(0,0,padRightBytes(String(title),20));
+  writeColsOverwrite(0,3,padRightBytes(String(getTextEN(TXT_BACK_SMALL)),20));
+  uiRefreshMirror();
+
+  while (true) {
+    server.handleClient();
+    acq_drain();
+    int pct = 0;
+    CalibRequestStatus st = calib_pollRequest(raw, &pct);
+    if (st == CALIB_REQ_DONE) return true;
+    if (st != CALIB_REQ_BUSY) {
+      writeColsOverwrite(0,1,padRightBytes(String("HX711 NOT READY"),20));
+      uiRefreshMirror();
+      delay(800);
+      return false;
+    }
+    if (pct != lastPct) {
+      snprintf(buf, sizeof(buf), "MEASURING %3d%%", pct);
+      writeColsOverwrite(0,1,padRightBytes(String(buf),20));
+      uiRefreshMirror();
+      lastPct = pct;
+    }
+    if (getButton() == BTN_BACK_PRESSED) { calib_cancelRequest(); return false; }
+    delay(40);
+  }
+}
+
+// Choose the load cell for a calibration action (UP/DOWN, SEL). Returns
+// false on BACK; with a single load cell it returns true right away.
+static bool menuPickLoadcell() {
+  if (LOADCELL_CHANNELS == 1) { calChannel = 0; return true; }
+  int last = -1;
+  menuClear();
+  for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
+  writeColsOverwrite(0,0,padRightBytes(String("SELECT LOAD CELL"),20));
+  writeColsOverwrite(0,3,padRightBytes(String("SEL:OK BACK:Exit"),20));
+  while (true) {
+    server.handleClient();
+    if (calChannel != last) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "HIVE %d%s", calChannel + 1, calib_present(calChannel) ? "" : " (NO HX711)");
+      writeColsOverwrite(0,1,padRightBytes(String(buf),20));
+      uiRefreshMirror();
+      last = calChannel;
+    }
+    Button b = getButton();
+    if (b == BTN_UP_PRESSED)   calChannel = (calChannel + LOADCELL_CHANNELS - 1) % LOADCELL_CHANNELS;
+    if (b == BTN_DOWN_PRESSED) calChannel = (calChannel + 1) % LOADCELL_CHANNELS;
+    if (b == BTN_SELECT_PRESSED) return true;
+    if (b == BTN_BACK_PRESSED) return false;
+    delay(60);
+  }
+}
+
 void menuCalTare() {
+  long offset = 0;
+  if (!menuPickLoadcell()) { menuDraw(); return; }
+  calib_requestTare(calChannel, CALIB_SAMPLES, CALIB_SKIP);
+  if (!menuWaitCalibRequest("TARE", offset)) { menuDraw(); return; }
   menuClear();
   for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
-  long offset = calib_doTare(CALIB_SAMPLES, CALIB_SKIP);
   char buf[64]; snprintf(buf, sizeof(buf), "OFFSET:%ld", offset);
   writeColsOverwrite(0,0,padRightBytes(String("TARE DONE"),20));
   writeColsOverwrite(0,1,padRightBytes(String(buf),20));
@@ -590,6 +686,7 @@ void menuCalTare() {
 }
 
 void menuCalCalibrate() {
+  if (!menuPickLoadcell()) { menuDraw(); return; }
   menuClear();
   for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
   writeColsOverwrite(0,0,padRightBytes(String("CALIBRATE: READ RAW"),20));
@@ -600,7 +697,9 @@ void menuCalCalibrate() {
     server.handleClient();
     Button b = getButton();
     if (b == BTN_SELECT_PRESSED) {
-      long raw = calib_readRawAverage(CALIB_SAMPLES, CALIB_SKIP);
+      long raw = 0;
+      calib_requestRawAverage(calChannel, CALIB_SAMPLES, CALIB_SKIP);
+      if (!menuWaitCalibRequest("CALIBRATE: READ RAW", raw)) { menuDraw(); return; }
       char line[64]; snprintf(line,sizeof(line),"RAW: %ld", raw);
       menuClear(); for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
       writeColsOverwrite(0,1,padRightBytes(String(line),20));
@@ -619,10 +718,13 @@ void menuCalCalibrate() {
 }
 
 void menuCalRaw() {
+  long raw = 0;
+  if (!menuPickLoadcell()) { menuDraw(); return; }
+  calib_requestRawAverage(calChannel, CALIB_SAMPLES, CALIB_SKIP);
+  if (!menuWaitCalibRequest("RAW VALUE", raw)) { menuDraw(); return; }
   menuClear();
   for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
   writeColsOverwrite(0,0,padRightBytes(String("RAW VALUE"),20));
-  long raw = calib_readRawAverage(CALIB_SAMPLES, CALIB_SKIP);
   char buf[64]; snprintf(buf,sizeof(buf),"RAW: %ld", raw);
   writeColsOverwrite(0,1,padRightBytes(String(buf),20));
   writeColsOverwrite(0,3,padRightBytes(String(getTextEN(TXT_BACK_SMALL)),20));
@@ -632,11 +734,16 @@ void menuCalRaw() {
 }
 
 void menuCalSave() {
+  if (!menuPickLoadcell()) { menuDraw(); return; }
   menuClear();
   for (int r = 0; r < 4; ++r) ui_setMarkerCharAtRow(r, ' ');
-  if (calib_hasSavedFactor()) {
-    float f = calib_getSavedFactor();
-    long o = calib_getSavedOffset();
+  if (LOADCELL_CHANNELS > 1) {
+    char hb[16]; snprintf(hb, sizeof(hb), "HIVE %d", calChannel + 1);
+    writeColsOverwrite(0,2,padRightBytes(String(hb),20));
+  }
+  if (calib_hasSavedFactor(calChannel)) {
+    float f = calib_getSavedFactor(calChannel);
+    long o = calib_getSavedOffset(calChannel);
     char b1[64], b2[64];
     snprintf(b1,sizeof(b1),"FACTOR: %.3f", f);
     snprintf(b2,sizeof(b2),"OFFSET:%ld", o);
@@ -658,6 +765,7 @@ void menuShowConnectivity() {
   uiRefreshMirror();
   while (true) {
     server.handleClient();
+    modem_service();   // this loop owns the task: keep URCs / status refresh going
     Serial.println("[MENU] menuShowConnectivity() loop iteration");
     bool wifiOK = (WiFi.status()==WL_CONNECTED);
     bool lteOK = modem_isNetworkRegistered();
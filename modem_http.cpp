@@ -0,0 +1,160 @@
+// modem_http.cpp
+// A7670 built-in HTTP(S) service as an HttpTransport (see http_transport.h).
+//
+//   AT+HTTPINIT
+//   AT+HTTPPARA="URL","https://..."      (+ "SSLCFG" / "CONTENT")
+//   AT+HTTPDATA=<len>,<s>  -> DOWNLOAD -> <body>      (POST only)
+//   AT+HTTPACTION=<0|1>    -> OK ... +HTTPACTION: <m>,<status>,<len>
+//   AT+HTTPREAD=<off>,<n>  -> OK, +HTTPREAD: <n>, <n raw bytes>, +HTTPREAD: 0
+//   AT+HTTPTERM
+
+#include "http_transport.h"
+#include "modem_manager.h"
+#include "at_engine.h"
+#include "pdp_session.h"
+#include "config.h"
+
+static bool          s_inited = false;
+static bool          s_actionDone = false;
+static int           s_actionStatus = 0;
+static long          s_actionLen = 0;
+static bool          s_readDone = false;
+static HttpResponse *s_resp = nullptr;
+
+// +HTTPACTION: <method>,<status>,<datalen>
+static void mh_onAction(const char *line, uint32_t, void *) {
+  int method, status;
+  long len;
+  const char *p = strchr(line, ':');
+  if (p && sscanf(p + 1, "%d,%d,%ld", &method, &status, &len) == 3) {
+    s_actionStatus = status;
+    s_actionLen = len;
+    s_actionDone = true;
+  }
+}
+
+static void mh_onData(const char *data, size_t len, void *) {
+  if (s_resp) http_appendBody(*s_resp, data, len);
+}
+
+// +HTTPREAD: <n> (A76xx) or +HTTPREAD: DATA,<n> (SIM76xx); 0 ends the block
+static void mh_readLine(const char *line, void *) {
+  const char *p = strchr(line, ':');
+  if (!p) return;
+  p++;
+  while (*p == ' ') p++;
+  if (strncmp(p, "DATA,", 5) == 0) p += 5;
+  long n = atol(p);
+  if (n > 0) at_expectRaw((size_t)n, mh_onData);
+  else s_readDone = true;
+}
+
+static void mh_onReadUrc(const char *line, uint32_t, void *arg) { mh_readLine(line, arg); }
+
+static bool mh_wait(const bool &flag, uint32_t timeout_ms) {
+  uint32_t t0 = millis();
+  while (!flag) {
+    if (millis() - t0 >= timeout_ms) return false;
+    at_poll();
+    delay(2);
+  }
+  return true;
+}
+
+static bool mh_ready() { return modem_isNetworkRegistered(); }
+
+static bool mh_perform(const HttpRequest &req, HttpResponse &resp) {
+  if (!s_inited) {
+    s_inited = true;
+    at_subscribe("+HTTPACTION:", mh_onAction);
+    at_subscribe("+HTTPREAD:", mh_onReadUrc);
+    // SSL context 0: any TLS version, no server verification (as the WiFi path)
+    at_command("+CSSLCFG=\"sslversion\",0,4", 1000);
+    at_command("+CSSLCFG=\"authmode\",0,0", 1000);
+  }
+
+  // the HTTP service needs the PDP context; the attach itself runs in
+  // pdp_service(), the caller retries on its next cycle
+  if (!pdp_isUp()) {
+    pdp_want(true);
+#if ENABLE_DEBUG
+    Serial.printf("[HTTP-MODEM] no data session (%s)\n", pdp_stateName(pdp_state()));
+#endif
+    return false;
+  }
+
+  at_command("+HTTPTERM", 2000);          // session left over from an aborted request
+  if (at_command("+HTTPINIT", 5000) != AT_OK) {
+#if ENABLE_DEBUG
+    Serial.println("[HTTP-MODEM] HTTPINIT failed");
+#endif
+    return false;
+  }
+
+  bool ok = false;
+  char cmd[AT_CMD_MAX];
+  uint32_t t0 = millis();
+  do {
+    if (snprintf(cmd, sizeof(cmd), "+HTTPPARA=\"URL\",\"%s\"", req.url) >= (int)sizeof(cmd)) break;
+    if (at_command(cmd, 2000) != AT_OK) break;
+    if (strncmp(req.url, "https:", 6) == 0) at_command("+HTTPPARA=\"SSLCFG\",0", 2000);
+
+    if (req.content_type) {
+      snprintf(cmd, sizeof(cmd), "+HTTPPARA=\"CONTENT\",\"%s\"", req.content_type);
+      if (at_command(cmd, 2000) != AT_OK) break;
+    }
+    if (req.body && req.body_len) {
+      snprintf(cmd, sizeof(cmd), "+HTTPDATA=%u,10", (unsigned)req.body_len);
+      if (at_commandPayload(cmd, "DOWNLOAD", req.body, req.body_len, 12000) != AT_OK) break;
+    }
+
+    int method = (strcmp(req.method, "POST") == 0) ? 1 : (strcmp(req.method, "HEAD") == 0) ? 2 : 0;
+    s_actionDone = false;
+    snprintf(cmd, sizeof(cmd), "+HTTPACTION=%d", method);
+    if (at_command(cmd, 2000) != AT_OK) break;
+    if (!mh_wait(s_actionDone, req.timeout_ms)) {
+#if ENABLE_DEBUG
+      Serial.println("[HTTP-MODEM] no +HTTPACTION result (timeout)");
+#endif
+      break;
+    }
+    if (s_actionStatus < 100 || s_actionStatus >= 600) {
+      // 7xx: modem-side error (DNS, TLS, socket...), not an HTTP status
+#if ENABLE_DEBUG
+      Serial.printf("[HTTP-MODEM] request failed, modem error %d\n", s_actionStatus);
+#endif
+      break;
+    }
+
+    resp.status = s_actionStatus;
+    resp.content_length = s_actionLen;
+    resp.headers_done = true;
+
+    // body in large blocks, only as much as fits the caller's buffer
+    s_resp = &resp;
+    long off = 0;
+    while (off < s_actionLen && !resp.truncated) {
+      long want = s_actionLen - off;
+      if (want > MODEM_HTTP_READ_BLOCK) want = MODEM_HTTP_READ_BLOCK;
+      s_readDone = false;
+      snprintf(cmd, sizeof(cmd), "+HTTPREAD=%ld,%ld", off, want);
+      if (at_command(cmd, 5000, mh_readLine) != AT_OK) break;
+      if (!mh_wait(s_readDone, 5000)) break;
+      off += want;
+    }
+    s_resp = nullptr;
+    if (off < s_actionLen && !resp.truncated) break;
+    resp.complete = true;
+    ok = true;
+  } while (0);
+
+  at_command("+HTTPTERM", 2000);
+#if ENABLE_DEBUG
+  Serial.printf("[HTTP-MODEM] %s %s -> %d, %u bytes%s in %lu ms\n", req.method, req.url,
+                resp.status, (unsigned)resp.body_len, resp.truncated ? " (cut)" : "",
+                (unsigned long)(millis() - t0));
+#endif
+  return ok;
+}
+
+const HttpTransport HTTP_MODEM = { "modem", mh_ready, mh_perform };
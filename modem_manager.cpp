@@ -4,7 +4,12 @@
 
 #include "modem_manager.h"
 #include "config.h"
+#include "gnss.h"
+#include "at_engine.h"
+#include "modem_power.h"
+#include "pdp_session.h"
 #include <HardwareSerial.h>
+#include <Preferences.h>
 #include <TinyGsmClient.h>
 #include <Arduino.h>
 
@@ -14,6 +19,34 @@ HardwareSerial SerialAT(2);  // UART2 on ESP32
 
 static TinyGsm* _modem = nullptr;
 
+// ---------------------------------------------------------
+// AT engine binding (at_engine.h talks to SerialAT through these)
+// ---------------------------------------------------------
+static size_t   at_io_read(void *, char *buf, size_t cap)    {
+    int n = SerialAT.available();
+    if (n <= 0) return 0;
+    return SerialAT.read((uint8_t *)buf, (size_t)n < cap ? (size_t)n : cap);
+}
+static size_t   at_io_write(void *, const char *d, size_t n) { return SerialAT.write((const uint8_t *)d, n); }
+static uint32_t at_io_now(void *)                            { return millis(); }
+static void     at_io_idle(void *)                           { delay(1); }
+
+// The UART driver's receive ring is filled from the RX interrupt, so it
+// has to hold everything the modem sends while loop() is busy elsewhere:
+// a CIPRXGET chunk, a burst of URCs. The default (256) is far too small.
+static void modem_uartBegin() {
+    static bool sized = false;
+    if (!sized) {
+        sized = SerialAT.setRxBufferSize(MODEM_UART_RX_BUFFER) > 0;
+    }
+    SerialAT.begin(115200, SERIAL_8N1, MODEM_RX, MODEM_TX);
+}
+
+static void modem_atBegin() {
+    AtIo io = { nullptr, at_io_read, at_io_write, at_io_now, at_io_idle };
+    at_init(io);
+}
+
 // ---------------------------------------------------------
 // Helper: power-up sequences and AT check
 // ---------------------------------------------------------
@@ -21,107 +54,118 @@ static TinyGsm* _modem = nullptr;
 #define MODEM_PWR_ACTIVE_LOW 0
 #endif
 
-static bool modem_power_up_check(unsigned long atTimeoutMs = 5000) {
-#if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] Starting power-up/detection sequence"));
-#endif
+#define MODEM_PREF_NS      "modem"
+#define MODEM_PREF_PWRSEQ  "pwr_seq"
 
-    pinMode(MODEM_PWR, OUTPUT);
+// PWRKEY sequences, tried in this order unless NVS remembers a better one.
+// A pulse toggles the modem, so nothing is pulsed while it answers AT.
+// The last one tries the opposite polarity (board without the inverting
+// transistor); the polarity is part of the remembered sequence.
+struct PwrSeq { const char *name; uint16_t hold_ms; bool inverted; };
+static const PwrSeq kPwrSeq[] = {
+    { "short pulse (200ms)",                 200, false },
+    { "long hold (1200ms)",                 1200, false },
+    { "inverted polarity hold (1200ms)",    1200, true  },
+};
+#define MODEM_PWR_SEQ_COUNT ((int)(sizeof(kPwrSeq) / sizeof(kPwrSeq[0])))
 
-    // Baseline
-    if (MODEM_PWR_ACTIVE_LOW) digitalWrite(MODEM_PWR, HIGH);
-    else digitalWrite(MODEM_PWR, LOW);
-    delay(50);
+static ModemBootStats s_boot = { -2, 0, 0, 0 };
+static bool s_pwrInverted = false;   // PWRKEY polarity opposite to MODEM_PWR_ACTIVE_LOW
 
-    // Sequence 1: short pulse (200ms)
-#if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] Sequence 1: short pulse (200ms)"));
-#endif
-    if (MODEM_PWR_ACTIVE_LOW) {
-      digitalWrite(MODEM_PWR, LOW);
-      delay(200);
-      digitalWrite(MODEM_PWR, HIGH);
-    } else {
-      digitalWrite(MODEM_PWR, HIGH);
-      delay(200);
-      digitalWrite(MODEM_PWR, LOW);
-    }
-    delay(1500);
+static void modem_pwrIdle(bool idle) {
+    bool active_low = (MODEM_PWR_ACTIVE_LOW != 0) != s_pwrInverted;
+    digitalWrite(MODEM_PWR, (active_low ? idle : !idle) ? HIGH : LOW);
+}
 
-    // Sequence 2: long hold (1200ms)
+// Every sequence starts and ends at the idle level of its own polarity.
+static void modem_pulse(int seq) {
+    const PwrSeq &ps = kPwrSeq[seq];
 #if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] Sequence 2: long hold (1200ms)"));
+    Serial.printf("[modem_hw_init] Sequence %d: %s\n", seq + 1, ps.name);
 #endif
-    if (MODEM_PWR_ACTIVE_LOW) {
-      digitalWrite(MODEM_PWR, LOW);
-      delay(1200);
-      digitalWrite(MODEM_PWR, HIGH);
-    } else {
-      digitalWrite(MODEM_PWR, HIGH);
-      delay(1200);
-      digitalWrite(MODEM_PWR, LOW);
+    if (ps.inverted != s_pwrInverted) {
+        s_pwrInverted = ps.inverted;
+        modem_pwrIdle(true);
+        delay(50);
     }
-    delay(1500);
+    modem_pwrIdle(false);
+    delay(ps.hold_ms);
+    modem_pwrIdle(true);
+}
+
+// Poll AT until the modem answers or wait_ms passes (returns on first OK).
+static bool modem_waitAt(uint32_t wait_ms) {
+    uint32_t t0 = millis();
+    do {
+        if (at_command("", MODEM_AT_PROBE_MS) == AT_OK) return true;
+    } while (millis() - t0 < wait_ms);
+    return false;
+}
 
-    // Sequence 3: alternate polarity hold (1200ms)
+static int modem_loadPwrSeq() {
+    Preferences p;
+    if (!p.begin(MODEM_PREF_NS, true)) return -1;
+    int seq = p.getChar(MODEM_PREF_PWRSEQ, -1);
+    p.end();
+    return (seq >= 0 && seq < MODEM_PWR_SEQ_COUNT) ? seq : -1;
+}
+
+static void modem_savePwrSeq(int seq) {
+    Preferences p;
+    if (!p.begin(MODEM_PREF_NS, false)) return;
+    p.putChar(MODEM_PREF_PWRSEQ, (int8_t)seq);
+    p.end();
+}
+
+// 1) already on? (warm reset of the ESP32, modem kept running)
+// 2) the sequence that worked last time (NVS)
+// 3) the remaining sequences
+static bool modem_power_up_check() {
+    uint32_t t0 = millis();
 #if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] Sequence 3: alternate polarity hold (1200ms)"));
+    Serial.println(F("[modem_hw_init] Starting power-up/detection sequence"));
 #endif
-    if (MODEM_PWR_ACTIVE_LOW) {
-      digitalWrite(MODEM_PWR, HIGH);
-      delay(50);
-      digitalWrite(MODEM_PWR, LOW);
-      delay(1200);
-      digitalWrite(MODEM_PWR, HIGH);
-    } else {
-      digitalWrite(MODEM_PWR, LOW);
-      delay(50);
-      digitalWrite(MODEM_PWR, HIGH);
-      delay(1200);
-      digitalWrite(MODEM_PWR, LOW);
-    }
-    delay(1500);
 
-    // Start UART
-    SerialAT.begin(115200, SERIAL_8N1, MODEM_RX, MODEM_TX);
-    delay(200);
+    // idle at the polarity that worked last time: the other level would
+    // hold PWRKEY down and switch a running modem off
+    int remembered = modem_loadPwrSeq();
+    s_pwrInverted = remembered >= 0 && kPwrSeq[remembered].inverted;
+    pinMode(MODEM_PWR, OUTPUT);
+    modem_pwrIdle(true);
 
-    // Flush and test AT
+    modem_uartBegin();
     while (SerialAT.available()) SerialAT.read();
-#if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] Sending AT to check modem responsiveness"));
-#endif
-    SerialAT.print("AT\r\n");
-
-    unsigned long start = millis();
-    String resp;
-    while (millis() - start < atTimeoutMs) {
-      while (SerialAT.available()) {
-        char c = (char)SerialAT.read();
-        resp += c;
-        if (resp.indexOf("OK") >= 0 || resp.indexOf("ERROR") >= 0) break;
-      }
-      if (resp.indexOf("OK") >= 0) {
-#if ENABLE_DEBUG
-        Serial.println(F("[modem_hw_init] Modem responded with OK"));
-#endif
-        return true;
-      }
-      if (resp.indexOf("ERROR") >= 0) {
-#if ENABLE_DEBUG
-        Serial.print(F("[modem_hw_init] Modem responded with ERROR: "));
-        Serial.println(resp);
-#endif
-        break;
-      }
-      delay(50);
+    modem_atBegin();
+
+    int seq = -1;
+    bool up = modem_waitAt(MODEM_AT_PROBE_MS * 2);
+    if (!up) {
+        if (remembered >= 0) {
+            modem_pulse(remembered);
+            if (modem_waitAt(MODEM_PWR_SEQ_WAIT_MS)) { up = true; seq = remembered; }
+        }
+        for (int i = 0; !up && i < MODEM_PWR_SEQ_COUNT; i++) {
+            if (i == remembered) continue;
+            modem_pulse(i);
+            if (modem_waitAt(MODEM_PWR_SEQ_WAIT_MS)) { up = true; seq = i; }
+        }
+        if (up && seq != remembered) modem_savePwrSeq(seq);
+        if (!up && s_pwrInverted) {
+            s_pwrInverted = false;      // back to the configured idle level
+            modem_pwrIdle(true);
+        }
     }
 
+    s_boot.pwr_seq = up ? seq : -2;
+    s_boot.at_ready_ms = millis();
+    s_boot.powerup_ms = millis() - t0;
 #if ENABLE_DEBUG
-    Serial.print(F("[modem_hw_init] No OK received, resp="));
-    Serial.println(resp);
+    if (!up) Serial.println(F("[modem_hw_init] No OK received"));
+    else if (seq < 0) Serial.println(F("[modem_hw_init] Modem already powered, responded with OK"));
+    else Serial.printf("[modem_hw_init] Modem responded with OK after sequence %d\n", seq + 1);
+    Serial.printf("[modem_hw_init] power-up took %lu ms\n", (unsigned long)s_boot.powerup_ms);
 #endif
-    return false;
+    return up;
 }
 
 // High-level modem_hw_init
@@ -130,27 +174,27 @@ void modem_hw_init() {
     Serial.println(F("[modem_hw_init] BEGIN"));
 #endif
 
-    bool up = modem_power_up_check(5000);
+    bool up = modem_power_up_check();
 #if ENABLE_DEBUG
     if (up) {
       Serial.println(F("[modem_hw_init] modem_power_up_check succeeded"));
     } else {
       Serial.println(F("[modem_hw_init] modem_power_up_check failed - check wiring/power"));
     }
-#endif
-
-    SerialAT.begin(115200, SERIAL_8N1, MODEM_RX, MODEM_TX);
-    delay(200);
-#if ENABLE_DEBUG
-    Serial.println(F("[modem_hw_init] SerialAT started"));
-    Serial.printf("[modem_hw_init] SerialAT TX=%d RX=%d\n", MODEM_TX, MODEM_RX);
+    Serial.printf("[modem_hw_init] SerialAT TX=%d RX=%d rx_buffer=%d\n", MODEM_TX, MODEM_RX, MODEM_UART_RX_BUFFER);
 #endif
 }
 
 // ---------------------------------------------------------
 // Accessor for global modem instance
 // ---------------------------------------------------------
+// Every TinyGSM user goes through here, so this is where the AT engine
+// hands over the UART: the command in flight completes first.
 TinyGsm& modem_get() {
+    // TinyGSM talks to the UART directly: a modem in PSM has to be woken
+    // first (blocking, a second or two) or every call would time out.
+    if (!modemPower_isAwake()) modemPower_wakeNow();
+    at_settle();
     if (!_modem) {
         static TinyGsm modemInstance(SerialAT);
         _modem = &modemInstance;
@@ -161,25 +205,59 @@ TinyGsm& modem_get() {
 // ---------------------------------------------------------
 // Initialization
 // ---------------------------------------------------------
+static void modem_powerBegin();
+static void modem_pdpBegin();
+
+static void modem_gnssUrc(const char *line, uint32_t now_ms, void *) {
+    gnss_feedLine(line, now_ms);
+}
+
 void modemManager_init()
 {
+    at_subscribe("+CGNSSINFO:", modem_gnssUrc);
+    at_subscribe("+CREG:", modem_regUrc);
+    at_subscribe("+CEREG:", modem_regUrc);
+
     // safe to call modem_hw_init here as well
     modem_hw_init();
-    delay(300);
 
     TinyGsm &modem = modem_get();
 
+    // The modem was just powered or found running: init() only sets up
+    // echo/error reporting. restart() (a full reboot, several seconds) is
+    // kept for a modem that does not answer.
+#if ENABLE_DEBUG
+    Serial.println(F("[modemManager_init] modem.init()"));
+#endif
+    if (!modem.init()) {
 #if ENABLE_DEBUG
-    Serial.println(F("[modemManager_init] attempting modem.restart()"));
+        Serial.println(F("[modemManager_init] init failed, attempting modem.restart()"));
 #endif
-    modem.restart();
-    delay(500);
+        modem.restart();
+    }
 
 #if ENABLE_DEBUG
     Serial.println(F("[modemManager_init] setting CFUN=1"));
 #endif
-    modem.sendAT("+CFUN=1");
-    modem.waitResponse(1000);
+    at_command("+CFUN=1", 1000);
+
+    // Registration changes as URCs (CEREG mode 4 also carries the PSM
+    // timers, see modem_power.cpp), operator names in long form.
+    at_submit("+CREG=1", 1000);
+    at_submit("+CEREG=4", 1000);
+    at_submit("+COPS=3,0", 1000);
+
+    // GNSS on once; positions then arrive as unsolicited reports
+    if (modem_enableGPS(true) && modem_setGnssReports(GNSS_REPORT_INTERVAL_S)) {
+#if ENABLE_DEBUG
+        Serial.printf("[modemManager_init] GNSS reports every %d s\n", GNSS_REPORT_INTERVAL_S);
+#endif
+    } else {
+        Serial.println(F("[modemManager_init] GNSS start FAILED (will retry)"));
+    }
+
+    modem_powerBegin();
+    modem_pdpBegin();
 
 #if ENABLE_DEBUG
     Serial.println(F("[modemManager_init] modemManager_init completed"));
@@ -189,30 +267,128 @@ void modemManager_init()
 // ---------------------------------------------------------
 // CHECK REGISTRATION (single canonical implementation)
 // ---------------------------------------------------------
-bool modem_isNetworkRegistered()
-{
-    TinyGsm &modem = modem_get();
-    int stat = modem.getRegistrationStatus();
-    return (stat == 1 || stat == 5);
+static void modem_noteRegistered() {
+    if (s_boot.registered_ms) return;
+    s_boot.registered_ms = millis();
+    Serial.printf("[MODEM] registered %lu ms after boot (modem answered AT at %lu ms)\n",
+                  (unsigned long)s_boot.registered_ms, (unsigned long)s_boot.at_ready_ms);
 }
 
+const ModemBootStats &modem_bootStats() { return s_boot; }
+
 // ---------------------------------------------------------
-// Signal quality (RSSI) - implemented here (canonical)
+// Status cache: registration, signal, operator
 // ---------------------------------------------------------
+// Readers never talk to the modem. Registration changes arrive as
+// +CREG / +CEREG URCs; modem_service() re-queries everything in the
+// background every MODEM_STATUS_TTL_MS (every MODEM_REG_PROBE_MS until
+// the first registration), not at all while the modem sleeps, and not
+// while the power manager counts down to a sleep (each query would
+// restart its idle timer). After a wake everything is queried at once.
+static ModemStatus s_status = { -1, -1, false, 99, 0, "", 0, 0, 0 };
+static int8_t      s_lastRegStat = -2;   // for change logging
+
+static void modem_setReg(bool eps, int stat) {
+    if (eps) s_status.eps_stat = (int8_t)stat;
+    else     s_status.cs_stat = (int8_t)stat;
+    bool reg = s_status.eps_stat == 1 || s_status.eps_stat == 5 ||
+               s_status.cs_stat == 1 || s_status.cs_stat == 5;
+    s_status.reg_ms = millis();
+    if (reg) modem_noteRegistered();
+    if (reg != s_status.registered) s_status.op_ms = 0;   // operator may have changed
+    s_status.registered = reg;
+#if ENABLE_DEBUG
+    if (stat != s_lastRegStat) {
+        Serial.printf("[MODEM] %s registration %d -> %s\n", eps ? "EPS" : "CS", stat,
+                      reg ? "registered" : "not registered");
+    }
+#endif
+    s_lastRegStat = (int8_t)stat;
+}
+
+// Solicited "+CEREG: <n>,<stat>[,...]" (answer to "+CEREG?")
+static void modem_regLine(const char *line, void *) {
+    int n, stat;
+    const char *colon = strchr(line, ':');
+    if (colon && sscanf(colon + 1, "%d,%d", &n, &stat) == 2) {
+        modem_setReg(line[2] == 'E', stat);
+    }
+}
+
+// Unsolicited "+CEREG: <stat>[,<tac>,...]" / "+CREG: <stat>[,...]"
+static void modem_regUrc(const char *line, uint32_t, void *) {
+    const char *colon = strchr(line, ':');
+    if (colon) modem_setReg(line[2] == 'E', atoi(colon + 1));
+}
+
+// +CSQ: 21,99
+static void modem_csqLine(const char *line, void *) {
+    int csq, ber;
+    if (sscanf(line + 5, "%d,%d", &csq, &ber) < 1) return;
+    s_status.csq = (int16_t)csq;
+    s_status.rssi_dbm = (csq >= 0 && csq <= 31) ? (int16_t)(-113 + 2 * csq) : 0;
+    s_status.csq_ms = millis();
+}
+
+// +COPS: 0,0,"COSMOTE",7
+static void modem_copsLine(const char *line, void *) {
+    const char *q = strchr(line, '"');
+    const char *e = q ? strchr(q + 1, '"') : nullptr;
+    size_t n = e ? (size_t)(e - q - 1) : 0;
+    if (n >= sizeof(s_status.op)) n = sizeof(s_status.op) - 1;
+    if (n) memcpy(s_status.op, q + 1, n);
+    s_status.op[n] = '\0';
+    s_status.op_ms = millis();
+}
+
+static void modem_refreshStatus() {
+    static uint32_t last = 0;
+    static uint32_t wakes = 0;
+    static bool eps = true;
+    if (s_boot.pwr_seq == -2) return;
+    uint32_t now = millis();
+    if (modemPower_wakeCount() != wakes) {
+        wakes = modemPower_wakeCount();
+        last = 0;                                   // slept: everything may have changed
+    }
+    if (!s_status.registered) {
+        // not (yet) registered: ask often, LTE then 2G/3G
+        if (last && now - last < MODEM_REG_PROBE_MS) return;
+        last = now;
+        at_submit(eps ? "+CEREG?" : "+CREG?", 1000, modem_regLine);
+        eps = !eps;
+        return;
+    }
+    if (last && now - last < MODEM_STATUS_TTL_MS) return;
+    if (last && modemPower_sleepPending()) return;  // URCs keep registration current
+    last = now;
+    at_submit("+CSQ", 1000, modem_csqLine);
+    at_submit("+CEREG?", 1000, modem_regLine);     // in case a URC got lost
+    if (!s_status.op_ms || now - s_status.op_ms > MODEM_OPERATOR_TTL_MS) {
+        at_submit("+COPS?", 3000, modem_copsLine);
+    }
+}
+
+const ModemStatus &modem_status() { return s_status; }
+
+uint32_t modem_statusAge(uint32_t updated_ms) {
+    return updated_ms ? millis() - updated_ms : 0xFFFFFFFFUL;
+}
+
+bool modem_isNetworkRegistered()
+{
+    return s_status.registered;
+}
+
+// CSQ 0-31 (99 = unknown), as TinyGSM's getSignalQuality() returned it
 int16_t modem_getRSSI()
 {
-    TinyGsm &modem = modem_get();
-    // TinyGsm returns signal quality (0-31 or 99); return as int16_t
-    return modem.getSignalQuality();
+    return s_status.csq;
 }
 
-// ---------------------------------------------------------
-// ---------------------------------------------------------
-// Operator name
-// ---------------------------------------------------------
 String modem_getOperator() {
-    TinyGsm &modem = modem_get();
-    return modem_isNetworkRegistered() ? modem.getOperator() : String("No Net");
+    if (!s_status.registered) return String("No Net");
+    return s_status.op[0] ? String(s_status.op) : String("?");
 }
 
 // ---------------------------------------------------------
@@ -227,24 +403,103 @@ bool modem_enableGPS(bool enable) {
     }
 }
 
-bool modem_getGPS(double &lat, double &lon) {
-    TinyGsm &modem = modem_get();
-    
-    // Simple check to see if modem is responsive first?
-    // No, that adds more delay.
-    
-    float fLat = 0, fLon = 0;
-    uint8_t status = 0;
-    float speed=0, alt=0, accuracy=0;
-    int vsat=0, usat=0, year=0, month=0, day=0, hour=0, min=0, sec=0;
-    
-    // This call can block for up to 2s (default TinyGSM timeout)
-    // We can't easily interrupt it.
-    bool ok = modem.getGPS(&status, &fLat, &fLon, &speed, &alt, &vsat, &usat, &accuracy, &year, &month, &day, &hour, &min, &sec);
-    
-    if (ok) {
-        lat = (double)fLat;
-        lon = (double)fLon;
-    }
-    return ok;
-}
\ No newline at end of file
+// Ask for a +CGNSSINFO report every interval_s seconds; the reports are
+// routed to gnss.h by the AT engine. interval_s = 0 stops them.
+bool modem_setGnssReports(uint8_t interval_s) {
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "+CGNSSINFO=%u", (unsigned)interval_s);
+    return at_command(cmd, 1000) == AT_OK;
+}
+
+// Re-arm the periodic reports if they stopped (modem restart, CGNSSPWR
+// lost). Rate-limited; only sends a short AT command.
+void modem_serviceGnss() {
+    static uint32_t lastRearm = 0;
+    uint32_t now = millis();
+    uint32_t expect = (uint32_t)GNSS_REPORT_INTERVAL_S * 1000UL;
+    if (gnss_reportAgeMs(now) < 3 * expect + 2000) return;
+    if (lastRearm && now - lastRearm < GNSS_REARM_MS) return;
+    lastRearm = now;
+#if ENABLE_DEBUG
+    Serial.println(F("[GNSS] no position reports, re-arming +CGNSSINFO"));
+#endif
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "+CGNSSINFO=%u", (unsigned)GNSS_REPORT_INTERVAL_S);
+    at_submit(cmd, 1000);
+}
+
+// ---------------------------------------------------------
+// AT engine service (loop task)
+// ---------------------------------------------------------
+bool modem_service(uint32_t ms_until_send) {
+    at_poll();
+    modemPower_service(ms_until_send);
+    if (!modemPower_isAwake()) return !at_held() && (at_busy() || at_queued() > 0);
+    modem_refreshStatus();
+    modem_serviceGnss();
+    pdp_service();
+    return at_busy() || at_queued() > 0;
+}
+
+// ---------------------------------------------------------
+// Power saving (modem_power.h)
+// ---------------------------------------------------------
+static uint32_t mpwr_io_now() { return millis(); }
+static void     mpwr_io_idle() { delay(1); }
+
+// Short PWRKEY pulse: wakes the modem from PSM, far too short to switch it off.
+static void mpwr_io_pwrkey(uint32_t hold_ms) {
+    modem_pwrIdle(false);
+    delay(hold_ms);
+    modem_pwrIdle(true);
+}
+
+// GNSS keeps the modem out of PSM: off before sleeping, back on after.
+static void mpwr_io_beforeSleep() {
+    at_submit("+CGNSSINFO=0", 1000);
+    at_submit("+CGNSSPWR=0", 2000);
+}
+
+static void mpwr_io_afterWake() {
+    char cmd[24];
+    at_submit("+CGNSSPWR=1", 2000);
+    snprintf(cmd, sizeof(cmd), "+CGNSSINFO=%u", (unsigned)GNSS_REPORT_INTERVAL_S);
+    at_submit(cmd, 1000);
+}
+
+static void modem_powerBegin() {
+    ModemPowerIo io = { mpwr_io_now, mpwr_io_pwrkey, mpwr_io_beforeSleep, mpwr_io_afterWake, mpwr_io_idle };
+    ModemPowerConfig cfg = {
+        MODEM_PSM_ENABLE != 0,
+        MODEM_PSM_TAU_S,
+        MODEM_PSM_ACTIVE_S,
+        MODEM_EDRX_MS,
+        MODEM_PSM_MIN_SLEEP_MS,
+        MODEM_PSM_WAKE_LEAD_MS,
+        MODEM_PSM_IDLE_MS,
+        MODEM_PSM_WAKE_PULSE_MS,
+        MODEM_PSM_WAKE_TRIES,
+    };
+    modemPower_init(io, cfg);
+}
+
+// ---------------------------------------------------------
+// LTE data session (pdp_session.h)
+// ---------------------------------------------------------
+static uint32_t pdp_io_now() { return millis(); }
+static bool     pdp_io_registered() { return s_status.registered; }
+static uint32_t pdp_io_random() { return esp_random(); }
+
+static void modem_pdpBegin() {
+    PdpIo io = { pdp_io_now, pdp_io_registered, pdp_io_random };
+    PdpConfig cfg = {
+        MODEM_APN,
+        MODEM_GPRS_USER,
+        MODEM_GPRS_PASS,
+        PDP_ATTACH_TIMEOUT_MS,
+        PDP_BACKOFF_MIN_MS,
+        PDP_BACKOFF_MAX_MS,
+        PDP_BACKOFF_JITTER_PCT,
+    };
+    pdp_init(io, cfg);
+}
@@ -8,7 +8,7 @@
 // ---------------------------------------------------------------------
 #define TINY_GSM_MODEM_A7670        // <-- required for A7670 modules
 //#define TINY_GSM_MODEM_SIM7600      // Use SIM7600 to enable TinyGsmClientSecure (A7670 is compatible)
-#define TINY_GSM_RX_BUFFER   512
+#define TINY_GSM_RX_BUFFER   1024       // per-socket FIFO; one CIPRXGET chunk fits whole
 
 #include <TinyGsmClient.h>
 
@@ -18,17 +18,62 @@ TinyGsm& modem_get();
 // ---------------------------------------------------------------------
 // Public API
 // ---------------------------------------------------------------------
+// Status cache: these return the last known values at once and never
+// touch the UART. Kept fresh by +CREG/+CEREG URCs and a background
+// refresh in modem_service() (MODEM_STATUS_TTL_MS), which waits while
+// the modem is about to sleep in PSM and runs again after the wake.
+struct ModemStatus {
+    int8_t   eps_stat;      // +CEREG stat (1 home, 5 roaming), -1 unknown
+    int8_t   cs_stat;       // +CREG stat
+    bool     registered;    // either of them 1 or 5
+    int16_t  csq;           // 0..31, 99 unknown
+    int16_t  rssi_dbm;      // from csq, 0 unknown
+    char     op[24];        // operator, "" unknown
+    uint32_t reg_ms;        // millis() of the last update, 0 = never
+    uint32_t csq_ms;
+    uint32_t op_ms;
+};
+const ModemStatus &modem_status();
+uint32_t modem_statusAge(uint32_t updated_ms);   // ms since, 0xFFFFFFFF = never
+
 bool modem_isNetworkRegistered();
-int16_t modem_getRSSI();
+int16_t modem_getRSSI();          // CSQ 0..31 (99 = unknown)
 String modem_getOperator();
 
 void modemManager_init();
 
 // Hardware init helper (power/reset/pwrkey sequence)
+// Probes for a modem that is already on, then tries the PWRKEY sequence
+// that worked last time (NVS), then the others.
 void modem_hw_init();
 
+// Boot timing (millis() since ESP32 reset; 0 = not yet)
+struct ModemBootStats {
+  int8_t   pwr_seq;        // -1 already on, 0.. sequence used, -2 no answer
+  uint32_t powerup_ms;     // time spent in the power-up check
+  uint32_t at_ready_ms;    // modem answered AT
+  uint32_t registered_ms;  // first network registration
+};
+const ModemBootStats &modem_bootStats();
+
 // ---------------------------------------------------------------------
 // GPS API
 // ---------------------------------------------------------------------
+// Positions arrive as unsolicited +CGNSSINFO reports and are cached by
+// gnss.h; nothing here waits for a fix.
 bool modem_enableGPS(bool enable);
-bool modem_getGPS(double &lat, double &lon);
\ No newline at end of file
+bool modem_setGnssReports(uint8_t interval_s);
+void modem_serviceGnss();
+
+// ---------------------------------------------------------------------
+// AT engine
+// ---------------------------------------------------------------------
+// SerialAT is owned by at_engine.h; other modules queue commands and
+// subscribe to URCs there. modem_get() first lets the engine finish its
+// command in flight, so TinyGSM calls never interleave with it.
+// modem_service() runs the engine (loop task) and returns true while
+// commands are still pending. ms_until_send is the time to the next
+// scheduled upload: the power manager (modem_power.h) sleeps the modem in
+// PSM until shortly before it. The LTE data session (pdp_session.h) is
+// driven from here as well.
+bool modem_service(uint32_t ms_until_send = 0xFFFFFFFFUL);
@@ -0,0 +1,387 @@
+// modem_power.cpp
+// PSM / eDRX state machine on top of the AT engine (see modem_power.h).
+
+#include "modem_power.h"
+#include "at_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MPWR_DAY_MS          (24UL * 3600UL * 1000UL)
+#define MPWR_ENTER_MARGIN_MS 15000UL   // no "ENTER PSM" report: asleep after T3324 + this
+#define MPWR_PROBE_MS        2000UL    // AT answer after a wake pulse
+#define MPWR_MAX_SLEEP_MS    (7UL * MPWR_DAY_MS)
+
+static ModemPowerIo     s_io = {};
+static ModemPowerConfig s_cfg = {};
+static ModemPowerState  s_state = MPWR_AWAKE;
+static ModemPowerStats  s_stats = {};
+
+static uint32_t s_since = 0;          // entered the current state
+static uint32_t s_idleSince = 0;      // last AT traffic
+static uint32_t s_lastCmds = 0;       // at_stats().commands at the last look
+static uint32_t s_keepUntil = 0;      // modemPower_requestAwake()
+static uint32_t s_wakeAt = 0;         // planned end of the sleep
+static uint32_t s_noPsmUntil = 0;     // network refused PSM for this window
+static uint32_t s_acctLast = 0;
+static uint32_t s_dayStart = 0;
+static uint32_t s_wakeCount = 0;
+static uint32_t s_lastUntil = 0xFFFFFFFFUL;
+static uint8_t  s_pulses = 0;
+static uint8_t  s_holds = 0;          // modemPower_hold()
+static bool     s_probing = false;
+static bool     s_wakeOk = true;      // last wake got an AT answer
+static bool     s_configured = false; // CEREG=4 / CEDRXS / CPSMSTATUS sent
+static bool     s_enterDone = false;  // CPSMS + CEREG? answered
+static bool     s_psmEntered = false; // +CPSMSTATUS: "ENTER PSM"
+
+static uint32_t mpwr_now() { return s_io.now_ms(); }
+static bool mpwr_due(uint32_t t, uint32_t now) { return (int32_t)(now - t) >= 0; }
+
+// --- 3GPP encodings ---------------------------------------------------
+
+struct TimerUnit { uint8_t code; uint32_t seconds; };
+
+// GPRS Timer 3 (T3412 extended), smallest unit first
+static const TimerUnit kTimer3[] = {
+  { 3, 2 }, { 4, 30 }, { 5, 60 }, { 0, 600 }, { 1, 3600 }, { 2, 36000 }, { 6, 1152000 },
+};
+// GPRS Timer 2 (T3324)
+static const TimerUnit kTimer2[] = {
+  { 0, 2 }, { 1, 60 }, { 2, 360 },
+};
+
+// E-UTRAN eDRX cycle per 4-bit code (TS 24.008 table 10.5.5.32), ms
+static const uint32_t kEdrxMs[16] = {
+  5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+  143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760,
+};
+
+static void mpwr_bits(uint32_t v, int n, char *out) {
+  for (int i = 0; i < n; i++) out[i] = (v & (1u << (n - 1 - i))) ? '1' : '0';
+  out[n] = '\0';
+}
+
+static bool mpwr_parseBits(const char *bits, int n, uint32_t &v) {
+  v = 0;
+  for (int i = 0; i < n; i++) {
+    if (bits[i] != '0' && bits[i] != '1') return false;
+    v = (v << 1) | (uint32_t)(bits[i] - '0');
+  }
+  return true;
+}
+
+static void mpwr_encodeTimer(const TimerUnit *units, int count, uint32_t s, char out[9]) {
+  for (int i = 0; i < count; i++) {
+    uint32_t v = (s + units[i].seconds - 1) / units[i].seconds;
+    if (v <= 31) {
+      mpwr_bits(((uint32_t)units[i].code << 5) | v, 8, out);
+      return;
+    }
+  }
+  mpwr_bits(((uint32_t)units[count - 1].code << 5) | 31, 8, out);   // longest there is
+}
+
+static uint32_t mpwr_decodeTimer(const TimerUnit *units, int count, const char *bits) {
+  uint32_t v;
+  if (!bits || !mpwr_parseBits(bits, 8, v)) return 0;
+  uint8_t code = (uint8_t)(v >> 5);
+  for (int i = 0; i < count; i++) {
+    if (units[i].code == code) return units[i].seconds * (v & 31);
+  }
+  return 0;   // 111 = deactivated
+}
+
+void modemPower_encodeTau(uint32_t s, char out[9]) {
+  mpwr_encodeTimer(kTimer3, sizeof(kTimer3) / sizeof(kTimer3[0]), s, out);
+}
+void modemPower_encodeActive(uint32_t s, char out[9]) {
+  mpwr_encodeTimer(kTimer2, sizeof(kTimer2) / sizeof(kTimer2[0]), s, out);
+}
+uint32_t modemPower_decodeTau(const char *bits) {
+  return mpwr_decodeTimer(kTimer3, sizeof(kTimer3) / sizeof(kTimer3[0]), bits);
+}
+uint32_t modemPower_decodeActive(const char *bits) {
+  return mpwr_decodeTimer(kTimer2, sizeof(kTimer2) / sizeof(kTimer2[0]), bits);
+}
+
+void modemPower_encodeEdrx(uint32_t ms, char out[5]) {
+  uint32_t code = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    if (kEdrxMs[i] <= ms && kEdrxMs[i] >= kEdrxMs[code]) code = i;
+  }
+  mpwr_bits(code, 4, out);
+}
+
+uint32_t modemPower_decodeEdrx(const char *bits) {
+  uint32_t v;
+  if (!bits || !mpwr_parseBits(bits, 4, v)) return 0;
+  return kEdrxMs[v];
+}
+
+// --- AT callbacks -----------------------------------------------------
+
+// Copy the quoted fields of a response line ("a","b",...) into q[].
+static int mpwr_quoted(const char *line, char q[][12], int max) {
+  int n = 0;
+  const char *p = line;
+  while (n < max && (p = strchr(p, '"')) != nullptr) {
+    const char *e = strchr(++p, '"');
+    if (!e) break;
+    size_t len = (size_t)(e - p) < 11 ? (size_t)(e - p) : 11;
+    memcpy(q[n], p, len);
+    q[n][len] = '\0';
+    n++;
+    p = e + 1;
+  }
+  return n;
+}
+
+// +CEREG: 4,1,"1A2B","01A2B3C4",7,,,"00100001","00000110"
+// The last two quoted fields (when present) are the granted T3324 / T3412.
+static void mpwr_ceregLine(const char *line, void *) {
+  char q[6][12];
+  int n = mpwr_quoted(line, q, 6);
+  if (n >= 4 && strlen(q[n - 2]) == 8 && strlen(q[n - 1]) == 8) {
+    s_stats.active_s = modemPower_decodeActive(q[n - 2]);
+    s_stats.tau_s = modemPower_decodeTau(q[n - 1]);
+  } else {
+    s_stats.active_s = 0;
+    s_stats.tau_s = 0;
+  }
+}
+
+// +CEDRXRDP: 4,"0101","0101","0011" -> requested, network-provided, PTW
+static void mpwr_edrxLine(const char *line, void *) {
+  char q[3][12];
+  int n = mpwr_quoted(line, q, 3);
+  s_stats.edrx_ms = (n >= 2) ? modemPower_decodeEdrx(q[1]) : 0;
+}
+
+static void mpwr_enterDone(AtResult, const char *, void *) {
+  s_enterDone = true;
+}
+
+static void mpwr_probeDone(AtResult res, const char *, void *) {
+  s_probing = false;
+  if (res != AT_OK || s_state != MPWR_WAKING) return;
+  // Up. PSM off first (ahead of what queued up while asleep), so the
+  // modem does not drop back into PSM while we still use it.
+  at_submitUrgent("+CPSMS=0", 2000);
+  at_hold(false);
+  s_state = MPWR_AWAKE;
+  s_since = s_idleSince = mpwr_now();
+  s_stats.wakes++;
+  s_wakeCount++;
+  s_wakeOk = true;
+  if (s_io.after_wake) s_io.after_wake();
+}
+
+// +CPSMSTATUS: "ENTER PSM" / "EXIT PSM"
+static void mpwr_psmUrc(const char *line, uint32_t, void *) {
+  if (strstr(line, "ENTER")) s_psmEntered = true;
+}
+
+// --- state machine ----------------------------------------------------
+
+static void mpwr_account(uint32_t now) {
+  uint32_t dt = now - s_acctLast;
+  s_acctLast = now;
+  if (s_state == MPWR_ASLEEP) s_stats.asleep_ms_total += dt;
+  else s_stats.awake_ms_today += dt;
+  while (now - s_dayStart >= MPWR_DAY_MS) {
+    s_dayStart += MPWR_DAY_MS;
+    s_stats.awake_ms_yesterday = s_stats.awake_ms_today;
+    s_stats.awake_ms_today = 0;
+    s_stats.day++;
+  }
+}
+
+static void mpwr_onDemand() {
+  modemPower_wakeNow();
+  at_hold(false);     // even if the modem did not answer: let the caller fail normally
+}
+
+static void mpwr_setState(ModemPowerState st, uint32_t now) {
+  s_state = st;
+  s_since = now;
+}
+
+// Leave ENTERING before the modem actually slept (new work, PSM refused).
+static void mpwr_abortEnter(uint32_t now) {
+  at_submitUrgent("+CPSMS=0", 2000);
+  mpwr_setState(MPWR_AWAKE, now);
+  s_idleSince = now;
+  if (s_io.after_wake) s_io.after_wake();
+}
+
+static void mpwr_configure() {
+  s_configured = true;
+  at_submit("+CEREG=4", 1000);            // registration reports carry the PSM timers
+  at_submit("+CPSMSTATUS=1", 1000);       // "ENTER PSM" report (not on every firmware)
+  if (s_cfg.edrx_ms) {
+    char cmd[32], cyc[5];
+    modemPower_encodeEdrx(s_cfg.edrx_ms, cyc);
+    snprintf(cmd, sizeof(cmd), "+CEDRXS=1,4,\"%s\"", cyc);
+    at_submit(cmd, 2000);
+    at_submit("+CEDRXRDP", 2000, mpwr_edrxLine);
+  }
+}
+
+static void mpwr_enter(uint32_t now, uint32_t sleep_ms) {
+  char cmd[48], tau[9], act[9];
+  // TAU a little beyond the planned sleep: the modem should not have to
+  // come up on its own before we wake it.
+  uint32_t tau_s = sleep_ms / 1000UL + 60UL;
+  if (tau_s < s_cfg.tau_s) tau_s = s_cfg.tau_s;
+  modemPower_encodeTau(tau_s, tau);
+  modemPower_encodeActive(s_cfg.active_s, act);
+  snprintf(cmd, sizeof(cmd), "+CPSMS=1,,,\"%s\",\"%s\"", tau, act);
+
+  if (s_io.before_sleep) s_io.before_sleep();
+  s_enterDone = false;
+  s_psmEntered = false;
+  at_submit(cmd, 2000);
+  at_submit("+CEREG?", 2000, mpwr_ceregLine, mpwr_enterDone);
+  s_wakeAt = now + sleep_ms;
+  mpwr_setState(MPWR_ENTERING, now);
+}
+
+void modemPower_init(const ModemPowerIo &io, const ModemPowerConfig &cfg) {
+  static bool subscribed = false;
+  s_io = io;
+  s_cfg = cfg;
+  s_state = MPWR_AWAKE;
+  uint32_t now = mpwr_now();
+  s_since = s_idleSince = s_acctLast = s_dayStart = now;
+  s_keepUntil = now;
+  s_noPsmUntil = now;
+  if (!subscribed) {
+    subscribed = true;
+    at_subscribe("+CPSMSTATUS:", mpwr_psmUrc);
+  }
+}
+
+void modemPower_service(uint32_t ms_until_send) {
+  if (!s_io.now_ms) return;
+  uint32_t now = mpwr_now();
+  mpwr_account(now);
+  s_lastUntil = ms_until_send;
+
+  uint32_t cmds = at_stats().commands;
+  bool traffic = at_busy() || at_queued() > 0 || cmds != s_lastCmds;
+  s_lastCmds = cmds;
+
+  switch (s_state) {
+  case MPWR_AWAKE: {
+    if (traffic) s_idleSince = now;
+    if (!s_cfg.enabled) return;
+    if (now - s_idleSince < s_cfg.idle_ms || !mpwr_due(s_keepUntil, now)) return;
+    if (s_holds) return;                            // a socket is open
+    if (!mpwr_due(s_noPsmUntil, now)) return;
+    if (!s_configured) { mpwr_configure(); return; }
+    if (ms_until_send <= s_cfg.wake_lead_ms) return;
+    uint32_t sleep_ms = ms_until_send - s_cfg.wake_lead_ms;
+    if (sleep_ms > MPWR_MAX_SLEEP_MS) sleep_ms = MPWR_MAX_SLEEP_MS;
+    if (sleep_ms < s_cfg.min_sleep_ms) return;
+    mpwr_enter(now, sleep_ms);
+    return;
+  }
+
+  case MPWR_ENTERING:
+    if (!s_enterDone) return;                       // our CPSMS / CEREG? still running
+    if (s_stats.active_s == 0 && s_stats.tau_s == 0) {
+      // PSM not granted: stay up (eDRX still applies) until this window is over
+      s_noPsmUntil = s_wakeAt;
+      mpwr_abortEnter(now);
+      return;
+    }
+    if (at_busy() || at_queued() > 0 || !mpwr_due(s_keepUntil, now) || s_holds) {
+      mpwr_abortEnter(now);                         // somebody needs the modem
+      return;
+    }
+    if (s_psmEntered || now - s_since >= s_stats.active_s * 1000UL + MPWR_ENTER_MARGIN_MS) {
+      at_hold(true, mpwr_onDemand);
+      mpwr_account(now);
+      mpwr_setState(MPWR_ASLEEP, now);
+      s_stats.sleeps++;
+    }
+    return;
+
+  case MPWR_ASLEEP:
+    if (mpwr_due(s_wakeAt, now) || at_queued() > 0 || !mpwr_due(s_keepUntil, now) || s_holds) {
+      s_pulses = 0;
+      s_probing = false;
+      mpwr_account(now);
+      mpwr_setState(MPWR_WAKING, now);
+    }
+    return;
+
+  case MPWR_WAKING:
+    if (s_probing) return;
+    if (s_pulses >= s_cfg.wake_tries) {
+      // no answer: release everything so callers see their own errors
+      s_stats.wake_failures++;
+      s_wakeOk = false;
+      at_hold(false);
+      mpwr_setState(MPWR_AWAKE, now);
+      s_idleSince = now;
+      s_keepUntil = now + s_cfg.idle_ms;
+      return;
+    }
+    s_pulses++;
+    s_io.pwrkey(s_cfg.wake_pulse_ms);
+    s_probing = at_submitUrgent("", MPWR_PROBE_MS, nullptr, mpwr_probeDone);
+    return;
+  }
+}
+
+void modemPower_requestAwake() {
+  if (!s_io.now_ms) return;
+  s_keepUntil = mpwr_now() + s_cfg.idle_ms;
+}
+
+void modemPower_hold(bool on) {
+  if (on) s_holds++;
+  else if (s_holds) s_holds--;
+}
+
+bool modemPower_wakeNow() {
+  if (!s_io.now_ms) return true;
+  if (s_state == MPWR_AWAKE) return true;
+  modemPower_requestAwake();
+  if (s_state == MPWR_ENTERING) {
+    mpwr_abortEnter(mpwr_now());
+    return true;
+  }
+  while (s_state != MPWR_AWAKE) {
+    modemPower_service(s_lastUntil);
+    at_poll();
+    if (s_state != MPWR_AWAKE && s_io.idle) s_io.idle();
+  }
+  return s_wakeOk;
+}
+
+bool     modemPower_isAwake()   { return s_state == MPWR_AWAKE; }
+
+bool modemPower_sleepPending() {
+  if (s_state != MPWR_AWAKE || !s_cfg.enabled || !s_io.now_ms) return false;
+  uint32_t now = mpwr_now();
+  if (!mpwr_due(s_keepUntil, now) || !mpwr_due(s_noPsmUntil, now)) return false;
+  if (s_lastUntil <= s_cfg.wake_lead_ms) return false;
+  uint32_t sleep_ms = s_lastUntil - s_cfg.wake_lead_ms;
+  return sleep_ms >= s_cfg.min_sleep_ms;
+}
+uint32_t modemPower_wakeCount() { return s_wakeCount; }
+ModemPowerState modemPower_state() { return s_state; }
+const ModemPowerStats &modemPower_stats() { return s_stats; }
+
+const char *modemPower_stateName(ModemPowerState s) {
+  switch (s) {
+  case MPWR_AWAKE:    return "awake";
+  case MPWR_ENTERING: return "entering PSM";
+  case MPWR_ASLEEP:   return "asleep (PSM)";
+  case MPWR_WAKING:   return "waking";
+  }
+  return "?";
+}
@@ -0,0 +1,106 @@
+#ifndef MODEM_POWER_H
+#define MODEM_POWER_H
+
+#include <stdint.h>
+
+// modem_power.h : PSM / eDRX power manager for the A7670.
+//
+// Between upload windows the modem does not need to be reachable, so it
+// is put into Power Saving Mode (3GPP PSM): the timers are negotiated with
+// the network (AT+CPSMS, granted values read back from AT+CEREG=4), GNSS is
+// stopped, and the modem drops into PSM once the active time (T3324)
+// runs out. While it sleeps the AT engine is held (at_hold), so nothing
+// is sent to a modem that cannot answer. It is woken with a short PWRKEY
+// pulse
+//   - wake_lead_ms before the next scheduled send,
+//   - when commands queue up (SMS outbox, a scan),
+//   - on demand by a blocking caller (at_command(), modem_get()).
+// Awake time is accounted per 24 h of uptime.
+//
+// eDRX (AT+CEDRXS) is requested too: it stretches the paging cycle while
+// the modem is idle but awake, and is what remains when the network does
+// not grant PSM (the modem then simply stays up).
+//
+// No Arduino dependency: the modem is reached through the AT engine and
+// the pin / clock through ModemPowerIo, so the state machine runs on a PC
+// against a simulated modem.
+
+struct ModemPowerIo {
+  uint32_t (*now_ms)();
+  void     (*pwrkey)(uint32_t hold_ms);   // PWRKEY low for hold_ms (wakes from PSM)
+  void     (*before_sleep)();             // queue GNSS off etc. (may be null)
+  void     (*after_wake)();               // queue GNSS on etc. (may be null)
+  void     (*idle)();                     // while blocking in modemPower_wakeNow() (may be null)
+};
+
+struct ModemPowerConfig {
+  bool     enabled;
+  uint32_t tau_s;              // requested periodic TAU (T3412 extended)
+  uint32_t active_s;           // requested active time (T3324)
+  uint32_t edrx_ms;            // requested eDRX cycle, 0 = do not ask
+  uint32_t min_sleep_ms;       // shorter gaps are not worth a sleep
+  uint32_t wake_lead_ms;       // awake this long before a scheduled send
+  uint32_t idle_ms;            // no AT traffic this long before sleeping
+  uint32_t wake_pulse_ms;      // PWRKEY pulse length (well below power-off)
+  uint8_t  wake_tries;         // pulses before giving up
+};
+
+enum ModemPowerState : uint8_t {
+  MPWR_AWAKE = 0,
+  MPWR_ENTERING,    // PSM requested, waiting for the active time to run out
+  MPWR_ASLEEP,
+  MPWR_WAKING,      // pulsed, probing with AT
+};
+
+struct ModemPowerStats {
+  uint32_t sleeps;
+  uint32_t wakes;
+  uint32_t wake_failures;       // no AT answer after wake_tries pulses
+  uint32_t awake_ms_today;      // current 24 h window of uptime
+  uint32_t awake_ms_yesterday;  // previous window (0 until one is complete)
+  uint32_t asleep_ms_total;
+  uint32_t day;                 // number of completed 24 h windows
+  // granted by the network (0 = not granted / not known yet)
+  uint32_t tau_s;
+  uint32_t active_s;
+  uint32_t edrx_ms;
+};
+
+void modemPower_init(const ModemPowerIo &io, const ModemPowerConfig &cfg);
+
+// Run the state machine (loop task). ms_until_send: time to the next
+// scheduled use of the modem (UINT32_MAX = none).
+void modemPower_service(uint32_t ms_until_send);
+
+// Keep the modem up for at least idle_ms from now; wakes it if asleep.
+void modemPower_requestAwake();
+
+// Keep the modem out of PSM while a socket is open on it (a sleep would
+// drop the connection under its owner). Counted: every hold(true) needs
+// its hold(false).
+void modemPower_hold(bool on);
+
+// Blocking wake (pulse + probe). Returns true if the modem answers.
+bool modemPower_wakeNow();
+
+bool     modemPower_isAwake();          // AWAKE: AT commands are answered
+// Awake, counting down idle_ms to a sleep that would be taken. Every AT
+// command restarts that countdown, so background polling (status cache)
+// waits while this is true and catches up after the next wake. Holds are
+// not considered: their owners can close their sockets on it.
+bool     modemPower_sleepPending();
+uint32_t modemPower_wakeCount();        // increments on every wake
+ModemPowerState modemPower_state();
+const char *modemPower_stateName(ModemPowerState s);
+const ModemPowerStats &modemPower_stats();
+
+// 3GPP TS 24.008 timer / cycle encodings used by AT+CPSMS / AT+CEDRXS.
+// Encoders round up to the next representable value (eDRX: down).
+void     modemPower_encodeTau(uint32_t s, char out[9]);     // GPRS Timer 3 (T3412 ext)
+void     modemPower_encodeActive(uint32_t s, char out[9]);  // GPRS Timer 2 (T3324)
+uint32_t modemPower_decodeTau(const char *bits);            // seconds, 0 = deactivated
+uint32_t modemPower_decodeActive(const char *bits);
+void     modemPower_encodeEdrx(uint32_t ms, char out[5]);
+uint32_t modemPower_decodeEdrx(const char *bits);           // ms
+
+#endif // MODEM_POWER_H
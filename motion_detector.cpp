@@ -0,0 +1,141 @@
+// motion_detector.cpp
+// Streaming motion detector (see motion_detector.h).
+
+#include "motion_detector.h"
+#include <math.h>
+#include <string.h>
+
+#define MOTION_HOUR_MS 3600000UL
+
+static uint64_t windowMask(uint8_t n) {
+  if (n == 0) n = 1;
+  if (n >= 64) return ~0ULL;
+  return (1ULL << n) - 1ULL;
+}
+
+static void enterState(MotionDetector &d, MotionState s, uint32_t t_ms) {
+  d.state = s;
+  d.state_since_ms = t_ms;
+}
+
+void motion_init(MotionDetector &d, const MotionConfig &cfg, uint32_t now_ms) {
+  memset(&d, 0, sizeof(d));
+  d.cfg = cfg;
+  if (d.cfg.window_samples == 0 || d.cfg.window_samples > 64) d.cfg.window_samples = 64;
+  if (d.cfg.debounce_samples == 0) d.cfg.debounce_samples = 1;
+  if (d.cfg.debounce_samples > d.cfg.window_samples) d.cfg.debounce_samples = d.cfg.window_samples;
+  d.armed_request = true;
+  d.hour_start_ms = now_ms;
+  enterState(d, MOTION_SETTLING, now_ms);
+}
+
+void motion_setArmed(MotionDetector &d, bool armed, uint32_t now_ms) {
+  d.armed_request = armed;
+  d.window = 0;
+  // re-learn the rest position before arming again (the hive may have been moved)
+  enterState(d, armed ? MOTION_SETTLING : MOTION_DISARMED, now_ms);
+}
+
+// Signed: samples drained after motion_trigger() may be older than it.
+static void hourRoll(MotionDetector &d, uint32_t t_ms) {
+  if ((int32_t)(t_ms - d.hour_start_ms) >= (int32_t)MOTION_HOUR_MS) {
+    d.hour_start_ms = t_ms;
+    d.hour_alarms = 0;
+  }
+}
+
+// ARMED -> TRIGGERED: one alarm, unless the hourly cap is reached
+static MotionEvent raiseAlarm(MotionDetector &d, float dev, uint32_t t_ms) {
+  enterState(d, MOTION_TRIGGERED, t_ms);
+  d.peak_dev = dev;
+  if (d.hour_alarms < d.cfg.max_alarms_per_hour) {
+    d.hour_alarms++;
+    d.alarms++;
+    return MOTION_EVT_ALARM;
+  }
+  d.suppressed++;
+  return MOTION_EVT_SUPPRESSED;
+}
+
+MotionEvent motion_update(MotionDetector &d, float x, float y, float z, uint32_t t_ms) {
+  d.samples++;
+
+  if (!d.have_baseline) {
+    d.gx = x; d.gy = y; d.gz = z;
+    d.have_baseline = true;
+  }
+
+  float dx = x - d.gx, dy = y - d.gy, dz = z - d.gz;
+  float dev = sqrtf(dx * dx + dy * dy + dz * dz);
+  bool over = dev > d.cfg.threshold;
+  d.last_dev = dev;
+  if (over) d.last_over_ms = t_ms;
+
+  d.window = ((d.window << 1) | (over ? 1ULL : 0ULL)) & windowMask(d.cfg.window_samples);
+  int hits = __builtin_popcountll(d.window);
+
+  // Baseline follows slow changes (temperature drift, a new rest position).
+  // While armed it is frozen on over-threshold samples so the onset of a
+  // disturbance is not absorbed before the debounce decides.
+  if (!(d.state == MOTION_ARMED && over)) {
+    float a = d.cfg.baseline_alpha;
+    d.gx += a * (x - d.gx);
+    d.gy += a * (y - d.gy);
+    d.gz += a * (z - d.gz);
+  }
+
+  hourRoll(d, t_ms);
+
+  switch (d.state) {
+    case MOTION_DISARMED:
+      return MOTION_EVT_NONE;
+
+    case MOTION_SETTLING:
+      if (t_ms - d.state_since_ms >= d.cfg.settle_ms) {
+        d.window = 0;
+        enterState(d, MOTION_ARMED, t_ms);
+      }
+      return MOTION_EVT_NONE;
+
+    case MOTION_ARMED:
+      if (hits < d.cfg.debounce_samples) return MOTION_EVT_NONE;
+      return raiseAlarm(d, dev, t_ms);
+
+    case MOTION_TRIGGERED:
+      if (dev > d.peak_dev) d.peak_dev = dev;
+      if (hits == 0) {
+        enterState(d, MOTION_COOLDOWN, t_ms);
+        return MOTION_EVT_QUIET;
+      }
+      return MOTION_EVT_NONE;
+
+    case MOTION_COOLDOWN:
+      // new activity during cooldown belongs to the same disturbance
+      if (hits >= d.cfg.debounce_samples) {
+        enterState(d, MOTION_TRIGGERED, t_ms);
+      } else if (t_ms - d.state_since_ms >= d.cfg.cooldown_ms) {
+        enterState(d, MOTION_ARMED, t_ms);
+      }
+      return MOTION_EVT_NONE;
+  }
+  return MOTION_EVT_NONE;
+}
+
+MotionEvent motion_trigger(MotionDetector &d, uint32_t t_ms) {
+  if (d.state != MOTION_ARMED) return MOTION_EVT_NONE;
+  hourRoll(d, t_ms);
+  // the samples that follow decide when the disturbance is over
+  d.window = 0;
+  return raiseAlarm(d, 0.0f, t_ms);
+}
+
+const char *motion_stateName(MotionState s) {
+  switch (s) {
+    case MOTION_SETTLING:  return "SETTLING";
+    case MOTION_ARMED:     return "ARMED";
+    case MOTION_TRIGGERED: return "TRIGGERED";
+    case MOTION_COOLDOWN:  return "COOLDOWN";
+    case MOTION_DISARMED:  return "DISARMED";
+  }
+  return "?";
+}
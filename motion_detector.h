@@ -0,0 +1,69 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <stdint.h>
+
+// motion_detector.h : streaming hive-motion detector.
+//
+// Keeps an EWMA gravity baseline and measures the vector deviation
+// |a - g| of each sample from it. An alarm needs `debounce_samples` samples
+// over threshold within the last `window_samples` samples; after that the
+// detector stays TRIGGERED for as long as the disturbance lasts and then
+// sits in COOLDOWN, so one disturbance produces one alarm. A per-hour cap
+// limits alarms further.
+//
+// Plain C++, no allocation: all state lives in the MotionDetector struct.
+
+enum MotionState : uint8_t {
+  MOTION_SETTLING = 0,   // learning the baseline after init / re-arm
+  MOTION_ARMED,
+  MOTION_TRIGGERED,
+  MOTION_COOLDOWN,
+  MOTION_DISARMED
+};
+
+enum MotionEvent : uint8_t {
+  MOTION_EVT_NONE = 0,
+  MOTION_EVT_ALARM,        // raise an alarm now
+  MOTION_EVT_SUPPRESSED,   // would have alarmed, but the hourly cap is reached
+  MOTION_EVT_QUIET         // disturbance over (TRIGGERED -> COOLDOWN)
+};
+
+struct MotionConfig {
+  float    threshold;         // m/s^2 deviation from baseline
+  float    baseline_alpha;    // EWMA weight per sample
+  uint8_t  debounce_samples;  // samples over threshold needed ...
+  uint8_t  window_samples;    // ... within this many samples (<= 64)
+  uint32_t cooldown_ms;       // quiet time after a disturbance before re-arming
+  uint32_t settle_ms;         // baseline learning time before arming
+  uint8_t  max_alarms_per_hour;
+};
+
+struct MotionDetector {
+  MotionConfig cfg;
+  MotionState  state;
+  bool     armed_request;     // false = user disarmed
+  bool     have_baseline;
+  float    gx, gy, gz;        // gravity baseline
+  uint64_t window;            // 1 bit per recent sample, 1 = over threshold
+  uint32_t state_since_ms;
+  uint32_t last_over_ms;
+  float    last_dev;
+  float    peak_dev;          // largest deviation of the current/last disturbance
+  uint32_t hour_start_ms;
+  uint8_t  hour_alarms;
+  uint32_t alarms;            // totals since init
+  uint32_t suppressed;
+  uint32_t samples;
+};
+
+void motion_init(MotionDetector &d, const MotionConfig &cfg, uint32_t now_ms);
+MotionEvent motion_update(MotionDetector &d, float x, float y, float z, uint32_t t_ms);
+// Disturbance known without its samples (e.g. a motion interrupt whose
+// samples were dropped): alarms like a detected one, hourly cap and
+// cooldown included, if the detector is ARMED.
+MotionEvent motion_trigger(MotionDetector &d, uint32_t t_ms);
+void motion_setArmed(MotionDetector &d, bool armed, uint32_t now_ms);
+const char *motion_stateName(MotionState s);
+
+#endif // MOTION_DETECTOR_H
@@ -0,0 +1,180 @@
+#include "mqtt_client.h"
+#include "mqtt_session.h"
+#include "config.h"
+#include "modem_manager.h"
+#include "modem_power.h"
+#include "pdp_session.h"
+#include <WiFi.h>
+#include <WebServer.h>
+
+extern WebServer server;
+extern void menuUpdate(); // Keep keyboard responsive
+
+static WiFiClient     s_wifi;
+static TinyGsmClient *s_gsm = nullptr;      // created on first use (owns MQTT_MUX)
+static Client        *s_net = nullptr;      // bearer of the session
+static bool           s_inited = false;
+static char           s_id[24];
+static char           s_topic[80];
+static bool           s_modemHeld = false;  // open on the modem: PSM held off
+
+// The bearer for one socket operation. On the modem that goes through
+// modem_get() (PSM wake, AT engine settled), like every TinyGSM call.
+static Client *mq_net() {
+  if (s_net && s_net == s_gsm) modem_get();
+  return s_net;
+}
+
+static void mq_holdModem(bool on) {
+  if (on == s_modemHeld) return;
+  s_modemHeld = on;
+  modemPower_hold(on);
+}
+
+static uint32_t mq_now() { return millis(); }
+
+static bool mq_open(const char *host, uint16_t port) {
+  Client *net = mq_net();
+  bool ok = net && net->connect(host, port);
+  if (ok && net == s_gsm) mq_holdModem(true);
+  return ok;
+}
+
+static bool mq_isOpen() {
+  Client *net = mq_net();
+  return net && net->connected();
+}
+
+static size_t mq_write(const uint8_t *buf, size_t len) {
+  Client *net = mq_net();
+  return net ? net->write(buf, len) : 0;
+}
+
+static int mq_read(uint8_t *buf, size_t cap) {
+  Client *net = mq_net();
+  if (!net) return 0;
+  int n = net->available();
+  if (n <= 0) return 0;
+  return net->read(buf, (size_t)n < cap ? n : cap);
+}
+
+static void mq_close() {
+  Client *net = mq_net();
+  if (net) net->stop();
+  mq_holdModem(false);
+}
+
+// Runs while waiting for CONNACK / PUBACK
+static void mq_idle() {
+  server.handleClient();  // Keep web server responsive
+  menuUpdate();           // Keep keyboard responsive!
+}
+
+// Client id from the MAC: stable, so the broker finds our session again
+static void mq_init() {
+  if (s_inited) return;
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(s_id, sizeof(s_id), "beehive-%06lx", (unsigned long)((mac >> 24) & 0xFFFFFF));
+  snprintf(s_topic, sizeof(s_topic), "%s/%s/telemetry", MQTT_TOPIC_PREFIX, s_id);
+  MqttIo io = { mq_now, mq_open, mq_isOpen, mq_write, mq_read, mq_close, mq_idle };
+  MqttConfig cfg = { MQTT_HOST, MQTT_PORT, s_id, MQTT_USER, MQTT_PASS,
+                     MQTT_KEEPALIVE_S, MQTT_ACK_TIMEOUT_MS };
+  mqtt_init(io, cfg);
+  s_inited = true;
+}
+
+// Session on the bearer the sink layer picked; moving from one to the
+// other reconnects (the broker still has the session).
+static bool mq_use(const HttpTransport &tp) {
+  Client *want;
+  if (&tp == &HTTP_WIFI) {
+    want = &s_wifi;
+  } else {
+    if (!s_gsm) s_gsm = new TinyGsmClient(modem_get(), MQTT_MUX);
+    want = s_gsm;
+  }
+  if (want != s_net) {
+    if (s_net) mqtt_disconnect();
+    s_net = want;
+  }
+  return mqtt_connect();
+}
+
+static bool mq_enabled() { return strlen(MQTT_HOST) > 0; }
+
+static void mq_encode(String &out, const SampleRecord &r, int n) {
+  if (n) out += '\n';                 // one message per line
+  sink_jsonSample(out, r);
+}
+
+static void mq_none(String &) {}
+
+static bool mq_deliver(const HttpTransport &tp, const String &body, int count) {
+  mq_init();
+  if (!mq_use(tp)) {
+#if ENABLE_DEBUG
+    Serial.printf("[MQTT] connect to %s:%u via %s failed (CONNACK %u)\n", MQTT_HOST,
+                  (unsigned)MQTT_PORT, tp.name, (unsigned)mqtt_stats().last_connack_rc);
+#endif
+    return false;
+  }
+
+  // all of the batch in flight, then wait for the PUBACKs
+  const char *p = body.c_str();
+  int sent = 0;
+  while (*p) {
+    const char *nl = strchr(p, '\n');
+    size_t len = nl ? (size_t)(nl - p) : strlen(p);
+    if (!mqtt_publish(s_topic, (const uint8_t *)p, len)) return false;
+    sent++;
+    p += len;
+    if (*p) p++;
+  }
+  return sent == count && mqtt_waitAcked(MQTT_ACK_TIMEOUT_MS);
+}
+
+const TelemetrySink SINK_MQTT = {
+  "mqtt",
+  MQTT_QUEUE_DIR,
+  MQTT_BATCH_MAX,
+  MQTT_BATCH_BYTES,
+  0,
+  mq_enabled,
+  mq_none,
+  mq_encode,
+  mq_none,
+  nullptr,
+  nullptr,
+  mq_deliver,
+  nullptr,
+};
+
+void mqttClient_service() {
+  if (!s_inited || !mqtt_isConnected()) return;
+  bool up = (s_net == &s_wifi) ? WiFi.status() == WL_CONNECTED : pdp_isUp();
+  if (up) mqtt_service();
+  else mqtt_disconnect();
+}
+
+void mqttClient_dropModem() {
+  if (s_inited && s_gsm && s_net == s_gsm) mqtt_disconnect();
+}
+
+void mqttClient_servicePower() {
+  if (s_modemHeld && modemPower_sleepPending()) {
+#if ENABLE_DEBUG
+    Serial.println(F("[MQTT] modem going to sleep (PSM), closing the session"));
+#endif
+    mqtt_disconnect();
+  }
+}
+
+const char *mqttClient_id() {
+  mq_init();
+  return s_id;
+}
+
+const char *mqttClient_bearer() {
+  if (!s_inited || !mqtt_isConnected()) return "none";
+  return s_net == &s_wifi ? "wifi" : "modem";
+}
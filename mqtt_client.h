@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include "telemetry_sink.h"
+
+// MQTT as an upload sink: each queued sample is one QoS 1 message (the
+// JSON of sink_jsonSample(), ~100 bytes) to
+//   MQTT_TOPIC_PREFIX/<client id>/telemetry
+// over one long-lived session (mqtt_session.h) on WiFi or a modem socket
+// (MQTT_MUX), instead of a request with headers per upload. A batch of up
+// to MQTT_BATCH_MAX publishes is in flight at once and the queue moves on
+// once the broker has acked them all. Off while MQTT_HOST is "".
+//
+// On the modem every socket operation goes through modem_get(), and an
+// open session holds PSM off (modemPower_hold); it is closed with a
+// DISCONNECT when the modem is about to sleep, and the next batch
+// reconnects (the broker keeps the session).
+extern const TelemetrySink SINK_MQTT;
+
+// Keep-alive, and close the session when its bearer is gone (loop task).
+void mqttClient_service();
+
+// Close the session if it runs over the modem (LTE data going down).
+void mqttClient_dropModem();
+
+// Close a modem session when the power manager wants to sleep (loop task,
+// often).
+void mqttClient_servicePower();
+
+const char *mqttClient_id();
+const char *mqttClient_bearer();   // "wifi" / "modem" / "none"
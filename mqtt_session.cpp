@@ -0,0 +1,306 @@
+// mqtt_session.cpp
+// MQTT 3.1.1 QoS 1 publisher session (see mqtt_session.h).
+
+#include "mqtt_session.h"
+#include <string.h>
+
+#define MQTT_TX_BUF 512             // one packet in one write when it fits
+
+enum : uint8_t {
+  PKT_CONNECT    = 0x10,
+  PKT_CONNACK    = 0x20,
+  PKT_PUBLISH_Q1 = 0x32,
+  PKT_PUBACK     = 0x40,
+  PKT_PINGREQ    = 0xC0,
+  PKT_PINGRESP   = 0xD0,
+  PKT_DISCONNECT = 0xE0,
+};
+
+enum RxState : uint8_t { RX_HEADER = 0, RX_LENGTH, RX_BODY };
+
+static MqttIo     s_io = {};
+static MqttConfig s_cfg = {};
+static MqttStats  s_stats = {};
+
+static bool     s_connected = false;
+static uint16_t s_nextId = 1;
+static uint16_t s_inflight[MQTT_MAX_INFLIGHT];
+static int      s_nInflight = 0;
+static uint32_t s_lastTx = 0;
+static bool     s_pingOut = false;
+static uint32_t s_pingMs = 0;
+static bool     s_connack = false;
+static uint8_t  s_tx[MQTT_TX_BUF];
+
+// incoming packet parser: only the first bytes of a body are kept
+// (CONNACK / PUBACK need two); anything longer is skipped
+static RxState  s_rxState = RX_HEADER;
+static uint8_t  s_rxType = 0;
+static uint32_t s_rxLen = 0;
+static uint32_t s_rxMult = 1;
+static uint32_t s_rxGot = 0;
+static uint8_t  s_rxBody[4];
+
+static uint32_t mq_now() { return s_io.now_ms(); }
+
+static void mq_drop() {
+  if (s_connected) s_stats.drops++;
+  s_connected = false;
+  s_nInflight = 0;
+  s_pingOut = false;
+  s_rxState = RX_HEADER;
+  s_io.close();
+}
+
+static bool mq_tx(const uint8_t *buf, size_t len) {
+  if (s_io.write(buf, len) != len) {
+    mq_drop();
+    return false;
+  }
+  s_stats.tx_bytes += len;
+  s_lastTx = mq_now();
+  return true;
+}
+
+// remaining length, 1..4 bytes
+static size_t mq_putLen(uint8_t *p, uint32_t n) {
+  size_t i = 0;
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    p[i++] = n ? (b | 0x80) : b;
+  } while (n && i < 4);
+  return i;
+}
+
+static size_t mq_putStr(uint8_t *p, const char *s) {
+  size_t n = strlen(s);
+  p[0] = n >> 8;
+  p[1] = n & 0xFF;
+  memcpy(p + 2, s, n);
+  return n + 2;
+}
+
+static void mq_packet(uint8_t type, const uint8_t *body, int body_len) {
+  switch (type & 0xF0) {
+    case PKT_CONNACK:
+      if (body_len >= 2) {
+        s_stats.session_present = body[0] & 1;
+        s_stats.last_connack_rc = body[1];
+        s_connack = true;
+      }
+      break;
+    case PKT_PUBACK:
+      if (body_len >= 2) {
+        uint16_t id = (body[0] << 8) | body[1];
+        for (int i = 0; i < s_nInflight; i++) {
+          if (s_inflight[i] != id) continue;
+          s_inflight[i] = s_inflight[--s_nInflight];
+          s_stats.acked++;
+          break;
+        }
+      }
+      break;
+    case PKT_PINGRESP:
+      s_pingOut = false;
+      break;
+    default:                      // nothing subscribed: nothing else expected
+      break;
+  }
+}
+
+static void mq_rxByte(uint8_t b) {
+  switch (s_rxState) {
+    case RX_HEADER:
+      s_rxType = b;
+      s_rxLen = 0;
+      s_rxMult = 1;
+      s_rxState = RX_LENGTH;
+      break;
+    case RX_LENGTH:
+      s_rxLen += (b & 0x7F) * s_rxMult;
+      s_rxMult *= 128;
+      if (b & 0x80) {
+        if (s_rxMult > 128UL * 128 * 128) mq_drop();   // malformed
+        break;
+      }
+      s_rxGot = 0;
+      if (s_rxLen == 0) {
+        mq_packet(s_rxType, s_rxBody, 0);
+        s_rxState = RX_HEADER;
+      } else {
+        s_rxState = RX_BODY;
+      }
+      break;
+    case RX_BODY:
+      if (s_rxGot < sizeof(s_rxBody)) s_rxBody[s_rxGot] = b;
+      if (++s_rxGot == s_rxLen) {
+        mq_packet(s_rxType, s_rxBody, s_rxGot < sizeof(s_rxBody) ? s_rxGot : sizeof(s_rxBody));
+        s_rxState = RX_HEADER;
+      }
+      break;
+  }
+}
+
+static void mq_pump() {
+  uint8_t buf[64];
+  int n;
+  while (s_connected || s_io.isOpen()) {
+    n = s_io.read(buf, sizeof(buf));
+    if (n <= 0) break;
+    s_stats.rx_bytes += n;
+    for (int i = 0; i < n; i++) mq_rxByte(buf[i]);
+  }
+  if (s_connected && !s_io.isOpen()) mq_drop();
+}
+
+void mqtt_init(const MqttIo &io, const MqttConfig &cfg) {
+  s_io = io;
+  s_cfg = cfg;
+  s_connected = false;
+  s_nInflight = 0;
+}
+
+bool mqtt_connect() {
+  if (s_connected && s_io.isOpen()) return true;
+  if (s_connected) mq_drop();
+  s_rxState = RX_HEADER;
+  if (!s_io.open(s_cfg.host, s_cfg.port)) {
+    s_stats.connect_failures++;
+    s_stats.last_connack_rc = 0xFF;
+    return false;
+  }
+
+  // CONNECT: clean session off, so the broker keeps our session
+  bool user = s_cfg.user && s_cfg.user[0];
+  bool pass = user && s_cfg.pass && s_cfg.pass[0];
+  uint32_t rem = 10 + 2 + strlen(s_cfg.client_id);
+  if (user) rem += 2 + strlen(s_cfg.user);
+  if (pass) rem += 2 + strlen(s_cfg.pass);
+  if (rem + 5 > sizeof(s_tx)) {
+    s_io.close();
+    s_stats.connect_failures++;
+    return false;
+  }
+  uint8_t *p = s_tx;
+  *p++ = PKT_CONNECT;
+  p += mq_putLen(p, rem);
+  p += mq_putStr(p, "MQTT");
+  *p++ = 4;                                   // protocol level 3.1.1
+  *p++ = (user ? 0x80 : 0) | (pass ? 0x40 : 0);
+  *p++ = s_cfg.keepalive_s >> 8;
+  *p++ = s_cfg.keepalive_s & 0xFF;
+  p += mq_putStr(p, s_cfg.client_id);
+  if (user) p += mq_putStr(p, s_cfg.user);
+  if (pass) p += mq_putStr(p, s_cfg.pass);
+
+  s_connack = false;
+  s_stats.last_connack_rc = 0xFF;
+  s_connected = false;
+  if (s_io.write(s_tx, p - s_tx) != (size_t)(p - s_tx)) {
+    s_io.close();
+    s_stats.connect_failures++;
+    return false;
+  }
+  s_stats.tx_bytes += p - s_tx;
+  s_lastTx = mq_now();
+
+  uint32_t start = mq_now();
+  while (!s_connack && s_io.isOpen() && mq_now() - start < s_cfg.ack_timeout_ms) {
+    mq_pump();
+    if (!s_connack && s_io.idle) s_io.idle();
+  }
+  if (!s_connack || s_stats.last_connack_rc != 0) {
+    s_io.close();
+    s_stats.connect_failures++;
+    return false;
+  }
+  s_connected = true;
+  s_nInflight = 0;
+  s_pingOut = false;
+  s_stats.connects++;
+  return true;
+}
+
+bool mqtt_isConnected() { return s_connected; }
+
+uint16_t mqtt_publish(const char *topic, const uint8_t *payload, size_t len) {
+  if (!s_connected || s_nInflight >= MQTT_MAX_INFLIGHT) return 0;
+  uint16_t id = s_nextId++;
+  if (s_nextId == 0) s_nextId = 1;
+
+  size_t tlen = strlen(topic);
+  uint32_t rem = 2 + tlen + 2 + len;
+  if (tlen + 9 > sizeof(s_tx)) return 0;
+  uint8_t *p = s_tx;
+  *p++ = PKT_PUBLISH_Q1;
+  p += mq_putLen(p, rem);
+  p += mq_putStr(p, topic);
+  *p++ = id >> 8;
+  *p++ = id & 0xFF;
+  size_t head = p - s_tx;
+  if (head + len <= sizeof(s_tx)) {
+    memcpy(p, payload, len);
+    if (!mq_tx(s_tx, head + len)) return 0;
+  } else if (!mq_tx(s_tx, head) || !mq_tx(payload, len)) {
+    return 0;
+  }
+
+  s_inflight[s_nInflight++] = id;
+  s_stats.published++;
+  s_stats.payload_bytes += len;
+  return id;
+}
+
+bool mqtt_waitAcked(uint32_t timeout_ms) {
+  uint32_t start = mq_now();
+  while (s_connected && s_nInflight > 0) {
+    if (mq_now() - start >= timeout_ms) {
+      s_stats.ack_timeouts++;
+      mq_drop();
+      return false;
+    }
+    mq_pump();
+    if (s_nInflight > 0 && s_io.idle) s_io.idle();
+  }
+  return s_connected;
+}
+
+int mqtt_inFlight() { return s_nInflight; }
+
+void mqtt_service() {
+  if (!s_connected) return;
+  mq_pump();
+  if (!s_connected) return;
+
+  uint32_t now = mq_now();
+  if (s_pingOut) {
+    if (now - s_pingMs >= s_cfg.ack_timeout_ms) mq_drop();   // broker gone quiet
+    return;
+  }
+  if (s_cfg.keepalive_s && now - s_lastTx >= (uint32_t)s_cfg.keepalive_s * 500UL) {
+    const uint8_t ping[2] = { PKT_PINGREQ, 0 };
+    if (!mq_tx(ping, sizeof(ping))) return;
+    s_stats.pings++;
+    s_pingOut = true;
+    s_pingMs = now;
+  }
+}
+
+void mqtt_disconnect() {
+  if (s_connected) {
+    const uint8_t bye[2] = { PKT_DISCONNECT, 0 };
+    if (s_io.write(bye, sizeof(bye)) == sizeof(bye)) s_stats.tx_bytes += sizeof(bye);
+  }
+  s_connected = false;
+  s_nInflight = 0;
+  s_pingOut = false;
+  s_io.close();
+}
+
+const MqttStats &mqtt_stats() { return s_stats; }
+
+void mqtt_resetStats() {
+  s_stats = MqttStats();
+  s_stats.last_connack_rc = 0xFF;
+}
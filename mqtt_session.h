@@ -0,0 +1,88 @@
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// mqtt_session.h : MQTT 3.1.1 publisher session with QoS 1.
+//
+// One long-lived connection to the broker under a fixed client id with
+// clean session off, so the broker keeps the session across reconnects.
+// mqtt_publish() sends a QoS 1 PUBLISH and returns at once: up to
+// MQTT_MAX_INFLIGHT can be outstanding, and mqtt_waitAcked() then waits
+// for their PUBACKs. Only what the broker acknowledged is delivered; the
+// caller sends the rest again (at least once, never lost).
+//
+// mqtt_service() reads what the broker sent and keeps the connection
+// alive: a PINGREQ after keepalive/2 without traffic, and the connection
+// is dropped when a PINGRESP (or a PUBACK) does not come within
+// ack_timeout_ms. The next mqtt_connect() then reconnects.
+//
+// Every MQTT byte both ways is counted, to compare with HTTP uploads.
+//
+// No Arduino dependency (MqttIo), like pdp_session.h.
+
+#define MQTT_MAX_INFLIGHT 32
+
+struct MqttIo {
+  uint32_t (*now_ms)();
+  bool     (*open)(const char *host, uint16_t port);   // TCP connect
+  bool     (*isOpen)();
+  size_t   (*write)(const uint8_t *buf, size_t len);
+  int      (*read)(uint8_t *buf, size_t cap);          // what has arrived, 0 = nothing
+  void     (*close)();
+  void     (*idle)();             // while waiting for the broker (may be null)
+};
+
+struct MqttConfig {
+  const char *host;
+  uint16_t    port;
+  const char *client_id;          // stable: the broker keeps the session under it
+  const char *user;               // "" = none
+  const char *pass;
+  uint16_t    keepalive_s;
+  uint32_t    ack_timeout_ms;     // CONNACK / PUBACK / PINGRESP
+};
+
+struct MqttStats {
+  uint32_t connects;
+  uint32_t connect_failures;
+  uint8_t  last_connack_rc;       // 0 accepted, 1..5 refused, 0xFF no CONNACK
+  bool     session_present;       // the broker still had our session
+  uint32_t published;             // QoS 1 PUBLISH sent
+  uint32_t acked;                 // PUBACK received
+  uint32_t ack_timeouts;
+  uint32_t pings;
+  uint32_t drops;                 // connection lost or given up
+  uint64_t tx_bytes;              // MQTT packets (TCP/IP headers not counted)
+  uint64_t rx_bytes;
+  uint64_t payload_bytes;         // of tx_bytes, PUBLISH payload
+};
+
+void mqtt_init(const MqttIo &io, const MqttConfig &cfg);
+
+// Connected already, or CONNECT and wait for CONNACK (up to ack_timeout_ms).
+// Publishes left in flight by a lost connection are forgotten: the caller
+// sends them again.
+bool mqtt_connect();
+bool mqtt_isConnected();
+
+// QoS 1 PUBLISH. Returns its packet id, 0 if not sent (not connected,
+// MQTT_MAX_INFLIGHT outstanding, or the write failed).
+uint16_t mqtt_publish(const char *topic, const uint8_t *payload, size_t len);
+
+// Wait until every publish in flight is acked. False on timeout (the
+// connection is dropped) or if the connection is lost meanwhile.
+bool mqtt_waitAcked(uint32_t timeout_ms);
+int  mqtt_inFlight();
+
+// Incoming packets and keep-alive (loop task, often enough for keepalive/2).
+void mqtt_service();
+
+// DISCONNECT and close; the broker keeps the session.
+void mqtt_disconnect();
+
+const MqttStats &mqtt_stats();
+void mqtt_resetStats();
+
+#endif // MQTT_SESSION_H
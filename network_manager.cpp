@@ -4,6 +4,9 @@
 #include <Preferences.h>
 #include <WebServer.h>
 #include "modem_manager.h"
+#include "http_pool.h"
+#include "pdp_session.h"
+#include "mqtt_client.h"
 #include "key_server.h"
 
 extern WebServer server;
@@ -23,6 +26,14 @@ static unsigned long lastAutoTry = 0;
 static unsigned long userActionBlockUntil = 0;
 #define USER_ACTION_BLOCK_MS 15000
 
+// Tear down the LTE data session; pooled keep-alive sockets go first.
+// The detach itself runs in pdp_service().
+static void lte_disconnectData() {
+  mqttClient_dropModem();
+  httpPool_closeAll();
+  pdp_want(false);
+}
+
 bool isUserActive() {
   return (millis() < userActionBlockUntil);
 }
@@ -98,26 +109,37 @@ static bool tryStartLTE_internal() {
     return false;
   }
 
-  TinyGsm &modem = modem_get();
-  Serial.println(F("[LTE] Attempting GPRS attach (internal)"));
-#if defined(MODEM_APN) && defined(MODEM_GPRS_USER) && defined(MODEM_GPRS_PASS)
-  bool ok = modem.gprsConnect(MODEM_APN, MODEM_GPRS_USER, MODEM_GPRS_PASS);
-#else
-  Serial.println(F("[LTE] MODEM_APN/MODEM_GPRS_* not defined in config.h"));
-  return false;
-#endif
-
-  if (ok) {
-    Serial.println(F("[LTE] GPRS attach OK"));
+  // Non-blocking: the attach (and its retries with backoff) runs in
+  // pdp_service(); manageAutoNetwork() picks up the result.
+  pdp_want(true);
+  if (pdp_isUp()) {
+    Serial.println(F("[LTE] data session up"));
     keyServer_stop();
     currentNet = NET_LTE;
     connectivityMode = CONNECTIVITY_LTE;
     return true;
-  } else {
-    Serial.println(F("[LTE] GPRS attach failed"));
+  }
+  Serial.printf("[LTE] data session %s\n", pdp_stateName(pdp_state()));
+  if (currentNet == NET_LTE) {
     currentNet = NET_NONE;
     connectivityMode = CONNECTIVITY_OFFLINE;
-    return false;
+  }
+  return false;
+}
+
+// Follow the data session: attaches finish, and bearers get lost, between
+// calls to tryStartLTE_internal().
+static void lte_syncState() {
+  if (currentNet == NET_LTE && !pdp_isUp()) {
+    Serial.printf("[LTE] data session lost (%s)\n", pdp_stateName(pdp_state()));
+    httpPool_closeAll();
+    currentNet = NET_NONE;
+    connectivityMode = CONNECTIVITY_OFFLINE;
+  } else if (currentNet == NET_NONE && pdp_wanted() && pdp_isUp()) {
+    Serial.println(F("[LTE] data session up"));
+    keyServer_stop();
+    currentNet = NET_LTE;
+    connectivityMode = CONNECTIVITY_LTE;
   }
 }
 
@@ -160,7 +182,7 @@ void setNetworkPreference(int newPref) {
       // If modem is registered, disconnect GPRS before trying WiFi to avoid races.
       if (modem_isNetworkRegistered()) {
         Serial.println(F("[NET] Disconnecting modem GPRS before WiFi attempt"));
-        modem_get().gprsDisconnect();
+        lte_disconnectData();
         delay(200);
       }
       bool ok = wifi_connectFromPrefs(10000);
@@ -175,7 +197,7 @@ void setNetworkPreference(int newPref) {
          delay(100);
       }
       // Ensure LTE is on
-      if (!modem_isNetworkRegistered()) {
+      if (!pdp_isUp()) {
          tryStartLTE_internal();
       }
     }
@@ -207,7 +229,7 @@ void setNetworkPreference(int newPref) {
       // ensure modem GPRS is disconnected before attempting WiFi
       if (modem_isNetworkRegistered()) {
         Serial.println(F("[NET] disconnecting GPRS before WiFi attempt"));
-        modem_get().gprsDisconnect();
+        lte_disconnectData();
         delay(200);
       }
       bool ok = wifi_connectFromPrefs(10000);
@@ -232,7 +254,7 @@ void setNetworkPreference(int newPref) {
     
     bool ok = tryStartLTE_internal();
     if (!ok) {
-      Serial.println(F("[NET] LTE requested but attach failed"));
+      Serial.println(F("[NET] LTE requested, attach in progress"));
     } else {
       Serial.println(F("[NET] LTE-only mode active - weather via LTE, no web interface"));
     }
@@ -247,7 +269,7 @@ void setNetworkPreference(int newPref) {
   currentNet = NET_NONE;
   connectivityMode = CONNECTIVITY_OFFLINE;
   if (WiFi.status() == WL_CONNECTED) { WiFi.disconnect(true); WiFi.mode(WIFI_OFF); }
-  if (modem_isNetworkRegistered()) modem_get().gprsDisconnect();
+  if (modem_isNetworkRegistered()) lte_disconnectData();
   Serial.println(F("[NET] Network set to OFFLINE by user"));
   persistUserForcedFlag(false);
 }
@@ -255,6 +277,8 @@ void setNetworkPreference(int newPref) {
 void manageAutoNetwork() {
   unsigned long now = millis();
 
+  lte_syncState();
+
   // If user recently changed preference, avoid auto switching for a short period
   if (now < userActionBlockUntil) {
     // Still log for diagnostics
@@ -307,7 +331,7 @@ void manageAutoNetwork() {
     if (currentNet != NET_WIFI) {
       currentNet = NET_WIFI;
       connectivityMode = CONNECTIVITY_WIFI;
-      if (modem_isNetworkRegistered()) modem_get().gprsDisconnect();
+      if (modem_isNetworkRegistered()) lte_disconnectData();
       delay(100);
     }
     return;
@@ -322,7 +346,7 @@ void manageAutoNetwork() {
     if (now - lastAutoTry > 15000) {
       lastAutoTry = now;
       if (wifi_connectFromPrefs(5000)) {
-        if (modem_isNetworkRegistered()) modem_get().gprsDisconnect();
+        if (modem_isNetworkRegistered()) lte_disconnectData();
         delay(100);
       }
     }
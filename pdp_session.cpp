@@ -0,0 +1,306 @@
+// pdp_session.cpp
+// Non-blocking PDP / socket-stack session (see pdp_session.h).
+
+#include "pdp_session.h"
+#include "at_engine.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PDP_REG_GRACE_MS   15000UL   // registration may blip (cell change) before we call it lost
+#define PDP_CMD_TIMEOUT_MS 5000UL
+
+enum PdpStep : uint8_t {
+  STEP_WAIT_REG = 0,
+  STEP_CONTEXT,       // +CGDCONT
+  STEP_AUTH,          // +CGAUTH (only with a user name)
+  STEP_ACTIVATE,      // +CGACT=1,1
+  STEP_NETOPEN,       // +NETOPEN -> OK
+  STEP_NETOPEN_WAIT,  // ... then +NETOPEN: 0
+};
+
+static PdpIo     s_io = {};
+static PdpConfig s_cfg = {};
+static PdpState  s_state = PDP_DOWN;
+static PdpStats  s_stats = {};
+
+static bool     s_want = false;
+static PdpStep  s_step = STEP_WAIT_REG;
+static bool     s_busy = false;          // a step command is in flight
+static bool     s_stepDone = false;
+static AtResult s_stepRes = AT_PENDING;
+static uint32_t s_attachStart = 0;
+static uint32_t s_nextTry = 0;
+static uint32_t s_unregSince = 0;
+static int      s_netopen = -1;          // +NETOPEN: <err>, -1 not yet
+static bool     s_alreadyOpen = false;
+static volatile bool s_lost = false;     // bearer-loss URC seen
+static uint8_t  s_closeStep = 0;
+
+static uint32_t pdp_now() { return s_io.now_ms(); }
+static bool pdp_due(uint32_t t, uint32_t now) { return (int32_t)(now - t) >= 0; }
+
+// --- URCs / command callbacks -----------------------------------------
+
+// +CGEV: NW PDN DEACT 1 / +CGEV: ME PDN DEACT 1 / +CGEV: NW DETACH
+static void pdp_cgevUrc(const char *line, uint32_t, void *) {
+  if (strstr(line, "DEACT") || strstr(line, "DETACH")) s_lost = true;
+}
+
+// +CIPEVENT: NETWORK CLOSED UNEXPECTEDLY
+static void pdp_cipeventUrc(const char *line, uint32_t, void *) {
+  if (strstr(line, "CLOSED")) s_lost = true;
+}
+
+// +NETOPEN: 0 (0 = opened, anything else = error code)
+static void pdp_netopenUrc(const char *line, uint32_t, void *) {
+  int err;
+  if (sscanf(line + 9, "%d", &err) == 1) s_netopen = err;
+}
+
+static void pdp_netopenLine(const char *line, void *) {
+  if (strncmp(line, "+NETOPEN:", 9) == 0) pdp_netopenUrc(line, 0, nullptr);
+  else if (strstr(line, "already opened")) s_alreadyOpen = true;   // +IP ERROR: Network is already opened
+}
+
+static void pdp_stepDone(AtResult res, const char *, void *) {
+  s_busy = false;
+  s_stepDone = true;
+  s_stepRes = res;
+}
+
+// --- state machine ----------------------------------------------------
+
+static uint32_t pdp_backoff() {
+  uint32_t b = s_cfg.backoff_min_ms;
+  for (uint16_t i = 1; i < s_stats.consecutive_failures && b < s_cfg.backoff_max_ms; i++) b *= 2;
+  if (b > s_cfg.backoff_max_ms) b = s_cfg.backoff_max_ms;
+  uint32_t j = (uint32_t)((uint64_t)b * s_cfg.jitter_pct / 100U);
+  if (j && s_io.random) b = b - j + s_io.random() % (2 * j + 1);
+  return b;
+}
+
+static void pdp_startAttach(uint32_t now) {
+  s_state = PDP_ATTACHING;
+  s_step = STEP_WAIT_REG;
+  s_stepDone = false;
+  s_netopen = -1;
+  s_alreadyOpen = false;
+  s_lost = false;
+  s_attachStart = now;
+  s_stats.attempts++;
+}
+
+static void pdp_fail(PdpFail why, uint32_t now) {
+  s_stats.failures++;
+  s_stats.fail_by_reason[why]++;
+  s_stats.last_fail = why;
+  s_stats.last_fail_ms = now;
+  if (why == PDP_FAIL_LOST) {
+    s_stats.consecutive_failures = 0;   // it worked until now: retry soon
+  }
+  s_stats.consecutive_failures++;
+  s_stats.backoff_ms = pdp_backoff();
+  s_nextTry = now + s_stats.backoff_ms;
+  s_state = PDP_BACKOFF;
+}
+
+static void pdp_up(uint32_t now) {
+  uint32_t took = now - s_attachStart;
+  s_state = PDP_UP;
+  s_stats.successes++;
+  s_stats.consecutive_failures = 0;
+  s_stats.last_attach_ms = took;
+  s_stats.total_attach_ms += took;
+  if (!s_stats.min_attach_ms || took < s_stats.min_attach_ms) s_stats.min_attach_ms = took;
+  if (took > s_stats.max_attach_ms) s_stats.max_attach_ms = took;
+  s_stats.up_since_ms = now;
+  s_unregSince = 0;
+  s_lost = false;
+}
+
+static bool pdp_submitStep(uint32_t now) {
+  char cmd[AT_CMD_MAX];
+  uint32_t left = s_cfg.attach_timeout_ms - (now - s_attachStart);
+  uint32_t t = PDP_CMD_TIMEOUT_MS;
+  switch (s_step) {
+  case STEP_CONTEXT:
+    snprintf(cmd, sizeof(cmd), "+CGDCONT=1,\"IP\",\"%s\"", s_cfg.apn);
+    break;
+  case STEP_AUTH:
+    snprintf(cmd, sizeof(cmd), "+CGAUTH=1,1,\"%s\",\"%s\"", s_cfg.user, s_cfg.pass);
+    break;
+  case STEP_ACTIVATE:
+    snprintf(cmd, sizeof(cmd), "+CGACT=1,1");
+    t = left;                         // the slow one: network attach + PDN
+    break;
+  case STEP_NETOPEN:
+    snprintf(cmd, sizeof(cmd), "+NETOPEN");
+    break;
+  default:
+    return false;
+  }
+  if (t > left) t = left;
+  s_stepDone = false;
+  s_busy = at_submit(cmd, t, s_step == STEP_NETOPEN ? pdp_netopenLine : nullptr, pdp_stepDone);
+  return s_busy;
+}
+
+static void pdp_serviceAttach(uint32_t now) {
+  if (s_busy) return;                  // never abandon a command in flight
+
+  if (s_stepDone) {
+    s_stepDone = false;
+    bool ok = (s_stepRes == AT_OK);
+    switch (s_step) {
+    case STEP_CONTEXT:
+    case STEP_AUTH:
+      if (!ok) { pdp_fail(PDP_FAIL_CONTEXT, now); return; }
+      s_step = (s_step == STEP_CONTEXT && s_cfg.user && s_cfg.user[0]) ? STEP_AUTH : STEP_ACTIVATE;
+      break;
+    case STEP_ACTIVATE:
+      if (!ok) { pdp_fail(s_stepRes == AT_TIMEOUT ? PDP_FAIL_TIMEOUT : PDP_FAIL_ACTIVATE, now); return; }
+      s_step = STEP_NETOPEN;
+      break;
+    case STEP_NETOPEN:
+      if (s_alreadyOpen || s_netopen == 0) { pdp_up(now); return; }
+      if (!ok) { pdp_fail(PDP_FAIL_NETOPEN, now); return; }
+      s_step = STEP_NETOPEN_WAIT;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (!s_want) {                       // given up while attaching: undo what is there
+    s_state = PDP_CLOSING;
+    s_closeStep = 0;
+    return;
+  }
+
+  if (now - s_attachStart >= s_cfg.attach_timeout_ms) {
+    pdp_fail(s_step == STEP_WAIT_REG ? PDP_FAIL_NO_REG : PDP_FAIL_TIMEOUT, now);
+    return;
+  }
+
+  switch (s_step) {
+  case STEP_WAIT_REG:
+    if (s_io.registered()) s_step = STEP_CONTEXT;
+    return;
+  case STEP_NETOPEN_WAIT:
+    if (s_netopen == 0) pdp_up(now);
+    else if (s_netopen > 0) pdp_fail(PDP_FAIL_NETOPEN, now);
+    return;
+  default:
+    pdp_submitStep(now);               // queue full: again next time
+    return;
+  }
+}
+
+static void pdp_serviceClose() {
+  if (s_busy) return;
+  switch (s_closeStep) {
+  case 0:
+    if (at_submit("+NETCLOSE", PDP_CMD_TIMEOUT_MS, nullptr, pdp_stepDone)) { s_busy = true; s_closeStep = 1; }
+    return;
+  case 1:
+    if (at_submit("+CGACT=0,1", 40000, nullptr, pdp_stepDone)) { s_busy = true; s_closeStep = 2; }
+    return;
+  default:
+    s_stepDone = false;
+    s_lost = false;                    // our own deactivation reports
+    s_state = PDP_DOWN;
+    return;
+  }
+}
+
+void pdp_init(const PdpIo &io, const PdpConfig &cfg) {
+  static bool subscribed = false;
+  s_io = io;
+  s_cfg = cfg;
+  if (!subscribed) {
+    subscribed = true;
+    at_subscribe("+CGEV:", pdp_cgevUrc);
+    at_subscribe("+CIPEVENT:", pdp_cipeventUrc);
+    at_subscribe("+NETOPEN:", pdp_netopenUrc);
+  }
+  at_submit("+CGEREP=2,1", 1000);        // PDN / detach events as +CGEV URCs
+}
+
+void pdp_want(bool up) { s_want = up; }
+bool pdp_wanted() { return s_want; }
+
+void pdp_service() {
+  if (!s_io.now_ms) return;
+  uint32_t now = pdp_now();
+
+  switch (s_state) {
+  case PDP_DOWN:
+    if (s_want) pdp_startAttach(now);
+    return;
+
+  case PDP_BACKOFF:
+    if (!s_want) { s_state = PDP_DOWN; return; }
+    if (pdp_due(s_nextTry, now)) pdp_startAttach(now);
+    return;
+
+  case PDP_ATTACHING:
+    pdp_serviceAttach(now);
+    return;
+
+  case PDP_UP:
+    if (!s_want) {
+      s_state = PDP_CLOSING;
+      s_closeStep = 0;
+      return;
+    }
+    if (!s_io.registered()) {
+      if (!s_unregSince) s_unregSince = now ? now : 1;
+      else if (now - s_unregSince >= PDP_REG_GRACE_MS) s_lost = true;
+    } else {
+      s_unregSince = 0;
+    }
+    if (s_lost) {
+      s_lost = false;
+      pdp_fail(PDP_FAIL_LOST, now);
+    }
+    return;
+
+  case PDP_CLOSING:
+    pdp_serviceClose();
+    return;
+  }
+}
+
+bool     pdp_isUp()    { return s_state == PDP_UP; }
+PdpState pdp_state()   { return s_state; }
+const PdpStats &pdp_stats() { return s_stats; }
+
+void pdp_resetStats() {
+  uint32_t up = s_stats.up_since_ms;
+  s_stats = {};
+  s_stats.up_since_ms = up;
+}
+
+const char *pdp_stateName(PdpState s) {
+  switch (s) {
+  case PDP_DOWN:      return "down";
+  case PDP_ATTACHING: return "attaching";
+  case PDP_UP:        return "up";
+  case PDP_BACKOFF:   return "backoff";
+  case PDP_CLOSING:   return "closing";
+  }
+  return "?";
+}
+
+const char *pdp_failName(PdpFail f) {
+  switch (f) {
+  case PDP_FAIL_NONE:     return "none";
+  case PDP_FAIL_NO_REG:   return "not registered";
+  case PDP_FAIL_CONTEXT:  return "context rejected";
+  case PDP_FAIL_ACTIVATE: return "activation rejected";
+  case PDP_FAIL_NETOPEN:  return "socket stack";
+  case PDP_FAIL_TIMEOUT:  return "timeout";
+  case PDP_FAIL_LOST:     return "bearer lost";
+  default:                return "?";
+  }
+}
@@ -0,0 +1,88 @@
+#ifndef PDP_SESSION_H
+#define PDP_SESSION_H
+
+#include <stdint.h>
+
+// pdp_session.h : LTE data session (PDP context + socket stack) lifecycle.
+//
+// Replaces the blocking gprsConnect(): the attach runs as a chain of
+// queued AT commands (CGDCONT, CGAUTH, CGACT, NETOPEN) driven by
+// pdp_service(), so a slow or failing attach never stalls loop(). Failed
+// attempts back off exponentially (with jitter, so a field of devices
+// does not retry in lockstep) up to backoff_max_ms. Loss of the bearer is
+// picked up from URCs (+CGEV PDN deactivation / detach, +CIPEVENT network
+// closed) and from registration loss, and leads to a fresh attach.
+//
+// Every attempt is measured: attach time (min / max / mean) and the
+// reason of every failure, for tuning in poor coverage.
+//
+// No Arduino dependency (AT engine + PdpIo), like modem_power.h.
+
+struct PdpIo {
+  uint32_t (*now_ms)();
+  bool     (*registered)();     // network registration (cached, no AT)
+  uint32_t (*random)();         // jitter source
+};
+
+struct PdpConfig {
+  const char *apn;
+  const char *user;             // "" = no CGAUTH
+  const char *pass;
+  uint32_t attach_timeout_ms;   // whole attach, registration wait included
+  uint32_t backoff_min_ms;
+  uint32_t backoff_max_ms;
+  uint8_t  jitter_pct;          // +/- this much of each backoff
+};
+
+enum PdpState : uint8_t {
+  PDP_DOWN = 0,      // not wanted
+  PDP_ATTACHING,
+  PDP_UP,
+  PDP_BACKOFF,       // wanted, waiting before the next attempt
+  PDP_CLOSING,
+};
+
+enum PdpFail : uint8_t {
+  PDP_FAIL_NONE = 0,
+  PDP_FAIL_NO_REG,      // not registered within the attach timeout
+  PDP_FAIL_CONTEXT,     // CGDCONT / CGAUTH rejected
+  PDP_FAIL_ACTIVATE,    // CGACT error (APN, network reject)
+  PDP_FAIL_NETOPEN,     // socket stack did not open
+  PDP_FAIL_TIMEOUT,     // attach took longer than attach_timeout_ms
+  PDP_FAIL_LOST,        // bearer lost while up
+  PDP_FAIL_COUNT
+};
+
+struct PdpStats {
+  uint32_t attempts;
+  uint32_t successes;
+  uint32_t failures;
+  uint32_t fail_by_reason[PDP_FAIL_COUNT];
+  PdpFail  last_fail;
+  uint32_t last_fail_ms;
+  uint32_t last_attach_ms;      // duration of the last successful attach
+  uint32_t min_attach_ms;
+  uint32_t max_attach_ms;
+  uint64_t total_attach_ms;
+  uint32_t up_since_ms;
+  uint32_t backoff_ms;          // current (or last) backoff
+  uint16_t consecutive_failures;
+};
+
+void pdp_init(const PdpIo &io, const PdpConfig &cfg);
+
+// Desired state. Cheap; the work happens in pdp_service().
+void pdp_want(bool up);
+bool pdp_wanted();
+
+// Run the state machine (loop task, modem awake).
+void pdp_service();
+
+bool     pdp_isUp();
+PdpState pdp_state();
+const char *pdp_stateName(PdpState s);
+const char *pdp_failName(PdpFail f);
+const PdpStats &pdp_stats();
+void     pdp_resetStats();
+
+#endif // PDP_SESSION_H
@@ -0,0 +1,57 @@
+// sample_record.cpp
+// Queued sample text format (see sample_record.h).
+
+#include "sample_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+size_t sample_format(char *out, size_t cap, const SampleRecord &r) {
+  char loc[40] = ";";
+  if (r.has_loc) snprintf(loc, sizeof(loc), "%.6f;%.6f", r.lat, r.lon);
+  int n = snprintf(out, cap, "S1;%lu;%lu;%lu;%s;%s",
+                   (unsigned long)r.epoch, (unsigned long)r.boot_id,
+                   (unsigned long)r.uptime_ms, loc, r.fields ? r.fields : "");
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// next ';'-terminated field; p is left after the ';'
+static const char *sample_field(const char *&p) {
+  const char *start = p;
+  const char *semi = strchr(p, ';');
+  if (!semi) return nullptr;
+  p = semi + 1;
+  return start;
+}
+
+bool sample_parse(const char *rec, SampleRecord &r) {
+  memset(&r, 0, sizeof(r));
+  if (strncmp(rec, "S1;", 3) == 0) {
+    const char *p = rec + 3;
+    const char *f[5];
+    for (int i = 0; i < 5; i++) {
+      if (!(f[i] = sample_field(p))) return false;
+    }
+    r.epoch     = strtoul(f[0], nullptr, 10);
+    r.boot_id   = strtoul(f[1], nullptr, 10);
+    r.uptime_ms = strtoul(f[2], nullptr, 10);
+    r.has_loc   = f[3][0] != ';' && f[4][0] != ';';
+    if (r.has_loc) {
+      r.lat = strtod(f[3], nullptr);
+      r.lon = strtod(f[4], nullptr);
+    }
+    r.fields = p;
+    return true;
+  }
+
+  // older queue lines: "<epoch>;<fields>", or just the fields
+  const char *semi = strchr(rec, ';');
+  if (semi && isdigit((unsigned char)rec[0])) {
+    r.epoch  = strtoul(rec, nullptr, 10);
+    r.fields = semi + 1;
+    return true;
+  }
+  r.fields = rec;
+  return true;
+}
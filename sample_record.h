@@ -0,0 +1,35 @@
+#ifndef SAMPLE_RECORD_H
+#define SAMPLE_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// sample_record.h : one queued sample, as stored in the upload queue.
+//
+// A sample waits on the SD card for as long as the uplink is down, so it
+// carries when and where it was taken rather than getting both at send
+// time:
+//   S1;<epoch>;<boot id>;<uptime ms>;<lat>;<lon>;<fields>
+// epoch is UTC seconds, 0 when the clock was not valid yet; boot id and
+// uptime then still date it (timeManager_epochAt()). lat/lon are empty
+// without a location. <fields> are the url-encoded "field1=..&..." pairs.
+//
+// sample_parse() also reads the earlier queue lines ("<epoch>;<fields>"
+// and bare "<fields>"). No Arduino dependency.
+
+struct SampleRecord {
+  uint32_t    epoch;       // 0 = not known at capture
+  uint32_t    boot_id;     // 0 = unknown (old record)
+  uint32_t    uptime_ms;
+  bool        has_loc;
+  double      lat, lon;
+  const char *fields;      // points into the parsed buffer
+};
+
+// Returns the record length, or 0 if it does not fit in cap.
+size_t sample_format(char *out, size_t cap, const SampleRecord &r);
+
+// Parses rec (NUL-terminated); r.fields points into it.
+bool   sample_parse(const char *rec, SampleRecord &r);
+
+#endif // SAMPLE_RECORD_H
@@ -0,0 +1,225 @@
+// scheduler.cpp
+// Deadline-driven cooperative scheduler (see scheduler.h).
+// Plain C++ on purpose: on the board the clock defaults to millis()/micros(),
+// on a host the caller installs a fake clock with sched_setClock().
+
+#include "scheduler.h"
+#include <string.h>
+#include <atomic>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static uint32_t sched_defaultMs() { return millis(); }
+static uint32_t sched_defaultUs() { return micros(); }
+static SchedClockFn s_msClock = sched_defaultMs;
+static SchedClockFn s_usClock = sched_defaultUs;
+#else
+static SchedClockFn s_msClock = nullptr;
+static SchedClockFn s_usClock = nullptr;
+#endif
+
+struct SchedJob {
+  const char *name;
+  SchedJobFn  fn;
+  uint32_t    period_ms;
+  uint32_t    deadline;       // absolute ms
+  bool        enabled;
+  bool        armed;          // false for a one-shot job that already ran
+  bool        rescheduled;    // deadline moved by the job itself while running
+  SchedJobStats st;
+};
+
+static SchedJob    s_jobs[SCHED_MAX_JOBS];
+static int         s_jobCount = 0;
+static int         s_running = SCHED_INVALID_JOB;
+static SchedWakeFn s_wake = nullptr;
+
+// sched_trigger() may come from another task on the other core (the
+// acquisition task): it only sets the job's bit here, and the loop task
+// moves the deadline itself in applyTriggers().
+static_assert(SCHED_MAX_JOBS <= 32, "one bit per job in s_triggered");
+static std::atomic<uint32_t> s_triggered(0);
+
+static uint32_t nowMs() { return s_msClock ? s_msClock() : 0; }
+static uint32_t nowUs() { return s_usClock ? s_usClock() : nowMs() * 1000UL; }
+
+// wrap-safe "a is at or before b"
+static bool dueAt(uint32_t deadline, uint32_t now) {
+  return (int32_t)(deadline - now) <= 0;
+}
+
+static bool validId(int id) { return id >= 0 && id < s_jobCount; }
+
+// ---------------------------------------------------------
+// REGISTRATION / CONTROL
+// ---------------------------------------------------------
+int sched_addJob(const char *name, SchedJobFn fn, uint32_t period_ms, uint32_t first_delay_ms) {
+  if (!fn || s_jobCount >= SCHED_MAX_JOBS) return SCHED_INVALID_JOB;
+  SchedJob &j = s_jobs[s_jobCount];
+  memset(&j, 0, sizeof(j));
+  j.name        = name ? name : "?";
+  j.fn          = fn;
+  j.period_ms   = period_ms;
+  j.deadline    = nowMs() + first_delay_ms;
+  j.enabled     = true;
+  j.armed       = true;
+  j.st.name     = j.name;
+  j.st.period_ms = period_ms;
+  return s_jobCount++;
+}
+
+void sched_setPeriod(int id, uint32_t period_ms) {
+  if (!validId(id)) return;
+  SchedJob &j = s_jobs[id];
+  if (j.period_ms == period_ms) return;
+  j.period_ms = period_ms;
+  j.st.period_ms = period_ms;
+  // pull a far-away deadline in when the period gets shorter
+  uint32_t now = nowMs();
+  if (j.armed && (int32_t)(j.deadline - (now + period_ms)) > 0) j.deadline = now + period_ms;
+}
+
+void sched_setNextDeadline(int id, uint32_t delay_ms) {
+  if (!validId(id)) return;
+  SchedJob &j = s_jobs[id];
+  j.deadline = nowMs() + delay_ms;
+  j.armed = true;
+  if (id == s_running) j.rescheduled = true;
+}
+
+void sched_trigger(int id) {
+  if (!validId(id)) return;
+  s_triggered.fetch_or(1UL << id);
+  if (s_wake) s_wake();
+}
+
+void sched_setEnabled(int id, bool enabled) {
+  if (!validId(id)) return;
+  s_jobs[id].enabled = enabled;
+  s_jobs[id].st.enabled = enabled;
+}
+
+uint32_t sched_msUntilDue(int id) {
+  if (!validId(id)) return 0;
+  if (s_triggered.load() & (1UL << id)) return 0;
+  uint32_t now = nowMs();
+  const SchedJob &j = s_jobs[id];
+  return dueAt(j.deadline, now) ? 0 : (j.deadline - now);
+}
+
+// ---------------------------------------------------------
+// DISPATCH
+// ---------------------------------------------------------
+// Triggered jobs become due now (loop task).
+static void applyTriggers(uint32_t now) {
+  uint32_t bits = s_triggered.exchange(0);
+  for (int i = 0; bits; ++i, bits >>= 1) {
+    if (!(bits & 1)) continue;
+    s_jobs[i].deadline = now;
+    s_jobs[i].armed = true;
+  }
+}
+
+static int earliestDue(uint32_t now) {
+  int best = SCHED_INVALID_JOB;
+  for (int i = 0; i < s_jobCount; ++i) {
+    const SchedJob &j = s_jobs[i];
+    if (!j.enabled || !j.armed || !dueAt(j.deadline, now)) continue;
+    if (best < 0 || (int32_t)(j.deadline - s_jobs[best].deadline) < 0) best = i;
+  }
+  return best;
+}
+
+int sched_runDue() {
+  int ran = 0;
+  // Each job runs at most once per call so a job that keeps re-triggering
+  // itself cannot starve the others.
+  bool done[SCHED_MAX_JOBS] = { false };
+
+  for (;;) {
+    uint32_t now = nowMs();
+    applyTriggers(now);
+    int id = SCHED_INVALID_JOB;
+    for (int i = 0; i < s_jobCount; ++i) {
+      const SchedJob &j = s_jobs[i];
+      if (done[i] || !j.enabled || !j.armed || !dueAt(j.deadline, now)) continue;
+      if (id < 0 || (int32_t)(j.deadline - s_jobs[id].deadline) < 0) id = i;
+    }
+    if (id < 0) break;
+
+    SchedJob &j = s_jobs[id];
+    done[id] = true;
+
+    uint32_t late = now - j.deadline;
+    j.st.last_late_ms = late;
+    if (late > j.st.max_late_ms) j.st.max_late_ms = late;
+
+    j.rescheduled = false;
+    s_running = id;
+    uint32_t t0 = nowUs();
+    j.fn();
+    uint32_t dt = nowUs() - t0;
+    s_running = SCHED_INVALID_JOB;
+
+    j.st.runs++;
+    j.st.last_run_us = dt;
+    j.st.total_run_us += dt;
+    if (dt > j.st.max_run_us) j.st.max_run_us = dt;
+
+    if (!j.rescheduled) {
+      if (j.period_ms == 0) {
+        j.armed = false;
+      } else {
+        // keep phase; if we fell a whole period behind, restart from now
+        j.deadline += j.period_ms;
+        uint32_t after = nowMs();
+        if (dueAt(j.deadline, after)) j.deadline = after + j.period_ms;
+      }
+    }
+    ran++;
+  }
+  return ran;
+}
+
+uint32_t sched_msUntilNext(uint32_t max_ms) {
+  uint32_t now = nowMs();
+  applyTriggers(now);
+  if (earliestDue(now) >= 0) return 0;
+  uint32_t best = max_ms;
+  for (int i = 0; i < s_jobCount; ++i) {
+    const SchedJob &j = s_jobs[i];
+    if (!j.enabled || !j.armed) continue;
+    uint32_t in = j.deadline - now;
+    if (in < best) best = in;
+  }
+  return best;
+}
+
+// ---------------------------------------------------------
+// HOOKS / STATS
+// ---------------------------------------------------------
+void sched_setClock(SchedClockFn ms_clock, SchedClockFn us_clock) {
+  s_msClock = ms_clock;
+  s_usClock = us_clock;
+}
+
+void sched_setWakeHook(SchedWakeFn fn) { s_wake = fn; }
+
+int sched_jobCount() { return s_jobCount; }
+
+bool sched_getStats(int id, SchedJobStats &out) {
+  if (!validId(id)) return false;
+  out = s_jobs[id].st;
+  out.enabled = s_jobs[id].enabled;
+  return true;
+}
+
+void sched_resetStats() {
+  for (int i = 0; i < s_jobCount; ++i) {
+    SchedJobStats &st = s_jobs[i].st;
+    st.runs = 0;
+    st.last_run_us = st.max_run_us = 0;
+    st.total_run_us = 0;
+    st.last_late_ms = st.max_late_ms = 0;
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// scheduler.h : deadline-driven cooperative scheduler used by loop().
+//
+// Each module registers a job with a period (or moves its own next deadline),
+// loop() calls sched_runDue() to run every job that is due and then sleeps
+// for sched_msUntilNext() instead of polling everything back-to-back.
+//
+// The module has no Arduino dependency: time comes from a pluggable clock
+// (millis()/micros() on the board, a fake clock when built on a host).
+
+#ifndef SCHED_MAX_JOBS
+#define SCHED_MAX_JOBS 16
+#endif
+
+#define SCHED_INVALID_JOB (-1)
+
+typedef void (*SchedJobFn)(void);
+typedef uint32_t (*SchedClockFn)(void);
+typedef void (*SchedWakeFn)(void);
+
+// Per-job timing statistics (run time in us, lateness in ms).
+struct SchedJobStats {
+  const char *name;
+  uint32_t period_ms;
+  uint32_t runs;
+  uint32_t last_run_us;
+  uint32_t max_run_us;
+  uint64_t total_run_us;
+  uint32_t last_late_ms;
+  uint32_t max_late_ms;
+  bool     enabled;
+};
+
+// Register a job. period_ms == 0 makes a one-shot job that only runs again
+// after sched_setNextDeadline()/sched_trigger(). Returns the job id or
+// SCHED_INVALID_JOB when the table is full.
+int  sched_addJob(const char *name, SchedJobFn fn, uint32_t period_ms, uint32_t first_delay_ms = 0);
+
+void sched_setPeriod(int id, uint32_t period_ms);
+void sched_setNextDeadline(int id, uint32_t delay_ms); // due delay_ms from now
+void sched_trigger(int id);                            // due now; wakes loop (any task, not an ISR)
+void sched_setEnabled(int id, bool enabled);
+uint32_t sched_msUntilDue(int id);                     // 0 if due or unknown
+
+// Run all due jobs (earliest deadline first). Returns the number of jobs run.
+int  sched_runDue();
+
+// Milliseconds until the earliest enabled job is due, capped at max_ms.
+uint32_t sched_msUntilNext(uint32_t max_ms);
+
+// Clock / wake hooks. ms_clock is required on a host build, us_clock may be
+// NULL (run times are then measured in ms * 1000).
+void sched_setClock(SchedClockFn ms_clock, SchedClockFn us_clock);
+void sched_setWakeHook(SchedWakeFn fn);
+
+int  sched_jobCount();
+bool sched_getStats(int id, SchedJobStats &out);
+void sched_resetStats();
+
+#endif // SCHEDULER_H
@@ -1,37 +1,37 @@
 #include "sd_logger.h"
 #include "config.h"
+#include "telemetry.h"
 #include <SD.h>
 #include <time.h>
 
-// External sensor globals
-extern float test_weight;
-extern float test_temp_int;
-extern float test_hum_int;
-extern float test_temp_ext;
-extern float test_hum_ext;
-extern float test_pressure;
-extern float test_acc_x;
-extern float test_acc_y;
-extern float test_acc_z;
-extern float test_batt_voltage;
-extern int test_batt_percent;
-extern double test_lat;
-extern double test_lon;
-extern int test_rssi;
+// External state
 extern int connectivityMode;
 extern bool sd_present;
 
 // Static variables
 static bool sdlog_enabled = false;
-static String current_filename = "";
+static String current_day = "";          // today's base name, /beehive_YYYYMMDD.csv
+static String current_filename = "";      // the file written to (may have a _N suffix)
 static int record_count = 0;
 static String last_timestamp = "";
 
-// CSV header
-static const char* CSV_HEADER = 
-  "Timestamp,Date,Time,Weight_kg,Temp_Int_C,Hum_Int_%,Temp_Ext_C,Hum_Ext_%,"
+// CSV header: one weight column per load-cell channel (Weight_kg with a
+// single channel, Weight1_kg..WeightN_kg otherwise)
+static const char* CSV_HEADER_HEAD = "Timestamp,Date,Time,";
+static const char* CSV_HEADER_TAIL =
+  "Temp_Int_C,Hum_Int_%,Temp_Ext_C,Hum_Ext_%,"
   "Pressure_hPa,Acc_X,Acc_Y,Acc_Z,Battery_V,Battery_%,Latitude,Longitude,RSSI_dBm,Network";
 
+static String csvHeader() {
+  String h = CSV_HEADER_HEAD;
+  if (LOADCELL_CHANNELS == 1) {
+    h += "Weight_kg,";
+  } else {
+    for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) h += "Weight" + String(ch + 1) + "_kg,";
+  }
+  return h + CSV_HEADER_TAIL;
+}
+
 // Helper: Get current date/time strings
 static void getDateTime(String &timestamp, String &date, String &time_str) {
   struct tm timeinfo;
@@ -70,15 +70,45 @@ static String getFilenameForToday() {
   return String(buf);
 }
 
-// Helper: Format float for CSV (empty if NAN)
-static String formatFloat(float value, int decimals = 1) {
-  if (isnan(value)) return "";
+// Helper: true if the file is empty or starts with this header line
+static bool headerMatches(const String &filename, const String &header) {
+  File f = SD.open(filename.c_str(), FILE_READ);
+  if (!f) return false;
+  bool match = (f.size() == 0);
+  if (!match) {
+    String first = f.readStringUntil('\n');
+    first.trim();
+    match = (first == header);
+  }
+  f.close();
+  return match;
+}
+
+// Helper: today's file, or /beehive_YYYYMMDD_N.csv when the existing one
+// was written with other columns (channel count changed): rows are never
+// appended under a header that does not describe them
+static String pickLogFile(const String &base) {
+  String header = csvHeader();
+  String stem = base.substring(0, base.length() - 4);   // drop ".csv"
+  String name = base;
+  for (int n = 2; n <= 99; n++) {
+    if (!SD.exists(name.c_str()) || headerMatches(name, header)) return name;
+    Serial.print("[SDLOG] Columns changed, not appending to ");
+    Serial.println(name);
+    name = stem + "_" + String(n) + ".csv";
+  }
+  return name;
+}
+
+// Helper: Format float for CSV (empty if the field is not valid)
+static String formatFloat(const TelemetrySnapshot &s, uint32_t field, float value, int decimals = 1) {
+  if (!telemetry_has(s, field)) return "";
   return String(value, decimals);
 }
 
-// Helper: Format int for CSV (empty if sentinel)
-static String formatInt(int value, int sentinel = -999) {
-  if (value == sentinel) return "";
+// Helper: Format int for CSV (empty if the field is not valid)
+static String formatInt(const TelemetrySnapshot &s, uint32_t field, int value) {
+  if (!telemetry_has(s, field)) return "";
   return String(value);
 }
 
@@ -111,16 +141,16 @@ bool sdlog_write() {
   // Get current filename
   String filename = getFilenameForToday();
   
-  // Check if file exists (need to write header if new file)
-  bool file_exists = SD.exists(filename.c_str());
-  bool is_new_day = (filename != current_filename);
+  bool is_new_day = (filename != current_day);
   
   if (is_new_day) {
-    current_filename = filename;
+    current_day = filename;
+    current_filename = pickLogFile(filename);
     record_count = 0;
     Serial.print("[SDLOG] New day, file: ");
-    Serial.println(filename);
+    Serial.println(current_filename);
   }
+  filename = current_filename;
   
   // Open file for append
   File dataFile = SD.open(filename.c_str(), FILE_APPEND);
@@ -129,9 +159,9 @@ bool sdlog_write() {
     return false;
   }
   
-  // Write header if new file
-  if (!file_exists) {
-    dataFile.println(CSV_HEADER);
+  // Write header if new (or empty) file
+  if (dataFile.size() == 0) {
+    dataFile.println(csvHeader());
     Serial.println("[SDLOG] Wrote CSV header");
   }
   
@@ -140,25 +170,32 @@ bool sdlog_write() {
   getDateTime(timestamp, date, time_str);
   last_timestamp = timestamp;
   
+  // One snapshot per record so the row never mixes sampling moments
+  TelemetrySnapshot t;
+  telemetry_read(t);
+
   // Build CSV row
   String row = "";
+  row.reserve(192);
   row += timestamp + ",";
   row += date + ",";
   row += time_str + ",";
-  row += formatFloat(test_weight, 2) + ",";
-  row += formatFloat(test_temp_int, 1) + ",";
-  row += formatFloat(test_hum_int, 1) + ",";
-  row += formatFloat(test_temp_ext, 1) + ",";
-  row += formatFloat(test_hum_ext, 1) + ",";
-  row += formatFloat(test_pressure, 1) + ",";
-  row += formatFloat(test_acc_x, 3) + ",";
-  row += formatFloat(test_acc_y, 3) + ",";
-  row += formatFloat(test_acc_z, 3) + ",";
-  row += formatFloat(test_batt_voltage, 2) + ",";
-  row += formatInt(test_batt_percent) + ",";
-  row += String(test_lat, 6) + ",";
-  row += String(test_lon, 6) + ",";
-  row += formatInt(test_rssi) + ",";
+  for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+    row += (telemetry_hasWeight(t, ch) ? String(t.weight[ch], 2) : String("")) + ",";
+  }
+  row += formatFloat(t, TLM_TEMP_INT, t.temp_int, 1) + ",";
+  row += formatFloat(t, TLM_HUM_INT,  t.hum_int, 1) + ",";
+  row += formatFloat(t, TLM_TEMP_EXT, t.temp_ext, 1) + ",";
+  row += formatFloat(t, TLM_HUM_EXT,  t.hum_ext, 1) + ",";
+  row += formatFloat(t, TLM_PRESSURE, t.pressure, 1) + ",";
+  row += formatFloat(t, TLM_ACCEL,    t.acc_x, 3) + ",";
+  row += formatFloat(t, TLM_ACCEL,    t.acc_y, 3) + ",";
+  row += formatFloat(t, TLM_ACCEL,    t.acc_z, 3) + ",";
+  row += formatFloat(t, TLM_BATT_V,   t.batt_voltage, 2) + ",";
+  row += formatInt(t, TLM_BATT_PCT, t.batt_percent) + ",";
+  row += (telemetry_has(t, TLM_GPS) ? String(t.lat, 6) : String("")) + ",";
+  row += (telemetry_has(t, TLM_GPS) ? String(t.lon, 6) : String("")) + ",";
+  row += formatInt(t, TLM_RSSI, t.rssi) + ",";
   row += getNetworkName();
   
   // Write row
@@ -0,0 +1,291 @@
+// seg_queue.cpp
+// Segmented, CRC-framed persistent queue (see seg_queue.h).
+
+#include "seg_queue.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define SQ_MAGIC0     0xA5
+#define SQ_MAGIC1     0x5A
+#define SQ_HDR        8
+#define SQ_CUR_MAGIC  0x31435153UL   // "SQC1"
+
+struct SqCursor {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t seg;
+  uint32_t off;
+  uint32_t crc;      // over the fields above
+};
+
+uint32_t sq_crc32(const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+  }
+  return ~crc;
+}
+
+static void sq_segPath(const SegQueue &q, uint32_t seg, char *out, size_t cap) {
+  snprintf(out, cap, "%s/%08lu.seg", q.dir, (unsigned long)seg);
+}
+
+static void sq_curPath(const SegQueue &q, int slot, char *out, size_t cap) {
+  snprintf(out, cap, "%s/cursor%d", q.dir, slot);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void sq_closeReader(SegQueue &q) {
+  if (q.rd) fclose(q.rd);
+  q.rd = nullptr;
+}
+
+static bool sq_readCursor(const SegQueue &q, int slot, SqCursor &c) {
+  char path[48];
+  sq_curPath(q, slot, path, sizeof(path));
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  bool ok = fread(&c, 1, sizeof(c), f) == sizeof(c);
+  fclose(f);
+  return ok && c.magic == SQ_CUR_MAGIC && c.crc == sq_crc32(&c, offsetof(SqCursor, crc));
+}
+
+// Alternate slots: a cut while writing one leaves the other intact.
+static bool sq_writeCursor(SegQueue &q) {
+  SqCursor c = { SQ_CUR_MAGIC, q.cur_seq + 1, q.head.seg, q.head.off, 0 };
+  c.crc = sq_crc32(&c, offsetof(SqCursor, crc));
+  char path[48];
+  sq_curPath(q, (int)(c.seq & 1U), path, sizeof(path));
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  bool ok = fwrite(&c, 1, sizeof(c), f) == sizeof(c);
+  ok = (fclose(f) == 0) && ok;
+  if (ok) q.cur_seq = c.seq;
+  return ok;
+}
+
+static void sq_removeSeg(SegQueue &q, uint32_t seg) {
+  char path[48];
+  if (q.rd && q.rd_seg == seg) sq_closeReader(q);
+  sq_segPath(q, seg, path, sizeof(path));
+  if (remove(path) == 0) q.stats.segs_deleted++;
+}
+
+bool sq_open(SegQueue &q, const char *dir, uint32_t seg_bytes) {
+  memset(&q, 0, sizeof(q));
+  snprintf(q.dir, sizeof(q.dir), "%s", dir);
+  q.seg_bytes = seg_bytes;
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+    struct stat st;
+    if (stat(dir, &st) != 0) return false;
+  }
+
+  // Segment range on the card
+  uint32_t lo = 0xFFFFFFFFUL, hi = 0;
+  bool any = false;
+  DIR *d = opendir(dir);
+  if (!d) return false;
+  struct dirent *e;
+  while ((e = readdir(d)) != nullptr) {
+    char *end;
+    unsigned long n = strtoul(e->d_name, &end, 10);
+    if (end == e->d_name || strcmp(end, ".seg") != 0) continue;
+    any = true;
+    if (n < lo) lo = n;
+    if (n > hi) hi = n;
+  }
+  closedir(d);
+
+  SqCursor c0, c1;
+  bool v0 = sq_readCursor(q, 0, c0), v1 = sq_readCursor(q, 1, c1);
+  if (v0 || v1) {
+    const SqCursor &c = (v0 && v1) ? ((int32_t)(c1.seq - c0.seq) > 0 ? c1 : c0) : (v0 ? c0 : c1);
+    q.head.seg = c.seg;
+    q.head.off = c.off;
+    q.cur_seq = c.seq;
+  } else {
+    q.head.seg = any ? lo : 1;
+    q.head.off = 0;
+  }
+
+  // Acknowledged segments whose deletion a reset interrupted
+  for (uint32_t s = lo; any && s < q.head.seg && s <= hi; s++) sq_removeSeg(q, s);
+
+  // Never append to a segment from before (it may end in a torn record)
+  q.wr_seg = (any && hi + 1 > q.head.seg + 1) ? hi + 1 : q.head.seg + 1;
+  q.wr_off = 0;
+
+  // Nothing left to read (fresh, or drained before the reset): start at
+  // the append segment so the queue reports empty, no segments, no backlog
+  bool readable = any && hi > q.head.seg;
+  if (!readable) {
+    char path[48];
+    struct stat st;
+    sq_segPath(q, q.head.seg, path, sizeof(path));
+    if (stat(path, &st) == 0) {
+      readable = (uint32_t)st.st_size > q.head.off;
+      if (!readable) sq_removeSeg(q, q.head.seg);
+    }
+  }
+  if (!readable) {
+    q.head.seg = q.wr_seg;
+    q.head.off = 0;
+    if (v0 || v1) sq_writeCursor(q);   // best effort: the old cursor reads the same
+  }
+  q.peek = q.head;
+  q.open = true;
+  return true;
+}
+
+void sq_close(SegQueue &q) {
+  sq_closeReader(q);
+  q.open = false;
+}
+
+bool sq_push(SegQueue &q, const void *data, size_t len) {
+  if (!q.open || len == 0 || len > SQ_MAX_RECORD) { q.stats.push_failed++; return false; }
+  if (q.wr_off && q.wr_off + SQ_HDR + len > q.seg_bytes) {
+    q.wr_seg++;
+    q.wr_off = 0;
+  }
+
+  uint8_t hdr[SQ_HDR] = { SQ_MAGIC0, SQ_MAGIC1, (uint8_t)len, (uint8_t)(len >> 8) };
+  put32(hdr + 4, sq_crc32(data, len));
+  char path[48];
+  sq_segPath(q, q.wr_seg, path, sizeof(path));
+  FILE *f = fopen(path, "ab");
+  if (!f) { q.stats.push_failed++; return false; }
+  bool ok = fwrite(hdr, 1, SQ_HDR, f) == SQ_HDR && fwrite(data, 1, len, f) == len;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) {
+    // whatever made it to the card is a torn frame: leave that segment
+    q.stats.push_failed++;
+    q.wr_seg++;
+    q.wr_off = 0;
+    return false;
+  }
+  q.wr_off += SQ_HDR + len;
+  q.stats.pushed++;
+  return true;
+}
+
+static void sq_nextSeg(SegQueue &q) {
+  q.peek.seg++;
+  q.peek.off = 0;
+}
+
+int sq_peek(SegQueue &q, void *buf, size_t cap) {
+  if (!q.open) return 0;
+  for (;;) {
+    if (q.peek.seg > q.wr_seg) return 0;
+    if (q.peek.seg == q.wr_seg && q.peek.off >= q.wr_off) return 0;
+
+    if (!q.rd || q.rd_seg != q.peek.seg) {
+      char path[48];
+      sq_closeReader(q);
+      sq_segPath(q, q.peek.seg, path, sizeof(path));
+      q.rd = fopen(path, "rb");
+      q.rd_seg = q.peek.seg;
+      if (!q.rd) {
+        if (q.peek.seg == q.wr_seg) return 0;
+        sq_nextSeg(q);              // gap (deleted / never written)
+        continue;
+      }
+    }
+
+    uint8_t hdr[SQ_HDR];
+    fseek(q.rd, (long)q.peek.off, SEEK_SET);   // also drops stale read buffering
+    size_t n = fread(hdr, 1, SQ_HDR, q.rd);
+    if (n == 0) {
+      if (q.peek.seg == q.wr_seg) return 0;
+      sq_nextSeg(q);                // end of an older segment
+      continue;
+    }
+
+    size_t len = hdr[2] | ((size_t)hdr[3] << 8);
+    bool ok = n == SQ_HDR && hdr[0] == SQ_MAGIC0 && hdr[1] == SQ_MAGIC1 &&
+              len > 0 && len <= SQ_MAX_RECORD && len <= cap &&
+              fread(buf, 1, len, q.rd) == len && sq_crc32(buf, len) == get32(hdr + 4);
+    if (!ok) {
+      // Torn or damaged: nothing after it in this segment can be trusted
+      // to be framed, so go on with the next one (and write elsewhere).
+      q.stats.corrupt++;
+      if (q.peek.seg == q.wr_seg) { q.wr_seg++; q.wr_off = 0; }
+      sq_nextSeg(q);
+      continue;
+    }
+    q.peek.off += (uint32_t)(SQ_HDR + len);
+    q.peeked++;
+    return (int)len;
+  }
+}
+
+// Nothing after the peek position: it is at the append point, or at the
+// end of the last segment written before a reopen (nothing appended since).
+static bool sq_drained(const SegQueue &q) {
+  if (q.peek.seg == q.wr_seg) return q.peek.off >= q.wr_off;
+  if (q.wr_off || q.peek.seg + 1 != q.wr_seg) return false;
+  char path[48];
+  struct stat st;
+  sq_segPath(q, q.peek.seg, path, sizeof(path));
+  return stat(path, &st) != 0 || (uint32_t)st.st_size <= q.peek.off;
+}
+
+bool sq_ack(SegQueue &q) {
+  if (!q.open) return false;
+  if (q.peek.seg == q.head.seg && q.peek.off == q.head.off) return true;
+  uint32_t from = q.head.seg;
+
+  // Drained completely: start over in a fresh segment so the card is empty
+  if (sq_drained(q)) {
+    if (q.wr_off) {
+      q.wr_seg++;
+      q.wr_off = 0;
+    }
+    q.peek.seg = q.wr_seg;
+    q.peek.off = 0;
+  }
+
+  SqPos old = q.head;
+  q.head = q.peek;
+  if (!sq_writeCursor(q)) {
+    q.head = old;
+    return false;
+  }
+  q.stats.acked += q.peeked;
+  q.peeked = 0;
+  for (uint32_t s = from; s < q.head.seg; s++) sq_removeSeg(q, s);
+  return true;
+}
+
+void sq_rewind(SegQueue &q) {
+  q.peek = q.head;
+  q.peeked = 0;
+}
+
+bool sq_empty(const SegQueue &q) {
+  return q.head.seg > q.wr_seg || (q.head.seg == q.wr_seg && q.head.off >= q.wr_off);
+}
+
+uint32_t sq_backlogBytes(const SegQueue &q) {
+  if (sq_empty(q)) return 0;
+  if (q.head.seg == q.wr_seg) return q.wr_off - q.head.off;
+  return (q.wr_seg - q.head.seg) * q.seg_bytes - q.head.off + q.wr_off;
+}
+
+uint32_t sq_segments(const SegQueue &q) {
+  if (sq_empty(q)) return 0;
+  return q.wr_seg - q.head.seg + (q.wr_off ? 1 : 0);
+}
@@ -0,0 +1,81 @@
+#ifndef SEG_QUEUE_H
+#define SEG_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// seg_queue.h : persistent FIFO of records on the SD card.
+//
+// Records are appended to numbered segment files ("<dir>/00000012.seg")
+// of at most seg_bytes each. Every record is framed
+//   [0xA5][0x5A][len lo][len hi][crc32 of payload, 4 bytes LE][payload]
+// so a record torn by a power cut, or a bad sector, is detected and
+// skipped (rest of that segment) instead of being sent as garbage.
+//
+// The reader never removes data: it peeks records after the acknowledged
+// position, and sq_ack() moves that position forward. The position lives
+// in two small cursor files written alternately (sequence number + CRC),
+// so a cut during the write leaves the previous one valid. Segments the
+// acknowledged position has left behind are deleted whole; nothing is
+// ever rewritten.
+//
+// Memory is O(1) in the queue length: the state is a few counters and
+// one open read handle. Plain stdio on the VFS path (the SD card is
+// mounted at "/sd" by SD.begin()), so the module also builds on a PC.
+
+#define SQ_MAX_RECORD 512    // payload bytes per record
+
+struct SqPos {
+  uint32_t seg;
+  uint32_t off;
+};
+
+struct SqStats {
+  uint32_t pushed;
+  uint32_t push_failed;     // SD error or record too large
+  uint32_t acked;           // records acknowledged
+  uint32_t corrupt;         // bad frames (segment tail skipped)
+  uint32_t segs_deleted;
+};
+
+struct SegQueue {
+  char     dir[32];
+  uint32_t seg_bytes;
+  SqPos    head;            // first unacknowledged record (persisted)
+  SqPos    peek;            // next record sq_peek() returns
+  uint32_t peeked;          // records peeked since head
+  uint32_t wr_seg;          // segment being appended to
+  uint32_t wr_off;          // its size
+  uint32_t cur_seq;         // cursor write sequence
+  FILE    *rd;              // read handle on segment rd_seg
+  uint32_t rd_seg;
+  bool     open;
+  SqStats  stats;
+};
+
+// Open (creating dir if needed) and recover the position. Appends go to a
+// fresh segment, so a torn tail from before a reset is never appended to.
+bool sq_open(SegQueue &q, const char *dir, uint32_t seg_bytes);
+void sq_close(SegQueue &q);
+
+bool sq_push(SegQueue &q, const void *data, size_t len);
+
+// Next record after the last one peeked: payload length, 0 = none left.
+// Does not consume anything; see sq_ack() / sq_rewind().
+int  sq_peek(SegQueue &q, void *buf, size_t cap);
+
+// Everything peeked so far was delivered: persist the new position and
+// delete segments left behind.
+bool sq_ack(SegQueue &q);
+
+// Delivery failed: the next sq_peek() starts at the acknowledged position.
+void sq_rewind(SegQueue &q);
+
+bool     sq_empty(const SegQueue &q);
+uint32_t sq_backlogBytes(const SegQueue &q);   // framed bytes not yet acknowledged (approx.)
+uint32_t sq_segments(const SegQueue &q);       // segment files in use
+
+uint32_t sq_crc32(const void *data, size_t len);
+
+#endif // SEG_QUEUE_H
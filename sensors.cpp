@@ -1,34 +1,20 @@
 // sensors.cpp
-// Bridge module: does NOT define test_* globals (they are defined in the .ino).
-// Provides sensors_init() and sensors_update() that operate on the globals that
-// already exist in the sketch (declared extern in config.h).
-//
-// IMPORTANT: keep your .ino definitions (the placeholders) as-is; this file
-// must NOT re-declare/define them.
+// Sensor module: probes the sensors, performs the raw reads used by the
+// acquisition task and publishes results through telemetry.h.
 #include "config.h"
 #include "sensors.h"
+#include "telemetry.h"
+#include "motion_detector.h"
+#include "calibration.h"
+#include "battery_monitor.h"
+#include "gnss.h"
+#include "ui.h"
+#include "safe_freertos.h"
 #include <Adafruit_MPU6050.h>
 #include <Adafruit_Sensor.h>
 #include <Wire.h>
 #include "modem_manager.h"
 
-// The actual globals are defined in the .ino (placeholders).
-// Here we only declare them as extern so this translation unit can use them.
-extern float test_weight;
-extern float test_temp_int;
-extern float test_hum_int;
-extern float test_temp_ext;
-extern float test_hum_ext;
-extern float test_pressure;
-extern float test_acc_x;
-extern float test_acc_y;
-extern float test_acc_z;
-extern float test_batt_voltage;
-extern int   test_batt_percent;
-extern int   test_rssi;
-extern double test_lat;
-extern double test_lon;
-
 // External alarm trigger (implemented in .ino)
 extern void trigger_alarm(String reason);
 
@@ -36,6 +22,104 @@ static bool sensors_initialized = false;
 static Adafruit_MPU6050 mpu;
 static bool mpu_found = false;
 
+static bool mpu_fifo = false;        // accel samples are collected in the MPU FIFO
+static bool mpu_motion_irq = false;  // hardware motion detection wakes the acquisition task
+static uint32_t mpu_fifo_overflows = 0;
+
+// movement check on every accelerometer sample (loop task)
+static MotionDetector motion;
+static uint32_t motion_irq_events = 0;
+
+// ---------------------------------------------------------
+// MPU6050 raw register access (FIFO is not exposed by the Adafruit driver)
+// ---------------------------------------------------------
+#define MPU_ADDR             0x68
+#define MPU_REG_FIFO_EN      0x23
+#define MPU_REG_INT_STATUS   0x3A
+#define MPU_REG_USER_CTRL    0x6A
+#define MPU_REG_FIFO_COUNTH  0x72
+#define MPU_REG_FIFO_R_W     0x74
+
+#define MPU_FIFO_EN_ACCEL    0x08
+#define MPU_USER_FIFO_EN     0x40
+#define MPU_USER_FIFO_RESET  0x04
+#define MPU_INT_MOT          0x40
+#define MPU_INT_FIFO_OFLOW   0x10
+
+#define MPU_FIFO_CHUNK       20      // samples per I2C read (6 bytes each, fits the 128-byte Wire buffer)
+#define MPU_ACCEL_SCALE      (SENSORS_GRAVITY_STANDARD / 16384.0f)   // +-2g range
+
+static bool mpu_writeReg(uint8_t reg, uint8_t val) {
+  Wire.beginTransmission(MPU_ADDR);
+  Wire.write(reg);
+  Wire.write(val);
+  return Wire.endTransmission() == 0;
+}
+
+static bool mpu_readRegs(uint8_t reg, uint8_t *buf, size_t len) {
+  Wire.beginTransmission(MPU_ADDR);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom((uint8_t)MPU_ADDR, (uint8_t)len) != len) return false;
+  for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)Wire.read();
+  return true;
+}
+
+// ---------------------------------------------------------
+// SI7021 internal temperature / humidity (raw I2C, no-hold-master mode:
+// start a conversion, come back for the result, no clock stretching)
+// ---------------------------------------------------------
+#define SI7021_ADDR          0x40
+#define SI7021_MEASURE_RH    0xF5   // RH conversion (also converts temperature)
+#define SI7021_READ_T_PREV   0xE0   // temperature of the last RH conversion
+#define SI7021_CONV_MS       25     // 12-bit RH 12 ms + 14-bit T 10.8 ms
+
+static bool si_found = false;
+static bool si_converting = false;
+static float die_temp_c = 0.0f;     // ESP32 die temperature (compensation fallback)
+static bool die_temp_valid = false;
+
+static bool si_command(uint8_t cmd) {
+  Wire.beginTransmission(SI7021_ADDR);
+  Wire.write(cmd);
+  return Wire.endTransmission() == 0;
+}
+
+static bool si_read16(uint16_t &v) {
+  if (Wire.requestFrom((uint8_t)SI7021_ADDR, (uint8_t)2) != 2) return false;
+  v = (uint16_t)Wire.read() << 8;
+  v |= (uint16_t)Wire.read();
+  return true;
+}
+
+static void mpu_fifoReset() {
+  mpu_writeReg(MPU_REG_USER_CTRL, MPU_USER_FIFO_RESET);
+  mpu_writeReg(MPU_REG_USER_CTRL, MPU_USER_FIFO_EN);
+}
+
+// Accel-only FIFO at 1 kHz / (1 + MPU_SAMPLE_DIV) plus the motion-detect
+// interrupt (latched, cleared when the acquisition task reads INT_STATUS).
+static void mpu_setupFifoAndMotion() {
+  mpu.setSampleRateDivisor(MPU_SAMPLE_DIV);
+  mpu_fifo = mpu_writeReg(MPU_REG_FIFO_EN, MPU_FIFO_EN_ACCEL);
+  if (mpu_fifo) mpu_fifoReset();
+
+#if MPU_INT_PIN >= 0
+  mpu.setHighPassFilter(MPU6050_HIGHPASS_0_63_HZ);
+  mpu.setMotionDetectionThreshold(MPU_MOTION_THRESHOLD);
+  mpu.setMotionDetectionDuration(MPU_MOTION_DURATION);
+  mpu.setInterruptPinLatch(true);
+  mpu.setInterruptPinPolarity(false);   // active high
+  mpu.setMotionInterrupt(true);
+  mpu_motion_irq = true;
+#endif
+
+#if ENABLE_DEBUG
+  Serial.printf("[SENS] MPU6050 FIFO %s, motion interrupt %s\n",
+                mpu_fifo ? "on" : "FAILED", mpu_motion_irq ? "on" : "off");
+#endif
+}
+
 bool sensors_init() {
   if (sensors_initialized) return true;
 
@@ -56,8 +140,28 @@ bool sensors_init() {
     mpu.setAccelerometerRange(MPU6050_RANGE_2_G);
     mpu.setGyroRange(MPU6050_RANGE_250_DEG);
     mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
+    mpu_setupFifoAndMotion();
   }
 
+  // SI7021: probe once (the acquisition task is not running yet)
+  si_found = si_command(SI7021_MEASURE_RH);
+  si_converting = si_found;
+  Serial.println(si_found ? "[SENS] SI7021 Found!" : "[SENS] No SI7021 (internal T/H)");
+
+  MotionConfig mc;
+  mc.threshold = MOTION_THRESHOLD;
+  mc.baseline_alpha = MOTION_BASELINE_ALPHA;
+  mc.debounce_samples = MOTION_DEBOUNCE_SAMPLES;
+  mc.window_samples = MOTION_WINDOW_SAMPLES;
+  mc.cooldown_ms = MOTION_COOLDOWN_MS;
+  mc.settle_ms = MOTION_SETTLE_MS;
+  mc.max_alarms_per_hour = MOTION_MAX_ALARMS_PER_HOUR;
+  motion_init(motion, mc, millis());
+
+  // HX711 + saved calibration; samples come from the acquisition task
+  calib_init();
+  battery_init();
+
   // Ensure GPS is enabled on the modem
   // Note: This might take time if modem is not ready, so we do best effort.
   // Ideally modem_manager handles its own init.
@@ -68,17 +172,83 @@ bool sensors_init() {
   return true;
 }
 
+// Publish one channel's filtered, temperature-compensated weight (no I/O).
+static bool sensors_publish_weight(int ch) {
+  float kg;
+  uint8_t conf;
+  if (!calib_getWeightKg(ch, kg, &conf)) {
+    telemetry_invalidateWeight(ch);
+    return false;
+  }
+  telemetry_setWeight(ch, kg, conf);
+  return true;
+}
+
+// Temperature compensation follows the internal temperature; without an
+// SI7021 reading, the ESP32 die temperature if TEMP_COMP_DIE_FALLBACK.
+static void sensors_update_temperature_comp() {
+  TelemetrySnapshot t;
+  telemetry_read(t);
+  if (telemetry_has(t, TLM_TEMP_INT)) calib_setTemperature(true, t.temp_int);
+  else calib_setTemperature(die_temp_valid, die_temp_c);
+}
+
 bool sensors_update_loadcell() {
-  // Replace with real HX711 reading code once load cell is connected.
-  // Example: long raw = hx.read_average(...); test_weight = (raw - offset) / factor / 1000.0;
-  (void)0;
+  sensors_update_temperature_comp();
+  bool ok = true;
+  for (int ch = 0; ch < calib_channelCount(); ch++) ok &= sensors_publish_weight(ch);
+  return ok;
+}
+
+bool sensors_poll_internal(uint32_t &next_ms) {
+  next_ms = INT_CLIMATE_PERIOD_MS;
+#if TEMP_COMP_DIE_FALLBACK
+  if (!si_found) {
+    die_temp_c = temperatureRead();
+    die_temp_valid = true;
+    sensors_update_temperature_comp();
+    return false;
+  }
+#endif
+  if (!si_found) return false;
+
+  // the bus is shared with the LCD and the acquisition task
+  if (!safeSemaphoreTake(lcdMutex, pdMS_TO_TICKS(50), "si7021")) {
+    next_ms = 100;
+    return false;
+  }
+  bool ok = false;
+  uint16_t rh_raw = 0, t_raw = 0;
+  if (!si_converting) {
+    si_converting = si_command(SI7021_MEASURE_RH);
+    if (si_converting) next_ms = SI7021_CONV_MS;
+  } else {
+    si_converting = false;
+    ok = si_read16(rh_raw) && si_command(SI7021_READ_T_PREV) && si_read16(t_raw);
+    // start the next conversion right away: it is ready long before the next poll
+    si_converting = si_command(SI7021_MEASURE_RH);
+  }
+  safeSemaphoreGive(lcdMutex, "si7021");
+  if (!ok) {
+    if (next_ms != SI7021_CONV_MS) telemetry_invalidate(TLM_TEMP_INT | TLM_HUM_INT);
+    return false;
+  }
+
+  float rh = 125.0f * rh_raw / 65536.0f - 6.0f;
+  float tc = 175.72f * t_raw / 65536.0f - 46.85f;
+  if (rh < 0.0f) rh = 0.0f;
+  if (rh > 100.0f) rh = 100.0f;
+  telemetry_setInternal(tc, rh);
+  sensors_update_temperature_comp();
   return true;
 }
 
 bool sensors_update_internal() {
-  // Replace with real SI7021 or other internal T/H sensor read.
-  (void)0;
-  return true;
+  uint32_t next_ms;
+  if (sensors_poll_internal(next_ms)) return true;
+  if (next_ms > SI7021_CONV_MS) return !si_found;   // nothing to wait for
+  delay(next_ms);
+  return sensors_poll_internal(next_ms);
 }
 
 bool sensors_update_external() {
@@ -87,69 +257,162 @@ bool sensors_update_external() {
   return true;
 }
 
-bool sensors_update_accel() {
+// Raw MPU6050 read (I2C). Called from the acquisition task, which holds the
+// I2C bus lock; publishes nothing.
+bool sensors_read_accel(float &x, float &y, float &z) {
   if (!mpu_found) return false;
 
   sensors_event_t a, g, temp;
   mpu.getEvent(&a, &g, &temp);
 
-  float new_x = a.acceleration.x;
-  float new_y = a.acceleration.y;
-  float new_z = a.acceleration.z;
-
-  // Check for movement (alarm)
-  // We compare against the LAST reading (test_acc_x/y/z).
-  // If this is the first reading (NAN), we just store it.
-  if (!isnan(test_acc_x)) {
-    float dx = abs(new_x - test_acc_x);
-    float dy = abs(new_y - test_acc_y);
-    float dz = abs(new_z - test_acc_z);
-
-    if (dx > ACCEL_THRESHOLD || dy > ACCEL_THRESHOLD || dz > ACCEL_THRESHOLD) {
-      String reason = "Motion detected! dX=" + String(dx) + " dY=" + String(dy) + " dZ=" + String(dz);
-      Serial.println("[ALARM] " + reason);
-      trigger_alarm(reason);
+  x = a.acceleration.x;
+  y = a.acceleration.y;
+  z = a.acceleration.z;
+  return true;
+}
+
+int sensors_read_accel_fifo(float (*xyz)[3], int max, bool &motion) {
+  motion = false;
+  if (!mpu_found || !mpu_fifo) return 0;
+
+  // INT_STATUS read also clears the latched INT pin
+  uint8_t st = 0;
+  if (mpu_readRegs(MPU_REG_INT_STATUS, &st, 1)) {
+    if (st & MPU_INT_MOT) motion = true;
+    if (st & MPU_INT_FIFO_OFLOW) {
+      // data in the FIFO is no longer frame aligned
+      mpu_fifo_overflows++;
+      mpu_fifoReset();
+      return 0;
     }
   }
 
-  test_acc_x = new_x;
-  test_acc_y = new_y;
-  test_acc_z = new_z;
+  uint8_t cnt[2];
+  if (!mpu_readRegs(MPU_REG_FIFO_COUNTH, cnt, 2)) return 0;
+  int avail = (((int)cnt[0] << 8) | cnt[1]) / 6;
 
-  return true;
+  uint8_t raw[MPU_FIFO_CHUNK * 6];
+  int n = 0;
+  while (avail > 0 && n < max) {
+    int k = avail;
+    if (k > MPU_FIFO_CHUNK) k = MPU_FIFO_CHUNK;
+    if (k > max - n) k = max - n;
+    if (!mpu_readRegs(MPU_REG_FIFO_R_W, raw, (size_t)k * 6)) break;
+    for (int i = 0; i < k; ++i, ++n) {
+      const uint8_t *r = &raw[i * 6];
+      xyz[n][0] = (int16_t)((r[0] << 8) | r[1]) * MPU_ACCEL_SCALE;
+      xyz[n][1] = (int16_t)((r[2] << 8) | r[3]) * MPU_ACCEL_SCALE;
+      xyz[n][2] = (int16_t)((r[4] << 8) | r[5]) * MPU_ACCEL_SCALE;
+    }
+    avail -= k;
+  }
+  return n;
 }
 
-bool sensors_update_gps() {
-  // Try to enable GPS if not already (idempotent-ish)
-  modem_enableGPS(true);
+bool sensors_accel_fifoEnabled() { return mpu_found && mpu_fifo; }
+bool sensors_accel_motionIrq()   { return mpu_found && mpu_motion_irq; }
+uint32_t sensors_accel_fifoOverflows() { return mpu_fifo_overflows; }
 
-  double lat = 0, lon = 0;
-  
-  // Note: modem.getGPS() can block waiting for AT response.
-  // We can't easily make TinyGSM non-blocking, but we can wrap it
-  // or just accept it takes a few hundred ms. 
-  // If it takes longer (e.g. timeout), it will freeze UI.
-  // For now, let's just ensure we don't block forever.
-  
-  // Actually, better approach: only update GPS if we really need to,
-  // or accept a small freeze. But if it freezes for seconds, that's bad.
-  
-  // Let's try to get GPS.
-  if (modem_getGPS(lat, lon)) {
-    test_lat = lat;
-    test_lon = lon;
-    #if ENABLE_DEBUG
-      Serial.printf("[SENS] GPS Updated: %.6f, %.6f\n", test_lat, test_lon);
-    #endif
-    return true;
+static void sensors_report_motion(MotionEvent ev, bool from_irq) {
+  char reason[80];
+  switch (ev) {
+    case MOTION_EVT_ALARM:
+      if (from_irq)
+        snprintf(reason, sizeof(reason), "Motion detected! (MPU interrupt, alarm %u this hour)",
+                 (unsigned)motion.hour_alarms);
+      else
+        snprintf(reason, sizeof(reason), "Motion detected! dev=%.2f m/s2 (alarm %u this hour)",
+                 motion.last_dev, (unsigned)motion.hour_alarms);
+      Serial.printf("[ALARM] %s\n", reason);
+      trigger_alarm(String(reason));
+      break;
+    case MOTION_EVT_SUPPRESSED:
+      Serial.printf("[ALARM] Motion detected, not sent (%u alarms this hour)\n",
+                    (unsigned)motion.hour_alarms);
+      break;
+    case MOTION_EVT_QUIET:
+#if ENABLE_DEBUG
+      Serial.printf("[SENS] Motion ended (peak dev=%.2f m/s2), cooldown %lu s\n",
+                    motion.peak_dev, (unsigned long)(MOTION_COOLDOWN_MS / 1000UL));
+#endif
+      break;
+    default:
+      break;
+  }
+}
+
+// Motion interrupt seen by the acquisition task (loop task context). The
+// samples around it are normally in the ring and the detector decides
+// whether they are an alarm, so this only counts. If the ring overflowed
+// (loop() blocked longer than it holds) those samples are gone and the
+// interrupt raises the alarm itself.
+void sensors_on_motion_event(uint32_t count, uint32_t t_ms, bool samples_lost) {
+  motion_irq_events += count;
+#if ENABLE_DEBUG
+  Serial.printf("[SENS] MPU motion interrupt x%lu (%lu ms ago), detector %s%s\n",
+                (unsigned long)count, (unsigned long)(millis() - t_ms),
+                motion_stateName(motion.state), samples_lost ? ", samples lost" : "");
+#endif
+  if (samples_lost) sensors_report_motion(motion_trigger(motion, t_ms), true);
+}
+
+// Publish a new accelerometer reading and run the motion detector on it.
+static void sensors_process_accel(float new_x, float new_y, float new_z, uint32_t t_ms) {
+  telemetry_setAccel(new_x, new_y, new_z);
+  sensors_report_motion(motion_update(motion, new_x, new_y, new_z, t_ms), false);
+}
+
+void sensors_apply_sample(const SensorSample &s) {
+  switch (s.type) {
+    case SAMPLE_ACCEL:
+      sensors_process_accel(s.v[0], s.v[1], s.v[2], s.t_ms);
+      break;
+    case SAMPLE_LOADCELL:
+      calib_onRawSample(s.channel, (long)s.v[0], s.t_ms);
+      sensors_update_temperature_comp();
+      sensors_publish_weight(s.channel);
+      break;
+    default:
+      break;
   }
-  return false;
 }
 
+bool sensors_update_accel() {
+  float x, y, z;
+  if (!sensors_read_accel(x, y, z)) return false;
+  sensors_process_accel(x, y, z, millis());
+  return true;
+}
+
+void sensors_motion_setArmed(bool armed) {
+  motion_setArmed(motion, armed, millis());
+  Serial.printf("[SENS] Motion alarm %s\n", armed ? "armed" : "disarmed");
+}
+
+const MotionDetector &sensors_motion() { return motion; }
+uint32_t sensors_motion_irqEvents() { return motion_irq_events; }
+
+// Publish the cached fix from the unsolicited +CGNSSINFO reports (no
+// modem I/O, returns immediately).
+bool sensors_update_gps() {
+  GnssFix fix;
+  if (!gnss_getFix(fix)) return false;
+  uint32_t age = gnss_fixAgeMs(millis());
+  if (age > GNSS_MAX_FIX_AGE_MS) return false;
+  telemetry_setGps(fix.lat, fix.lon);
+  #if ENABLE_DEBUG
+    Serial.printf("[SENS] GPS Updated: %.6f, %.6f (%u sats, %lus old)\n",
+                  fix.lat, fix.lon, (unsigned)fix.sats, (unsigned long)(age / 1000UL));
+  #endif
+  return true;
+}
+
+// Publish the latest battery reading (measured by battery_poll()).
 bool sensors_update_battery() {
-  // If you later measure battery here, update test_batt_voltage and test_batt_percent.
-  // For now do nothing because placeholders live in .ino and you asked to keep them.
-  (void)0;
+  float v;
+  int pct;
+  if (!battery_get(v, pct)) return false;
+  telemetry_setBattery(v, pct);
   return true;
 }
 
@@ -168,7 +431,7 @@ bool sensors_update() {
   // It is called periodically from loop().
 
   // Optionally update RSSI if modem available (example):
-  // test_rssi = modem_getRSSI();
+  // telemetry_setRssi(modem_getRSSI());
 
   return ok;
 }
\ No newline at end of file
@@ -1,24 +1,56 @@
 #pragma once
 #include <Arduino.h>
+#include "acquisition.h"
+#include "motion_detector.h"
 
 // sensors.h : API for sensor module
-// Implementations update global variables declared in config.h
+// Implementations publish readings through telemetry.h
 
 // Initialize sensors (I2C, SPI, HX711, etc). Return true if initialization ok.
 bool sensors_init();
 
 // Periodic update function — should be called regularly (or from a task)
-// to read sensors and update the global variables.
+// to read sensors and publish the readings.
 // Returns true on successful update.
 bool sensors_update();
 
 // Optional: explicit functions to read/refresh individual sensors
-// Optional: explicit functions to read/refresh individual sensors
-bool sensors_update_loadcell();   // updates test_weight
-bool sensors_update_internal();   // updates test_temp_int/test_hum_int
-bool sensors_update_external();   // updates test_temp_ext/test_hum_ext/test_pressure
-bool sensors_update_accel();      // updates test_acc_x/_y/_z and checks alarm
-bool sensors_update_battery();    // updates test_batt_voltage/test_batt_percent
-bool sensors_update_gps();        // updates test_lat/test_lon from modem
+bool sensors_update_loadcell();   // publishes weight
+bool sensors_update_internal();   // publishes internal temp/humidity (blocks for one SI7021 conversion)
+bool sensors_update_external();   // publishes external temp/humidity/pressure
+bool sensors_update_accel();      // publishes acceleration and checks alarm
+bool sensors_update_battery();    // publishes battery voltage/percentage
+bool sensors_update_gps();        // publishes lat/lon from modem
+
+// Internal temp/humidity without blocking (loop task): starts an SI7021
+// conversion, then publishes its result when called again next_ms later.
+// Returns true when a new reading was published. Without an SI7021 it
+// keeps the ESP32 die temperature for load-cell compensation instead
+// (TEMP_COMP_DIE_FALLBACK); that is not published as temp_int.
+bool sensors_poll_internal(uint32_t &next_ms);
+
+// Acquisition task support: raw reads (nothing published, caller holds the
+// I2C lock) and applying a record drained from the sample ring (loop task).
+bool sensors_read_accel(float &x, float &y, float &z);
+void sensors_apply_sample(const SensorSample &s);
+
+// MPU6050 FIFO burst read (acquisition task, I2C lock held): drains up to
+// `max` queued samples into xyz (m/s^2, oldest first) and reports whether
+// the motion-detect interrupt fired since the last call.
+int  sensors_read_accel_fifo(float (*xyz)[3], int max, bool &motion);
+bool sensors_accel_fifoEnabled();
+bool sensors_accel_motionIrq();
+uint32_t sensors_accel_fifoOverflows();
+
+// Motion interrupt(s) latched by the acquisition task (loop task).
+// samples_lost: the ring overflowed, so the alarm is raised from the
+// interrupt itself.
+void sensors_on_motion_event(uint32_t count, uint32_t t_ms, bool samples_lost);
+
+// Motion alarm: arm/disarm (re-arming re-learns the rest position first)
+// and read-only access to the detector state for status output.
+void sensors_motion_setArmed(bool armed);
+const MotionDetector &sensors_motion();
+uint32_t sensors_motion_irqEvents();
 
 // If you add more sensor-specific APIs, declare them here.
\ No newline at end of file
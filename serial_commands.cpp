@@ -6,6 +6,22 @@
 #include <SD.h>
 #include <Preferences.h>
 #include "modem_manager.h"
+#include "scheduler.h"
+#include "acquisition.h"
+#include "sensors.h"
+#include "calibration.h"
+#include "loadcell_filter.h"
+#include "battery_monitor.h"
+#include "gnss.h"
+#include "at_engine.h"
+#include "modem_power.h"
+#include "pdp_session.h"
+#include "http_response.h"
+#include "http_pool.h"
+#include "seg_queue.h"
+#include "telemetry_sink.h"
+#include "mqtt_session.h"
+#include "mqtt_client.h"
 #include <TinyGsmClient.h>
 
 // Forward to modem post function implemented in thingspeak_client_modem.cpp
@@ -34,76 +50,218 @@ static String readSerialLineNonBlocking() {
   return String();
 }
 
-static void printTSQueueStatus() {
-  if (!SD.begin(SD_CS)) {
-    Serial.println(F("[TS STATUS] SD not available"));
-    return;
+// One block per upload sink: its queue and its delivery/retry state
+static void printSinkStatus() {
+  for (int i = 0; i < sink_count(); i++) {
+    const TelemetrySink *k = sink_get(i);
+    const SinkStats &st = sink_stats(i);
+    if (!k->enabled()) {
+      Serial.printf("[SINK] %s: off\n", k->name);
+      continue;
+    }
+    const SegQueue *q = sink_queue(i);
+    if (!q) {
+      Serial.printf("[SINK] %s: queue %s not open (SD?)\n", k->name, k->queue_dir);
+    } else {
+      Serial.printf("[SINK] %s: queue %s: %s, ~%lu bytes in %lu segments (head %lu:%lu, write %lu:%lu)\n",
+                    k->name, q->dir, sq_empty(*q) ? "empty" : "pending",
+                    (unsigned long)sq_backlogBytes(*q), (unsigned long)sq_segments(*q),
+                    (unsigned long)q->head.seg, (unsigned long)q->head.off,
+                    (unsigned long)q->wr_seg, (unsigned long)q->wr_off);
+      Serial.printf("[SINK] %s: pushed=%lu acked=%lu push_failed=%lu corrupt=%lu segs_deleted=%lu\n",
+                    k->name, (unsigned long)q->stats.pushed, (unsigned long)q->stats.acked,
+                    (unsigned long)q->stats.push_failed, (unsigned long)q->stats.corrupt,
+                    (unsigned long)q->stats.segs_deleted);
+    }
+    Serial.printf("[SINK] %s: published=%lu not_queued=%lu delivered=%lu batches=%lu failures=%lu (in a row %u, backoff %lu ms) last ok %lu ms ago\n",
+                  k->name, (unsigned long)st.published, (unsigned long)st.queue_failed,
+                  (unsigned long)st.delivered, (unsigned long)st.batches,
+                  (unsigned long)st.failures, (unsigned)st.consecutive_failures,
+                  (unsigned long)st.backoff_ms,
+                  st.last_ok_ms ? (unsigned long)(millis() - st.last_ok_ms) : 0UL);
+  }
+}
+
+// --- Modem diagnostic helpers (used by 'modem test' / 'at') ---
+static void printAtLine(const char *line, void *) {
+  Serial.print(F("    "));
+  Serial.println(line);
+}
+
+static const char *atResultName(AtResult r) {
+  switch (r) {
+    case AT_OK:        return "OK";
+    case AT_ERROR:     return "ERROR";
+    case AT_TIMEOUT:   return "TIMEOUT";
+    case AT_CANCELLED: return "CANCELLED";
+    default:           return "PENDING";
+  }
+}
+
+// Run one command through the AT engine and print its response lines.
+static void runAt(const char *cmd, uint32_t timeout_ms) {
+  uint32_t t0 = millis();
+  Serial.printf("[AT] AT%s\n", cmd);
+  AtResult r = at_command(cmd, timeout_ms, printAtLine);
+  Serial.printf("[AT] -> %s (%lu ms)\n", atResultName(r), (unsigned long)(millis() - t0));
+}
+
+static void printAtStats() {
+  const AtStats &st = at_stats();
+  Serial.printf("[AT] commands=%lu ok=%lu errors=%lu timeouts=%lu last=%lums max=%lums queued=%d busy=%d\n",
+                (unsigned long)st.commands, (unsigned long)st.ok, (unsigned long)st.errors,
+                (unsigned long)st.timeouts, (unsigned long)st.last_ms, (unsigned long)st.max_ms,
+                at_queued(), at_busy() ? 1 : 0);
+  Serial.printf("[AT] urcs=%lu unhandled=%lu queue_full=%lu line_overflows=%lu\n",
+                (unsigned long)st.urcs, (unsigned long)st.urc_unhandled,
+                (unsigned long)st.queue_full, (unsigned long)st.line_overflows);
+}
+
+// Per-job scheduler statistics (used by 'sched' / 'sched reset')
+static void printSchedStats() {
+  Serial.println(F("[SCHED] job        period   runs   avg_us   max_us  late_ms  max_late"));
+  for (int i = 0; i < sched_jobCount(); ++i) {
+    SchedJobStats st;
+    if (!sched_getStats(i, st)) continue;
+    unsigned long avg = st.runs ? (unsigned long)(st.total_run_us / st.runs) : 0;
+    Serial.printf("[SCHED] %-9s %7lu %6lu %8lu %8lu %8lu %9lu%s\n",
+                  st.name, (unsigned long)st.period_ms, (unsigned long)st.runs,
+                  avg, (unsigned long)st.max_run_us,
+                  (unsigned long)st.last_late_ms, (unsigned long)st.max_late_ms,
+                  st.enabled ? "" : " (off)");
   }
-  if (!SD.exists(TS_QUEUE_FILENAME)) {
-    Serial.println(F("[TS STATUS] No queued posts (no /ts_queue.txt)"));
+  Serial.printf("[ACQ] samples pushed=%lu dropped=%lu pending=%u fifo_bursts=%lu fifo_overflows=%lu hx711_reads=%lu\n",
+                (unsigned long)acq_getPushed(), (unsigned long)acq_getDropped(),
+                (unsigned)acq_getPending(), (unsigned long)acq_getFifoBursts(),
+                (unsigned long)sensors_accel_fifoOverflows(), (unsigned long)acq_getLoadcellReads());
+}
+
+// Motion detector status (used by 'motion')
+static void printMotionStatus() {
+  const MotionDetector &m = sensors_motion();
+  Serial.printf("[MOTION] state=%s since=%lus dev=%.2f peak=%.2f thr=%.2f m/s2\n",
+                motion_stateName(m.state),
+                (unsigned long)((millis() - m.state_since_ms) / 1000UL),
+                m.last_dev, m.peak_dev, m.cfg.threshold);
+  Serial.printf("[MOTION] baseline=(%.2f, %.2f, %.2f) alarms=%lu suppressed=%lu this_hour=%u/%u\n",
+                m.gx, m.gy, m.gz, (unsigned long)m.alarms, (unsigned long)m.suppressed,
+                (unsigned)m.hour_alarms, (unsigned)m.cfg.max_alarms_per_hour);
+  Serial.printf("[MOTION] samples=%lu mpu_irq_events=%lu\n",
+                (unsigned long)m.samples, (unsigned long)sensors_motion_irqEvents());
+}
+
+// Replay a recorded accelerometer trace from SD through a private detector
+// with the live configuration (used by 'motion replay <file>').
+// Lines are "t_ms,x,y,z" (m/s^2); a header line or other text is skipped.
+static void replayMotionTrace(const String &path) {
+  if (!SD.begin(SD_CS)) {
+    Serial.println(F("[MOTION] SD not available"));
     return;
   }
-  File f = SD.open(TS_QUEUE_FILENAME, FILE_READ);
+  File f = SD.open(path, FILE_READ);
   if (!f) {
-    Serial.println(F("[TS STATUS] Cannot open /ts_queue.txt"));
+    Serial.print(F("[MOTION] Cannot open "));
+    Serial.println(path);
     return;
   }
-  Serial.println(F("[TS STATUS] /ts_queue.txt contents:"));
-  int i = 0;
+
+  MotionDetector d;
+  bool started = false;
+  uint32_t lines = 0, quiet = 0;
+  uint64_t busy_us = 0;
+  char buf[96];
   while (f.available()) {
-    String ln = f.readStringUntil('\n');
-    ln.trim();
-    if (ln.length() == 0) continue;
-    Serial.print("#");
-    Serial.print(++i);
-    Serial.print(": ");
-    Serial.println(ln);
-    if (i >= 50) {
-      Serial.println(F("[TS STATUS] ... truncated after 50 lines"));
-      break;
+    size_t n = f.readBytesUntil('\n', buf, sizeof(buf) - 1);
+    buf[n] = '\0';
+    unsigned long t;
+    float x, y, z;
+    if (sscanf(buf, "%lu,%f,%f,%f", &t, &x, &y, &z) != 4) continue;
+    if (!started) {
+      motion_init(d, sensors_motion().cfg, (uint32_t)t);
+      started = true;
+    }
+    lines++;
+    uint32_t t0 = micros();
+    MotionEvent ev = motion_update(d, x, y, z, (uint32_t)t);
+    busy_us += micros() - t0;
+    if (ev == MOTION_EVT_ALARM || ev == MOTION_EVT_SUPPRESSED) {
+      Serial.printf("[MOTION] t=%lu %s dev=%.2f\n", t,
+                    ev == MOTION_EVT_ALARM ? "ALARM" : "suppressed", d.last_dev);
+    } else if (ev == MOTION_EVT_QUIET) {
+      quiet++;
     }
   }
   f.close();
+
+  Serial.printf("[MOTION] replay: %lu samples, %lu alarms, %lu suppressed, %lu disturbances ended\n",
+                (unsigned long)lines, (unsigned long)d.alarms,
+                (unsigned long)d.suppressed, (unsigned long)quiet);
+  if (lines) {
+    Serial.printf("[MOTION] detector cost: %.2f us/sample\n", (double)busy_us / lines);
+  }
 }
 
-// --- Modem diagnostic helper (used by 'modem test') ---
-static String modemReadStream(Stream &s, unsigned long timeout = 1000) {
-  unsigned long t0 = millis();
-  String resp;
-  while (millis() - t0 < timeout) {
-    while (s.available()) {
-      char c = s.read();
-      resp += c;
-    }
-    delay(5);
+// Load-cell filter status per channel (used by 'weight')
+static void printWeightStatus() {
+  for (int ch = 0; ch < calib_channelCount(); ch++) {
+    const LoadcellFilter &f = calib_filter(ch);
+    float kg = 0;
+    uint8_t conf = 0;
+    bool ok = calib_getWeightKg(ch, kg, &conf);
+    Serial.printf("[WEIGHT] ch%d hx711=%s samples=%lu accepted=%lu rejected=%lu\n", ch,
+                  calib_present(ch) ? "yes" : "NO", (unsigned long)calib_rawSampleCount(ch),
+                  (unsigned long)f.accepted, (unsigned long)f.rejected);
+    Serial.printf("[WEIGHT] ch%d median=%ld sigma=%ld counts, filtered=%.3f kg conf=%u%%%s\n", ch,
+                  (long)f.median, (long)f.sigma, ok ? kg : 0.0f, (unsigned)conf,
+                  ok ? "" : " (not available)");
+    Serial.printf("[WEIGHT] ch%d factor=%.3f offset=%ld tc=%.2f g/C ref=%.1f C\n", ch,
+                  calib_getSavedFactor(ch), calib_getSavedOffset(ch),
+                  calib_getTempCoeff(ch), calib_getTempRef(ch));
   }
-  return resp;
+}
+
+// Cycles per sample of the filter pipeline on a synthetic trace (noise,
+// 5% glitches, a slow drift) through a private filter (used by 'weight bench').
+static void benchWeightFilter() {
+  const int N = 2000;
+  LoadcellFilter f;
+  lcf_init(f, calib_filter(0).cfg);
+  lcf_setTempComp(f, 10.0f, 20.0f);
+  uint32_t seed = 12345;
+  uint32_t cycles = 0, worst = 0;
+  for (int i = 0; i < N; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    int32_t raw = 250000 + i * 2 + (int32_t)((seed >> 24) % 81) - 40;
+    if ((seed & 0xFF) < 13) raw += 60000;   // glitch
+    uint32_t c0 = ESP.getCycleCount();
+    lcf_push(f, raw);
+    int32_t out;
+    uint8_t conf;
+    lcf_output(f, true, 2500, out, conf);
+    uint32_t c = ESP.getCycleCount() - c0;
+    cycles += c;
+    if (c > worst) worst = c;
+  }
+  Serial.printf("[WEIGHT] bench: %d samples, window=%u, avg %lu cycles/sample (max %lu) at %lu MHz, rejected=%lu\n",
+                N, (unsigned)f.cfg.window, (unsigned long)(cycles / N), (unsigned long)worst,
+                (unsigned long)ESP.getCpuFreqMHz(), (unsigned long)f.rejected);
 }
 
 static void runModemDiag() {
   Serial.println(F("[MODEM DIAG] Starting modem diagnostics..."));
-  TinyGsm &modem = modem_get();
-  Stream &s = modem.stream;
-
   // 1) Basic AT check
-  modem.sendAT("AT");
-  Serial.print(F("[MODEM DIAG] AT -> "));
-  Serial.println(modemReadStream(s, 800));
+  runAt("", 800);
 
   // 2) CGATT? attached?
-  modem.sendAT("AT+CGATT?");
-  Serial.print(F("[MODEM DIAG] AT+CGATT? -> "));
-  Serial.println(modemReadStream(s, 800));
+  runAt("+CGATT?", 800);
 
   // 3) PDP context definitions
-  modem.sendAT("AT+CGDCONT?");
-  Serial.print(F("[MODEM DIAG] AT+CGDCONT? -> "));
-  Serial.println(modemReadStream(s, 800));
+  runAt("+CGDCONT?", 800);
 
   // 4) Active PDP addresses (some modems)
-  modem.sendAT("AT+CGPADDR");
-  Serial.print(F("[MODEM DIAG] AT+CGPADDR -> "));
-  Serial.println(modemReadStream(s, 800));
+  runAt("+CGPADDR", 800);
+
+  TinyGsm &modem = modem_get();
 
   // 5) Try TCP connect to ThingSpeak using TinyGsmClient
   Serial.println(F("[MODEM DIAG] Trying TCP connect to api.thingspeak.com:80"));
@@ -118,24 +276,14 @@ static void runModemDiag() {
     String req = String("GET /update?api_key=test&field1=1 HTTP/1.1\r\nHost: api.thingspeak.com\r\nConnection: close\r\n\r\n");
     client.print(req);
     Serial.println(F("[MODEM DIAG] Sent HTTP GET, waiting for response..."));
-    unsigned long t0 = millis();
-    String resp;
-    while (millis() - t0 < 8000) {
-      while (client.available()) {
-        char c = client.read();
-        resp += c;
-      }
-      if (resp.length()) break;
-      delay(50);
-    }
-    if (resp.length()) {
-      Serial.println(F("[MODEM DIAG] HTTP response (truncated 1024 chars):"));
-      if (resp.length() > 1024) {
-        Serial.println(resp.substring(0, 1024));
-        Serial.println(F("... (truncated)"));
-      } else {
-        Serial.println(resp);
-      }
+    char body[256];
+    HttpResponse resp;
+    http_begin(resp, body, sizeof(body));
+    http_readClient(client, resp, 8000);
+    if (resp.status) {
+      Serial.printf("[MODEM DIAG] HTTP %d, %u body bytes%s:\n", resp.status,
+                    (unsigned)resp.received, resp.truncated ? " (truncated)" : "");
+      Serial.println(body);
     } else {
       Serial.println(F("[MODEM DIAG] No HTTP response received."));
     }
@@ -162,6 +310,17 @@ void serial_commands_poll() {
   String up = ln;
   up.toUpperCase();
 
+  if (up == "SMS STATS") {
+    const SmsStats &st = sms_stats();
+    Serial.printf("[SMS] in: scans=%lu received=%lu commands=%lu rejected=%lu deleted=%lu\n",
+                  (unsigned long)st.scans, (unsigned long)st.received, (unsigned long)st.commands,
+                  (unsigned long)st.rejected, (unsigned long)st.deleted);
+    Serial.printf("[SMS] out: queued=%lu coalesced=%lu sent=%lu delivered=%lu retries=%lu failed=%lu dropped=%lu waiting=%d\n",
+                  (unsigned long)st.queued, (unsigned long)st.coalesced, (unsigned long)st.sent,
+                  (unsigned long)st.delivered, (unsigned long)st.retries, (unsigned long)st.failed,
+                  (unsigned long)st.dropped, sms_outboxCount());
+    return;
+  }
   if (up == "SMS" || up == "SCAN" || up == "SCAN SMS" || up == "SMS SCAN") {
     Serial.println(F("[CMD] Triggering manual SMS scan..."));
     sms_scan_now();
@@ -170,10 +329,24 @@ void serial_commands_poll() {
   if (up == "HELP" || up == "?") {
     Serial.println(F("[CMD] Commands:"));
     Serial.println(F("  sms            -> trigger immediate SMS scan"));
-    Serial.println(F("  ts status      -> print ThingSpeak/WiFi/queue status"));
+    Serial.println(F("  sms stats      -> inbound/outbound SMS counters"));
+    Serial.println(F("  ts status      -> print ThingSpeak/WiFi status and every upload sink's queue"));
     Serial.println(F("  ts send        -> trigger immediate ThingSpeak upload (WiFi-first path)"));
     Serial.println(F("  ts send-lte    -> trigger ThingSpeak upload via MODEM (LTE, manual)"));
+    Serial.println(F("  ts flush       -> send one batch now from every sink that is due"));
     Serial.println(F("  modem test     -> run modem diagnostics (AT cmds + TCP test)"));
+    Serial.println(F("  at [cmd]       -> AT engine stats, or send AT<cmd> and print the reply"));
+    Serial.println(F("  modem boot     -> modem power-up and boot-to-network timing"));
+    Serial.println(F("  modem power    -> PSM state, wakes and awake time per day"));
+    Serial.println(F("  modem status   -> cached registration / signal / operator and their age"));
+    Serial.println(F("  modem pdp      -> LTE data session state, attach times and failure reasons (modem pdp reset)"));
+    Serial.println(F("  http           -> LTE HTTP connection pool latency stats"));
+    Serial.println(F("  mqtt           -> MQTT upload session, acks and bytes per sample"));
+    Serial.println(F("  sched          -> print scheduler job timing (sched reset clears)"));
+    Serial.println(F("  motion         -> motion detector status (motion arm|disarm|replay <file>)"));
+    Serial.println(F("  batt           -> battery monitor status"));
+    Serial.println(F("  gps            -> cached GNSS fix and report counters"));
+    Serial.println(F("  weight         -> load-cell filter status (weight bench | weight tc <g/C> <ref C> [ch])"));
     Serial.println(F("  help           -> print this help"));
     return;
   }
@@ -185,7 +358,7 @@ void serial_commands_poll() {
     IPAddress ip = WiFi.localIP();
     Serial.print(F("  localIP: "));
     Serial.println(ip);
-    printTSQueueStatus();
+    printSinkStatus();
     if (strlen(THINGSPEAK_WRITE_APIKEY) == 0) {
       Serial.println(F("  THINGSPEAK_WRITE_APIKEY: (empty)"));
     } else {
@@ -202,41 +375,21 @@ void serial_commands_poll() {
     return;
   }
 
+  if (up == "TS FLUSH") {
+    uint32_t next = sink_service();
+    Serial.printf("[CMD] Upload sinks serviced, %s; next in %lu ms\n",
+                  sink_allDelivered() ? "all delivered" : "samples still queued", (unsigned long)next);
+    printSinkStatus();
+    return;
+  }
+
   if (up == "TS SEND-LTE" || up == "TSSENDLTE") {
     Serial.println(F("[CMD] Triggering ThingSpeak upload via MODEM (LTE)..."));
 
     // Build post body same as thingspeak_upload_current() would
-    char buf[64];
-    String b;
-    b.reserve(200);
-
-    // field1: weight (kg) 1 decimal
-    snprintf(buf, sizeof(buf), "%.1f", test_weight);
-    b += "field1=" + String(buf);
-
-    // field2: internal temp 1 decimal
-    snprintf(buf, sizeof(buf), "%.1f", test_temp_int);
-    b += "&field2=" + String(buf);
-
-    // field3: internal humidity 0 decimals
-    snprintf(buf, sizeof(buf), "%.0f", test_hum_int);
-    b += "&field3=" + String(buf);
-
-    // field4: external temp 1 decimal
-    snprintf(buf, sizeof(buf), "%.1f", test_temp_ext);
-    b += "&field4=" + String(buf);
-
-    // field5: external humidity 0 decimals
-    snprintf(buf, sizeof(buf), "%.0f", test_hum_ext);
-    b += "&field5=" + String(buf);
-
-    // field6: pressure 0 decimals
-    snprintf(buf, sizeof(buf), "%.0f", test_pressure);
-    b += "&field6=" + String(buf);
-
-    // field7: battery voltage 2 decimals
-    snprintf(buf, sizeof(buf), "%.2f", test_batt_voltage);
-    b += "&field7=" + String(buf);
+    TelemetrySnapshot t;
+    telemetry_read(t);
+    String b = thingspeak_buildBodyPairs(t);
 
     // coords from preferences
     Preferences p;
@@ -254,7 +407,8 @@ void serial_commands_poll() {
     snprintf(lonBuf, sizeof(lonBuf), "%.4f", lon);
     String coords = String(latBuf) + String(" ") + String(lonBuf);
     String coordsEnc = urlEncodeSimple(coords);  // or urlEncodeSimple(coords) -> ensure it encodes space as +
-    b += "&field8=" + coordsEnc;
+    if (b.length()) b += "&";
+    b += "field8=" + coordsEnc;
 
     // Prepend api_key
     String post = String("api_key=") + THINGSPEAK_WRITE_APIKEY + String("&") + b;
@@ -267,6 +421,196 @@ void serial_commands_poll() {
     return;
   }
 
+  if (up == "SCHED") {
+    printSchedStats();
+    return;
+  }
+
+  if (up == "SCHED RESET") {
+    sched_resetStats();
+    Serial.println(F("[SCHED] statistics cleared"));
+    return;
+  }
+
+  if (up == "MOTION") {
+    printMotionStatus();
+    return;
+  }
+
+  if (up == "MOTION ARM" || up == "MOTION DISARM") {
+    sensors_motion_setArmed(up == "MOTION ARM");
+    return;
+  }
+
+  if (up.startsWith("MOTION REPLAY ")) {
+    String path = ln.substring(14);
+    path.trim();
+    if (!path.startsWith("/")) path = "/" + path;
+    replayMotionTrace(path);
+    return;
+  }
+
+  if (up == "GPS") {
+    GnssFix f;
+    uint32_t now = millis();
+    Serial.printf("[GNSS] reports=%lu fixes=%lu parse_errors=%lu unhandled_urc=%lu last_report=%lds ago\n",
+                  (unsigned long)gnss_reports(), (unsigned long)gnss_fixes(),
+                  (unsigned long)gnss_parseErrors(), (unsigned long)at_stats().urc_unhandled,
+                  gnss_reportAgeMs(now) == UINT32_MAX ? -1L : (long)(gnss_reportAgeMs(now) / 1000UL));
+    if (gnss_getFix(f)) {
+      Serial.printf("[GNSS] %.6f, %.6f alt=%.1f m sats=%u hdop=%.1f utc=%06lu %06lu age=%lus\n",
+                    f.lat, f.lon, f.alt_m, (unsigned)f.sats, f.hdop,
+                    (unsigned long)f.utc_date, (unsigned long)f.utc_time,
+                    (unsigned long)(gnss_fixAgeMs(now) / 1000UL));
+    } else {
+      Serial.println(F("[GNSS] no fix yet"));
+    }
+    return;
+  }
+
+  if (up == "BATT") {
+    float v = 0;
+    int pct = 0;
+    bool ok = battery_get(v, pct);
+    Serial.printf("[BATT] %s, bursts=%lu last_pin=%lu mV\n",
+                  battery_usesContinuousAdc() ? "ADC continuous mode" : "analogReadMilliVolts",
+                  (unsigned long)battery_bursts(), (unsigned long)battery_lastBurstMv());
+    if (ok) Serial.printf("[BATT] %.3f V, %d%%\n", v, pct);
+    else Serial.println(F("[BATT] no reading yet"));
+    return;
+  }
+
+  if (up == "WEIGHT") {
+    printWeightStatus();
+    return;
+  }
+
+  if (up == "WEIGHT BENCH") {
+    benchWeightFilter();
+    return;
+  }
+
+  if (up.startsWith("WEIGHT TC ")) {
+    float gpc = 0, ref = 0;
+    int ch = 0;
+    int n = sscanf(ln.c_str() + 10, "%f %f %d", &gpc, &ref, &ch);
+    if (n < 2 || ch < 0 || ch >= calib_channelCount()) {
+      Serial.println(F("[WEIGHT] usage: weight tc <grams per C> <reference C> [channel]"));
+      return;
+    }
+    if (calib_saveTempComp(ch, gpc, ref)) Serial.printf("[WEIGHT] ch%d temperature compensation %.2f g/C around %.1f C saved\n", ch, gpc, ref);
+    else Serial.println(F("[WEIGHT] saving temperature compensation FAILED"));
+    return;
+  }
+
+  if (up == "AT") {
+    printAtStats();
+    return;
+  }
+
+  if (up.startsWith("AT ")) {
+    String cmd = ln.substring(3);
+    cmd.trim();
+    if (cmd.startsWith("AT") || cmd.startsWith("at")) cmd = cmd.substring(2);
+    runAt(cmd.c_str(), 5000);
+    return;
+  }
+
+  if (up == "HTTP") {
+    const HttpPoolStats &st = httpPool_stats();
+    Serial.printf("[HTTP] requests=%lu reused=%lu connects=%lu connect_fail=%lu retries=%lu failures=%lu open=%d\n",
+                  (unsigned long)st.requests, (unsigned long)st.reused, (unsigned long)st.connects,
+                  (unsigned long)st.connect_failures, (unsigned long)st.retries,
+                  (unsigned long)st.failures, httpPool_openCount());
+    Serial.printf("[HTTP] connect avg=%lu ms max=%lu ms, transfer avg=%lu ms max=%lu ms\n",
+                  st.connects ? (unsigned long)(st.connect_ms_total / st.connects) : 0UL,
+                  (unsigned long)st.connect_ms_max,
+                  st.requests ? (unsigned long)(st.transfer_ms_total / st.requests) : 0UL,
+                  (unsigned long)st.transfer_ms_max);
+    return;
+  }
+
+  if (up == "MQTT") {
+    const MqttStats &st = mqtt_stats();
+    Serial.printf("[MQTT] %s as %s on %s, session %s, CONNACK %u\n",
+                  mqtt_isConnected() ? "connected" : "not connected", mqttClient_id(),
+                  mqttClient_bearer(), st.session_present ? "resumed" : "new",
+                  (unsigned)st.last_connack_rc);
+    Serial.printf("[MQTT] connects=%lu connect_fail=%lu published=%lu acked=%lu ack_timeouts=%lu pings=%lu drops=%lu in_flight=%d\n",
+                  (unsigned long)st.connects, (unsigned long)st.connect_failures,
+                  (unsigned long)st.published, (unsigned long)st.acked,
+                  (unsigned long)st.ack_timeouts, (unsigned long)st.pings,
+                  (unsigned long)st.drops, mqtt_inFlight());
+    Serial.printf("[MQTT] tx=%llu rx=%llu bytes (payload %llu), %lu bytes on the wire per acked sample\n",
+                  (unsigned long long)st.tx_bytes, (unsigned long long)st.rx_bytes,
+                  (unsigned long long)st.payload_bytes,
+                  st.acked ? (unsigned long)((st.tx_bytes + st.rx_bytes) / st.acked) : 0UL);
+    return;
+  }
+
+  if (up == "MODEM BOOT") {
+    const ModemBootStats &b = modem_bootStats();
+    const char *how = b.pwr_seq == -1 ? "already on" : (b.pwr_seq == -2 ? "no answer" : "PWRKEY sequence");
+    Serial.printf("[MODEM] power-up %lu ms (%s", (unsigned long)b.powerup_ms, how);
+    if (b.pwr_seq >= 0) Serial.printf(" %d", b.pwr_seq + 1);
+    Serial.printf("), AT ready at %lu ms, registered at ", (unsigned long)b.at_ready_ms);
+    if (b.registered_ms) Serial.printf("%lu ms\n", (unsigned long)b.registered_ms);
+    else Serial.println(F("- (not yet)"));
+    return;
+  }
+
+  if (up == "MODEM STATUS") {
+    const ModemStatus &m = modem_status();
+    Serial.printf("[MODEM] %s (EPS %d, CS %d), age %ld ms\n", m.registered ? "registered" : "not registered",
+                  m.eps_stat, m.cs_stat, m.reg_ms ? (long)modem_statusAge(m.reg_ms) : -1L);
+    Serial.printf("[MODEM] CSQ %d (%d dBm), age %ld ms\n", m.csq, m.rssi_dbm,
+                  m.csq_ms ? (long)modem_statusAge(m.csq_ms) : -1L);
+    Serial.printf("[MODEM] operator \"%s\", age %ld ms\n", m.op,
+                  m.op_ms ? (long)modem_statusAge(m.op_ms) : -1L);
+    return;
+  }
+
+  if (up == "MODEM POWER") {
+    const ModemPowerStats &p = modemPower_stats();
+    Serial.printf("[MODEM] %s, sleeps=%lu wakes=%lu wake_failures=%lu\n",
+                  modemPower_stateName(modemPower_state()), (unsigned long)p.sleeps,
+                  (unsigned long)p.wakes, (unsigned long)p.wake_failures);
+    Serial.printf("[MODEM] awake today %lu s, previous day %lu s, asleep total %lu s (day %lu)\n",
+                  (unsigned long)(p.awake_ms_today / 1000UL), (unsigned long)(p.awake_ms_yesterday / 1000UL),
+                  (unsigned long)(p.asleep_ms_total / 1000UL), (unsigned long)p.day);
+    Serial.printf("[MODEM] granted: TAU %lu s, active %lu s, eDRX %lu ms\n",
+                  (unsigned long)p.tau_s, (unsigned long)p.active_s, (unsigned long)p.edrx_ms);
+    return;
+  }
+
+  if (up == "MODEM PDP") {
+    const PdpStats &p = pdp_stats();
+    Serial.printf("[PDP] %s (%s), attempts=%lu ok=%lu failed=%lu consecutive=%u\n",
+                  pdp_stateName(pdp_state()), pdp_wanted() ? "wanted" : "not wanted",
+                  (unsigned long)p.attempts, (unsigned long)p.successes,
+                  (unsigned long)p.failures, (unsigned)p.consecutive_failures);
+    if (p.successes) {
+      Serial.printf("[PDP] attach ms: last=%lu min=%lu mean=%lu max=%lu\n",
+                    (unsigned long)p.last_attach_ms, (unsigned long)p.min_attach_ms,
+                    (unsigned long)(p.total_attach_ms / p.successes), (unsigned long)p.max_attach_ms);
+    }
+    if (pdp_isUp()) Serial.printf("[PDP] up for %lu s\n", (unsigned long)((millis() - p.up_since_ms) / 1000UL));
+    for (uint8_t i = 1; i < PDP_FAIL_COUNT; i++) {
+      if (p.fail_by_reason[i]) Serial.printf("[PDP]   %-20s %lu\n", pdp_failName((PdpFail)i), (unsigned long)p.fail_by_reason[i]);
+    }
+    if (p.failures) {
+      Serial.printf("[PDP] last failure: %s, %lu s ago, backoff %lu ms\n", pdp_failName(p.last_fail),
+                    (unsigned long)((millis() - p.last_fail_ms) / 1000UL), (unsigned long)p.backoff_ms);
+    }
+    return;
+  }
+
+  if (up == "MODEM PDP RESET") {
+    pdp_resetStats();
+    Serial.println(F("[PDP] stats cleared"));
+    return;
+  }
+
   if (up == "MODEM TEST" || up == "MODEMTEST") {
     Serial.println(F("[CMD] Running modem diagnostics..."));
     runModemDiag();
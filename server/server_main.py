@@ -1,6 +1,6 @@
 from fastapi import FastAPI, HTTPException, Request
 from pydantic import BaseModel
-from typing import Optional, Dict, Any
+from typing import Optional, Dict, Any, List
 from datetime import datetime
 import sqlite3
 import os
@@ -18,6 +18,17 @@ class TelemetryPayload(BaseModel):
     lon: Optional[float] = None
     ts: Optional[str] = None  # ISO timestamp προαιρετικά
 
+# Batch από την ουρά της συσκευής: δείγματα με τη δική τους ώρα λήψης
+class TelemetrySample(BaseModel):
+    fields: Dict[str, Any]
+    lat: Optional[float] = None
+    lon: Optional[float] = None
+    ts: Optional[str] = None  # ISO timestamp λήψης (αλλιώς ώρα άφιξης)
+
+class TelemetryBatch(BaseModel):
+    api_key: str
+    samples: List[TelemetrySample]
+
 def get_conn():
     conn = sqlite3.connect(DB_PATH, check_same_thread=False)
     conn.row_factory = sqlite3.Row
@@ -70,6 +81,27 @@ async def post_telemetry(payload: TelemetryPayload, request: Request):
 
     return {"status": "ok", "id": rowid}
     
+@app.post("/api/telemetry/batch")
+async def post_telemetry_batch(payload: TelemetryBatch):
+    if payload.api_key != API_KEY:
+        raise HTTPException(status_code=401, detail="invalid api key")
+
+    # όλο το batch σε μία συναλλαγή: ή αποθηκεύονται όλα ή κανένα,
+    # ώστε η συσκευή να ξαναστείλει ολόκληρο το batch χωρίς κενά
+    import json
+    now = datetime.utcnow().isoformat() + "Z"
+    conn = get_conn()
+    try:
+        with conn:
+            conn.executemany(
+                "INSERT INTO telemetry (ts, lat, lon, fields_json, created_at) VALUES (?, ?, ?, ?, ?)",
+                [(s.ts or now, s.lat, s.lon, json.dumps(s.fields), now) for s in payload.samples]
+            )
+    finally:
+        conn.close()
+
+    return {"status": "ok", "count": len(payload.samples)}
+
 @app.get("/api/telemetry")
 def get_telemetry(limit: int = 100):
     conn = get_conn()
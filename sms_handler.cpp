@@ -1,55 +1,484 @@
 #include "sms_handler.h"
 #include "modem_manager.h"
-#include <TinyGsmClient.h>
+#include "at_engine.h"
+#include "modem_power.h"
+#include "config.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include <Preferences.h>
 #include <Arduino.h>
 
-static unsigned long s_lastCheck = 0;
-static const unsigned long SMS_CHECK_INTERVAL = 30UL * 1000UL;
-
-static String sms_modemReadStream(TinyGsm &modem, unsigned long timeout=1000) {
-  Stream &s = modem.stream; unsigned long start=millis(); String resp;
-  while (millis()-start<timeout) {
-    while (s.available()) { char c=(char)s.read(); resp+=c; }
-    if (resp.length()) {
-      unsigned long grace=millis();
-      while (millis()-grace<120) { while (s.available()) { char c=(char)s.read(); resp+=c; } delay(5); }
-      break;
+enum SmsScanState : uint8_t { SMS_IDLE = 0, SMS_LISTING, SMS_LISTED };
+
+static SmsScanState  s_state = SMS_IDLE;
+static volatile bool s_newMessage = true;    // +CMTI seen (or boot: look at what is stored)
+static unsigned long s_lastScan = 0;
+static SmsMessage    s_batch[SMS_MAX_BATCH];
+static int           s_count = 0;
+static bool          s_overflow = false;     // more stored than s_batch holds
+static bool          s_listOk = false;
+static bool          s_retry = false;        // last listing failed: try again sooner
+static SmsStats      s_stats = {};
+
+// Outbox (see sms_handler.h). SENT entries stay until their delivery
+// report or the coalesce window is over, whichever is later; they are the
+// first slots reused when the outbox is full.
+enum SmsOutState : uint8_t { OUT_FREE = 0, OUT_PENDING, OUT_SENDING, OUT_SENT };
+
+struct SmsOut {
+  SmsOutState state;
+  uint8_t     prio;
+  uint8_t     attempts;
+  int16_t     mr;             // message reference from +CMGS, -1 unknown
+  uint16_t    count;          // coalesced repeats (1 = plain message)
+  const char *key;
+  uint32_t    seq;            // FIFO order within a priority
+  uint32_t    not_before_ms;  // backoff / end of the coalesce window
+  uint32_t    sent_ms;
+  char        number[24];
+  char        text[161];
+};
+
+static SmsOut   s_out[SMS_OUTBOX_LEN];
+static uint32_t s_outSeq = 0;
+static int      s_sending = -1;
+static char     s_payload[162];             // text + Ctrl-Z, valid while AT+CMGS runs
+static void   (*s_wake)(void) = nullptr;
+
+// +CMTI: "SM",3 -> a message arrived; scan on the next sms_loop()
+static void sms_onCmti(const char *, uint32_t, void *) {
+  s_newMessage = true;
+}
+
+// Copy the next "quoted" field of a +CMGL header; p is left after it.
+static const char *sms_quoted(const char *p, char *out, size_t cap) {
+  out[0] = '\0';
+  p = strchr(p, '"');
+  if (!p) return nullptr;
+  p++;
+  size_t n = 0;
+  while (*p && *p != '"') {
+    if (n + 1 < cap) out[n++] = *p;
+    p++;
+  }
+  out[n] = '\0';
+  return *p ? p + 1 : p;
+}
+
+// +CMGL: 3,"REC UNREAD","+306912345678","","26/10/16,12:00:00+12"
+static bool sms_parseHeader(const char *line, SmsMessage &m) {
+  const char *p = line + 6;
+  while (*p == ' ') p++;
+  if (*p < '0' || *p > '9') return false;
+  m.index = atoi(p);
+  char stat[16], alpha[8];
+  p = sms_quoted(p, stat, sizeof(stat));
+  if (p) p = sms_quoted(p, m.sender, sizeof(m.sender));
+  if (p) p = sms_quoted(p, alpha, sizeof(alpha));
+  if (p) sms_quoted(p, m.stamp, sizeof(m.stamp));
+  m.unread = (strcmp(stat, "REC UNREAD") == 0);
+  m.text[0] = '\0';
+  return true;
+}
+
+// Header lines open a record; every other line is message text (a text
+// with line breaks arrives as several lines).
+static void sms_onListLine(const char *line, void *) {
+  if (strncmp(line, "+CMGL:", 6) == 0) {
+    if (s_count >= SMS_MAX_BATCH) { s_overflow = true; return; }
+    SmsMessage &m = s_batch[s_count];
+    if (sms_parseHeader(line, m)) s_count++;
+    return;
+  }
+  if (s_count == 0 || s_overflow) return;
+  SmsMessage &m = s_batch[s_count - 1];
+  size_t used = strlen(m.text);
+  if (used && used + 1 < sizeof(m.text)) m.text[used++] = '\n';
+  strncpy(m.text + used, line, sizeof(m.text) - 1 - used);
+  m.text[sizeof(m.text) - 1] = '\0';
+}
+
+static void sms_onListDone(AtResult res, const char *, void *) {
+  s_listOk = (res == AT_OK);
+  s_state = SMS_LISTED;
+}
+
+// Numbers match on their last SMS_NUMBER_MATCH_DIGITS digits, so
+// "+3069..." and "69..." are the same phone.
+static bool sms_sameNumber(const char *a, const char *b) {
+  char da[24], db[24];
+  size_t na = 0, nb = 0;
+  for (; *a && na < sizeof(da); a++) if (*a >= '0' && *a <= '9') da[na++] = *a;
+  for (; *b && nb < sizeof(db); b++) if (*b >= '0' && *b <= '9') db[nb++] = *b;
+  if (na < SMS_NUMBER_MATCH_DIGITS || nb < SMS_NUMBER_MATCH_DIGITS) return false;
+  return memcmp(da + na - SMS_NUMBER_MATCH_DIGITS, db + nb - SMS_NUMBER_MATCH_DIGITS,
+                SMS_NUMBER_MATCH_DIGITS) == 0;
+}
+
+static void sms_statusText(char *out, size_t cap) {
+  TelemetrySnapshot t;
+  telemetry_read(t);
+  int n = snprintf(out, cap, "BEEHIVE");
+  for (int ch = 0; ch < TLM_MAX_WEIGHTS; ch++) {
+    if (telemetry_hasWeight(t, ch)) n += snprintf(out + n, cap - n, " W%d=%.2fkg", ch + 1, t.weight[ch]);
+  }
+  if (telemetry_has(t, TLM_TEMP_INT)) n += snprintf(out + n, cap - n, " Tin=%.1fC", t.temp_int);
+  if (telemetry_has(t, TLM_HUM_INT))  n += snprintf(out + n, cap - n, " Hin=%.0f%%", t.hum_int);
+  if (telemetry_has(t, TLM_TEMP_EXT)) n += snprintf(out + n, cap - n, " Tout=%.1fC", t.temp_ext);
+  if (telemetry_has(t, TLM_BATT_V))   n += snprintf(out + n, cap - n, " Batt=%.2fV", t.batt_voltage);
+  if (telemetry_has(t, TLM_BATT_PCT)) n += snprintf(out + n, cap - n, "/%d%%", t.batt_percent);
+
+  Preferences p;
+  p.begin("beehive", true);
+  int mins = p.getInt("ts_interval", 0);
+  p.end();
+  const MotionDetector &m = sensors_motion();
+  snprintf(out + n, cap - n, " Alarm=%s Int=%dmin",
+           m.armed_request ? "ARMED" : "OFF",
+           mins > 0 ? mins : (int)(GPS_UPDATE_INTERVAL / 60000UL));
+}
+
+// Run one message. Returns the reply text ("" = no reply).
+static String sms_execute(const SmsMessage &m) {
+  if (!sms_sameNumber(m.sender, ALARM_PHONE_NUMBER)) {
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] #%d from %s ignored (not the alarm phone)\n", m.index, m.sender);
+#endif
+    s_stats.rejected++;
+    return "";
+  }
+
+  String text = String(m.text);
+  text.trim();
+  text.toUpperCase();
+  String pin = String(SMS_CMD_PIN) + " ";
+  if (!text.startsWith(pin)) {
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] #%d from %s: wrong or missing PIN\n", m.index, m.sender);
+#endif
+    s_stats.rejected++;
+    return "";
+  }
+  String cmd = text.substring(pin.length());
+  cmd.trim();
+
+  if (cmd == "STATUS") {
+    char buf[161];
+    sms_statusText(buf, sizeof(buf));
+    s_stats.commands++;
+    return String(buf);
+  }
+  if (cmd == "ARM" || cmd == "DISARM") {
+    sensors_motion_setArmed(cmd == "ARM");
+    s_stats.commands++;
+    return cmd == "ARM" ? "OK alarm armed" : "OK alarm disarmed";
+  }
+  if (cmd.startsWith("INTERVAL ")) {
+    int mins = cmd.substring(9).toInt();
+    if (mins < 1 || mins > 1440) {
+      s_stats.rejected++;
+      return "ERR interval 1..1440 min";
+    }
+    Preferences p;              // picked up by the scheduler's interval job
+    p.begin("beehive", false);
+    p.putInt("ts_interval", mins);
+    p.end();
+    s_stats.commands++;
+    return String("OK interval ") + mins + " min";
+  }
+
+#if ENABLE_DEBUG
+  Serial.printf("[SMS] #%d unknown command: %s\n", m.index, cmd.c_str());
+#endif
+  s_stats.rejected++;
+  return "ERR commands: STATUS, INTERVAL <min>, ARM, DISARM";
+}
+
+// Run the listed batch, then delete it. Text-mode listing marks messages
+// read, so "delete all read" (one command) removes exactly this batch
+// while anything that arrived meanwhile stays unread. When the list did
+// not fit, the handled ones are deleted by index and the rest rescanned.
+static void sms_processBatch() {
+  for (int i = 0; i < s_count; i++) {
+    const SmsMessage &m = s_batch[i];
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] #%d %s %s: %s\n", m.index, m.sender, m.stamp, m.text);
+#endif
+    String reply = sms_execute(m);
+    if (reply.length()) sms_send(String(m.sender), reply);
+  }
+  s_stats.received += s_count;
+
+  if (s_count == 0) return;
+  if (!s_overflow) {
+    at_submit("+CMGD=1,1", 5000);
+  } else {
+    char cmd[16];
+    for (int i = 0; i < s_count; i++) {
+      snprintf(cmd, sizeof(cmd), "+CMGD=%d", s_batch[i].index);
+      at_submit(cmd, 5000);
     }
-    delay(10);
+    s_newMessage = true;
   }
-  return resp;
+  s_stats.deleted += s_count;
 }
 
-static String sms_atSendAndRead(TinyGsm &modem, const char *cmd, unsigned long timeout=1000) {
-  modem.sendAT(cmd);
-  return sms_modemReadStream(modem, timeout);
+// --- outbox ---
+
+static bool sms_due(uint32_t t, uint32_t now) { return (int32_t)(now - t) >= 0; }
+
+// Free slot, else the oldest already-sent one, else a pending message of
+// lower priority (dropped). -1: nothing can make room.
+static int sms_allocOut(uint8_t prio) {
+  int sent = -1, low = -1;
+  for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+    SmsOut &o = s_out[i];
+    if (o.state == OUT_FREE) return i;
+    if (o.state == OUT_SENT && (sent < 0 || (int32_t)(o.sent_ms - s_out[sent].sent_ms) < 0)) sent = i;
+    if (o.state == OUT_PENDING && o.prio < prio && (low < 0 || o.seq < s_out[low].seq)) low = i;
+  }
+  if (sent >= 0) return sent;
+  if (low >= 0) {
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] outbox full, dropping queued message to %s\n", s_out[low].number);
+#endif
+    s_stats.dropped++;
+    return low;
+  }
+  return -1;
 }
 
-void sms_init() { s_lastCheck = millis(); }
+bool sms_queue(const char *number, const char *text, SmsPriority prio, const char *coalesce_key) {
+  uint32_t now = millis();
+  uint32_t not_before = now;
+
+  if (coalesce_key) {
+    for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+      SmsOut &o = s_out[i];
+      if (o.key != coalesce_key && !(o.key && strcmp(o.key, coalesce_key) == 0)) continue;
+      if (o.state == OUT_PENDING) {
+        // still waiting: fold this one in, keep the latest text
+        o.count++;
+        strncpy(o.text, text, sizeof(o.text) - 1);
+        o.text[sizeof(o.text) - 1] = '\0';
+        if (prio > o.prio) o.prio = prio;
+        s_stats.coalesced++;
+        return true;
+      }
+      if ((o.state == OUT_SENT || o.state == OUT_SENDING) && now - o.sent_ms < SMS_COALESCE_MS) {
+        not_before = o.sent_ms + SMS_COALESCE_MS;   // hold until the window is over
+      }
+    }
+  }
+
+  int i = sms_allocOut(prio);
+  if (i < 0) {
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] outbox full, message to %s dropped\n", number);
+#endif
+    s_stats.dropped++;
+    return false;
+  }
+  SmsOut &o = s_out[i];
+  o.state = OUT_PENDING;
+  o.prio = prio;
+  o.attempts = 0;
+  o.mr = -1;
+  o.count = 1;
+  o.key = coalesce_key;
+  o.seq = s_outSeq++;
+  o.not_before_ms = not_before;
+  o.sent_ms = 0;
+  strncpy(o.number, number, sizeof(o.number) - 1);
+  o.number[sizeof(o.number) - 1] = '\0';
+  strncpy(o.text, text, sizeof(o.text) - 1);
+  o.text[sizeof(o.text) - 1] = '\0';
+  s_stats.queued++;
+  if (s_wake) s_wake();
+  return true;
+}
+
+bool sms_send(String number, String message) {
+  return sms_queue(number.c_str(), message.c_str(), SMS_PRIO_STATUS);
+}
+
+static void sms_onCmgsLine(const char *line, void *arg) {
+  if (strncmp(line, "+CMGS:", 6) == 0) s_out[(intptr_t)arg].mr = (int16_t)atoi(line + 6);
+}
+
+static void sms_onCmgsDone(AtResult res, const char *final, void *arg) {
+  SmsOut &o = s_out[(intptr_t)arg];
+  uint32_t now = millis();
+  s_sending = -1;
+  if (res == AT_OK) {
+    o.state = OUT_SENT;
+    o.sent_ms = now;
+    s_stats.sent++;
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] sent to %s (mr %d)\n", o.number, o.mr);
+#endif
+    return;
+  }
+  o.attempts++;
+  if (o.attempts >= SMS_MAX_ATTEMPTS) {
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] giving up on %s after %u attempts (%s)\n", o.number, (unsigned)o.attempts,
+                  res == AT_TIMEOUT ? "timeout" : final);
+#endif
+    o.state = OUT_FREE;
+    s_stats.failed++;
+    return;
+  }
+  uint32_t backoff = SMS_RETRY_BASE_MS << (o.attempts - 1);
+  if (backoff > SMS_RETRY_MAX_MS) backoff = SMS_RETRY_MAX_MS;
+  o.state = OUT_PENDING;
+  o.not_before_ms = now + backoff;
+  s_stats.retries++;
+#if ENABLE_DEBUG
+  Serial.printf("[SMS] send to %s failed (%s), retry in %lu s\n", o.number,
+                res == AT_TIMEOUT ? "timeout" : final, (unsigned long)(backoff / 1000UL));
+#endif
+}
+
+// +CDS: 6,12,"+306912345678",145,"26/10/16,12:00:00+12","26/10/16,12:00:05+12",0
+static void sms_onCds(const char *line, uint32_t, void *) {
+  const char *p = strchr(line, ',');
+  if (!p) return;
+  int mr = atoi(p + 1);
+  const char *st = strrchr(line, ',');
+  int status = st ? atoi(st + 1) : -1;
+  for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+    SmsOut &o = s_out[i];
+    if (o.state != OUT_SENT || o.mr != mr) continue;
+    if (status == 0) s_stats.delivered++;
+#if ENABLE_DEBUG
+    Serial.printf("[SMS] mr %d to %s: %s (status %d)\n", mr, o.number,
+                  status == 0 ? "delivered" : "not delivered", status);
+#endif
+    o.mr = -1;          // report seen; the slot frees once the coalesce window is over
+    return;
+  }
+}
+
+static void sms_pumpOutbox() {
+  uint32_t now = millis();
+  for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+    SmsOut &o = s_out[i];
+    if (o.state != OUT_SENT) continue;
+    uint32_t age = now - o.sent_ms;
+    bool waitReport = SMS_DELIVERY_REPORTS && o.mr >= 0 && age < SMS_REPORT_WAIT_MS;
+    if (!waitReport && age >= SMS_COALESCE_MS) o.state = OUT_FREE;
+  }
+
+  if (s_sending >= 0 || !modem_isNetworkRegistered()) return;
+
+  int next = -1;
+  for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+    SmsOut &o = s_out[i];
+    if (o.state != OUT_PENDING || !sms_due(o.not_before_ms, now)) continue;
+    if (next < 0 || o.prio > s_out[next].prio ||
+        (o.prio == s_out[next].prio && (int32_t)(o.seq - s_out[next].seq) < 0)) next = i;
+  }
+  if (next < 0) return;
+
+  SmsOut &o = s_out[next];
+  size_t n;
+  if (o.count > 1) {
+    char tail[16];
+    int tn = snprintf(tail, sizeof(tail), " (x%u)", (unsigned)o.count);
+    n = strlen(o.text);
+    if (n + tn > 160) n = 160 - tn;
+    memcpy(s_payload, o.text, n);
+    memcpy(s_payload + n, tail, tn);
+    n += tn;
+  } else {
+    n = strlen(o.text);
+    memcpy(s_payload, o.text, n);
+  }
+  s_payload[n++] = 0x1A;    // Ctrl-Z ends the text
+
+  char cmd[40];
+  snprintf(cmd, sizeof(cmd), "+CMGS=\"%s\"", o.number);
+  at_submit("+CMGF=1", 1000);
+#if SMS_DELIVERY_REPORTS
+  at_submit("+CSMP=49,167,0,0", 1000);        // ask for a status report
+#endif
+  if (!at_submitPayload(cmd, "> ", s_payload, n, SMS_SEND_TIMEOUT_MS,
+                        sms_onCmgsLine, sms_onCmgsDone, (void *)(intptr_t)next)) {
+    return;                                     // AT queue full, next sms_loop()
+  }
+  o.state = OUT_SENDING;
+  o.sent_ms = now;
+  s_sending = next;
+}
+
+int sms_outboxCount() {
+  int n = 0;
+  for (int i = 0; i < SMS_OUTBOX_LEN; i++) {
+    if (s_out[i].state == OUT_PENDING || s_out[i].state == OUT_SENDING) n++;
+  }
+  return n;
+}
+
+void sms_setWakeHook(void (*fn)(void)) { s_wake = fn; }
+
+void sms_init() {
+  s_lastScan = millis();
+  static bool subscribed = false;
+  if (!subscribed) {
+    subscribed = true;
+    at_subscribe("+CMTI:", sms_onCmti);
+    at_subscribe("+CDS:", sms_onCds);
+  }
+}
 
 void sms_scan_now() {
-  TinyGsm &modem = modem_get();
-  if (!modem_isNetworkRegistered()) return;
-  sms_atSendAndRead(modem, "+CMGF=1", 800);
-  modem.sendAT("+CMGL=\"REC UNREAD\"");
-  String resp = sms_modemReadStream(modem, 2000);
-  if (resp.indexOf("+CMGL:")>=0) {
-    // Process responses (left minimal to avoid accidental deletion issues)
-    // Implementation in production should parse entries and act accordingly.
+  if (s_state != SMS_IDLE || !modem_isNetworkRegistered()) return;
+  s_newMessage = false;
+  s_lastScan = millis();
+  s_count = 0;
+  s_overflow = false;
+  s_state = SMS_LISTING;
+  s_stats.scans++;
+  // Re-sent with every scan: a modem restart forgets both.
+  at_submit("+CMGF=1", 1000);
+  // announce new messages with +CMTI (and status reports with +CDS)
+  at_submit(SMS_DELIVERY_REPORTS ? "+CNMI=2,1,0,1,0" : "+CNMI=2,1,0,0,0", 1000);
+  if (!at_submit("+CMGL=\"ALL\"", 10000, sms_onListLine, sms_onListDone)) {
+    s_state = SMS_IDLE;
+    s_retry = true;
   }
 }
 
 void sms_loop() {
-  unsigned long now = millis();
-  if (now - s_lastCheck < SMS_CHECK_INTERVAL) return;
-  s_lastCheck = now;
-  if (!modem_isNetworkRegistered()) return;
+  // In PSM nothing can arrive: wake only for outgoing messages, and scan
+  // once after every wake for what the network delivered meanwhile.
+  static uint32_t seenWakes = 0;
+  if (!modemPower_isAwake()) {
+    if (sms_outboxCount()) modemPower_requestAwake();
+    return;
+  }
+  if (modemPower_wakeCount() != seenWakes) {
+    seenWakes = modemPower_wakeCount();
+    s_newMessage = true;
+  }
+  sms_pumpOutbox();
+  if (s_state == SMS_LISTED) {
+    s_state = SMS_IDLE;
+    if (s_listOk) {
+#if ENABLE_DEBUG
+      if (s_count) Serial.printf("[SMS] %d message(s)%s\n", s_count, s_overflow ? " (more stored)" : "");
+#endif
+      sms_processBatch();
+    }
+    s_retry = !s_listOk;     // SIM busy / not ready yet
+    return;
+  }
+  if (s_state != SMS_IDLE) return;
+  uint32_t wait = s_retry ? SMS_RETRY_MS : SMS_RESCAN_MS;
+  if (!s_newMessage && millis() - s_lastScan < wait) return;
   sms_scan_now();
 }
 
-bool sms_send(String number, String message) {
-  TinyGsm &modem = modem_get();
-  // Ensure modem is ready/registered? 
-  // We try anyway.
-  return modem.sendSMS(number, message);
-}
\ No newline at end of file
+
+const SmsStats &sms_stats() { return s_stats; }
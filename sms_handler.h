@@ -3,9 +3,72 @@
 
 #include <Arduino.h>
 
+// sms_handler.h : inbound SMS commands and outgoing alarm messages.
+//
+// Nothing polls the SIM: the modem announces each new message with +CMTI,
+// which schedules one scan. A scan lists the stored messages (AT+CMGL,
+// queued on the AT engine, nothing blocks), parses them into SmsMessage
+// records, runs the authenticated commands and deletes the whole batch
+// with one AT+CMGD. A slow safety scan (SMS_RESCAN_MS) catches a lost URC.
+//
+// Command format: "<SMS_CMD_PIN> <COMMAND> [arg]" from ALARM_PHONE_NUMBER.
+//   STATUS            -> reply with readings, battery, alarm and interval
+//   INTERVAL <min>    -> upload interval in minutes (1..1440)
+//   ARM / DISARM      -> motion alarm
+// An unknown command with the right PIN is answered with this list
+// ("ERR commands: ..."). Other senders and a wrong or missing PIN are
+// logged and deleted without a reply.
+//
+// Outgoing messages go through a small outbox, sent one at a time from
+// sms_loop() on the AT engine (AT+CMGS, text after the "> " prompt), so
+// nothing ever blocks loop(). Alarms go before status replies. A message
+// with a coalesce key that repeats within SMS_COALESCE_MS of the last one
+// sent is held back and folded into one "... (xN)" message at the end of
+// the window. Failures retry with exponential backoff up to
+// SMS_MAX_ATTEMPTS; with SMS_DELIVERY_REPORTS the +CDS report marks the
+// message delivered.
+
+struct SmsMessage {
+  int  index;          // storage slot (AT+CMGD)
+  bool unread;
+  char sender[24];
+  char stamp[24];      // "yy/MM/dd,hh:mm:ss+zz"
+  char text[161];      // cut at 160 characters
+};
+
+enum SmsPriority : uint8_t {
+  SMS_PRIO_STATUS = 0,   // command replies
+  SMS_PRIO_ALARM  = 1,
+};
+
+struct SmsStats {
+  uint32_t scans;
+  uint32_t received;
+  uint32_t commands;     // authenticated and executed
+  uint32_t rejected;     // wrong sender or PIN, unknown command
+  uint32_t deleted;
+  uint32_t queued;       // outbox
+  uint32_t coalesced;    // folded into a pending message
+  uint32_t sent;
+  uint32_t delivered;    // +CDS status report "received by SME"
+  uint32_t retries;
+  uint32_t failed;       // gave up after SMS_MAX_ATTEMPTS
+  uint32_t dropped;      // outbox full
+};
+
 void sms_init();
 void sms_loop();
 void sms_scan_now();
-bool sms_send(String number, String message);
 
-#endif // SMS_HANDLER_H
\ No newline at end of file
+// Queue a message; returns false if the outbox is full of equal or higher
+// priority messages. coalesce_key (a literal, may be null) groups repeats.
+bool sms_queue(const char *number, const char *text, SmsPriority prio,
+               const char *coalesce_key = nullptr);
+bool sms_send(String number, String message);   // status priority, no coalescing
+int  sms_outboxCount();
+const SmsStats &sms_stats();
+
+// Called when a message is queued, so the loop can run sms_loop() now.
+void sms_setWakeHook(void (*fn)(void));
+
+#endif // SMS_HANDLER_H
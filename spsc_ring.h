@@ -0,0 +1,67 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// spsc_ring.h : lock-free single-producer / single-consumer ring buffer.
+//
+// One task pushes, one task pops; neither side takes a lock. N must be a
+// power of two. push() never overwrites: when the ring is full the new item
+// is dropped and counted, so the consumer always sees a gap-free prefix.
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head_(0), tail_(0), dropped_(0) {}
+
+  // producer side
+  bool push(const T &item) {
+    uint32_t h = head_.load(std::memory_order_relaxed);
+    uint32_t t = tail_.load(std::memory_order_acquire);
+    if (h - t >= N) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[h & (N - 1)] = item;
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool pop(T &out) {
+    uint32_t t = tail_.load(std::memory_order_relaxed);
+    uint32_t h = head_.load(std::memory_order_acquire);
+    if (t == h) return false;
+    out = buf_[t & (N - 1)];
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side: look at the oldest item without removing it
+  bool peek(T &out) const {
+    uint32_t t = tail_.load(std::memory_order_relaxed);
+    uint32_t h = head_.load(std::memory_order_acquire);
+    if (t == h) return false;
+    out = buf_[t & (N - 1)];
+    return true;
+  }
+
+  size_t size() const {
+    return (size_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  T buf_[N];
+  std::atomic<uint32_t> head_;    // written by producer only
+  std::atomic<uint32_t> tail_;    // written by consumer only
+  std::atomic<uint32_t> dropped_; // items rejected because the ring was full
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,121 @@
+// telemetry.cpp
+// Seqlock-published TelemetrySnapshot (see telemetry.h).
+//
+// Writer: seq goes odd, fields are written, seq goes even.
+// Reader: copy, then retry if seq was odd or changed during the copy.
+
+#include "telemetry.h"
+#include <string.h>
+#include <atomic>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static uint32_t tlm_nowMs() { return millis(); }
+static void tlm_backoff() { yield(); }
+#else
+static uint32_t tlm_nowMs() { return 0; }
+static void tlm_backoff() {}
+#endif
+
+static TelemetrySnapshot     s_snap = {};
+static std::atomic<uint32_t> s_lock(0);   // seqlock counter (odd = write in progress)
+
+void telemetry_read(TelemetrySnapshot &out) {
+  for (unsigned tries = 0;; ++tries) {
+    uint32_t s1 = s_lock.load(std::memory_order_acquire);
+    if ((s1 & 1u) == 0) {
+      memcpy(&out, &s_snap, sizeof(out));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s_lock.load(std::memory_order_relaxed) == s1) return;
+    }
+    // the writer may be preempted by us on the same core: let it finish
+    if (tries >= 4) tlm_backoff();
+  }
+}
+
+static void tlm_beginWrite() {
+  s_lock.fetch_add(1, std::memory_order_acq_rel);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void tlm_endWrite() {
+  s_snap.seq++;
+  s_snap.t_ms = tlm_nowMs();
+  time_t now = time(nullptr);
+  s_snap.epoch = (now > 100000) ? now : 0;   // same "clock is set" test as time_manager
+  s_lock.fetch_add(1, std::memory_order_release);
+}
+
+void telemetry_setWeight(int ch, float kg, uint8_t confidence) {
+  if (ch < 0 || ch >= TLM_MAX_WEIGHTS) return;
+  tlm_beginWrite();
+  s_snap.weight[ch] = kg;
+  s_snap.weight_conf[ch] = confidence;
+  s_snap.weight_valid |= (uint8_t)(1u << ch);
+  s_snap.valid |= TLM_WEIGHT;
+  tlm_endWrite();
+}
+
+void telemetry_invalidateWeight(int ch) {
+  if (ch < 0 || ch >= TLM_MAX_WEIGHTS) return;
+  tlm_beginWrite();
+  s_snap.weight_valid &= (uint8_t)~(1u << ch);
+  if (!s_snap.weight_valid) s_snap.valid &= ~TLM_WEIGHT;
+  tlm_endWrite();
+}
+
+void telemetry_setInternal(float temp_c, float hum) {
+  tlm_beginWrite();
+  s_snap.temp_int = temp_c;
+  s_snap.hum_int  = hum;
+  s_snap.valid |= TLM_TEMP_INT | TLM_HUM_INT;
+  tlm_endWrite();
+}
+
+void telemetry_setExternal(float temp_c, float hum, float pressure_hpa) {
+  tlm_beginWrite();
+  s_snap.temp_ext = temp_c;
+  s_snap.hum_ext  = hum;
+  s_snap.pressure = pressure_hpa;
+  s_snap.valid |= TLM_TEMP_EXT | TLM_HUM_EXT | TLM_PRESSURE;
+  tlm_endWrite();
+}
+
+void telemetry_setAccel(float x, float y, float z) {
+  tlm_beginWrite();
+  s_snap.acc_x = x;
+  s_snap.acc_y = y;
+  s_snap.acc_z = z;
+  s_snap.valid |= TLM_ACCEL;
+  tlm_endWrite();
+}
+
+void telemetry_setBattery(float volts, int percent) {
+  tlm_beginWrite();
+  s_snap.batt_voltage = volts;
+  s_snap.batt_percent = percent;
+  s_snap.valid |= TLM_BATT_V | TLM_BATT_PCT;
+  tlm_endWrite();
+}
+
+void telemetry_setGps(double lat, double lon) {
+  tlm_beginWrite();
+  s_snap.lat = lat;
+  s_snap.lon = lon;
+  s_snap.valid |= TLM_GPS;
+  tlm_endWrite();
+}
+
+void telemetry_setRssi(int rssi) {
+  tlm_beginWrite();
+  s_snap.rssi = rssi;
+  s_snap.valid |= TLM_RSSI;
+  tlm_endWrite();
+}
+
+void telemetry_invalidate(uint32_t fields) {
+  tlm_beginWrite();
+  s_snap.valid &= ~fields;
+  if (fields & TLM_WEIGHT) s_snap.weight_valid = 0;
+  tlm_endWrite();
+}
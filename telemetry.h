@@ -0,0 +1,76 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <time.h>
+
+// telemetry.h : the single source of current sensor values.
+//
+// All readings live in one TelemetrySnapshot published through a seqlock.
+// Readers (SD logger, ThingSpeak, menus, web endpoints) take a consistent
+// copy in O(1) without blocking the writer; every field carries a bit in
+// `valid` instead of the old NAN / -999 sentinels.
+//
+// Writers: the loop task only (acquisition drain, GPS, battery jobs).
+// Readers: any task.
+
+#define TLM_MAX_WEIGHTS 4   // load-cell channels (one hive each)
+
+enum TelemetryField : uint32_t {
+  TLM_WEIGHT    = 1u << 0,   // at least one weight channel (see weight_valid)
+  TLM_TEMP_INT  = 1u << 1,
+  TLM_HUM_INT   = 1u << 2,
+  TLM_TEMP_EXT  = 1u << 3,
+  TLM_HUM_EXT   = 1u << 4,
+  TLM_PRESSURE  = 1u << 5,
+  TLM_ACCEL     = 1u << 6,
+  TLM_BATT_V    = 1u << 7,
+  TLM_BATT_PCT  = 1u << 8,
+  TLM_GPS       = 1u << 9,
+  TLM_RSSI      = 1u << 10,
+};
+
+struct TelemetrySnapshot {
+  uint32_t seq;           // number of publishes so far
+  uint32_t t_ms;          // millis() of the last publish
+  time_t   epoch;         // wall clock of the last publish (0 = clock not valid)
+  uint32_t valid;         // TLM_* bits
+
+  float   weight[TLM_MAX_WEIGHTS];      // kg per load-cell channel
+  uint8_t weight_conf[TLM_MAX_WEIGHTS]; // 0..100, filter confidence
+  uint8_t weight_valid;                 // bit per channel
+  float temp_int;         // C (SI7021)
+  float hum_int;          // %
+  float temp_ext;         // C (BME280/BME680)
+  float hum_ext;          // %
+  float pressure;         // hPa
+  float acc_x, acc_y, acc_z; // m/s^2
+  float batt_voltage;     // V
+  int   batt_percent;     // %
+  int   rssi;             // modem signal
+  double lat, lon;        // GPS
+};
+
+inline bool telemetry_has(const TelemetrySnapshot &s, uint32_t fields) {
+  return (s.valid & fields) == fields;
+}
+
+inline bool telemetry_hasWeight(const TelemetrySnapshot &s, int ch) {
+  return ch >= 0 && ch < TLM_MAX_WEIGHTS && (s.weight_valid & (1u << ch));
+}
+
+// Consistent copy of the current snapshot (never blocks the writer).
+void telemetry_read(TelemetrySnapshot &out);
+
+// Writer side (loop task). Each call publishes one new snapshot.
+void telemetry_setWeight(int ch, float kg, uint8_t confidence = 100);
+void telemetry_invalidateWeight(int ch);
+void telemetry_setInternal(float temp_c, float hum);
+void telemetry_setExternal(float temp_c, float hum, float pressure_hpa);
+void telemetry_setAccel(float x, float y, float z);
+void telemetry_setBattery(float volts, int percent);
+void telemetry_setGps(double lat, double lon);
+void telemetry_setRssi(int rssi);
+void telemetry_invalidate(uint32_t fields);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,264 @@
+// telemetry_sink.cpp
+// Sample fan-out to the upload sinks, one queue and retry state each
+// (see telemetry_sink.h).
+
+#include "telemetry_sink.h"
+#include "config.h"
+#include "time_manager.h"
+#include <SD.h>
+
+struct SinkSlot {
+  const TelemetrySink *sink;
+  SegQueue  q;
+  SinkStats st;
+  uint32_t  next_ms;      // not before this (rate limit / backoff)
+};
+
+static SinkSlot s_slots[SINK_MAX];
+static int      s_count = 0;
+static char     s_rec[SQ_MAX_RECORD + 1];
+static String   s_body;
+static void   (*s_wake)(void) = nullptr;
+static const SinkStats s_noStats = {};
+
+static bool sink_due(uint32_t t, uint32_t now) { return (int32_t)(now - t) >= 0; }
+
+bool sink_register(const TelemetrySink *sink) {
+  if (s_count >= SINK_MAX || !sink) return false;
+  SinkSlot &s = s_slots[s_count++];
+  s.sink = sink;
+  s.next_ms = millis();
+  return true;
+}
+
+void sink_setWakeHook(void (*fn)(void)) { s_wake = fn; }
+
+static bool sink_open(SinkSlot &s) {
+  if (s.q.open) return true;
+  if (!SD.begin(SD_CS)) return false;
+  if (!sq_open(s.q, s.sink->queue_dir, SINK_SEG_BYTES)) {
+#if ENABLE_DEBUG
+    Serial.printf("[SINK] %s: cannot open queue %s\n", s.sink->name, s.sink->queue_dir);
+#endif
+    return false;
+  }
+  if (s.sink->opened) s.sink->opened(s.q);
+  return true;
+}
+
+bool sink_publish(const char *fields, const SampleRecord &capture) {
+  SampleRecord r = capture;
+  r.fields = fields;
+  size_t n = sample_format(s_rec, sizeof(s_rec), r);
+  bool all = n > 0;
+  for (int i = 0; i < s_count; i++) {
+    SinkSlot &s = s_slots[i];
+    if (!s.sink->enabled()) continue;
+    if (n && sink_open(s) && sq_push(s.q, s_rec, n)) {
+      s.st.published++;
+    } else {
+      s.st.queue_failed++;
+      all = false;
+#if ENABLE_DEBUG
+      Serial.printf("[SINK] %s: sample not queued\n", s.sink->name);
+#endif
+    }
+  }
+  if (s_wake) s_wake();
+  return all;
+}
+
+// WiFi, or an LTE data session that is already up. Over LTE, plain-HTTP
+// sinks reuse the pool's kept-alive sockets (https:// falls back to the
+// modem's HTTPS service inside HTTP_POOL).
+static const HttpTransport *sink_bearer() {
+  if (HTTP_WIFI.ready()) return &HTTP_WIFI;
+  if (HTTP_POOL.ready()) return &HTTP_POOL;
+  return nullptr;
+}
+
+// Build and send one batch. Returns the number of samples delivered,
+// 0 if there was nothing to send, -1 if the server did not take it.
+static int sink_sendBatch(SinkSlot &s, const HttpTransport &tp) {
+  const TelemetrySink *k = s.sink;
+  sq_rewind(s.q);
+  s_body = "";
+  s_body.reserve(k->max_bytes + 256);
+  k->begin(s_body);
+  int count = 0;
+  while (count < k->max_batch && s_body.length() < k->max_bytes) {
+    int n = sq_peek(s.q, s_rec, SQ_MAX_RECORD);
+    if (n <= 0) break;
+    s_rec[n] = '\0';
+    SampleRecord r;
+    if (!sample_parse(s_rec, r)) continue;
+    k->encode(s_body, r, count++);
+  }
+  k->end(s_body);
+  if (count == 0) {
+    sq_ack(s.q);              // step over damaged records
+    return 0;
+  }
+
+  bool ok;
+  int status = 0;
+  if (k->deliver) {
+    ok = k->deliver(tp, s_body, count);
+  } else {
+    char body[128];
+    HttpResponse resp;
+    http_begin(resp, body, sizeof(body));
+    ok = k->send(tp, s_body, resp) && k->ack(resp, count);
+    status = resp.status;
+  }
+#if ENABLE_DEBUG
+  if (k->deliver) Serial.printf("[SINK] %s via %s: %d samples %s\n", k->name, tp.name, count,
+                                ok ? "acked" : "NOT acked");
+  else Serial.printf("[SINK] %s via %s: %d samples, HTTP %d %s\n", k->name, tp.name, count,
+                     status, ok ? "acked" : "NOT acked");
+#endif
+  if (!ok) {
+    sq_rewind(s.q);
+    return -1;
+  }
+  sq_ack(s.q);
+  return count;
+}
+
+uint32_t sink_service() {
+  uint32_t next = SINK_IDLE_MS;
+  const HttpTransport *tp = sink_bearer();
+
+  for (int i = 0; i < s_count; i++) {
+    SinkSlot &s = s_slots[i];
+    if (!s.sink->enabled() || !sink_open(s) || sq_empty(s.q)) continue;
+    uint32_t now = millis();
+    if (!sink_due(s.next_ms, now)) {
+      if (s.next_ms - now < next) next = s.next_ms - now;
+      continue;
+    }
+    if (!tp) {
+      if (SINK_BEARER_POLL_MS < next) next = SINK_BEARER_POLL_MS;
+      continue;
+    }
+
+    int n = sink_sendBatch(s, *tp);
+    now = millis();
+    uint32_t wait;
+    if (n >= 0) {
+      s.st.delivered += n;
+      if (n) { s.st.batches++; s.st.last_ok_ms = now; }
+      s.st.consecutive_failures = 0;
+      s.st.backoff_ms = 0;
+      wait = s.sink->min_interval_ms;
+    } else {
+      s.st.failures++;
+      s.st.consecutive_failures++;
+      uint32_t b = SINK_RETRY_MIN_MS;
+      for (uint16_t k = 1; k < s.st.consecutive_failures && b < SINK_RETRY_MAX_MS; k++) b *= 2;
+      if (b > SINK_RETRY_MAX_MS) b = SINK_RETRY_MAX_MS;
+      s.st.backoff_ms = b;
+      wait = b;
+    }
+    s.next_ms = now + wait;
+    if (!sq_empty(s.q) && wait < next) next = wait;
+  }
+  return next;
+}
+
+bool sink_allDelivered() {
+  for (int i = 0; i < s_count; i++) {
+    SinkSlot &s = s_slots[i];
+    if (!s.sink->enabled()) continue;
+    if (!s.q.open || !sq_empty(s.q)) return false;
+  }
+  return true;
+}
+
+int sink_count() { return s_count; }
+
+const TelemetrySink *sink_get(int i) {
+  return (i >= 0 && i < s_count) ? s_slots[i].sink : nullptr;
+}
+
+const SinkStats &sink_stats(int i) {
+  return (i >= 0 && i < s_count) ? s_slots[i].st : s_noStats;
+}
+
+const SegQueue *sink_queue(int i) {
+  return (i >= 0 && i < s_count && s_slots[i].q.open) ? &s_slots[i].q : nullptr;
+}
+
+bool sink_isoTime(const SampleRecord &r, char out[24]) {
+  time_t tt = (time_t)r.epoch;
+  if (!tt && !(r.boot_id && timeManager_epochAt(r.boot_id, r.uptime_ms, tt))) return false;
+  struct tm tmv;
+  gmtime_r(&tt, &tmv);
+  strftime(out, 24, "%Y-%m-%dT%H:%M:%SZ", &tmv);
+  return true;
+}
+
+void sink_jsonSample(String &out, const SampleRecord &r) {
+  char buf[40];
+  out += "{\"fields\":{";
+  size_t mark = out.length();
+  sink_jsonFields(out, r.fields);
+  if (out.length() > mark) out.remove(mark, 1);   // leading comma
+  out += '}';
+  if (sink_isoTime(r, buf)) {
+    out += ",\"ts\":\"";
+    out += buf;
+    out += '"';
+  }
+  if (r.has_loc) {
+    snprintf(buf, sizeof(buf), ",\"lat\":%.6f,\"lon\":%.6f", r.lat, r.lon);
+    out += buf;
+  }
+  out += '}';
+}
+
+void sink_jsonString(String &out, const char *v) {
+  out += '"';
+  for (; *v; ++v) {
+    char c = *v;
+    if (c == '"' || c == '\\') { out += '\\'; out += c; }
+    else if ((unsigned char)c < 0x20) { char tmp[8]; snprintf(tmp, sizeof(tmp), "\\u%04x", (unsigned char)c); out += tmp; }
+    else out += c;
+  }
+  out += '"';
+}
+
+static int hexval(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+void sink_jsonFields(String &out, const char *fields) {
+  const char *p = fields;
+  while (*p) {
+    const char *amp = strchr(p, '&');
+    if (!amp) amp = p + strlen(p);
+    const char *eq = (const char *)memchr(p, '=', amp - p);
+    if (eq && eq > p) {
+      out += ",\"";
+      for (const char *c = p; c < eq; ++c) out += *c;   // field1..7 / status: no escaping needed
+      out += "\":";
+      // '+' and %XX back to plain text (the queue stores url-encoded pairs)
+      String v;
+      v.reserve(amp - eq);
+      for (const char *c = eq + 1; c < amp; ++c) {
+        if (*c == '+') {
+          v += ' ';
+        } else if (*c == '%' && c + 2 < amp && hexval(c[1]) >= 0 && hexval(c[2]) >= 0) {
+          v += (char)(hexval(c[1]) * 16 + hexval(c[2]));
+          c += 2;
+        } else {
+          v += *c;
+        }
+      }
+      sink_jsonString(out, v.c_str());
+    }
+    p = *amp ? amp + 1 : amp;
+  }
+}
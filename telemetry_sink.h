@@ -0,0 +1,99 @@
+#ifndef TELEMETRY_SINK_H
+#define TELEMETRY_SINK_H
+
+#include <Arduino.h>
+#include "sample_record.h"
+#include "seg_queue.h"
+#include "http_transport.h"
+
+// telemetry_sink.h : upload destinations behind one interface.
+//
+// A sample is published once and fans out to every enabled sink: each
+// sink has its own persistent queue (seg_queue.h, under its queue_dir)
+// and its own retry state, so a slow or failing sink never holds back
+// the others, and a sink that was down catches up from its queue.
+//
+// A sink only describes its wire format and its server:
+//   begin/encode/end  build one request body from up to max_batch samples
+//   send              performs it on the transport it is given
+//   ack               decides from the response whether the server took
+//                     the batch; only then is the queue advanced
+//   deliver           instead of send/ack, for sinks with their own
+//                     protocol (mqtt_client.h): sends the batch on the
+//                     bearer tp stands for, true once the server acked it
+// sink_service() sends at most one batch per due sink per call, over WiFi
+// or an LTE data session that is already up (never attaching or waking
+// the modem for it). A failed batch backs off per sink, SINK_RETRY_MIN_MS
+// doubling up to SINK_RETRY_MAX_MS.
+
+struct TelemetrySink {
+  const char *name;
+  const char *queue_dir;          // VFS path, e.g. "/sd/tsq"
+  uint16_t    max_batch;          // samples per request
+  uint16_t    max_bytes;          // request body soft limit
+  uint32_t    min_interval_ms;    // between requests (server rate limit)
+  bool (*enabled)();
+  void (*begin)(String &out);
+  void (*encode)(String &out, const SampleRecord &r, int n);   // n: index in this batch
+  void (*end)(String &out);
+  bool (*send)(const HttpTransport &tp, const String &body, HttpResponse &resp);
+  bool (*ack)(const HttpResponse &resp, int count);
+  bool (*deliver)(const HttpTransport &tp, const String &body, int count);   // may be null
+  void (*opened)(SegQueue &q);    // queue opened (import old data), may be null
+};
+
+struct SinkStats {
+  uint32_t published;       // samples queued
+  uint32_t queue_failed;    // could not be queued (SD)
+  uint32_t delivered;       // samples acknowledged by the server
+  uint32_t batches;         // requests acknowledged
+  uint32_t failures;        // requests not acknowledged
+  uint32_t last_ok_ms;
+  uint32_t backoff_ms;      // current backoff, 0 = none
+  uint16_t consecutive_failures;
+};
+
+#define SINK_MAX 4
+
+// Setup: register each sink once (queues open lazily on first use).
+bool sink_register(const TelemetrySink *sink);
+
+// Queue one sample (fields + capture stamp) on every enabled sink.
+// Returns false if any queue refused it.
+bool sink_publish(const char *fields, const SampleRecord &capture);
+
+// One batch for every sink that is due and has work. Returns the ms until
+// a sink is due again (SINK_IDLE_MS when nothing is pending).
+uint32_t sink_service();
+
+// Every enabled sink has delivered everything queued.
+bool sink_allDelivered();
+
+// Called by sink_publish(), so the loop can run sink_service() now.
+void sink_setWakeHook(void (*fn)(void));
+
+int                  sink_count();
+const TelemetrySink *sink_get(int i);
+const SinkStats     &sink_stats(int i);
+const SegQueue      *sink_queue(int i);     // nullptr until opened
+
+// --- encoding helpers for sinks ---
+
+// Capture time as ISO-8601 UTC ("2024-05-01T10:00:00Z"). Samples taken
+// before the clock was valid are dated from boot id + uptime; false if
+// that is not possible either (old records, a boot that never got a clock).
+bool sink_isoTime(const SampleRecord &r, char out[24]);
+
+// One sample as the collector's JSON object:
+//   {"fields":{..},"ts":"..","lat":..,"lon":..}
+// ts only if the sample can be dated, lat/lon only with a location.
+void sink_jsonSample(String &out, const SampleRecord &r);
+
+// JSON string literal, quoted and escaped.
+void sink_jsonString(String &out, const char *v);
+
+// The url-encoded "k=v&k=v" pairs as JSON members: ,"k":"v",...
+// (leading comma each; keys are field1..7/status, values decoded).
+void sink_jsonFields(String &out, const char *fields);
+
+#endif // TELEMETRY_SINK_H
@@ -1,7 +1,10 @@
 #include "thingspeak_client.h"
 #include "config.h"
+#include "telemetry.h"
+#include "telemetry_sink.h"
+#include "pdp_session.h"
+#include "time_manager.h"
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <Preferences.h>
 #include <SD.h>
 
@@ -9,10 +12,6 @@
 extern void wifi_connectFromPrefs(unsigned long timeoutMs);
 // forward to get user's network preference
 extern int getNetworkPreference();
-// forward to check if modem is registered
-extern bool modem_isNetworkRegistered();
-// forward to modem upload function
-extern bool thingspeak_post_via_modem(const String &postBody);
 
 // minimal URL-encode helper
 static String urlEncode(const String &str) {
@@ -36,55 +35,16 @@ static void fmt2(char *buf, size_t bufsz, double v) {
   snprintf(buf, bufsz, "%.2f", v);
 }
 
-// append a line (bodyPairs) to the SD-backed queue file
-static bool enqueuePost(const String &bodyPairs) {
-  if (!SD.begin(SD_CS)) {
-#if ENABLE_DEBUG
-    Serial.println("[TS] SD.begin failed - cannot enqueue");
-#endif
-    return false;
-  }
-  File f = SD.open(TS_QUEUE_FILENAME, FILE_APPEND);
-  if (!f) {
-#if ENABLE_DEBUG
-    Serial.println("[TS] open queue file failed");
-#endif
-    return false;
-  }
-  f.println(bodyPairs);
-  f.close();
-#if ENABLE_DEBUG
-  Serial.println("[TS] enqueued post");
-#endif
-  return true;
-}
+// Location for field8: the telemetry snapshot (updated by GPS); with no
+// fix, the Preferences override or the default.
+static void ts_location(double &lat, double &lon) {
+  TelemetrySnapshot t;
+  telemetry_read(t);
+  lat = t.lat;
+  lon = t.lon;
 
-// try to post via HTTPClient over WiFi
-static bool postViaWiFi(const String &postBody) {
-  HTTPClient http;
-  http.begin("http://api.thingspeak.com/update");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  int code = http.POST(postBody);
-  String resp = http.getString();
-#if ENABLE_DEBUG
-  Serial.printf("[TS] HTTP code=%d resp=%s\n", code, resp.c_str());
-#endif
-  http.end();
-  if (code == 200) {
-    long vid = resp.toInt();
-    return (vid > 0);
-  }
-  return false;
-}
-
-bool sendToThingSpeak(const String &bodyPairs) {
-  // Build coordinates field from Globals (updated by GPS)
-  // If GPS is invalid (0,0), fall back to Preferences or Default.
-  double lat = test_lat;
-  double lon = test_lon;
-
-  // If globals are 0.0, try preferences (manual override)
-  if (lat == 0.0 && lon == 0.0) {
+  // No fix yet: try preferences (manual override)
+  if (!telemetry_has(t, TLM_GPS) || (lat == 0.0 && lon == 0.0)) {
     Preferences p;
     p.begin("beehive", true);
     String latS = p.getString("owm_lat", "");
@@ -98,172 +58,244 @@ bool sendToThingSpeak(const String &bodyPairs) {
       lon = DEFAULT_LON;
     }
   }
+}
 
-  char latBuf[32], lonBuf[32];
-  snprintf(latBuf, sizeof(latBuf), "%.6f", lat);
-  snprintf(lonBuf, sizeof(lonBuf), "%.6f", lon);
-  // coords as "lat lon" (space separated)
-  String coords = String(latBuf) + String(" ") + String(lonBuf);
-  // use existing urlEncode (which turns spaces -> +)
-  String coordsEnc = urlEncode(coords);
-
-  // Build final POST body: api_key + caller pairs + field8
-  String post;
-  post.reserve(256);
-  post += "api_key=";
-  post += THINGSPEAK_WRITE_APIKEY;
-  if (bodyPairs.length()) {
-    post += "&";
-    post += bodyPairs;
-  }
-  post += "&field8=";
-  post += coordsEnc;
+// field8 text: "lat lon"
+static String ts_coordsText(double lat, double lon) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.6f %.6f", lat, lon);
+  return String(buf);
+}
 
-  // 1) If WiFi connected, post immediately
-  if (WiFi.status() == WL_CONNECTED) {
-#if ENABLE_DEBUG
-    Serial.println("[TS] WiFi connected - posting via WiFi");
-#endif
-    bool ok = postViaWiFi(post);
-    if (ok) return true;
-#if ENABLE_DEBUG
-    Serial.println("[TS] WiFi post failed - enqueueing");
-#endif
-    enqueuePost(bodyPairs);  // store original bodyPairs (field8 will be appended when retried)
-    return false;
-  }
+static String ts_coords() {
+  double lat, lon;
+  ts_location(lat, lon);
+  return ts_coordsText(lat, lon);
+}
 
+// Stamp a sample as it is taken: clock time if valid, always boot id +
+// uptime, and the location it belongs to.
+static SampleRecord ts_capture() {
+  SampleRecord r = {};
+  r.epoch = timeManager_isTimeValid() ? (uint32_t)time(nullptr) : 0;
+  r.boot_id = timeManager_bootId();
+  r.uptime_ms = millis();
+  r.has_loc = true;
+  ts_location(r.lat, r.lon);
+  return r;
+}
 
-// 2) Check user preference - if LTE preferred, try LTE upload
-  int pref = getNetworkPreference();
-  if (pref == CONNECTIVITY_LTE) {
-    // User wants LTE - check if modem is connected
-    if (modem_isNetworkRegistered()) {
-#if ENABLE_DEBUG
-      Serial.println("[TS] User prefers LTE - attempting LTE upload");
-#endif
-      bool ok = thingspeak_post_via_modem(post);
-      if (ok) return true;
-#if ENABLE_DEBUG
-      Serial.println("[TS] LTE upload failed - enqueueing");
-#endif
-    } else {
+bool sendToThingSpeak(const String &bodyPairs) {
+  // Every sample goes through the sink queues (telemetry_sink.h): queued
+  // with its capture stamp on each sink, then sent right away if a bearer
+  // is up. What does not go out now follows from the queue.
+  SampleRecord cap = ts_capture();
+  if (!sink_publish(bodyPairs.c_str(), cap)) {
 #if ENABLE_DEBUG
-      Serial.println("[TS] User prefers LTE but not connected - enqueueing");
+    Serial.println("[TS] sample not queued on every sink");
 #endif
-    }
-    enqueuePost(bodyPairs);
-    return false;
   }
 
-  // Try to auto-connect to known WiFi briefly
-#if ENABLE_DEBUG
-  Serial.println("[TS] WiFi not connected - attempting auto-connect");
-#endif
-  wifi_connectFromPrefs(8000);
-  delay(200);
-  if (WiFi.status() == WL_CONNECTED) {
+  // No bearer: briefly try known WiFi first, unless LTE is preferred
+  if (WiFi.status() != WL_CONNECTED && !pdp_isUp() && getNetworkPreference() != CONNECTIVITY_LTE) {
 #if ENABLE_DEBUG
-    Serial.println("[TS] Auto-connect succeeded - posting via WiFi");
+    Serial.println("[TS] no bearer - attempting WiFi auto-connect");
 #endif
-    bool ok = postViaWiFi(post);
-    if (ok) return true;
-#if ENABLE_DEBUG
-    Serial.println("[TS] WiFi post after auto-connect failed - enqueueing");
-#endif
-    enqueuePost(bodyPairs);
-    return false;
+    wifi_connectFromPrefs(8000);
   }
+  sink_service();
+  return sink_allDelivered();
+}
 
-// 3) No WiFi available - enqueue for later retry
-#if ENABLE_DEBUG
-  Serial.println("[TS] No WiFi - enqueueing post for later");
-#endif
-  enqueuePost(bodyPairs);
-  return false;
+// append "&fieldN=<value>" (or "fieldN=" for the first pair) when the field is valid
+static void appendField(String &b, const TelemetrySnapshot &t, uint32_t field, int n, const char *fmt, double v) {
+  if (!telemetry_has(t, field)) return;
+  char buf[32];
+  snprintf(buf, sizeof(buf), fmt, v);
+  if (b.length()) b += "&";
+  b += "field";
+  b += n;
+  b += "=";
+  b += urlEncode(String(buf));
 }
 
-bool thingspeak_upload_current() {
-  // Build body with fields 1..7 from global test_ variables
-  char buf[64];
+String thingspeak_buildBodyPairs(const TelemetrySnapshot &t) {
   String b;
   b.reserve(160);
+  if (telemetry_hasWeight(t, 0)) appendField(b, t, TLM_WEIGHT, 1, "%.1f", t.weight[0]); // weight (kg) 1 decimal
+  appendField(b, t, TLM_TEMP_INT, 2, "%.1f", t.temp_int);      // internal temp 1 decimal
+  appendField(b, t, TLM_HUM_INT,  3, "%.0f", t.hum_int);       // internal humidity 0 decimals
+  appendField(b, t, TLM_TEMP_EXT, 4, "%.1f", t.temp_ext);      // external temp 1 decimal
+  appendField(b, t, TLM_HUM_EXT,  5, "%.0f", t.hum_ext);       // external humidity 0 decimals
+  appendField(b, t, TLM_PRESSURE, 6, "%.0f", t.pressure);      // pressure 0 decimals
+  appendField(b, t, TLM_BATT_V,   7, "%.2f", t.batt_voltage);  // battery voltage 2 decimals
+
+  // The channel has no spare fields for more hives: with several load
+  // cells all weights go into the status text ("W1=12.3 W2=14.0"), field1
+  // stays hive 1.
+  if (LOADCELL_CHANNELS > 1 && telemetry_has(t, TLM_WEIGHT)) {
+    String st;
+    char buf[24];
+    for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+      if (!telemetry_hasWeight(t, ch)) continue;
+      snprintf(buf, sizeof(buf), "%sW%d=%.1f", st.length() ? " " : "", ch + 1, t.weight[ch]);
+      st += buf;
+    }
+    if (b.length()) b += "&";
+    b += "status=" + urlEncode(st);
+  }
+  return b;
+}
 
-  // field1: weight (kg) 1 decimal
-  snprintf(buf, sizeof(buf), "%.1f", test_weight);
-  b += "field1=" + urlEncode(String(buf));
+bool thingspeak_upload_current() {
+  // Build body with fields 1..7 from one telemetry snapshot
+  TelemetrySnapshot t;
+  telemetry_read(t);
+  return sendToThingSpeak(thingspeak_buildBodyPairs(t));
+}
+
+// ---------------------------------------------------------------------
+// ThingSpeak sink (telemetry_sink.h)
+// ---------------------------------------------------------------------
+// One bulk_update.json request carries up to TS_BULK_MAX_ENTRIES queued
+// samples, each with its own created_at, instead of one POST per sample:
+//   {"write_api_key":"..","updates":[{"created_at":"2024-05-01T10:00:00Z",
+//    "field1":"23.5",..,"field8":"lat lon"},..]}
+// Without THINGSPEAK_CHANNEL_ID there is no bulk endpoint: samples go one
+// per /update, still with their created_at.
+#define TS_BULK (THINGSPEAK_CHANNEL_ID != 0)
+
+// Where the sample was taken; old records without one use the current.
+static String ts_recordCoords(const SampleRecord &r) {
+  return r.has_loc ? ts_coordsText(r.lat, r.lon) : ts_coords();
+}
 
-  // field2: internal temp 1 decimal
-  snprintf(buf, sizeof(buf), "%.1f", test_temp_int);
-  b += "&field2=" + urlEncode(String(buf));
+// One queued sample -> one element of "updates". Undatable samples go out
+// with delta_t 0 (ThingSpeak stamps them on arrival).
+static void appendBulkEntry(String &json, const SampleRecord &r) {
+  char ts[24];
+  json += '{';
+  if (sink_isoTime(r, ts)) {
+    json += "\"created_at\":\"";
+    json += ts;
+    json += '"';
+  } else {
+    json += "\"delta_t\":0";
+  }
 
-  // field3: internal humidity 0 decimals
-  snprintf(buf, sizeof(buf), "%.0f", test_hum_int);
-  b += "&field3=" + urlEncode(String(buf));
+  sink_jsonFields(json, r.fields);
+  json += ",\"field8\":";
+  sink_jsonString(json, ts_recordCoords(r).c_str());
+  json += '}';
+}
 
-  // field4: external temp 1 decimal
-  snprintf(buf, sizeof(buf), "%.1f", test_temp_ext);
-  b += "&field4=" + urlEncode(String(buf));
+// One sample as an /update form body
+static void appendSingle(String &post, const SampleRecord &r) {
+  char ts[24];
+  post += "api_key=";
+  post += THINGSPEAK_WRITE_APIKEY;
+  if (sink_isoTime(r, ts)) {
+    post += "&created_at=";
+    post += ts;
+  }
+  if (r.fields[0]) { post += "&"; post += r.fields; }
+  post += "&field8=";
+  post += urlEncode(ts_recordCoords(r));
+}
 
-  // field5: external humidity 0 decimals
-  snprintf(buf, sizeof(buf), "%.0f", test_hum_ext);
-  b += "&field5=" + urlEncode(String(buf));
+static bool ts_enabled() { return strlen(THINGSPEAK_WRITE_APIKEY) > 0; }
 
-  // field6: pressure 0 decimals
-  snprintf(buf, sizeof(buf), "%.0f", test_pressure);
-  b += "&field6=" + urlEncode(String(buf));
+static void ts_begin(String &out) {
+  if (!TS_BULK) return;
+  out += "{\"write_api_key\":\"";
+  out += THINGSPEAK_WRITE_APIKEY;
+  out += "\",\"updates\":[";
+}
 
-  // field7: battery voltage 2 decimals
-  snprintf(buf, sizeof(buf), "%.2f", test_batt_voltage);
-  b += "&field7=" + urlEncode(String(buf));
+static void ts_encode(String &out, const SampleRecord &r, int n) {
+  if (!TS_BULK) { appendSingle(out, r); return; }
+  if (n) out += ',';
+  appendBulkEntry(out, r);
+}
 
-  return sendToThingSpeak(b);
+static void ts_end(String &out) {
+  if (TS_BULK) out += "]}";
 }
 
-// Attempt to flush queued posts from SD. Only runs when WiFi is connected.
-void retryQueuedThingSpeak() {
-  if (WiFi.status() != WL_CONNECTED) return;
-  if (!SD.begin(SD_CS)) {
-#if ENABLE_DEBUG
-    Serial.println("[TS] SD.begin failed - cannot retry queue");
-#endif
-    return;
+static bool ts_send(const HttpTransport &tp, const String &body, HttpResponse &resp) {
+  char url[96];
+  if (TS_BULK) {
+    snprintf(url, sizeof(url), "http://api.thingspeak.com/channels/%lu/bulk_update.json",
+             (unsigned long)THINGSPEAK_CHANNEL_ID);
+  } else {
+    snprintf(url, sizeof(url), "http://api.thingspeak.com/update");
   }
+  HttpRequest req = { "POST", url, TS_BULK ? "application/json" : "application/x-www-form-urlencoded",
+                      body.c_str(), body.length(), 20000 };
+  return tp.perform(req, resp);
+}
 
-  File f = SD.open(TS_QUEUE_FILENAME, FILE_READ);
-  if (!f) return;  // nothing to do
+// bulk: 202 Accepted {"success":true}; /update: the new entry id (0 = rejected)
+static bool ts_ack(const HttpResponse &resp, int) {
+  if (TS_BULK) return (resp.status == 200 || resp.status == 202) && strstr(resp.body, "true");
+  return resp.status == 200 && atol(resp.body) > 0;
+}
 
-  // Read all lines into memory (small queue expected). Keep lines that fail.
-  std::vector<String> remaining;
+// Lines left in the old one-post-per-line queue file are moved over once.
+static void ts_opened(SegQueue &q) {
+  static const char *REST = "/ts_queue.rest";
+  // a reset between the remove and the rename below
+  if (!SD.exists(TS_QUEUE_FILENAME) && SD.exists(REST)) SD.rename(REST, TS_QUEUE_FILENAME);
+  File f = SD.open(TS_QUEUE_FILENAME, FILE_READ);
+  if (!f) return;
+  uint32_t moved = 0, left = 0;
+  bool rest_ok = true;
+  File rest;
   while (f.available()) {
     String line = f.readStringUntil('\n');
     line.trim();
-    if (line.length() == 0) continue;
-    // attempt send
-    bool ok = sendToThingSpeak(line);
-    if (!ok) {
-      remaining.push_back(line);
-      // if send failed, we stop further sends to avoid hammering; break to rewrite remaining
-      break;
+    if (!line.length()) continue;
+    // after the first failure keep the order: the rest stays in the file
+    if (!left && sq_push(q, line.c_str(), line.length())) {
+      moved++;
+      continue;
     }
-    // success -> continue with next
+    if (!left) rest = SD.open(REST, FILE_WRITE);
+    left++;
+    rest_ok = rest_ok && rest && rest.println(line) == line.length() + 2;
   }
   f.close();
+  if (rest) rest.close();
 
-  // Rewrite queue file with remaining entries
-  if (remaining.empty()) {
+  // Only what was moved may go: the file shrinks to the lines left over.
+  // If that cannot be written, keep it whole (lines moved already are
+  // sent twice, which beats losing the others).
+  if (!left) {
     SD.remove(TS_QUEUE_FILENAME);
-#if ENABLE_DEBUG
-    Serial.println("[TS] queue flushed");
-#endif
+  } else if (rest_ok) {
+    SD.remove(TS_QUEUE_FILENAME);
+    SD.rename(REST, TS_QUEUE_FILENAME);
   } else {
-    File fw = SD.open(TS_QUEUE_FILENAME, FILE_WRITE);
-    if (fw) {
-      fw.seek(0);
-      for (auto &ln : remaining) {
-        fw.println(ln);
-      }
-      fw.close();
-    }
+    SD.remove(REST);
   }
-}
\ No newline at end of file
+#if ENABLE_DEBUG
+  Serial.printf("[TS] moved %lu lines from %s into the upload queue, %lu left there\n",
+                (unsigned long)moved, TS_QUEUE_FILENAME, (unsigned long)left);
+#endif
+}
+
+const TelemetrySink SINK_THINGSPEAK = {
+  "thingspeak",
+  TS_QUEUE_DIR,
+  TS_BULK ? TS_BULK_MAX_ENTRIES : 1,
+  TS_BULK_MAX_BYTES,
+  TS_BULK_MIN_INTERVAL_MS,
+  ts_enabled,
+  ts_begin,
+  ts_encode,
+  ts_end,
+  ts_send,
+  ts_ack,
+  nullptr,
+  ts_opened,
+};
@@ -1,24 +1,32 @@
 #pragma once
 #include <Arduino.h>
+#include "telemetry.h"
+#include "telemetry_sink.h"
 
 // ThingSpeak client API
 bool initThingSpeakClient();
 
-// Send telemetry bodyPairs (e.g. "field1=23.5&field2=60.0").
-// This function implements WiFi-first policy: if WiFi is available it will
-// POST immediately, otherwise it will try to auto-connect to known WiFi and
-// if still unavailable it will enqueue the body for later retry (SD card).
+// Publish one sample, bodyPairs (e.g. "field1=23.5&field2=60.0"), stamped
+// with capture time and location, to every sink (telemetry_sink.h), then
+// send what the bearer allows right away (trying known WiFi briefly when
+// nothing is up and LTE is not preferred). Returns true when every sink
+// has delivered everything queued; the rest follows from the queues.
 bool sendToThingSpeak(const String &bodyPairs);
 
-// Upload the current telemetry using the project's global test_* variables
-// (used by loop()). Returns true on immediate success.
+// Upload the current telemetry snapshot (used by loop()).
+// Returns true on immediate success.
 bool thingspeak_upload_current();
 
-// Attempt to flush queued posts (will only try when WiFi is connected).
-void retryQueuedThingSpeak();
+// Build "field1=..&field2=.." (fields 1..7) from one snapshot; fields that
+// are not valid in the snapshot are left out.
+String thingspeak_buildBodyPairs(const TelemetrySnapshot &t);
+
+// ThingSpeak as an upload sink: bulk_update.json batches of up to
+// TS_BULK_MAX_ENTRIES samples with their created_at, queued in TS_QUEUE_DIR.
+extern const TelemetrySink SINK_THINGSPEAK;
 
 // Post via modem/LTE (returns true on success)
 bool thingspeak_post_via_modem(const String &postBody);
 
-// Filename on SD for queued ThingSpeak posts (one per line)
+// Old one-line-per-post queue file, moved into the queue on first use
 static const char *TS_QUEUE_FILENAME = "/ts_queue.txt";
\ No newline at end of file
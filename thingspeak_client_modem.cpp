@@ -1,82 +1,57 @@
 #include "thingspeak_client.h"
 #include "config.h"
 #include "modem_manager.h"
-#include <TinyGsmClient.h>
+#include "http_pool.h"
+#include "http_transport.h"
 #include <WebServer.h>
 
 extern WebServer server;
 extern void menuUpdate(); // Keep keyboard responsive
 
+// Runs between socket reads while waiting for the response
+static void ts_modemIdle() {
+  server.handleClient();  // Keep web server responsive
+  menuUpdate();           // Keep keyboard responsive!
+}
+
 // Exposed function used by serial command handler to POST via modem.
 // Returns true on success (ThingSpeak returns numeric id > 0).
 bool thingspeak_post_via_modem(const String &postBody) {
-  TinyGsm &modem = modem_get();
-  TinyGsmClient client(modem);
-  client.setTimeout(15000); // 15s
-
   #if ENABLE_DEBUG
-    Serial.println("[TS-MODEM] Connecting to api.thingspeak.com:80 ...");
+    Serial.println("[TS-MODEM] POST api.thingspeak.com/update ...");
   #endif
 
-  if (!client.connect("api.thingspeak.com", 80)) {
-    #if ENABLE_DEBUG
-      Serial.println("[TS-MODEM] client.connect failed");
-    #endif
-    return false;
-  }
-
-  // build HTTP POST request
-  String req;
-  req.reserve(postBody.length() + 200);
-  req  = String("POST /update HTTP/1.1\r\n");
-  req += String("Host: api.thingspeak.com\r\n");
-  req += String("Content-Type: application/x-www-form-urlencoded\r\n");
-  req += String("Content-Length: ") + String(postBody.length()) + String("\r\n");
-  req += String("Connection: close\r\n\r\n");
-  req += postBody;
-
-  client.print(req);
-
-  #if ENABLE_DEBUG
-    Serial.println("[TS-MODEM] Sent HTTP POST, waiting for response...");
-  #endif
-
-  unsigned long start = millis();
-  String resp;
-  while (millis() - start < 15000) { // Increased timeout to 15s
-    if (client.available()) {
-      char c = client.read();
-      resp += c;
-      if (resp.length() > 4096) break;
-    } else {
-      if (!client.connected()) break; // Stop if server closed connection
-      delay(10);
-    }
-    
-    server.handleClient();  // Keep web server responsive
-    menuUpdate();           // Keep keyboard responsive!
-  }
-
-  client.stop();
+  // ThingSpeak answers with the new entry id ("0" on failure): a small body.
+  // The connection stays open for the next upload (http_pool.h).
+  char body[32];
+  HttpResponse resp;
+  http_begin(resp, body, sizeof(body));
+#if THINGSPEAK_LTE_NATIVE_HTTP
+  // HTTPS done by the modem itself: one session per upload, TLS off the ESP32
+  HttpRequest req = { "POST", "https://api.thingspeak.com/update",
+                      "application/x-www-form-urlencoded",
+                      postBody.c_str(), postBody.length(), 15000 };
+  bool done = HTTP_MODEM.perform(req, resp) && resp.complete;
+#else
+  bool done = httpPool_request("POST", "api.thingspeak.com", 80, "/update",
+                               "application/x-www-form-urlencoded",
+                               postBody.c_str(), postBody.length(),
+                               resp, 15000, ts_modemIdle);   // 15s without data
+#endif
 
   #if ENABLE_DEBUG
-    if (resp.length()) {
-      Serial.print("[TS-MODEM] HTTP response (truncated 1024): ");
-      if (resp.length() > 1024) Serial.println(resp.substring(0,1024));
-      else Serial.println(resp);
+    if (resp.status) {
+      Serial.printf("[TS-MODEM] HTTP %d, body: %s%s\n", resp.status, body, resp.truncated ? "..." : "");
     } else {
       Serial.println("[TS-MODEM] HTTP response empty");
     }
   #endif
 
   // Check HTTP status (200) and parse body for numeric id
-  if (resp.indexOf("HTTP/1.1 200") >= 0 || resp.indexOf("HTTP/1.0 200") >= 0) {
-    int pos = resp.lastIndexOf("\r\n\r\n");
-    String body = (pos >= 0) ? resp.substring(pos + 4) : resp;
-    body.trim();
-    long vid = body.toInt();
+  if (done && resp.status == 200) {
+    long vid = atol(body);
     return (vid > 0);
   }
 
   return false;
-}
\ No newline at end of file
+}
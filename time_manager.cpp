@@ -1,7 +1,9 @@
 #include "time_manager.h"
 #include "modem_manager.h"
+#include "at_engine.h"
 #include "config.h"
 #include <WiFi.h>
+#include <Preferences.h>
 #include <time.h>
 
 // ---------------------------------------------------------
@@ -10,6 +12,7 @@
 enum TimeState {
   TS_IDLE,
   TS_LTE_CHECK,
+  TS_LTE_WAIT,
   TS_WIFI_SCAN,
   TS_WIFI_CONNECTING,
   TS_NTP_REQUEST,
@@ -24,6 +27,19 @@ static int          attempt     = 0;
 static bool        time_valid   = false;
 static TimeSource  time_source  = TSRC_NONE;
 
+// Boot id (NVS counter) and this boot's anchor: the epoch at millis() == 0,
+// saved once the clock is valid so samples stamped only with boot id +
+// uptime can be dated later, even after the next reset.
+static uint32_t    boot_id      = 0;
+static bool        anchor_saved = false;
+static const char *PREF_TIME_NS = "beehive_time";
+
+// +CCLK? runs through the AT engine; the callbacks fill these
+static bool        cclk_done    = false;
+static bool        cclk_ok      = false;
+static struct tm   cclk_tm;
+static volatile bool net_time_urc = false;   // network sent a time zone/time update
+
 // ---------------------------------------------------------
 // WIFI HOTSPOTS (from your previous working setup)
 // ---------------------------------------------------------
@@ -39,6 +55,34 @@ static const char* hotspot_pass[] = {
   nullptr
 };
 
+// ---------------------------------------------------------
+// LTE TIME (AT engine callbacks)
+// ---------------------------------------------------------
+// +CCLK: "yy/MM/dd,hh:mm:ss±zz"  (local time, zone in quarter hours)
+static void onCclkLine(const char *line, void *) {
+  int y, M, d, h, m, s;
+  if (sscanf(line, "+CCLK: \"%d/%d/%d,%d:%d:%d", &y, &M, &d, &h, &m, &s) != 6) return;
+  if (y < 24 || y >= 80) return;   // RTC not set by the network yet (80/01/06...)
+  memset(&cclk_tm, 0, sizeof(cclk_tm));
+  cclk_tm.tm_year  = 2000 + y - 1900;
+  cclk_tm.tm_mon   = M - 1;
+  cclk_tm.tm_mday  = d;
+  cclk_tm.tm_hour  = h;
+  cclk_tm.tm_min   = m;
+  cclk_tm.tm_sec   = s;
+  cclk_tm.tm_isdst = -1;
+  cclk_ok = true;
+}
+
+static void onCclkDone(AtResult, const char *, void *) {
+  cclk_done = true;
+}
+
+// +CTZV / +CTZE / *PSUTTZ: the network pushed its time; read the RTC again
+static void onNetworkTime(const char *, uint32_t, void *) {
+  net_time_urc = true;
+}
+
 // ---------------------------------------------------------
 // INIT
 // ---------------------------------------------------------
@@ -46,11 +90,38 @@ void timeManager_init() {
   // Greece: GMT+2, DST +1
   configTime(2 * 3600, 3600, "pool.ntp.org", "time.google.com");
 
+  static bool subscribed = false;
+  if (!subscribed) {
+    subscribed = true;
+    at_subscribe("+CTZV:", onNetworkTime);
+    at_subscribe("+CTZE:", onNetworkTime);
+    at_subscribe("*PSUTTZ:", onNetworkTime);
+  }
+  at_submit("+CTZU=1", 1000);   // let the network set the modem RTC
+  at_submit("+CTZR=1", 1000);   // and tell us when it does
+
   state       = TS_LTE_CHECK;
   last_query  = 0;
   attempt     = 0;
   time_valid  = false;
   time_source = TSRC_NONE;
+
+  if (!boot_id) {
+    Preferences p;
+    p.begin(PREF_TIME_NS, false);
+    boot_id = p.getUInt("boot_id", 0) + 1;
+    p.putUInt("boot_id", boot_id);
+    p.end();
+  }
+}
+
+static void saveAnchor() {
+  anchor_saved = true;
+  Preferences p;
+  p.begin(PREF_TIME_NS, false);
+  p.putUInt("anchor_boot", boot_id);
+  p.putUInt("anchor_epoch", (uint32_t)(time(nullptr) - (time_t)(millis() / 1000UL)));
+  p.end();
 }
 
 // ---------------------------------------------------------
@@ -76,47 +147,45 @@ static bool tryConnectToWifi() {
 // UPDATE
 // ---------------------------------------------------------
 void timeManager_update() {
-  if (time_valid) return;
+  if (time_valid && !anchor_saved) saveAnchor();
+  if (net_time_urc && state != TS_LTE_WAIT) {
+    net_time_urc = false;
+    state        = TS_LTE_CHECK;
+    last_query   = 0;
+  }
+  if (time_valid && state == TS_DONE) return;
 
   unsigned long now = millis();
 
   switch (state) {
     case TS_LTE_CHECK:
     {
-      if (now - last_query < 3000) return;
+      if (last_query && now - last_query < 3000) return;
       last_query = now;
 
-      TinyGsm& modem = modem_get();
-
-      modem.sendAT("+CCLK?");
-      String resp = modem.stream.readString();
-
-      if (resp.indexOf("+CCLK:") >= 0) {
-        int y, M, d, h, m, s, tz;
-        if (sscanf(resp.c_str(),
-                   "*+CCLK: \"%d/%d/%d,%d:%d:%d+%d",
-                   &y, &M, &d, &h, &m, &s, &tz) == 7) {
-          struct tm t;
-          t.tm_year = 2000 + y - 1900;
-          t.tm_mon  = M - 1;
-          t.tm_mday = d;
-          t.tm_hour = h;
-          t.tm_min  = m;
-          t.tm_sec  = s;
-
-          time_t tt = mktime(&t);
-          struct timeval tv = { tt, 0 };
-          settimeofday(&tv, nullptr);
-
-          time_valid  = true;
-          time_source = TSRC_LTE;
-          state       = TS_DONE;
-          break;
-        }
+      cclk_done = false;
+      cclk_ok   = false;
+      if (at_submit("+CCLK?", 1000, onCclkLine, onCclkDone)) state = TS_LTE_WAIT;
+      break;
+    }
+
+    case TS_LTE_WAIT:
+    {
+      if (!cclk_done) return;
+
+      if (cclk_ok) {
+        time_t tt = mktime(&cclk_tm);
+        struct timeval tv = { tt, 0 };
+        settimeofday(&tv, nullptr);
+
+        time_valid  = true;
+        time_source = TSRC_LTE;
+        state       = TS_DONE;
+        break;
       }
 
-      // If LTE time failed → fallback to WiFi NTP
-      state = TS_WIFI_SCAN;
+      // If LTE time failed → fallback to WiFi NTP (unless we already have time)
+      state = time_valid ? TS_DONE : TS_WIFI_SCAN;
       break;
     }
 
@@ -201,3 +270,22 @@ String timeManager_getTime() {
 TimeSource timeManager_getSource() {
   return time_source;
 }
+
+uint32_t timeManager_bootId() {
+  return boot_id;
+}
+
+bool timeManager_epochAt(uint32_t boot, uint32_t uptime_ms, time_t &out) {
+  if (boot == boot_id && time_valid) {
+    out = time(nullptr) - (time_t)((millis() - uptime_ms) / 1000UL);
+    return true;
+  }
+  Preferences p;
+  p.begin(PREF_TIME_NS, true);
+  uint32_t ab = p.getUInt("anchor_boot", 0);
+  uint32_t ae = p.getUInt("anchor_epoch", 0);
+  p.end();
+  if (!ab || ab != boot || !ae) return false;
+  out = (time_t)ae + (time_t)(uptime_ms / 1000UL);
+  return true;
+}
@@ -16,4 +16,11 @@ String timeManager_getDate();   // local, DD-MM-YYYY
 String timeManager_getTime();   // local, HH:MM:SS
 TimeSource timeManager_getSource();
 
+// Boot id: counts resets (NVS). Samples taken before the clock was valid
+// are stamped with boot id + millis() and dated afterwards: within this
+// boot from the current clock, for the last boot that got a valid clock
+// from its saved anchor. Returns false if the time cannot be recovered.
+uint32_t timeManager_bootId();
+bool   timeManager_epochAt(uint32_t boot_id, uint32_t uptime_ms, time_t &out);
+
 #endif
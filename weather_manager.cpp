@@ -4,15 +4,13 @@
 #include <Arduino.h>
 #include <Preferences.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <time.h>
 #include "time_manager.h"
 #include "modem_manager.h"
+#include "http_response.h"
+#include "http_transport.h"
 
-// For LTE weather fetching
-// For LTE weather fetching
-// TinyGsmClient.h is already included in modem_manager.h with correct defines
 // extern TinyGsm modem;  // This is wrong, use modem_get()
 
 Preferences prefs;
@@ -54,6 +52,23 @@ static String urlEncode(const String &str) {
   return encoded;
 }
 
+// GET url over the given bearer into a malloc'd buffer (caller frees).
+// Returns the HTTP status, 0 if no response came back.
+static int weather_httpGet(const HttpTransport &tp, const String &url, size_t cap,
+                           char *&body, size_t &len) {
+  body = (char *)malloc(cap + 1);
+  len = 0;
+  if (!body) return 0;
+  HttpResponse resp;
+  http_begin(resp, body, cap + 1);
+  HttpRequest req = { "GET", url.c_str(), nullptr, nullptr, 0, 15000 };
+  Serial.printf("[Weather] GET via %s\n", tp.name);
+  if (!tp.perform(req, resp)) return 0;
+  if (resp.truncated) Serial.println("[Weather] Body too large, cut");
+  len = resp.body_len;
+  return resp.status;
+}
+
 void weather_init() {
   prefs.begin(PREF_NS, false);
   String latS = prefs.getString(PREF_KEY_LAT, "");
@@ -137,30 +152,30 @@ bool weather_geocodeLocation(const char* city, const char* countryCode) {
   Serial.print("[Weather] Geocode (OpenMeteo) -> ");
   Serial.println(url);
 
-  if (WiFi.status() != WL_CONNECTED) {
-    s_lastError = "WiFi not connected";
-    Serial.println("[Weather] Geocode failed: WiFi not connected");
+  const HttpTransport *tp = http_pickTransport();
+  if (!tp) {
+    s_lastError = "No network";
+    Serial.println("[Weather] Geocode failed: no WiFi and no LTE");
     return false;
   }
 
-  HTTPClient http;
-  http.begin(url);
-  int code = http.GET();
-  String body;
-  if (code > 0) body = http.getString();
-  http.end();
+  char *body;
+  size_t len;
+  int code = weather_httpGet(*tp, url, 8 * 1024, body, len);
 
   if (code != 200) {
-    s_lastError = String("HTTP_") + String(code) + ": " + body;
+    s_lastError = String("HTTP_") + String(code) + ": " + String(body ? body : "");
     Serial.print("[Weather] Geocode failed: ");
     Serial.println(s_lastError);
+    free(body);
     return false;
   }
 
-  // Parse JSON with ArduinoJson v7 API
+  // Parse JSON with ArduinoJson v7 API (const input: strings are copied)
   const size_t CAP = 10 * 1024;
   DynamicJsonDocument doc(CAP);
-  DeserializationError derr = deserializeJson(doc, body);
+  DeserializationError derr = deserializeJson(doc, (const char *)body, len);
+  free(body);
   if (derr) {
     s_lastError = "JSON parse error";
     Serial.print("[Weather] Geocode JSON parse failed: ");
@@ -209,7 +224,7 @@ bool weather_geocodeLocation(const char* city, const char* countryCode) {
 }
 
 // Fetch Open-Meteo forecast: hourly arrays, sample every 6 hours for next 72h
-static bool weather_fetch_open_meteo() {
+static bool weather_fetch_open_meteo(const HttpTransport &tp) {
   Serial.println("[Weather] weather_fetch_open_meteo() ENTER");
   
   // include humidity and surface_pressure in hourly arrays
@@ -219,42 +234,26 @@ static bool weather_fetch_open_meteo() {
 
   Serial.print("[Weather] OpenMeteo Request URL: ");
   Serial.println(url);
-  Serial.print("[Weather] WiFi status: ");
-  Serial.println(WiFi.status());
-
-  if (WiFi.status() != WL_CONNECTED) {
-    s_lastError = "WiFi not connected";
-    Serial.println("[Weather] OpenMeteo fetch SKIPPED: WiFi not connected (LTE mode?)");
-    Serial.println("[Weather] weather_fetch_open_meteo() EXIT (no WiFi)");
-    return false;
-  }
-  
-  Serial.println("[Weather] WiFi connected, proceeding with HTTP request...");
-
-  Serial.println("[Weather] Starting HTTPClient.GET() - THIS MAY BLOCK");
-  HTTPClient http;
-  http.begin(url);
-  http.setTimeout(10000);  // 10 second timeout
-  int code = http.GET();
-  Serial.print("[Weather] HTTPClient.GET() completed, code=");
+  char *body;
+  size_t len;
+  int code = weather_httpGet(tp, url, 30000, body, len);
+  Serial.print("[Weather] HTTP request complete, code=");
   Serial.println(code);
-  String body;
-  if (code > 0) body = http.getString();
-  http.end();
-  Serial.println("[Weather] HTTP request complete");
 
   if (code != 200) {
-    s_lastError = String("HTTP_") + String(code) + ": " + body;
+    s_lastError = String("HTTP_") + String(code);
     Serial.print("[Weather] OpenMeteo HTTP fail: ");
     Serial.println(s_lastError);
-    Serial.println(body.substring(0, min((int)body.length(), 512)));
+    if (body && len) Serial.println(String(body).substring(0, 512));
+    free(body);
     return false;
   }
 
-  // Parse JSON
+  // Parse JSON (const input: the document copies its strings, the body can go)
   const size_t CAP = 28 * 1024; // adjust if memory issues appear
   DynamicJsonDocument doc(CAP);
-  DeserializationError derr = deserializeJson(doc, body);
+  DeserializationError derr = deserializeJson(doc, (const char *)body, len);
+  free(body);
   if (derr) {
     s_lastError = "JSON parse failed";
     Serial.print("[Weather] OpenMeteo JSON parse failed: ");
@@ -355,276 +354,28 @@ static bool weather_fetch_open_meteo() {
   return true;
 }
 
-// Fetch weather via LTE modem using TinyGSM HTTP client
-static bool weather_fetch_via_lte() {
-  Serial.println("[Weather] weather_fetch_via_lte() ENTER");
-  
-  if (!modem_isNetworkRegistered()) {
-    s_lastError = "LTE not registered";
-    Serial.println("[Weather] LTE not registered");
-    return false;
-  }
-  
-  // Build URL (use HTTPS for LTE)
-  String url = String("https://api.open-meteo.com/v1/forecast?latitude=")
-    + String(s_lat, 6) + "&longitude=" + String(s_lon, 6)
-    + "&hourly=temperature_2m,weathercode,relativehumidity_2m,surface_pressure&forecast_days=3&timezone=auto";
-  
-  Serial.print("[Weather] LTE Request URL: ");
-  Serial.println(url);
-  
-  // Parse URL for TinyGSM
-  String urlStr = String(url);
-  int hostStart = urlStr.indexOf("//") + 2;
-  int pathStart = urlStr.indexOf("/", hostStart);
-  String host = urlStr.substring(hostStart, pathStart);
-  String path = urlStr.substring(pathStart);
-  
-  Serial.print("[Weather] Host: ");
-  Serial.println(host);
-  Serial.print("[Weather] Path: ");
-  Serial.println(path);
-  
-  // Get modem instance and create client (Standard client, we will enable SSL manually)
-  TinyGsm& modem = modem_get();
-  TinyGsmClient client(modem);
-  
-  // Connect to server
-  Serial.println("[Weather] Connecting to server via LTE (HTTPS Manual)...");
-  
-  // Debug signal quality
-  int csq = modem.getSignalQuality();
-  Serial.print("[Weather] Signal Quality (CSQ): ");
-  Serial.println(csq);
-  
-  // Ensure GPRS is connected
-  if (!modem.isGprsConnected()) {
-    Serial.println("[Weather] GPRS not connected, attempting to connect...");
-    if (!modem.gprsConnect(MODEM_APN)) {
-       Serial.println("[Weather] GPRS connect failed");
-       s_lastError = "GPRS connect failed";
-       return false;
-    }
-    Serial.println("[Weather] GPRS connected");
-  }
-  
-  // MANUAL SSL ENABLE FOR A7670/SIM7600
-  // This tells the modem to use SSL for the next TCP connection
-  Serial.println("[Weather] Enabling SSL (AT+CIPSSL=1)...");
-  
-  // Configure SSL context 0 to use TLS 1.2 (3) or ANY (0)
-  // A7670 might need this
-  modem.sendAT("+CSSLCFG=\"sslversion\",0,3"); 
-  modem.waitResponse();
-  
-  modem.sendAT("+CIPSSL=1");
-  if (modem.waitResponse() != 1) {
-     Serial.println("[Weather] Warning: AT+CIPSSL=1 failed or ignored");
-  }
-  
-  // Connect to port 443 for HTTPS
-  if (!client.connect(host.c_str(), 443)) {
-    s_lastError = "LTE HTTPS connect failed";
-    Serial.println("[Weather] LTE HTTPS connection to server failed");
-    return false;
-  }
-  
-  Serial.println("[Weather] Connected, sending HTTP GET...");
-  
-  // Send HTTP GET request
-  client.print(String("GET ") + path + " HTTP/1.1\r\n");
-  client.print(String("Host: ") + host + "\r\n");
-  client.print("Connection: close\r\n\r\n");
-  
-  // Wait for response
-  unsigned long timeout = millis();
-  while (client.connected() && millis() - timeout < 15000) {
-    if (client.available()) break;
-    delay(10);
-  }
-  
-  if (!client.available()) {
-    s_lastError = "LTE timeout";
-    Serial.println("[Weather] LTE response timeout");
-    client.stop();
-    return false;
-  }
-  
-  Serial.println("[Weather] Reading response headers...");
-  
-  // Skip HTTP headers - look for empty line (just \r\n)
-  bool headersEnd = false;
-  String line;
-  while (client.connected() || client.available()) {
-    if (!client.available()) {
-      delay(10);
-      continue;
-    }
-    
-    line = client.readStringUntil('\n');
-    line.trim();  // Remove \r and whitespace
-    
-    Serial.print("[Weather] Header: ");
-    Serial.println(line.length() == 0 ? "(empty - end of headers)" : line.substring(0, min(50, (int)line.length())));
-    
-    if (line.length() == 0) {
-      // Empty line = end of headers
-      headersEnd = true;
-      break;
-    }
-  }
-  
-  if (!headersEnd) {
-    s_lastError = "Invalid HTTP response";
-    Serial.println("[Weather] Invalid HTTP response - headers not found");
-    client.stop();
-    return false;
-  }
-  
-  // Read JSON body
-  Serial.println("[Weather] Reading JSON body...");
-  String body = "";
-  body.reserve(4096);  // Pre-allocate for efficiency
-  
-  while (client.connected() || client.available()) {
-    if (client.available()) {
-      char c = client.read();
-      body += c;
-    } else {
-      delay(10);
-    }
-    
-    // Safety check - stop if body gets too large
-    if (body.length() > 30000) {
-      Serial.println("[Weather] Body too large, stopping read");
-      break;
-    }
-  }
-  
-  client.stop();
-  
-  Serial.print("[Weather] JSON length: ");
-  Serial.println(body.length());
-  
-  if (body.length() < 100) {
-    s_lastError = "Empty response";
-    Serial.println("[Weather] Response too short");
-    return false;
-  }
-  
-  // Parse JSON (same as WiFi version)
-  const size_t CAP = 28 * 1024;
-  DynamicJsonDocument doc(CAP);
-  DeserializationError derr = deserializeJson(doc, body);
-  
-  if (derr) {
-    s_lastError = String("JSON parse: ") + String(derr.c_str());
-    Serial.print("[Weather] JSON parse error: ");
-    Serial.println(derr.c_str());
-    return false;
-  }
-  
-  // Parse hourly data (same logic as WiFi version)
-  JsonObject hourly = doc["hourly"];
-  if (!hourly) {
-    s_lastError = "No hourly data";
-    Serial.println("[Weather] No hourly object");
-    return false;
-  }
-  
-  JsonArray times = hourly["time"];
-  JsonArray temps = hourly["temperature_2m"];
-  JsonArray codes = hourly["weathercode"];
-  JsonArray hums  = hourly["relativehumidity_2m"];
-  JsonArray press = hourly["surface_pressure"];
-  
-  if (!times || !temps || !codes) {
-    s_lastError = "Missing arrays";
-    Serial.println("[Weather] Missing required arrays");
-    return false;
-  }
-  
-  int total = times.size();
-  Serial.print("[Weather] Total hourly samples: ");
-  Serial.println(total);
-  
-  if (total == 0) {
-    s_lastError = "No samples";
-    return false;
-  }
-  
-  // Sample every 6 hours
-  const int maxSamples = 12;
-  if (s_days) delete[] s_days;
-  s_days = new WeatherDay[maxSamples];
-  s_daysCount = 0;
-  
-  int samples = 0;
-  for (int i = 0; i < total && samples < maxSamples; i += 6) {
-    const char* tstr = times[i];
-    double temp = temps[i];
-    int wc = codes[i];
-    double hum = (hums && i < (int)hums.size()) ? (double)hums[i] : NAN;
-    double pr  = (press && i < (int)press.size()) ? (double)press[i] : NAN;
-    
-    if (!tstr) continue;
-    
-    char dbuf[32];
-    snprintf(dbuf, sizeof(dbuf), "%s", tstr);
-    s_days[samples].date = String(dbuf);
-    s_days[samples].temp_min = (float)temp;
-    s_days[samples].temp_max = (float)temp;
-    s_days[samples].humidity = isnan(hum) ? 0.0f : (float)hum;
-    s_days[samples].pressure = isnan(pr) ? 0.0f : (float)pr;
-    s_days[samples].desc = mapWeatherCodeOpenMeteo(wc);
-    samples++;
-  }
-  
-  if (samples == 0) {
-    s_lastError = "No samples parsed";
-    Serial.println("[Weather] No samples parsed");
-    delete[] s_days;
-    s_days = nullptr;
-    s_daysCount = 0;
-    s_hasData = false;
-    return false;
-  }
-  
-  s_daysCount = samples;
-  s_hasData = true;
-  Serial.print("[Weather] LTE fetch successful, samples=");
-  Serial.println(s_daysCount);
-  return true;
-}
-
 bool weather_fetch() {
 #if USE_OPENMETEO
-  // Check which network is active and choose appropriate method
-  bool wifiOK = (WiFi.status() == WL_CONNECTED);
-  
+  // WiFi if it is up, else the modem's own HTTPS client over LTE
+  const HttpTransport *tp = http_pickTransport();
+
   Serial.println("[Weather] weather_fetch() called");
-  Serial.print("[Weather] WiFi: ");
-  Serial.println(wifiOK ? "connected" : "disconnected");
-  
-  if (wifiOK) {
-    // Only use WiFi for weather fetch
-    Serial.println("[Weather] Using WiFi for weather fetch");
-    bool success = weather_fetch_open_meteo();
-    
-    if (success) {
-      Serial.print("[Weather] Fetch successful, ");
-      Serial.print(s_daysCount);
-      Serial.println(" samples");
-    } else {
-      Serial.print("[Weather] Fetch failed: ");
-      Serial.println(s_lastError);
-    }
-    return success;
-  } else {
-    s_lastError = "WiFi not connected (LTE weather disabled)";
-    Serial.println("[Weather] WiFi not connected - skipping weather fetch");
+  if (!tp) {
+    s_lastError = "No network (WiFi down, LTE not registered)";
+    Serial.println("[Weather] No network - skipping weather fetch");
     return false;
   }
+
+  bool success = weather_fetch_open_meteo(*tp);
+  if (success) {
+    Serial.print("[Weather] Fetch successful, ");
+    Serial.print(s_daysCount);
+    Serial.println(" samples");
+  } else {
+    Serial.print("[Weather] Fetch failed: ");
+    Serial.println(s_lastError);
+  }
+  return success;
 #else
   s_lastError = "OpenMeteo disabled in config.h";
   Serial.println("[Weather] No provider enabled");